@@ -0,0 +1,92 @@
+#ifndef CLASS_ALLOCTRACK
+#define CLASS_ALLOCTRACK
+
+#include <atomic>
+#include <cstddef>
+
+//debug builds replace global new/delete with counting versions, release keeps the plain ones
+#ifdef DEBUG
+#define ALLOC_TRACKING 1
+#else
+#define ALLOC_TRACKING 0
+#endif
+#define ALLOC_MAX_THREADS 64 // threads past this share the last counter slot
+#define ALLOC_SAMPLE_SITES 256
+
+struct AllocCounters
+{
+    std::atomic<unsigned long long> allocs;
+    std::atomic<unsigned long long> frees;
+    std::atomic<unsigned long long> bytes; // requested bytes, frees are not sized
+};
+
+//caller address of sampled allocations
+struct AllocSite
+{
+    void *address;
+    unsigned int count;
+};
+
+//counts heap allocations per thread and per frame of the main loop, the goal is a steady
+//state frame with zero allocations.  call sites can be sampled on one thread, addresses are
+//resolved offline (addr2line -f -e uwproj <address>)
+class AllocTracker
+{
+private:
+    AllocTracker();
+    static AllocTracker *m_Instance;
+
+    //main thread frame counts
+    unsigned long long m_FrameStartAllocs;
+    unsigned long long m_FrameStartBytes;
+    unsigned long long m_FrameStartTotal;
+    unsigned long long m_LastFrameAllocs;
+    unsigned long long m_LastFrameBytes;
+    unsigned long long m_LastFrameTotal; // all threads
+
+    //since last reset
+    int m_Frames;
+    int m_AllocFrames; // frames that allocated at all
+    unsigned long long m_MaxFrameAllocs;
+    unsigned long long m_SumFrameAllocs;
+
+public:
+    static AllocTracker *getInstance()
+    {
+        if(m_Instance == NULL) m_Instance = new AllocTracker;
+        return m_Instance;
+    }
+    ~AllocTracker();
+
+    //false in release, every count is zero then
+    static bool isEnabled() { return ALLOC_TRACKING != 0;}
+
+    //counters, these never allocate
+    static unsigned long long getThreadAllocs();
+    static unsigned long long getThreadBytes();
+    static unsigned long long getTotalAllocs();
+    static unsigned long long getTotalFrees();
+
+    void beginFrame();
+    void endFrame();
+    void reset();
+
+    unsigned long long getLastFrameAllocs() { return m_LastFrameAllocs;}
+    unsigned long long getLastFrameBytes() { return m_LastFrameBytes;}
+    unsigned long long getLastFrameTotalAllocs() { return m_LastFrameTotal;}
+    int getFrameCount() { return m_Frames;}
+    int getAllocFrameCount() { return m_AllocFrames;}
+    unsigned long long getMaxFrameAllocs() { return m_MaxFrameAllocs;}
+    float getAvgFrameAllocs() { return m_Frames ? float(m_SumFrameAllocs) / float(m_Frames) : 0.f;}
+
+    //sample every nth allocation of the calling thread, 0 turns sampling off
+    void setSampling(int samplerate);
+    int getSampleRate();
+    //most frequent sampled sites, returns number written
+    int getTopSites(AllocSite *tsites, int maxsites);
+    void clearSites();
+
+    void printStats();
+};
+
+#endif // CLASS_ALLOCTRACK
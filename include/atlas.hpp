@@ -0,0 +1,69 @@
+#ifndef CLASS_ATLAS
+#define CLASS_ATLAS
+
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_PADDING 2 // transparent pixels between regions (page pixels)
+
+//region of an atlas page
+struct AtlasRegion
+{
+    int page;
+    rect<s32> pixels; // for 2d drawing (source rect)
+    rect<f32> uv; // for 3d drawing (texture coords)
+};
+
+//named range of regions (one graphics file)
+struct AtlasSet
+{
+    std::string name;
+    int start;
+    int count;
+};
+
+//packs many small images into a few large texture pages.
+//images are added in sets (usually one .gr file each), then build() packs
+//everything at once using shelves and uploads the pages
+class TextureAtlas
+{
+private:
+
+    std::vector<ITexture*> m_Pages;
+    std::vector<AtlasRegion> m_Regions;
+    std::vector<AtlasSet> m_Sets;
+
+    //images waiting to be packed, indexed by region
+    std::vector<IImage*> m_Pending;
+
+    int m_PageSize;
+    int m_Scale;
+    std::string m_Name; // page texture name prefix
+
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+
+    void setName(std::string tname) { m_Name = tname;}
+
+    //add images to be packed, atlas grabs them, returns first region index
+    int addImageSet(std::string setname, std::vector<IImage*> *images);
+
+    //pack and upload all pending images scaled by tscale, returns page count
+    int build(IVideoDriver *driver, int tscale);
+
+    //regions
+    const AtlasRegion *getRegion(int index);
+    int getRegionCount() { return int(m_Regions.size());}
+    const AtlasSet *getSet(std::string setname);
+
+    //pages
+    ITexture *getPage(int page);
+    ITexture *getRegionTexture(int index);
+    int getPageCount() { return int(m_Pages.size());}
+};
+
+#endif // CLASS_ATLAS
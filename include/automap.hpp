@@ -0,0 +1,61 @@
+#ifndef CLASS_AUTOMAP
+#define CLASS_AUTOMAP
+
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define AUTOMAP_TILE_PIXELS 4 // target texels per tile, 64 tiles = 256 texels
+#define AUTOMAP_TILES_PER_FRAME 512 // revealed tiles drawn per frame, the rest wait
+#define AUTOMAP_REVEAL_RADIUS 1 // tiles around the player that get explored
+#define AUTOMAP_MAX_ZOOM 8
+
+class Level;
+
+//keeps the map of the current level in a render target.  only newly explored tiles are
+//drawn into it, opening the map just pans and scales the cached texture into the view
+class Automap
+{
+private:
+
+    IVideoDriver *m_Driver;
+    ITexture *m_Target;
+    Level *m_Level; // level the target shows
+    std::vector<vector2di> m_Pending; // explored but not drawn yet
+    bool m_Clear;
+
+    bool m_Open;
+    int m_Zoom; // screen pixels per target texel
+
+    //stats
+    int m_LastDrawCount;
+    int m_TotalDrawCount;
+
+    void drawTile(int x, int y);
+
+public:
+    Automap();
+    ~Automap();
+
+    //returns false if render targets are not supported, there is no map then
+    bool init(IVideoDriver *tdriver);
+    bool isValid() { return m_Target != NULL;}
+
+    //marks tiles around ttile explored, returns number newly revealed
+    int reveal(Level *tlevel, vector2di ttile);
+    //switches level if needed and draws pending tiles, returns number drawn
+    int update(Level *tlevel);
+    //draws the cached map into viewrect centered on a tile position
+    void draw(const rect<s32> &viewrect, vector2df center);
+
+    void setOpen(bool nopen) { m_Open = nopen;}
+    bool isOpen() { return m_Open;}
+    void zoom(int steps);
+    int getZoom() { return m_Zoom;}
+
+    int getPendingCount() { return int(m_Pending.size());}
+    int getLastDrawCount() { return m_LastDrawCount;}
+    int getTotalDrawCount() { return m_TotalDrawCount;}
+};
+
+#endif // CLASS_AUTOMAP
@@ -0,0 +1,94 @@
+#ifndef CLASS_BENCHMARK
+#define CLASS_BENCHMARK
+
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define BENCHMARK_DEFAULT_OUTPUT "benchmark.json"
+#define BENCHMARK_DEFAULT_WALK_SECONDS 20
+#define BENCHMARK_DEFAULT_PICKS 5000
+#define BENCHMARK_STEP_MS 16 // simulated frame time, so every run walks the same path
+#define BENCHMARK_SEED 1234
+
+enum _BENCHDRIVER{BENCHDRIVER_NULL, BENCHDRIVER_SOFTWARE};
+
+//forward declaration
+class Game;
+
+struct BenchmarkConfig
+{
+    bool enabled;
+    int driver; // _BENCHDRIVER
+    std::string outFile;
+    int walkSeconds; // 0 skips walk scenario
+    int pickCount; // 0 skips picking scenario
+    std::string recordFile; // record a demo while playing
+    std::string replayFile; // replay a demo, as a scenario when benchmarking
+    std::string traceFile; // trace from launch, written on exit
+    std::string captureDir; // world view captures are written here, empty skips capture scenario
+    std::string goldenDir; // captures are compared against images of the same name here
+    int captureTolerance; // per channel difference that still matches
+};
+
+struct BenchmarkValue
+{
+    std::string key;
+    double value;
+};
+
+//named group of values, written as a json object
+struct BenchmarkEntry
+{
+    std::string name;
+    std::vector<BenchmarkValue> values;
+
+    void setValue(std::string key, double value);
+    //count, avg, max and percentiles of samples (microseconds), keys are prefixed
+    void setSampleStats(std::string prefix, std::vector<u32> samples);
+};
+
+struct BenchmarkScenario : public BenchmarkEntry
+{
+    std::vector<BenchmarkEntry> entries;
+
+    BenchmarkEntry *addEntry(std::string name);
+};
+
+//headless benchmark, runs scripted scenarios against a loaded game and writes json timings
+class Benchmark
+{
+private:
+
+    Game *gptr;
+    BenchmarkConfig m_Config;
+
+    std::vector<BenchmarkScenario> m_Scenarios;
+    int m_CaptureFailures; // captures missing or not matching their golden image
+
+    void runStartup();
+    void runLevelGeometry();
+    void runCapture();
+    void runWalk();
+    void runPicking();
+    void runReplay();
+    void runMemory();
+
+public:
+    Benchmark(Game *ngame, const BenchmarkConfig &nconfig);
+    ~Benchmark();
+
+    static BenchmarkConfig getDefaultConfig();
+    //fill config from command line, returns -1 on bad arguments
+    static int parseArgs(int argc, char *argv[], BenchmarkConfig *tconfig);
+    static void printUsage();
+
+    //run all scenarios and write results, returns 0 on success, -2 if captures didn't match
+    int run();
+
+    BenchmarkScenario *addScenario(std::string name);
+    bool writeJSON(std::string tfilename);
+};
+
+#endif // CLASS_BENCHMARK
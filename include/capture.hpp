@@ -0,0 +1,27 @@
+#ifndef CLASS_CAPTURE
+#define CLASS_CAPTURE
+
+#include "irrcommon.hpp"
+
+#define CAPTURE_IMAGE_EXT ".png" // anything irrlicht can write and read back, .ppm works too
+#define CAPTURE_DEFAULT_TOLERANCE 8 // per channel difference that still counts as a match
+#define CAPTURE_MAX_BAD_FRACTION 0.001 // share of pixels allowed past the tolerance
+
+struct ImageCompareResult
+{
+    bool sizematch;
+    int badpixels; // pixels with any channel past the tolerance
+    int maxdiff; // largest channel difference
+    double meandiff; // average channel difference
+    bool passed;
+};
+
+//copy of part of the last rendered frame, caller drops it.  NULL if the driver can't
+//read back its frame (null driver)
+IImage *captureFrame(IVideoDriver *tdriver, const rect<s32> &trect);
+
+//compares rgb, alpha of a read back frame is meaningless.  tdiff, if given and the same
+//size, gets bad pixels in red over a dimmed copy of timage
+bool compareImages(IImage *timage, IImage *tgolden, int tolerance, ImageCompareResult *tresult, IImage *tdiff = NULL);
+
+#endif // CLASS_CAPTURE
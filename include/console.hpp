@@ -1,7 +1,11 @@
 #ifndef CLASS_CONSOLE
 #define CLASS_CONSOLE
 
+#include <functional>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "irrcommon.hpp"
 #include "game.hpp"
@@ -10,6 +14,24 @@
 class Game;
 class Scroll;
 
+//words[0] is the command name
+typedef std::function<void(const std::vector<std::string> &words)> ConsoleFunc;
+
+struct ConsoleCommand
+{
+    ConsoleFunc func;
+    std::string help;
+};
+
+//tunable engine value.  get / set go through strings so every type is handled the same,
+//the typed register functions do the conversion and range check
+struct ConsoleVar
+{
+    std::function<std::string()> get;
+    std::function<bool(const std::string &value)> set; // empty if read only
+    std::string help;
+};
+
 class Console
 {
 private:
@@ -20,6 +42,16 @@ private:
     Game *gptr;
     Scroll *m_Scroll;
 
+    //registry, names are also kept sorted for completion
+    std::unordered_map<std::string, ConsoleCommand> m_Commands;
+    std::unordered_map<std::string, ConsoleVar> m_Vars;
+    std::set<std::string> m_Names;
+    std::vector<std::string> m_Words; // reused by parse
+
+    void splitWords(const std::string &cmdstring, std::vector<std::string> *words);
+    void registerCommands();
+    void registerVars();
+
 public:
 
     static Console *getInstance()
@@ -33,6 +65,17 @@ public:
 
     void parse(std::string cmdstring);
 
+    //registering a name again replaces it
+    void registerCommand(std::string name, ConsoleFunc func, std::string help);
+    //an empty set function makes the value read only
+    void registerInt(std::string name, std::function<int()> get, std::function<void(int)> set, int minval, int maxval, std::string help);
+    void registerFloat(std::string name, std::function<f32()> get, std::function<void(f32)> set, f32 minval, f32 maxval, std::string help);
+    void registerBool(std::string name, std::function<bool()> get, std::function<void(bool)> set, std::string help);
+
+    //completes the command name being typed as far as it is unambiguous, matches gets
+    //every candidate.  returns number of candidates
+    int complete(std::string *tstring, std::vector<std::string> *matches);
+
     void addMessage(std::string msgstring, int fonttype = 0, SColor fcolor = SColor(255,255,255,255));
 };
 #endif // CLASS_CONSOLE
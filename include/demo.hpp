@@ -0,0 +1,87 @@
+#ifndef CLASS_DEMO
+#define CLASS_DEMO
+
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define DEMO_MAGIC "UWDM"
+#define DEMO_VERSION 1
+#define DEMO_TICK_MS 16 // fixed timestep while recording or replaying
+
+enum _DEMOSTATE{DEMO_IDLE, DEMO_RECORDING, DEMO_REPLAYING};
+enum _DEMOEVENT{DEMOEVENT_KEY, DEMOEVENT_MOUSE};
+
+//game state a demo starts from
+struct DemoStart
+{
+    int level;
+    vector3df position;
+    vector3df rotation;
+    vector3df velocity;
+    vector2di mousePosition;
+    vector2di lastTile;
+    int inputContext;
+};
+
+struct DemoTick
+{
+    std::vector<SEvent> events;
+    u32 checksum; // simulation state at end of tick
+};
+
+//per tick input capture.  every tick stores the key/mouse events drained that tick and a
+//checksum of the simulation state, replays feed the same events through the receiver and
+//compare checksums to catch divergence
+class Demo
+{
+private:
+
+    int m_State; // _DEMOSTATE
+    std::string m_Filename;
+
+    DemoStart m_Start;
+    std::vector<DemoTick> m_Ticks;
+    int m_TickIndex;
+
+    //replay verification
+    int m_Mismatches;
+    int m_FirstMismatch;
+
+public:
+    Demo();
+    ~Demo();
+
+    //recording, file is written when recording stops
+    bool startRecording(std::string tfilename, const DemoStart &tstart);
+    void recordEvent(const SEvent &tevent);
+
+    //replay
+    bool load(std::string tfilename);
+    bool startReplay();
+    const std::vector<SEvent> *getReplayEvents();
+
+    //close current tick, returns false once a replay has no ticks left
+    bool endTick(u32 checksum);
+    //stop recording (saves) or replay, returns false if saving failed
+    bool stop();
+
+    bool save(std::string tfilename);
+
+    int getState() { return m_State;}
+    bool isActive() { return m_State != DEMO_IDLE;}
+    bool isRecording() { return m_State == DEMO_RECORDING;}
+    bool isReplaying() { return m_State == DEMO_REPLAYING;}
+
+    const DemoStart *getStart() { return &m_Start;}
+    //simulated time since start of demo, in milliseconds
+    u32 getTickTime() { return u32(m_TickIndex) * DEMO_TICK_MS;}
+    int getTickIndex() { return m_TickIndex;}
+    int getTickCount() { return int(m_Ticks.size());}
+    int getMismatches() { return m_Mismatches;}
+    int getFirstMismatch() { return m_FirstMismatch;}
+    std::string getFilename() { return m_Filename;}
+};
+
+#endif // CLASS_DEMO
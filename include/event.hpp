@@ -5,6 +5,9 @@
 #include "irrcommon.hpp"
 
 #include "game.hpp"
+#include "eventqueue.hpp"
+
+#define EVENT_QUEUE_SIZE 256
 
 //forward declarations
 class Game;
@@ -14,7 +17,9 @@ class MyEventReceiver : public IEventReceiver
 
 private:
 
-    //std::vector<const SEvent*> eventque;
+    //events are queued by OnEvent and processed once per tick by drainEvents
+    SPSCQueue<SEvent, EVENT_QUEUE_SIZE> m_EventQueue;
+    std::atomic<int> m_DroppedEvents;
 
     bool Keys[KEY_KEY_CODES_COUNT];
 
@@ -26,43 +31,20 @@ public:
     // This is the one method that we have to implement
     bool OnEvent(const SEvent &event);
 
-    bool isKeyPressed(EKEY_CODE keycode){ return Keys[keycode]; }
-
-
-
-    /*
-    bool processEvents(const SEvent *&event)
-    {
-        //no events to process
-        if(eventque.empty()) return false;
-
-        //setting event pointer to first event in que
-        event = eventque[0];
-        //event = eventque.back();
+    //process all queued events, returns number of events processed
+    int drainEvents();
+    //process a single event as if it had been queued (demo replay)
+    void dispatchEvent(const SEvent &event);
+    //drop queued events during replay, escape still closes the device
+    int discardEvents();
+    //track key state only, for when the game is not ready to handle events (loading)
+    int skipEvents();
+    int getDroppedEvents() { return m_DroppedEvents.load();}
 
-        //removing processed event from que
-        eventque.erase(eventque.begin());
-
-        return true;
-    }
-    */
-
-
-/*
-    int queSize() { return int(eventque.size());}
-    void clearQue()
-    {
-        for(int i = 0; i < int(eventque.size()); i++) delete eventque[i];
-        eventque.clear();
-    }
-    bool getEvent(int eindex, const SEvent *event)
-    {
-        if(eindex < 0 || eindex >= int(eventque.size()) ) return false;
-
-        event = eventque[eindex];
-        return true;
-    }
-*/
+    bool isKeyPressed(EKEY_CODE keycode){ return Keys[keycode]; }
+    //scripted input (benchmarks)
+    void setKeyState(EKEY_CODE keycode, bool pressed) { Keys[keycode] = pressed;}
+    void clearKeys() { for(int i = 0; i < KEY_KEY_CODES_COUNT; i++) Keys[i] = false;}
 
 };
 
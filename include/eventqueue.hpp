@@ -0,0 +1,55 @@
+#ifndef CLASS_EVENTQUEUE
+#define CLASS_EVENTQUEUE
+
+#include <atomic>
+
+//fixed size lock-free queue for exactly one producer thread and one consumer thread.
+//the producer only writes the tail and the consumer only writes the head, so no locks
+//are needed. capacity must be a power of 2, one slot is always left empty.
+template <class T, unsigned int CAPACITY>
+class SPSCQueue
+{
+private:
+
+    static_assert( (CAPACITY & (CAPACITY - 1)) == 0, "SPSCQueue capacity must be a power of 2");
+
+    T m_Items[CAPACITY];
+
+    std::atomic<unsigned int> m_Head; // next item to pop, written by consumer
+    std::atomic<unsigned int> m_Tail; // next free slot, written by producer
+
+public:
+    SPSCQueue() : m_Head(0), m_Tail(0) {/* empty */}
+
+    //producer side, returns false if queue is full
+    bool push(const T &titem)
+    {
+        unsigned int tail = m_Tail.load(std::memory_order_relaxed);
+        unsigned int next = (tail + 1) & (CAPACITY - 1);
+
+        if(next == m_Head.load(std::memory_order_acquire)) return false; // full
+
+        m_Items[tail] = titem;
+        m_Tail.store(next, std::memory_order_release);
+
+        return true;
+    }
+
+    //consumer side, returns false if queue is empty
+    bool pop(T *titem)
+    {
+        unsigned int head = m_Head.load(std::memory_order_relaxed);
+
+        if(head == m_Tail.load(std::memory_order_acquire)) return false; // empty
+
+        *titem = m_Items[head];
+        m_Head.store( (head + 1) & (CAPACITY - 1), std::memory_order_release);
+
+        return true;
+    }
+
+    bool empty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire);}
+    unsigned int getCapacity() const { return CAPACITY - 1;}
+};
+
+#endif // CLASS_EVENTQUEUE
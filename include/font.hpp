@@ -4,20 +4,113 @@
 #include <vector>
 #include <string>
 #include "irrcommon.hpp"
+#include "atlas.hpp"
+
+//fonts by type, all .sys fonts are loaded
+enum SCROLLMSGFONTS
+{
+    FONT_NORMAL, // font5x6p
+    FONT_SMALL, // font4x5p
+    FONT_ITALIC, // font5x6i
+    FONT_BIG, // fontbig
+    FONT_BUTTON, // fontbutn
+    FONT_CHARACTER, // fontchar
+    FONT_TOTAL
+};
 
 struct UWFont
 {
-    ITexture *m_Texture;
+    ITexture *m_Texture; // shared font atlas page
+    //source rect of each glyph in m_Texture, width is the glyph advance
     std::vector<core::rect<s32> > m_Clips;
     int m_Height;
     int m_WidestCharacter;
     int m_Count;
 };
 
-int loadFont(std::string tfilename, UWFont *font);
+#define TEXTBATCH_RESERVE_GLYPHS 1024
+#define GLYPHRUN_MAX_GLYPHS 128 // longer strings are cut off when shaped
+
+//string laid out once, glyph offsets from the run origin and indices into UWFont::m_Clips
+struct GlyphRun
+{
+    int count;
+    int width;
+    s16 offsets[GLYPHRUN_MAX_GLYPHS];
+    u8 glyphs[GLYPHRUN_MAX_GLYPHS];
+};
+
+//glyphs sharing a font texture and color, drawn with one draw2DImageBatch call
+struct TextRun
+{
+    ITexture *texture;
+    SColor color;
+    core::array< position2d<s32> > positions;
+    core::array< rect<s32> > clips;
+};
+
+//collects glyph quads for any number of strings, then draws them with one batched call
+//per font texture and color.  run storage is kept between batches so steady state text
+//drawing does not allocate
+class TextBatch
+{
+private:
+
+    std::vector<TextRun> m_Runs;
+    int m_RunCount;
+
+    rect<s32> m_ClipRect;
+    bool m_HasClip;
+
+    //stats from last end()
+    int m_GlyphCount;
+    int m_DrawCalls;
+
+    TextRun *getRun(ITexture *ttexture, SColor tcolor);
+
+public:
+    TextBatch();
+    ~TextBatch();
+
+    //glyphs entirely outside cliprect are dropped, the rest are clipped by the driver
+    void begin(const rect<s32> *cliprect = NULL);
+    //returns width of string, kerning is extra spacing added after each glyph
+    int addString(UWFont *tfont, const std::string &tstring, position2d<s32> tpos, SColor tcolor = SColor(255,255,255,255), int kerning = 0);
+    //replay a pre-shaped run, no measuring
+    void addRun(UWFont *tfont, const GlyphRun &trun, position2d<s32> tpos, SColor tcolor = SColor(255,255,255,255));
+    void end(IVideoDriver *tdriver);
+
+    int getGlyphCount() { return m_GlyphCount;}
+    int getDrawCalls() { return m_DrawCalls;}
+};
+
+//loads every .sys font and packs all glyphs into one shared atlas, so text in any font
+//batches together.  fonts that fail to load fall back to the normal font
+class FontManager
+{
+private:
+
+    UWFont m_Fonts[FONT_TOTAL];
+    bool m_Loaded[FONT_TOTAL];
+    TextureAtlas m_Atlas;
+
+public:
+    FontManager();
+    ~FontManager();
+
+    //normal font is required, returns error code if it can't be loaded
+    int loadFonts(IVideoDriver *tdriver, std::string tpath);
+
+    UWFont *getFont(int fonttype);
+    bool isLoaded(int fonttype);
+    ITexture *getTexture() { return m_Fonts[FONT_NORMAL].m_Texture;}
+};
+
 bool drawFontChar(UWFont *tfont, int charnum, position2d<s32> tpos, SColor tcolor = SColor(255,255,255,255));
-bool drawFontString(UWFont *tfont, std::string tstring, position2d<s32> tpos, SColor tcolor = SColor(255,255,255,255));
-int getStringWidth(UWFont *tfont, std::string tstring);
+bool drawFontString(UWFont *tfont, const std::string &tstring, position2d<s32> tpos, SColor tcolor = SColor(255,255,255,255), const rect<s32> *cliprect = NULL);
+int getStringWidth(UWFont *tfont, const std::string &tstring);
+//lay out string into glyph run, returns width
+int shapeString(UWFont *tfont, const std::string &tstring, GlyphRun *trun, int kerning = 0);
 
 
 #endif // CLASS_FONT
@@ -6,6 +6,8 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <atomic>
+#include <functional>
 
 
 #include "irrcommon.hpp"
@@ -14,13 +16,28 @@
 #include "strings.hpp"
 #include "graphics.hpp"
 #include "level.hpp"
+#include "levelmanager.hpp"
 #include "object.hpp"
 #include "font.hpp"
-#include "thread.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "memstats.hpp"
+#include "alloctrack.hpp"
 #include "mouse.hpp"
 #include "scroll.hpp"
+#include "uicompositor.hpp"
+#include "automap.hpp"
 #include "player.hpp"
 #include "timer.hpp"
+#include "scheduler.hpp"
+#include "spritebatch.hpp"
+#include "atlas.hpp"
+#include "palette.hpp"
+#include "shading.hpp"
+#include "texanim.hpp"
+#include "benchmark.hpp"
+#include "demo.hpp"
 
 #define DEBUG_NO_START 0
 #define FULLSCREEN 0
@@ -43,6 +60,8 @@
 #define ROTATION_SPEED 120
 #define MOVE_SPEED 15
 #define STANDING_HEIGHT 3
+#define SPRITE_CHUNK_TILES 8
+#define LOAD_FRAME_BUDGET 16000 // microseconds of main thread load work per loading screen frame
 
 
 //forward declaration
@@ -50,10 +69,21 @@ class Mouse;
 class Scroll;
 class MyEventReceiver;
 class Console;
+class Benchmark;
 
 enum {ID_IsNotPickable = 0, ID_IsMap = 1 << 0, ID_IsObject = 1 << 1};
 enum {IMODE_PLAY, IMODE_SCROLL_ENTRY, IMODE_TOTAL};
 
+//one step of the startup graph, times are in microseconds from getMicroseconds()
+struct LoadPhase
+{
+    std::string name;
+    JobHandle job;
+    std::atomic<unsigned long long> starttime; // 0 until started
+    std::atomic<unsigned long long> endtime; // 0 until finished
+    std::atomic<int> errorcode;
+};
+
 struct UIAnimation
 {
     std::string name;
@@ -64,13 +94,13 @@ struct UIAnimation
     Timer timer;
 };
 
-class Game
+class Game : public EntityClient
 {
 private:
     Game();
     static Game *mInstance;
     Console *m_Console;
-    bool m_DoShutdown;
+    std::atomic<bool> m_DoShutdown;
 
     //irrlicht renderer
     IrrlichtDevice *m_Device;
@@ -92,21 +122,52 @@ private:
     int m_LightRadius;
     SLight m_LightData;
 
+    //lighting, distance shading from the original tables or the dynamic camera light
+    ShadeTable m_ShadeTable;
+    int m_ShadingMode;
+    int m_ShadeLevel; // shades.dat light level, 0 is brightest
+    bool setShading(int mode, int lightlevel);
+    //without the palette shader the shade is a vertex colour, rewritten each frame for tiles
+    //in range.  tiles outside m_VertexShadeRect keep the darkest shade
+    rect<s32> m_VertexShadeRect;
+    int m_VertexShadeLevel; // level m_VertexShadeRect belongs to
+    bool isVertexShading();
+    void shadeMeshNode(IMeshSceneNode *tnode, const vector3df *eyepos);
+    void updateVertexShading();
+
     //player
     Player *m_Player;
 
     //threads
-    std::vector<MyThreadClass*> m_Threads;
+    JobSystem *m_Jobs;
+
+    //frame timing
+    Profiler *m_Profiler;
+    Tracer *m_Tracer;
+    MemStats *m_MemStats;
+    AllocTracker *m_AllocTracker;
+    void stopThreads();
 
     //mesh stuff
     SMesh *getCubeMesh(f32 cubesize);
     SMesh *getSquareMesh(int ul, int ur, int br, int bl);
 
     //init / load
-    void loadScreen(std::string loadmessage);
+    //startup runs as a graph of load phases on the job workers and main thread
+    std::vector<LoadPhase*> m_LoadPhases;
+    std::atomic<bool> m_LoadFailed;
+    unsigned long long m_StartTime;
+    unsigned long long m_FirstFrameTime; // time to first interactive frame, 0 until drawn
+    LoadPhase *addLoadPhase(std::string name, std::function<int()> func, bool mainthread,
+                            std::vector<LoadPhase*> deps = std::vector<LoadPhase*>());
+    int runLoadPhases();
+    BenchmarkConfig m_BenchConfig;
+    void drawLoadScreen();
+    void printLoadPhases();
     int initIrrlicht();
     int initCamera();
     int initMouse();
+    int decodeSpriteAtlas();
     int initObjects();
     int initPlayer();
     int initMainUI();
@@ -116,18 +177,21 @@ private:
     int m_CurrentLevel;
     std::vector<Level> mLevels;
     std::vector<IMeshSceneNode*> mLevelMeshes;
+    LevelManager *m_LevelManager;
+    vector2di m_LastPlayerTile;
+    void checkMoveTriggers(vector2di ttile);
 
     //palettes
     std::vector< std::vector<SColor> > m_Palettes;
     std::vector< std::vector<SColor> > m_AuxPalettes;
+    PaletteManager m_PaletteManager; // wall and floor textures keep their indices
 
     //textures
     std::vector<ITexture*> m_Wall64TXT;
     std::vector<ITexture*> m_Floor32TXT;
+    TextureAnimator m_TextureAnimator; // water, lava and falls scroll
     std::vector<ITexture*> m_CharHeadTXT;
     std::vector<ITexture*> m_BitmapsTXT;
-    std::vector<ITexture*> m_CursorsTXT;
-    std::vector<ITexture*> m_ObjectsTXT;
     std::vector<ITexture*> m_QuestionTXT;
     std::vector<ITexture*> m_InventoryTXT;
     std::vector<ITexture*> m_ScrollEdgeTXT;
@@ -135,18 +199,32 @@ private:
     std::vector<ITexture*> m_ModeButtonsMiscTXT;
     std::vector<ITexture*> m_DragonsTXT;
 
+    //small sprite sets (objects, cursors, tmaps) packed into shared pages
+    TextureAtlas m_SpriteAtlas;
+
     //fonts
-    UWFont m_FontNormal;
+    FontManager m_Fonts;
+    UWFont *m_FontNormal;
 
     //strings
     std::vector<stringBlock> m_StringBlocks;
 
     //objects
     std::vector<Object*> m_Objects;
+    EntityScheduler *m_Scheduler;
+    SpriteBatch *m_SpriteBatch;
 
     //mainloop
 
     void mainLoop();
+    void runFrame(u32 now);
+
+    //input record / replay, runs at a fixed DEMO_TICK_MS timestep
+    Demo *m_Demo;
+    u32 m_DemoBaseTime;
+    int m_PendingDemoState; // demo to start before the next frame, DEMO_IDLE if none
+    std::string m_PendingDemoFile;
+    u32 getSimChecksum();
 
 
     //input
@@ -160,7 +238,10 @@ private:
 
     //main UI
     int drawMainUI();
+    void drawStaticUI(const rect<s32> *cliprect);
     Scroll *m_Scroll;
+    UICompositor *m_UICompositor;
+    Automap *m_Automap;
     std::vector<UIAnimation> m_UIAnimations;
     std::vector< rect<s32> > m_UIInventorySlots;
 
@@ -175,6 +256,8 @@ private:
     void dbg_drawrect(rect<s32> trect, SColor tcolor = SColor(255,255,255,255));
     void reconfigureAllLevelMeshes();
     void reconfigureAllLevelObjects();
+    //sprites for every object lying on a level's tiles, or release them all
+    void setLevelSprites(Level *tlevel, bool visible);
 
 public:
     static Game *getInstance()
@@ -186,18 +269,30 @@ public:
 
     //start initialization
     int start();
+    //headless benchmark instead of the main loop, set before start()
+    void setBenchmarkConfig(const BenchmarkConfig &nconfig) { m_BenchConfig = nconfig;}
 
     //mesh stuff
     bool configMeshSceneNode(IMeshSceneNode *tnode);
-    bool configBillboardSceneNode(IBillboardSceneNode *tnode);
+    bool configSpriteBatch(SpriteBatch *tbatch);
+    //vertex shaded geometry needs nodes that draw straight from their mesh
+    bool hasVertexShading() { return !m_PaletteManager.isShaderMode();}
 
     //world functions
     bool processCollision(vector3df *pos, vector3df *vel);
     int getCurrentLevel() { return m_CurrentLevel;}
+    bool changeLevel(int nlevel);
+    bool teleportPlayer(int nlevel, vector2di ntile);
+
+    //demos
+    bool startDemoRecord(std::string tfilename);
+    bool startDemoReplay(std::string tfilename);
+    void stopDemo();
 
     //textures
     const std::vector<ITexture*> *getWall64Textures() const { return &m_Wall64TXT;}
     const std::vector<ITexture*> *getFloor32Textures() const { return &m_Floor32TXT;}
+    ITexture *getDisplayTexture(ITexture *ttexture) { return m_TextureAnimator.getDisplayTexture(ttexture);}
     ITexture *getDefaultTexture() { return m_QuestionTXT[0];}
     std::vector< std::vector<SColor> > *getPalletes() { return &m_Palettes;}
     std::vector< std::vector<SColor> > *getAuxPalletes() { return &m_AuxPalettes;}
@@ -206,13 +301,20 @@ public:
     bool updateObject(ObjectInstance *tobj, Tile *ttile);
     Object *getObject(int id);
     std::string lookAtObject(ObjectInstance *tobj);
+    SpriteBatch *getSpriteBatch() { return m_SpriteBatch;}
+
+    //entity scheduler hooks
+    //no per tick object simulation yet, so the update hook isn't overridden
+    void onEntityWake(ObjectHandle thandle, vector2di ttile, u32 elapsed);
+    void onEntityHibernate(ObjectHandle thandle, vector2di ttile);
 
     //strings
     std::string getDefaultString() { return "no string";}
     std::string getString(int blockindex, int stringindex);
 
     //fonts
-    UWFont *getNormalFont() { return &m_FontNormal;}
+    UWFont *getNormalFont() { return m_FontNormal;}
+    UWFont *getFont(int fonttype) { return m_Fonts.getFont(fonttype);}
 
     //
     int getInputContext() { return m_InputContext;}
@@ -232,8 +334,10 @@ public:
 
     //console
     void sendToConsole(std::string nstring);
+    int completeConsoleInput(std::string *tstring, std::vector<std::string> *matches);
 
     friend MyEventReceiver;
     friend Console;
+    friend Benchmark;
 };
 #endif // CLASS_GAME
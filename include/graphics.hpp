@@ -10,6 +10,15 @@
 int loadPalette(std::vector< std::vector<SColor> > *pals);
 int loadAuxPalette(std::vector< std::vector<SColor> > *pals);
 
+//decode functions only read files and build unscaled images (caller drops), they are
+//safe to run on job workers once palettes are loaded.  upload functions must run on the
+//main thread, they create textures and drop the images.  load functions do both.
+int decodeGraphic(std::string tfilename, std::vector<IImage*> *ilist);
+//indices optionally keeps the palette index data of each texture (see PaletteManager)
+int decodeTexture(std::string tfilename, std::vector<IImage*> *ilist, std::vector< std::vector<u8> > *indices = NULL);
+int decodeBitmap(std::string tfilename, std::vector<IImage*> *ilist, int tpalindex);
+int uploadTextures(std::vector<IImage*> *ilist, std::vector<ITexture*> *tlist);
+int uploadGraphics(std::vector<IImage*> *ilist, std::vector<ITexture*> *tlist, std::string tname);
 int loadGraphic(std::string tfilename, std::vector<ITexture*> *tlist);
 int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist);
 int loadBitmap(std::string tfilename, std::vector<ITexture*> *tlist, int tpalindex);
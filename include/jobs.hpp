@@ -0,0 +1,142 @@
+#ifndef CLASS_JOBS
+#define CLASS_JOBS
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "thread.hpp"
+
+#define JOBS_MIN_WORKERS 1
+
+//forward declarations
+class JobSystem;
+struct Job;
+
+typedef std::shared_ptr<Job> JobHandle;
+
+struct Job
+{
+    std::function<void()> func;
+    bool mainThread; // must run on main thread (rendering / scene manager work)
+
+    //starts at 1, held until submit() so dependencies can be added first
+    std::atomic<int> pendingDeps;
+    std::atomic<bool> started;
+    std::atomic<bool> done;
+    std::atomic<bool> cancelled;
+
+    //jobs waiting on this one
+    std::mutex depLock;
+    std::vector<JobHandle> dependents;
+};
+
+//worker thread, runs jobs from its own deque and steals from others when empty
+class JobWorker : public MyThreadClass
+{
+private:
+    JobSystem *m_Jobs;
+    int m_Index;
+
+    void InternalThreadEntry();
+
+public:
+    JobWorker(JobSystem *njobs, int nindex);
+    ~JobWorker();
+
+    //owner pushes/pops at back, thieves steal from front
+    std::deque<JobHandle> m_Queue;
+    std::mutex m_QueueLock;
+
+    //utilization counters, written by the worker only
+    std::atomic<unsigned long long> m_BusyTime; // microseconds spent running jobs
+    std::atomic<int> m_JobsRun;
+    std::atomic<int> m_Steals;
+};
+
+//fixed pool of workers (one per core, minus the main thread) with work stealing.
+//jobs may depend on other jobs, and jobs marked main thread are run when the main
+//loop calls runMainThreadJobs() (continuations that touch irrlicht)
+class JobSystem
+{
+private:
+    JobSystem();
+    static JobSystem *m_Instance;
+
+    std::vector<JobWorker*> m_Workers;
+    std::thread::id m_MainThreadID;
+    std::atomic<bool> m_Shutdown;
+    std::atomic<unsigned int> m_NextWorker;
+
+    //sleeping workers wait here when nothing is queued
+    std::mutex m_WakeLock;
+    std::condition_variable m_WakeCondition;
+    std::atomic<int> m_QueuedCount;
+
+    //main thread jobs
+    std::deque<JobHandle> m_MainQueue;
+    std::mutex m_MainQueueLock;
+
+    unsigned long long m_StatsStartTime;
+
+    void enqueue(JobHandle tjob);
+    void finish(JobHandle tjob);
+    JobHandle popLocal(int workerindex);
+    JobHandle steal(int thiefindex);
+
+public:
+    static JobSystem *getInstance()
+    {
+        if(m_Instance == NULL) m_Instance = new JobSystem;
+        return m_Instance;
+    }
+    ~JobSystem();
+
+    //start workers, 0 = one per core minus the main thread
+    int init(int workercount = 0);
+    //stops all workers, then finishes every job still queued as cancelled
+    void shutdown();
+
+    //jobs
+    JobHandle createJob(std::function<void()> nfunc, bool mainthread = false);
+    //tjob will not run until tdependency is done, both must not be submitted yet for tjob
+    bool addDependency(JobHandle tjob, JobHandle tdependency);
+    void submit(JobHandle tjob);
+    //create and submit in one call
+    JobHandle schedule(std::function<void()> nfunc, bool mainthread = false);
+    //run nfunc after tdependency is done
+    JobHandle then(JobHandle tdependency, std::function<void()> nfunc, bool mainthread = false);
+    //skip job if it has not started yet, dependents still run
+    void cancel(JobHandle tjob);
+    bool isDone(JobHandle tjob) { return tjob == NULL || tjob->done.load();}
+
+    //wait for job, calling thread runs other jobs while waiting.  returns early, with the job
+    //not done, once shutting down and there is nothing left to run
+    void wait(JobHandle tjob);
+    //run nfunc(begin,end) over [start,end) split into chunks of grain size, waits for all chunks
+    void parallelFor(int start, int end, int grain, std::function<void(int,int)> nfunc);
+
+    //run queued main thread jobs, returns number run. call from main loop once per tick
+    int runMainThreadJobs(int maxjobs = -1);
+    bool isMainThread() { return std::this_thread::get_id() == m_MainThreadID;}
+
+    //run one job from any worker queue on the calling thread, returns false if none found
+    bool runPendingJob(int workerindex = -1);
+    bool waitForWork(int workerindex);
+    bool isShuttingDown() { return m_Shutdown.load();}
+
+    //stats
+    int getWorkerCount() { return int(m_Workers.size());}
+    float getWorkerUtilization(int workerindex);
+    int getWorkerJobsRun(int workerindex);
+    int getWorkerSteals(int workerindex);
+    void resetStats();
+    void printStats();
+};
+
+#endif // CLASS_JOBS
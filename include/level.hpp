@@ -4,11 +4,14 @@
 #define TILE_COLS 64
 #define TILE_ROWS 64
 #define CEIL_HEIGHT 15
+#define LEVEL_GEOMETRY_ROWS_PER_JOB 4
 
 #include <cstdlib>
 #include <vector>
 
 #include "object.hpp"
+#include "objectpool.hpp"
+#include "npc.hpp"
 
 #include "irrcommon.hpp"
 
@@ -19,6 +22,18 @@ enum _DCOORDS{NW, NE, SE, SW};
 
 enum _DIRS{NORTH,EAST,SOUTH,WEST};
 
+enum _TILEPART{TILEPART_FLOOR, TILEPART_CEILING, TILEPART_WALL, TILEPART_TOTAL};
+
+//mesh generated for part of a tile, turned into a scene node on the main thread
+struct TileMeshDesc
+{
+    SMesh *mesh;
+    vector3df position;
+    vector3df rotation;
+    ITexture *texture;
+    int part; // _TILEPART
+};
+
 //forward declaration
 class Tile;
 class Level;
@@ -30,10 +45,17 @@ class Level
 private:
     std::vector< std::vector<Tile> > mTiles;
 
-    std::vector<ObjectInstance*> m_ObjectsMaster;
+    //master object list, mirrors the uw 1024 slot list
+    ObjectPool m_ObjectPool;
+
+    //npc state for mobile slots of master list
+    NPCTable m_NPCs;
 
     int m_CeilingTextureIndex;
 
+    //automap, a byte per tile, non zero once seen
+    std::vector<u8> m_Explored;
+
 public:
     Level();
     ~Level();
@@ -44,7 +66,14 @@ public:
     Tile *getTile(int x, int y);
 
     bool buildLevelGeometry(); //high level, geomery gen for entire map
+    bool generateLevelMeshes(std::vector< std::vector<TileMeshDesc> > *meshdescs); // mesh gen for entire map, from any thread
+    bool createLevelNodes(std::vector< std::vector<TileMeshDesc> > *meshdescs, int startrow = 0, int endrow = TILE_ROWS,
+                          bool visible = true); // scene nodes for rows of map, main thread
     bool buildTileGeometry(int x, int y); // lower level, geometry for individual tile
+    bool generateTileMeshes(int x, int y, std::vector<TileMeshDesc> *meshdescs); // mesh gen only, safe on job workers
+    bool createTileNodes(int x, int y, std::vector<TileMeshDesc> *meshdescs, bool visible = true); // scene nodes from meshes, main thread
+    int clearGeometry(); // remove all tile scene nodes
+    void setGeometryVisible(bool nvisible);
 
     //NOTE NEED TO CHANGE PARAMETERS TO F32, CANT DIVIDE SCALING WITH INT (UNLESS CASTED FIRST)
     SMesh *generateFloorMesh(int ul, int ur, int br, int bl); // generate floor model
@@ -53,7 +82,7 @@ public:
     SMesh *generateWallMesh(int tl, int tr, int br, int bl); // generate wall model
     SMesh *generateDiagonalWallMesh(int tl, int tr, int br, int bl); // generate diagonal wall model
 
-    std::vector<Tile*> getAdjacentTilesAt(int x, int y);
+    void getAdjacentTilesAt(int x, int y, Tile **adjacents);
 
     //a level uses one ceiling texture
     int getCeilingTextureIndex() { return m_CeilingTextureIndex;}
@@ -61,8 +90,13 @@ public:
 
     std::vector<IMeshSceneNode*> getMeshes();
 
-    std::vector<ObjectInstance*> *getObjectsMaster() { return &m_ObjectsMaster;}
-    bool addObject(ObjectInstance *nobj);
+    //automap explored tiles, setExplored returns true if the tile wasn't explored before
+    bool isExplored(int x, int y);
+    bool setExplored(int x, int y);
+
+    ObjectPool *getObjectPool() { return &m_ObjectPool;}
+    NPCTable *getNPCs() { return &m_NPCs;}
+    void unloadObjects();
 
 
     void printDebug();
@@ -93,7 +127,7 @@ private:
 
     //objects
     int mFirstObjectIndex;
-    std::vector<ObjectInstance*> mObjects;
+    std::vector<ObjectHandle> mObjects;
 
 public:
     Tile(int xpos, int ypos);
@@ -125,15 +159,17 @@ public:
     //geometry
     int clearGeometry();
     bool addMesh(IMeshSceneNode *tnode);
-    std::vector<IMeshSceneNode*> getMeshes();
+    const std::vector<IMeshSceneNode*> &getMeshes();
 
     //objects
-    bool addObject(ObjectInstance *tobj);
-    //this is not safe, for temporary implementation
-    std::vector<ObjectInstance*> getObjects() { return mObjects;}
+    bool addObject(ObjectHandle tobj);
+    bool removeObject(ObjectHandle tobj);
+    //note : handles may be stale, always resolve through the level's object pool
+    const std::vector<ObjectHandle> &getObjects() { return mObjects;}
+    void clearObjects() { mObjects.clear();}
 
     //debug
-    void printDebug();
+    void printDebug(ObjectPool *tpool = NULL);
 };
 
 #endif // CLASS_LEVEL
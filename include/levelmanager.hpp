@@ -0,0 +1,93 @@
+#ifndef CLASS_LEVELMANAGER
+#define CLASS_LEVELMANAGER
+
+#include <atomic>
+#include <vector>
+
+#include "irrcommon.hpp"
+#include "jobs.hpp"
+#include "level.hpp"
+
+#define LEVELMANAGER_DEFAULT_BUDGET 64 // megabytes of level geometry kept resident
+#define LEVELMANAGER_ROWS_PER_FRAME 4 // default tile rows of a prebuilt level turned into scene nodes per update
+
+enum _LEVELSTATE{LEVELSTATE_UNLOADED, LEVELSTATE_BUILDING, LEVELSTATE_BUILT, LEVELSTATE_RESIDENT};
+
+struct LevelSlot
+{
+    std::atomic<int> state; // _LEVELSTATE
+    JobHandle job;
+
+    //generated meshes waiting to become scene nodes, rows before nextRow are done
+    std::vector< std::vector<TileMeshDesc> > meshDescs;
+    int nextRow;
+
+    unsigned int bytes; // estimated geometry memory, valid once built
+
+    //levels reachable by stairs or teleport traps
+    std::vector<int> adjacent;
+    bool hasAdjacent;
+};
+
+//keeps the current level resident and prebuilds the levels reachable from it on the
+//job workers.  prebuilt levels have hidden scene nodes, so switching level only swaps
+//visibility.  levels not adjacent to the current one are unloaded when over budget
+class LevelManager
+{
+private:
+
+    std::vector<Level> *m_Levels;
+    std::vector<LevelSlot*> m_Slots;
+    JobSystem *m_Jobs;
+
+    int m_Current;
+    unsigned int m_Budget; // bytes
+    int m_RowsPerFrame; // tile rows turned into scene nodes per update
+
+    //stats
+    int m_Transitions;
+    int m_Misses; // transitions to a level that was not resident yet
+    unsigned long long m_LastTransitionTime; // microseconds
+
+    bool isValid(int levelindex) { return levelindex >= 0 && levelindex < int(m_Slots.size());}
+    void createPendingNodes(int levelindex, int rowcount);
+    void evict();
+
+public:
+    LevelManager(std::vector<Level> *nlevels);
+    ~LevelManager();
+
+    //generate meshes for level on the calling thread, no scene nodes yet
+    bool generateLevel(int levelindex);
+    //generate meshes on a job worker, scene nodes are added a few rows per update
+    bool prebuild(int levelindex);
+    //remove scene nodes and meshes of level, current level can't be unloaded
+    bool unload(int levelindex);
+    //stop background builds, call before job workers shut down
+    void cancelBuilds();
+
+    //make level visible and hide the old one, finishes building it first if needed
+    bool setCurrentLevel(int levelindex);
+    int getCurrentLevel() { return m_Current;}
+
+    //call once per frame from main thread
+    void update();
+
+    std::vector<int> getAdjacentLevels(int levelindex);
+    int getState(int levelindex);
+    unsigned int getLevelBytes(int levelindex);
+    unsigned int getResidentBytes();
+
+    void setBudget(unsigned int nbudget) { m_Budget = nbudget;}
+    unsigned int getBudget() { return m_Budget;}
+    void setRowsPerFrame(int nrows) { if(nrows > 0) m_RowsPerFrame = nrows;}
+    int getRowsPerFrame() { return m_RowsPerFrame;}
+
+    int getTransitions() { return m_Transitions;}
+    int getMisses() { return m_Misses;}
+    unsigned long long getLastTransitionTime() { return m_LastTransitionTime;}
+
+    void printDebug();
+};
+
+#endif // CLASS_LEVELMANAGER
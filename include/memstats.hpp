@@ -0,0 +1,55 @@
+#ifndef CLASS_MEMSTATS
+#define CLASS_MEMSTATS
+
+#include <atomic>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+//tracked memory, texture sets are counted at their uploaded (scaled) size
+enum _MEMCATEGORY{MEMCAT_TEX_WALL64, MEMCAT_TEX_FLOOR32, MEMCAT_TEX_CHARHEAD, MEMCAT_TEX_QUESTION, MEMCAT_TEX_INVENTORY,
+                  MEMCAT_TEX_SCROLLEDGE, MEMCAT_TEX_MODEBUTTONS, MEMCAT_TEX_MODEBUTTONSMISC, MEMCAT_TEX_DRAGONS,
+                  MEMCAT_TEX_BITMAPS, MEMCAT_TEX_SPRITEATLAS, MEMCAT_TEX_FONTS, MEMCAT_MESH_VERTICES, MEMCAT_MESH_INDICES,
+                  MEMCAT_COLLISION, MEMCAT_STRINGS, MEMCAT_OBJECTS, MEMCAT_TOTAL};
+
+//current and peak bytes per category.  counters are updated where the memory is created
+//and released, so they can be read from any thread at any time
+class MemStats
+{
+private:
+    MemStats();
+    static MemStats *m_Instance;
+
+    std::atomic<long long> m_Current[MEMCAT_TOTAL];
+    std::atomic<long long> m_Peak[MEMCAT_TOTAL];
+
+public:
+    static MemStats *getInstance()
+    {
+        if(m_Instance == NULL) m_Instance = new MemStats;
+        return m_Instance;
+    }
+    ~MemStats();
+
+    void add(int category, long long bytes);
+    void remove(int category, long long bytes);
+
+    //helpers for irrlicht resources
+    void addTextures(int category, const std::vector<ITexture*> *tlist);
+    void addMeshNode(IMeshSceneNode *tnode);
+    void removeMeshNode(IMeshSceneNode *tnode);
+    void addTriangleSelector(ITriangleSelector *tselector);
+    void removeTriangleSelector(ITriangleSelector *tselector);
+
+    static const char *getName(int category);
+    long long getCurrent(int category);
+    long long getPeak(int category);
+    long long getTotalCurrent();
+    long long getTotalPeak(); // sum of category peaks
+
+    static long long getTextureBytes(ITexture *ttexture);
+
+    void printStats();
+};
+
+#endif // CLASS_MEMSTATS
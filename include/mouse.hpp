@@ -4,8 +4,6 @@
 #include "irrcommon.hpp"
 #include "game.hpp"
 
-#include "thread.hpp"
-
 
 //forward declarations
 class Game;
@@ -31,10 +29,14 @@ public:
     line3d<f32> m_CameraMouseRay;
 
     ITexture *m_Texture;
+    rect<s32> m_TextureRect; // region of texture (atlas page) to draw
     void setTexture(ITexture *ttxt);
+    void setTexture(ITexture *ttxt, rect<s32> tregion);
     void draw();
 
+    //poll cursor position, normally position is set from mouse events
     void updatePosition();
+    void setPosition(int x, int y) { m_MousePos = vector2di(x, y);}
     int getMousePositionX() { return m_MousePos.X;}
     int getMousePositionY() { return m_MousePos.Y;}
     vector2di *getMousePosition() { return &m_MousePos;}
@@ -47,17 +49,4 @@ public:
     int increaseDebugTexture(int nval);
 };
 
-//mouse update thread
-class MouseUpdateThread:public MyThreadClass
-{
-private:
-    Mouse *m_Mouse;
-    bool *shutdownflag;
-
-    void InternalThreadEntry();
-public:
-    MouseUpdateThread(Mouse *nmouse, bool *nshutdownflag);
-    ~MouseUpdateThread();
-};
-
 #endif // CLASS_MOUSE
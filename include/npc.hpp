@@ -0,0 +1,94 @@
+#ifndef CLASS_NPC
+#define CLASS_NPC
+
+#include <vector>
+
+#include "irrcommon.hpp"
+
+//mobile object extra info (see data formats, 4.2.3)
+#define NPC_MOBILE_DATA_SIZE 19
+#define NPC_TABLE_SIZE 256
+
+//npc attitudes
+enum _NPCATTITUDE{NPC_ATT_HOSTILE, NPC_ATT_UPSET, NPC_ATT_MELLOW, NPC_ATT_FRIENDLY};
+
+//npc state for all mobile slots of a level, stored as structure of arrays
+//each array is indexed by master list slot (0-255) so it lines up with object handles.
+//hot arrays (hp, goal, target, heading, attitude) are what per tick ai / animation
+//updates touch, they should be walked using the active slot list
+class NPCTable
+{
+private:
+
+    //hot data
+    std::vector<u8> m_HP;
+    std::vector<u8> m_Goal;
+    std::vector<u8> m_Target;
+    std::vector<u8> m_Heading;
+    std::vector<u8> m_Attitude;
+
+    //cold data
+    std::vector<u8> m_Level;
+    std::vector<u8> m_Height;
+    std::vector<u8> m_HomeX;
+    std::vector<u8> m_HomeY;
+    std::vector<u8> m_Hunger;
+    std::vector<u8> m_WhoAmI;
+    std::vector<bool> m_TalkedTo;
+
+    //raw extra info bytes, kept so unknown fields survive a save
+    std::vector<unsigned char> m_RawData;
+
+    //slots that hold a live npc
+    std::vector<u16> m_ActiveSlots;
+    std::vector<bool> m_IsActive;
+
+    bool isValidSlot(int slot) { return slot >= 0 && slot < NPC_TABLE_SIZE;}
+
+public:
+    NPCTable();
+    ~NPCTable();
+
+    void clear();
+
+    //decode 19 bytes of mobile object extra info into slot
+    bool parseMobileData(int slot, const unsigned char *data);
+    const unsigned char *getMobileData(int slot);
+
+    //active npc slots
+    bool setActive(int slot, bool nactive);
+    bool isActive(int slot) { if(!isValidSlot(slot)) return false; return m_IsActive[slot];}
+    int getActiveCount() { return int(m_ActiveSlots.size());}
+    const std::vector<u16> *getActiveSlots() { return &m_ActiveSlots;}
+
+    //hot arrays for contiguous iteration, indexed by slot
+    u8 *getHPArray() { return &m_HP[0];}
+    u8 *getGoalArray() { return &m_Goal[0];}
+    u8 *getTargetArray() { return &m_Target[0];}
+    u8 *getHeadingArray() { return &m_Heading[0];}
+    u8 *getAttitudeArray() { return &m_Attitude[0];}
+
+    //per slot access
+    int getHP(int slot) { return m_HP[slot];}
+    void setHP(int slot, int nhp) { m_HP[slot] = u8(nhp);}
+    int getGoal(int slot) { return m_Goal[slot];}
+    void setGoal(int slot, int ngoal) { m_Goal[slot] = u8(ngoal);}
+    int getTarget(int slot) { return m_Target[slot];}
+    void setTarget(int slot, int ntarget) { m_Target[slot] = u8(ntarget);}
+    int getHeading(int slot) { return m_Heading[slot];}
+    void setHeading(int slot, int nheading) { m_Heading[slot] = u8(nheading);}
+    int getAttitude(int slot) { return m_Attitude[slot];}
+    void setAttitude(int slot, int nattitude) { m_Attitude[slot] = u8(nattitude);}
+    int getLevel(int slot) { return m_Level[slot];}
+    int getHeight(int slot) { return m_Height[slot];}
+    vector2di getHome(int slot) { return vector2di(m_HomeX[slot], m_HomeY[slot]);}
+    int getHunger(int slot) { return m_Hunger[slot];}
+    int getWhoAmI(int slot) { return m_WhoAmI[slot];}
+    bool getTalkedTo(int slot) { return m_TalkedTo[slot];}
+    void setTalkedTo(int slot, bool ntalked) { m_TalkedTo[slot] = ntalked;}
+
+    //debug
+    void printDebug(int slot);
+};
+
+#endif // CLASS_NPC
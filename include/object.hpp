@@ -3,6 +3,11 @@
 
 #include <string>
 #include "irrcommon.hpp"
+#include "spritebatch.hpp"
+
+//object ids with special handling
+#define OBJECT_ID_TELEPORT_TRAP 0x181
+#define OBJECT_ID_MOVE_TRIGGER 0x1a0
 
 class Object
 {
@@ -11,16 +16,24 @@ private:
     static int m_TotalObjects;
     int m_ID;
 
+    //texture page and region of it used by this object
     ITexture *m_TXT;
+    rect<s32> m_ImageRect;
+    rect<f32> m_UVRect;
 
 public:
     Object();
     ~Object();
 
     ITexture *getTexture() { return m_TXT;}
+    const rect<s32> &getImageRect() { return m_ImageRect;}
+    const rect<f32> &getUVRect() { return m_UVRect;}
     int getID() { return m_ID;}
 
-    void setTexture(ITexture *ntxt) { m_TXT = ntxt;}
+    //use whole texture
+    void setTexture(ITexture *ntxt);
+    //use region of an atlas page
+    void setTexture(ITexture *npage, const rect<s32> &nimagerect, const rect<f32> &nuvrect);
 
     int getObjectCount() { return m_TotalObjects;}
 };
@@ -28,10 +41,9 @@ public:
 class ObjectInstance
 {
 private:
-    static int m_InstanceCount;
-    int m_InstanceID;
+    u32 m_Handle; // handle assigned by owning object pool
     Object *m_Ref;
-    IBillboardSceneNode *m_Billboard;
+    int m_Sprite; // sprite in games sprite batch, -1 if not drawn
 
 
     //object flags
@@ -54,18 +66,26 @@ private:
     int m_Quantity; // quantity / special link / special property
 
 public:
-    ObjectInstance(Object *tobj);
+    ObjectInstance(Object *tobj = NULL);
     ~ObjectInstance();
 
+    //reset all data to defaults (used when pool slots are reused)
+    void reset(Object *tobj);
+    //copy object data, but not the pool handle or sprite
+    void copyFrom(const ObjectInstance &tobj);
+
     //reference
     Object *getRef() { return m_Ref;}
-    int getRefID() { return m_Ref->getID();}
-    int getInstanceID() { return m_InstanceID;}
+    int getRefID() { if(m_Ref == NULL) return -1; return m_Ref->getID();}
+    u32 getHandle() { return m_Handle;}
+    void setHandle(u32 nhandle) { m_Handle = nhandle;}
     ITexture *getTexture() { return m_Ref->getTexture();}
+    const rect<s32> &getImageRect() { return m_Ref->getImageRect();}
+    const rect<f32> &getUVRect() { return m_Ref->getUVRect();}
 
-    //billboard
-    IBillboardSceneNode *getBillboard() { return m_Billboard;}
-    bool setBillboard(IBillboardSceneNode *tbb);
+    //sprite
+    int getSprite() { return m_Sprite;}
+    bool setSprite(int nsprite);
 
     //object flags
     int getFlags() { return m_Flags;}
@@ -97,8 +117,6 @@ public:
     int getQuantity() { return m_Quantity;}
     void setQuantity(int nquant) { m_Quantity = nquant;}
 
-    int getObjectInstanceCount() { return m_InstanceCount;}
-
     //debug
     void printDebug();
 };
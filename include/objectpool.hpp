@@ -0,0 +1,81 @@
+#ifndef CLASS_OBJECTPOOL
+#define CLASS_OBJECTPOOL
+
+#include <vector>
+
+#include "irrcommon.hpp"
+#include "object.hpp"
+
+//master object list layout (see data formats, 4.2 / 4.3)
+// 0000 - 00ff mobile objects (npcs), 0100 - 03ff static objects
+// slot 0 is never allocated (null link) and slot 1 is reserved for the player
+#define OBJECT_POOL_SIZE 1024
+#define OBJECT_POOL_MOBILE 256
+#define OBJECT_POOL_FIRST_MOBILE 2
+
+//object handles are 32 bits
+// bits 0-9   slot index into master list (same as uw "next" / tile links)
+// bits 10-31 generation of slot, bumped on every free so stale handles fail
+#define OBJECT_HANDLE_INDEX_BITS 10
+#define OBJECT_HANDLE_INDEX_MASK 0x3ff
+#define OBJECT_HANDLE_NULL 0
+
+typedef u32 ObjectHandle;
+
+class ObjectPool
+{
+private:
+
+    //slot count and size of the mobile region at the start of the list
+    int m_Capacity;
+    int m_MobileCount;
+
+    //object storage, allocated once and never resized
+    std::vector<ObjectInstance> m_Slots;
+    std::vector<u32> m_Generations;
+    std::vector<bool> m_InUse;
+
+    //free lists, used as stacks (uw allocates from the end of the list)
+    std::vector<u16> m_MobileFree;
+    std::vector<u16> m_StaticFree;
+    int m_MobileFreeCount;
+    int m_StaticFreeCount;
+
+    int m_UsedCount;
+
+    ObjectHandle makeHandle(int index) { return (m_Generations[index] << OBJECT_HANDLE_INDEX_BITS) | u32(index);}
+    bool isMobileIndex(int index) { return index < m_MobileCount;}
+    bool removeFromFreeList(int index);
+
+public:
+    //level pools use the uw master list layout, smaller pools (player inventory) pass
+    //their own capacity, a mobile count of 1 makes every slot after the null one static
+    ObjectPool(int capacity = OBJECT_POOL_SIZE, int mobilecount = OBJECT_POOL_MOBILE);
+    ~ObjectPool();
+
+    //reset all slots to free, O(slots) but no heap allocation
+    void clear();
+
+    //rebuild free lists from the uw level data free lists
+    bool setFreeLists(const std::vector<int> &mobilefree, const std::vector<int> &staticfree);
+
+    //allocation
+    ObjectHandle allocate(Object *tobj, bool mobile = false);
+    ObjectHandle allocateAt(int index, Object *tobj);
+    bool release(ObjectHandle thandle);
+
+    //lookup
+    ObjectInstance *get(ObjectHandle thandle);
+    ObjectInstance *getAt(int index);
+    ObjectHandle getHandleAt(int index);
+    bool isValid(ObjectHandle thandle) { return get(thandle) != NULL;}
+    static int getIndex(ObjectHandle thandle) { return int(thandle & OBJECT_HANDLE_INDEX_MASK);}
+
+    //stats
+    int getUsedCount() { return m_UsedCount;}
+    int getMobileFreeCount() { return m_MobileFreeCount;}
+    int getStaticFreeCount() { return m_StaticFreeCount;}
+    int getCapacity() { return m_Capacity;}
+};
+
+#endif // CLASS_OBJECTPOOL
@@ -0,0 +1,120 @@
+#ifndef CLASS_PALETTE
+#define CLASS_PALETTE
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define PALETTE_SIZE 256
+#define PALETTE_SHADE_ROWS 16 // palette texture rows, one per light.dat shade level
+#define PALETTE_USE_SHADER 1 // apply palette in a shader when the driver has glsl
+#define PALCYCLE_INTERVAL 150 // ms between colour cycle steps
+#define PALCYCLE_LAVA_START 16 // palette 0 entries
+#define PALCYCLE_LAVA_COUNT 8
+#define PALCYCLE_WATER_START 48
+#define PALCYCLE_WATER_COUNT 4
+
+enum PALETTEMODE{PALMODE_SOFTWARE, PALMODE_SHADER};
+
+//range of palette entries rotated one step each interval (water, lava)
+struct PaletteCycle
+{
+    int start;
+    int count;
+};
+
+//texture that keeps its 8-bit palette indices
+struct IndexedEntry
+{
+    ITexture *texture;
+    dimension2d<u32> size;
+    std::vector<u8> indices;
+    u32 usage[PALETTE_SIZE/32]; // bit per palette entry used by any texel
+};
+
+class PaletteShaderCallback;
+
+//applies a palette to indexed textures at draw time.  in shader mode textures hold the
+//index in the red channel and a 256x1 palette texture is looked up per pixel, so a palette
+//change only rewrites 256 texels.  the software fallback keeps the index data and rewrites
+//only the textures that use a changed entry
+class PaletteManager
+{
+private:
+
+    IVideoDriver *m_Driver;
+    int m_Mode;
+
+    std::vector<SColor> m_Palette; // working palette, cycles applied
+    std::vector<SColor> m_AppliedPalette; // what the textures currently show
+    std::vector<IndexedEntry> m_Entries;
+    std::set<ITexture*> m_IndexedTextures;
+
+    //shader mode
+    ITexture *m_PaletteTexture;
+    PaletteShaderCallback *m_ShaderCallback;
+    s32 m_MaterialType;
+    std::vector< std::vector<u8> > m_LightMaps; // shade level x palette index, empty for no shading
+    f32 m_ShadeStart;
+    f32 m_ShadeEnd;
+    bool m_Saved32Bit;
+    bool m_Saved16Bit;
+
+    //colour cycling
+    std::vector<PaletteCycle> m_Cycles;
+    u32 m_CycleTime;
+    bool m_Cycling;
+
+    //stats
+    int m_RemapCount; // textures rewritten by last apply
+    std::vector<ITexture*> m_Remapped; // and which ones, capacity kept between applies
+
+    void remapEntry(IndexedEntry *tentry);
+    //shader textures must keep 8 bits per channel whatever the game asked for
+    void setFull32Bit(bool tfull);
+
+public:
+    PaletteManager();
+    ~PaletteManager();
+
+    //shader mode is only used if requested and supported, returns mode in use
+    int init(IVideoDriver *tdriver, const std::vector<SColor> &tpalette, bool useshader);
+    int getMode() { return m_Mode;}
+    bool isShaderMode() { return m_Mode == PALMODE_SHADER;}
+
+    //creates textures for the decoded images, in software mode the images are uploaded as
+    //usual, in shader mode index textures are created instead.  images are dropped
+    int uploadIndexed(std::vector<IImage*> *ilist, std::vector< std::vector<u8> > *indices,
+                      std::vector<ITexture*> *tlist, std::string tname);
+
+    //material setup, only materials with an indexed texture in layer 0 are changed
+    bool isIndexed(ITexture *ttexture) { return m_IndexedTextures.count(ttexture) != 0;}
+    //texture holding copies of an indexed texture's texels, drawn the same way
+    void addAlias(ITexture *talias, ITexture *tsource) { if(isIndexed(tsource)) m_IndexedTextures.insert(talias);}
+    void configMaterial(SMaterial *tmat);
+
+    //palette
+    void setPalette(const std::vector<SColor> &tpalette);
+    const std::vector<SColor> *getPalette() { return &m_Palette;}
+    void addCycle(int start, int count);
+    void clearCycles() { m_Cycles.clear();}
+    void setCycling(bool tcycling) { m_Cycling = tcycling;}
+    bool isCycling() { return m_Cycling;}
+
+    //advance colour cycles and apply palette changes
+    void update(u32 deltams);
+    int apply();
+
+    //distance shading in shader mode, row n of the palette texture is the palette seen
+    //through light map n.  an empty range turns shading off
+    void setLightMaps(const std::vector< std::vector<u8> > *tmaps);
+    void setShadeRange(f32 start, f32 end);
+
+    int getTextureCount() { return int(m_Entries.size());}
+    int getLastRemapCount() { return m_RemapCount;}
+    const std::vector<ITexture*> *getLastRemapped() { return &m_Remapped;}
+};
+
+#endif // CLASS_PALETTE
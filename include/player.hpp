@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "object.hpp"
+#include "objectpool.hpp"
 
 //player inventory slots
 // note : left and right relative to player
@@ -41,9 +42,10 @@ private:
 
     std::string m_Name;
 
-    //inventory slots
-    std::vector<ObjectInstance*> m_InvSlots;
-
+    //inventory objects live in their own pool sized to the slots, slots hold handles into it
+    ObjectPool m_InvObjects;
+    std::vector<ObjectHandle> m_InvSlots;
+    bool m_InventoryDirty; // slots changed since the ui last drew them
 
 public:
     Player();
@@ -59,8 +61,11 @@ public:
     void setRotation(vector3df nrot) { m_Rotation = nrot;}
     void setVelocity(vector3df nvel) { m_Velocity = nvel;}
 
+    //note : set copies the object into the inventory pool, pop copies it back out
     ObjectInstance *getInventorySlot(int slotnum);
     bool setInventorySlot(int slotnum, ObjectInstance *tobj);
-    ObjectInstance *popInventorySlot(int slotnum);
+    bool popInventorySlot(int slotnum, ObjectInstance *tobj = NULL);
+    bool isInventoryDirty() { return m_InventoryDirty;}
+    void clearInventoryDirty() { m_InventoryDirty = false;}
 };
 #endif // CLASS_PLAYER
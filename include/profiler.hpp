@@ -0,0 +1,114 @@
+#ifndef CLASS_PROFILER
+#define CLASS_PROFILER
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "irrcommon.hpp"
+#include "font.hpp"
+#include "trace.hpp"
+
+#define PROFILER_MAX_SCOPES 32
+#define PROFILER_MAX_DEPTH 8
+#define PROFILER_FRAME_HISTORY 256 // frames kept in ring buffer
+#define PROFILER_SCOPE_DROPPED -2 // stack entry of a scope that didn't fit the scope table
+
+//time the rest of the enclosing block, scopes opened inside it become its children
+#define PROFILE_SCOPE(name) ProfileScope profilescope(name)
+
+struct ProfilerScope
+{
+    std::string name;
+    int parent; // scope index, -1 for top level
+    int depth;
+};
+
+//microseconds over the frames in the ring buffer, frames a scope did not run count as 0
+struct ProfilerStats
+{
+    float avg;
+    u32 max;
+    u32 p50;
+    u32 p95;
+    u32 p99;
+};
+
+//hierarchical cpu timers for the main thread.  each frame the time spent in every scope
+//is summed (a scope can run several times per frame) and stored in a ring buffer
+class Profiler
+{
+private:
+    Profiler();
+    static Profiler *m_Instance;
+
+    std::vector<ProfilerScope> m_Scopes;
+
+    //ring buffer, PROFILER_FRAME_HISTORY frames of PROFILER_MAX_SCOPES times
+    std::vector<u32> m_History;
+    std::vector<u32> m_FrameTimes;
+    int m_FrameIndex; // next slot to write
+    int m_FrameCount; // valid frames in history
+
+    //current frame
+    u32 m_Current[PROFILER_MAX_SCOPES];
+    u32 m_CurrentAllocs[PROFILER_MAX_SCOPES];
+    u32 m_LastAllocs[PROFILER_MAX_SCOPES]; // heap allocations per scope in the last finished frame
+    unsigned long long m_FrameStart;
+    bool m_InFrame;
+
+    //open scopes
+    int m_Stack[PROFILER_MAX_DEPTH];
+    unsigned long long m_StackStart[PROFILER_MAX_DEPTH];
+    unsigned long long m_StackAllocs[PROFILER_MAX_DEPTH];
+    int m_StackDepth;
+    int m_Overflow; // scopes opened past max depth, ignored
+
+    //only the thread running the main loop is timed
+    std::thread::id m_ThreadID;
+
+    bool m_ShowOverlay;
+    TextBatch m_OverlayText;
+
+    int findScope(const char *name, int parent);
+    u32 getPercentile(std::vector<u32> *tsamples, float tpercent);
+
+public:
+    static Profiler *getInstance()
+    {
+        if(m_Instance == NULL) m_Instance = new Profiler;
+        return m_Instance;
+    }
+    ~Profiler();
+
+    void beginFrame();
+    void endFrame();
+    void beginScope(const char *name);
+    void endScope();
+    void reset();
+
+    int getScopeCount() { return int(m_Scopes.size());}
+    const ProfilerScope *getScope(int scopeindex);
+    int getFrameCount() { return m_FrameCount;}
+    //scopeindex -1 gives whole frame stats
+    bool getStats(int scopeindex, ProfilerStats *tstats);
+    u32 getScopeAllocs(int scopeindex);
+
+    bool isOverlayVisible() { return m_ShowOverlay;}
+    void setOverlayVisible(bool nshow) { m_ShowOverlay = nshow;}
+    void drawOverlay(IVideoDriver *tdriver, UWFont *tfont, position2d<s32> tpos);
+    void printStats();
+};
+
+//opens a profiler scope for its lifetime, also traced when tracing is on
+class ProfileScope
+{
+private:
+    TraceScope m_Trace;
+
+public:
+    ProfileScope(const char *name) : m_Trace(name) { Profiler::getInstance()->beginScope(name);}
+    ~ProfileScope() { Profiler::getInstance()->endScope();}
+};
+
+#endif // CLASS_PROFILER
@@ -0,0 +1,106 @@
+#ifndef CLASS_SCHEDULER
+#define CLASS_SCHEDULER
+
+#include <vector>
+
+#include "irrcommon.hpp"
+#include "objectpool.hpp"
+
+#define SCHEDULER_DEFAULT_RADIUS 8 // tiles
+#define SCHEDULER_DEFAULT_BUDGET 2000 // microseconds per tick
+
+//forward declaration
+class Level;
+
+//hooks called by the scheduler, times are in milliseconds
+class EntityClient
+{
+public:
+    virtual ~EntityClient() {/* empty */}
+
+    //entity entered the active radius, elapsed is time spent asleep (for catching up)
+    virtual void onEntityWake(ObjectHandle thandle, vector2di ttile, u32 elapsed) = 0;
+    //entity left the active radius
+    virtual void onEntityHibernate(ObjectHandle thandle, vector2di ttile) = 0;
+    //active entity update, dt is time since this entity was last updated.  only called for
+    //clients that return true from hasEntityUpdates, the others skip the budgeted update pass
+    virtual bool hasEntityUpdates() { return false;}
+    virtual void onEntityUpdate(ObjectHandle thandle, vector2di ttile, u32 dt) {/* empty */}
+};
+
+struct SchedulerEntity
+{
+    ObjectHandle handle;
+    vector2di tile;
+    bool active;
+    u32 stamp; // active set pass that last saw this entity in range
+    u32 lastTime; // time of last update (active) or hibernation (asleep)
+    int activeIndex; // index in active list, -1 if asleep
+};
+
+class EntityScheduler
+{
+private:
+
+    EntityClient *m_Client;
+
+    //all entities of level, plus a per tile index for radius queries
+    std::vector<SchedulerEntity> m_Entities;
+    std::vector< std::vector<int> > m_TileEntities;
+    std::vector<int> m_Active;
+
+    //settings
+    int m_Radius;
+    u32 m_Budget;
+
+    //active set tracking
+    vector2di m_CenterTile;
+    bool m_NeedsRefresh;
+    u32 m_Stamp;
+    int m_UpdateCursor;
+
+    //counters
+    int m_WokenThisTick;
+    int m_HibernatedThisTick;
+    int m_UpdatedThisTick;
+    int m_BudgetOverruns;
+
+    void refreshActiveSet(u32 now);
+    void wake(int eindex, u32 now);
+    void hibernate(int eindex, u32 now);
+    int findEntity(ObjectHandle thandle);
+
+public:
+    EntityScheduler(EntityClient *nclient);
+    ~EntityScheduler();
+
+    //build entity list from the objects linked to a levels tiles, all entities start asleep
+    int buildFromLevel(Level *tlevel, u32 now);
+    void clear();
+    //put every active entity to sleep, eg. before leaving the level
+    void hibernateAll(u32 now);
+
+    //object moved or was removed
+    bool moveEntity(ObjectHandle thandle, vector2di ntile);
+    bool removeEntity(ObjectHandle thandle);
+
+    //wake/sleep entities around center tile and update active entities within budget
+    void tick(u32 now, vector2di centertile);
+
+    //settings
+    void setRadius(int nradius);
+    int getRadius() { return m_Radius;}
+    void setBudget(u32 nbudget) { m_Budget = nbudget;}
+    u32 getBudget() { return m_Budget;}
+
+    //counters
+    int getEntityCount() { return int(m_Entities.size());}
+    int getActiveCount() { return int(m_Active.size());}
+    int getSleepingCount() { return int(m_Entities.size() - m_Active.size());}
+    int getWokenThisTick() { return m_WokenThisTick;}
+    int getHibernatedThisTick() { return m_HibernatedThisTick;}
+    int getUpdatedThisTick() { return m_UpdatedThisTick;}
+    int getBudgetOverruns() { return m_BudgetOverruns;}
+};
+
+#endif // CLASS_SCHEDULER
@@ -3,6 +3,7 @@
 
 #include "game.hpp"
 #include "irrcommon.hpp"
+#include "font.hpp"
 
 #include "timer.hpp"
 
@@ -14,11 +15,8 @@
 #define SCROLL_DEFAULT_FONT_PAL 47
 #define SCROLL_FONT_PAL_GREEN 253
 #define SCROLL_CURSOR_BLINK 500
-
-enum SCROLLMSGFONTS
-{
-    FONT_NORMAL
-};
+#define SCROLL_LINES 5
+#define SCROLL_HISTORY 256 // oldest messages are dropped past this
 
 class Game;
 class UWFont;
@@ -28,6 +26,7 @@ struct ScrollMessage
     std::string msg;
     SColor color;
     UWFont *font;
+    GlyphRun run; // shaped once when the message is added
 };
 
 class Scroll
@@ -42,15 +41,23 @@ private:
     rect<s32> m_ScrollRect;
     static SColor m_DefaultColor;
     int m_ScrollStartIndex;
+    bool m_Dirty; // messages or input changed since last cached draw
 
-    //fonts
-    UWFont *m_FontNormal;
-
-    //message buffer
+    //message ring buffer, slots are reused so adding a message doesn't allocate
     std::vector<ScrollMessage> m_MsgBuffer;
+    int m_MsgHead; // oldest message
+    int m_MsgCount;
+    TextBatch m_TextBatch;
+
+    //index is 0 for oldest message
+    ScrollMessage *getMessage(int index) { return &m_MsgBuffer[ (m_MsgHead + index) % SCROLL_HISTORY];}
+    ScrollMessage *getLastMessage() { return m_MsgCount ? getMessage(m_MsgCount-1) : NULL;}
+    void pushLine(const std::string &msgstring, int start, int end, UWFont *font, SColor fcolor);
+    void updateScrollState();
 
     //input mode
     std::string *m_InputModeString;
+    GlyphRun m_InputRun;
     ITexture *m_CursorGraphic;
     Timer m_CursorTimer;
 
@@ -64,8 +71,17 @@ public:
 
     int getScrollEdgeState() { return m_ScrollEdgeState;}
 
-    void draw();
+    bool isDirty() { return m_Dirty;}
+    void clearDirty() { m_Dirty = false;}
+
+    //messages and input string, cursor blinks so it is drawn separately every frame
+    void draw(const rect<s32> *cliprect = NULL);
+    void drawCursor();
     void addMessage(std::string msgstring, int fonttype = FONT_NORMAL, SColor fcolor = m_DefaultColor);
+    int getMessageCount() { return m_MsgCount;}
+
+    //move window by lines, negative is back in history
+    void scroll(int lines);
 
     //input mode
     bool startInputMode( std::string *tstring, std::string promptstr = std::string(">"));
@@ -0,0 +1,54 @@
+#ifndef CLASS_SHADING
+#define CLASS_SHADING
+
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define SHADE_LEVELS 16 // light.dat blocks, 0 is original colors, 15 is almost black
+#define SHADE_ENTRY_SIZE 12 // shades.dat is 96 bytes, 8 entries of 6 Int16
+#define SHADE_UNITS_PER_TILE 8 // shades.dat distances are in 1/8 tile
+
+enum SHADINGMODE{SHADING_DYNAMIC, SHADING_TABLE};
+
+//one shades.dat entry, only the range is understood, the rest are kept as read
+struct ShadeEntry
+{
+    int range; // distance where shading reaches black
+    int unknown[5];
+};
+
+//distance shading from the original lighting tables.  light.dat maps every palette index
+//to a darker index for each of 16 shade levels, shades.dat gives how far each light level
+//reaches.  shade rises linearly with distance to black at the light level's range
+class ShadeTable
+{
+private:
+
+    std::vector< std::vector<u8> > m_LightMaps; // SHADE_LEVELS x 256 palette indices
+    std::vector<ShadeEntry> m_Entries; // one per light level, brightest first
+    u8 m_Intensities[SHADE_LEVELS]; // average brightness of each light.dat block, 255 is unshaded
+
+public:
+    ShadeTable();
+    ~ShadeTable();
+
+    //reads light.dat and shades.dat from tpath
+    int load(std::string tpath);
+
+    const std::vector< std::vector<u8> > *getLightMaps() { return &m_LightMaps;}
+    int getLightLevelCount() { return int(m_Entries.size());}
+
+    //world units where a light level fades to black, 0 if there is no such level
+    f32 getRange(int lightlevel);
+
+    //how much each light.dat block darkens tpalette, used where the palette can't be
+    //looked up per pixel and shading is applied as a colour instead
+    void computeIntensities(const std::vector<SColor> &tpalette);
+    //shade level at an eye distance, same rounding as the palette shader
+    int getShadeLevel(f32 distance, f32 range);
+    SColor getShadeColor(f32 distance, f32 range);
+};
+
+#endif // CLASS_SHADING
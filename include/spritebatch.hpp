@@ -0,0 +1,112 @@
+#ifndef CLASS_SPRITEBATCH
+#define CLASS_SPRITEBATCH
+
+#include <vector>
+
+#include "irrcommon.hpp"
+#include "shading.hpp"
+
+#define SPRITEBATCH_MAX_SPRITES 2048
+#define SPRITEBATCH_NONE -1
+
+struct Sprite
+{
+    bool used;
+    vector3df position; // center of sprite
+    dimension2d<f32> size;
+    ITexture *texture; // texture page
+    rect<f32> uvrect; // region of texture page
+    u32 userdata; // owner data (object handle)
+    int chunk;
+};
+
+struct SpriteChunk
+{
+    std::vector<int> sprites;
+    aabbox3d<f32> box;
+    bool hasbox;
+};
+
+//sort entry for one visible sprite
+struct SpriteDrawItem
+{
+    int sprite;
+    ITexture *texture;
+    f32 distance;
+};
+
+//draws all camera facing sprites (object billboards) as one scene node
+//sprites are bucketed into square chunks on the x/z plane, each frame the chunks
+//in the view frustum are gathered, sorted back to front and drawn with one dynamic
+//vertex buffer, one draw call per run of neighbouring sprites on the same texture page
+class SpriteBatch : public ISceneNode
+{
+private:
+
+    std::vector<Sprite> m_Sprites;
+    std::vector<int> m_FreeSprites;
+    int m_SpriteCount;
+
+    //spatial chunks
+    std::vector<SpriteChunk> m_Chunks;
+    f32 m_ChunkSize;
+    int m_ChunksX;
+    int m_ChunksZ;
+
+    //per frame buffers, reserved up front
+    std::vector<SpriteDrawItem> m_DrawList;
+    std::vector<S3DVertex> m_Vertices;
+    std::vector<u16> m_Indices;
+
+    SMaterial m_Material;
+    aabbox3d<f32> m_Box;
+
+    //distance shading, sprite textures are never palette indexed so it is always a vertex colour
+    ShadeTable *m_ShadeTable;
+    f32 m_ShadeRange;
+
+    //stats from last render
+    int m_DrawnCount;
+    int m_BatchCount;
+    int m_VisibleChunks;
+
+    int getChunkIndex(const vector3df &tpos);
+    void addToChunk(int spriteid);
+    void removeFromChunk(int spriteid);
+    void updateBoundingBox();
+    void gatherVisible(const SViewFrustum *frustum, const vector3df &campos);
+
+public:
+    SpriteBatch(ISceneNode *parent, ISceneManager *mgr, s32 id, f32 chunksize, int chunksx, int chunksz);
+    ~SpriteBatch();
+
+    //sprites
+    int addSprite(vector3df tpos, dimension2d<f32> tsize, ITexture *ttexture, u32 tuserdata,
+                  rect<f32> tuvrect = rect<f32>(0,0,1,1));
+    bool updateSprite(int spriteid, vector3df tpos, dimension2d<f32> tsize, ITexture *ttexture,
+                      rect<f32> tuvrect = rect<f32>(0,0,1,1));
+    bool removeSprite(int spriteid);
+    void clear();
+    const Sprite *getSprite(int spriteid);
+    int getSpriteCount() { return m_SpriteCount;}
+
+    //shade sprites by eye distance, a NULL table or zero range draws them unshaded
+    void setShading(ShadeTable *ttable, f32 range) { m_ShadeTable = ttable; m_ShadeRange = range;}
+
+    //find closest sprite hit by ray, returns sprite id or SPRITEBATCH_NONE
+    int pick(const line3df &ray);
+
+    //stats
+    int getDrawnCount() { return m_DrawnCount;}
+    int getBatchCount() { return m_BatchCount;}
+    int getVisibleChunks() { return m_VisibleChunks;}
+
+    //scene node
+    virtual void OnRegisterSceneNode();
+    virtual void render();
+    virtual const aabbox3d<f32>& getBoundingBox() const { return m_Box;}
+    virtual u32 getMaterialCount() const { return 1;}
+    virtual SMaterial& getMaterial(u32 i) { return m_Material;}
+};
+
+#endif // CLASS_SPRITEBATCH
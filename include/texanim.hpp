@@ -0,0 +1,78 @@
+#ifndef CLASS_TEXANIM
+#define CLASS_TEXANIM
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define TERRAIN_FLOOR_OFFSET 256 // terrain.dat has 256 wall words then the floors
+#define TERRAIN_WATER 0x10
+#define TERRAIN_LAVA 0x20
+#define TERRAIN_WATERFALL 0x40 // uw2
+#define TERRAIN_LAVAFALL 0x80 // uw2
+#define TEXANIM_WATER_INTERVAL 200 // ms per texel of scroll
+#define TEXANIM_LAVA_INTERVAL 400
+
+//one animated texture.  every face using the source texture draws the target instead,
+//so a step rewrites the target once no matter how many faces show it
+struct TextureAnimGroup
+{
+    ITexture *source;
+    ITexture *target;
+    dimension2d<u32> size;
+    u32 bytesperpixel;
+    std::vector<u8> texels; // copy of source, rows packed
+
+    int scrollx; // texels per step
+    int scrolly;
+    u32 interval; // ms per step
+    u32 time;
+    int offsetx; // shared scroll state
+    int offsety;
+};
+
+//scrolls water, lava and fall textures found in terrain.dat.  the level geometry looks up
+//the display texture when meshes are generated and never has to be touched again
+class TextureAnimator
+{
+private:
+
+    IVideoDriver *m_Driver;
+    std::vector<TextureAnimGroup> m_Groups;
+    std::map<ITexture*, int> m_GroupBySource;
+    bool m_Enabled;
+
+    //stats
+    int m_UpdateCount; // targets rewritten by last update
+
+    bool readSource(TextureAnimGroup *tgroup);
+    void writeTarget(TextureAnimGroup *tgroup);
+
+public:
+    TextureAnimator();
+    ~TextureAnimator();
+
+    void init(IVideoDriver *tdriver) { m_Driver = tdriver;}
+
+    //source keeps its texels, a new target texture is created for drawing
+    int addScroll(ITexture *tsource, int scrollx, int scrolly, u32 interval);
+    //adds a group for every water, lava and fall texture in terrain.dat
+    int addTerrainAnimations(std::string tfile, const std::vector<ITexture*> *walls, const std::vector<ITexture*> *floors);
+
+    //texture geometry should use, the source itself if it isn't animated
+    ITexture *getDisplayTexture(ITexture *tsource);
+
+    //advance every group, groups whose source is in remapped (software palette remap of
+    //this frame) re-read it first.  remapped may be NULL
+    void update(u32 deltams, const std::vector<ITexture*> *remapped);
+    void setEnabled(bool nenabled) { m_Enabled = nenabled;}
+    bool isEnabled() { return m_Enabled;}
+
+    int getGroupCount() { return int(m_Groups.size());}
+    TextureAnimGroup *getGroup(int index);
+    int getLastUpdateCount() { return m_UpdateCount;}
+};
+
+#endif // CLASS_TEXANIM
@@ -6,21 +6,27 @@
 class MyThreadClass
 {
 public:
-   MyThreadClass() {/* empty */}
+   MyThreadClass() : _started(false) {/* empty */}
    virtual ~MyThreadClass() {/* empty */}
 
    /** Returns true if the thread was successfully started, false if there was an error starting the thread */
    bool StartInternalThread()
    {
-      return (pthread_create(&_thread, NULL, InternalThreadEntryFunc, this) == 0);
+      if(_started) return false;
+      _started = (pthread_create(&_thread, NULL, InternalThreadEntryFunc, this) == 0);
+      return _started;
    }
 
-   /** Will not return until the internal thread has exited. */
+   /** Will not return until the internal thread has exited.  Safe to call if the thread was never started. */
    void WaitForInternalThreadToExit()
    {
+      if(!_started) return;
       (void) pthread_join(_thread, NULL);
+      _started = false;
    }
 
+   bool IsInternalThreadStarted() { return _started;}
+
 protected:
    /** Implement this method in your subclass with the code you want your thread to run. */
    virtual void InternalThreadEntry() = 0;
@@ -29,6 +35,7 @@ private:
    static void * InternalThreadEntryFunc(void * This) {((MyThreadClass *)This)->InternalThreadEntry(); return NULL;}
 
    pthread_t _thread;
+   bool _started;
 };
 
 #endif // CLASS_THREAD
@@ -13,6 +13,8 @@
 bool readBin(std::ifstream *fptr, unsigned char *data, int length, bool quiet = true);
 bool readBinAt(std::ifstream *fptr, unsigned char *data, int length, std::streampos offset, bool quiet = true);
 int lsbSum(unsigned char *bytes, int length);
+//read whole file into memory in one call, returns false if file couldn't be read
+bool readFile(std::string tfilename, std::vector<unsigned char> *tdata);
 int getBitVal(int data, int startbit, int length);
 std::vector<bool> printByteToBin(int val, bool quiet = true);
 std::vector<bool> printByteToBin(unsigned char *data, int datasize, bool quiet = true);
@@ -21,4 +23,7 @@ int getCount(std::vector<int> ndata, int *curindex, int nibsize = 4);
 
 irr::core::vector2df projectVectorAontoB(irr::core::vector2df va, irr::core::vector2df vb);
 
+//high resolution monotonic clock, in microseconds
+unsigned long long getMicroseconds();
+
 #endif // _TOOLS
@@ -0,0 +1,82 @@
+#ifndef CLASS_TRACE
+#define CLASS_TRACE
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_BUFFER_EVENTS 65536 // per thread, events past this are dropped
+#define TRACE_DEFAULT_OUTPUT "trace.json"
+
+//trace the rest of the enclosing block, name must outlive the trace (literal or game owned string)
+#define TRACE_SCOPE(name) TraceScope tracescope(name)
+
+//one begin/end pair, stored as a complete event
+struct TraceEvent
+{
+    const char *name;
+    unsigned long long start; // microseconds from getMicroseconds()
+    unsigned long long end;
+};
+
+//written only by the owning thread, read when dumping
+struct TraceBuffer
+{
+    int threadIndex;
+    std::string threadName;
+    std::vector<TraceEvent> events;
+    std::atomic<int> count;
+    std::atomic<int> dropped;
+};
+
+//timeline of begin/end events from every thread, written as chrome / perfetto trace json.
+//while disabled a traced scope costs one relaxed atomic load
+class Tracer
+{
+private:
+    Tracer();
+    static Tracer *m_Instance;
+
+    std::atomic<bool> m_Enabled;
+    unsigned long long m_StartTime; // timestamps are written relative to this
+
+    //one buffer per thread that has traced anything
+    std::mutex m_BufferLock;
+    std::vector<TraceBuffer*> m_Buffers;
+    TraceBuffer *getThreadBuffer();
+
+public:
+    static Tracer *getInstance()
+    {
+        if(m_Instance == NULL) m_Instance = new Tracer;
+        return m_Instance;
+    }
+    ~Tracer();
+
+    void start();
+    void stop();
+    bool isEnabled() { return m_Enabled.load(std::memory_order_relaxed);}
+
+    //name shown for the calling thread, doesn't allocate its buffer
+    void setThreadName(std::string tname);
+    void addEvent(const char *name, unsigned long long starttime, unsigned long long endtime);
+
+    int getEventCount();
+    int getDroppedCount();
+    bool write(std::string tfilename);
+};
+
+//records a trace event for its lifetime if tracing was enabled when it was opened
+class TraceScope
+{
+private:
+    const char *m_Name;
+    unsigned long long m_Start;
+
+public:
+    TraceScope(const char *name);
+    ~TraceScope();
+};
+
+#endif // CLASS_TRACE
@@ -0,0 +1,57 @@
+#ifndef CLASS_UICOMPOSITOR
+#define CLASS_UICOMPOSITOR
+
+#include <functional>
+#include <vector>
+
+#include "irrcommon.hpp"
+
+#define UICOMPOSITOR_MAX_DIRTY 16 // past this the whole target is redrawn
+
+//caches static 2d layers in a render target texture.  layers are only redrawn where
+//marked dirty, then the cached target is drawn in one call each frame.  partial redraws
+//can't clear alpha, so dirty rects touching a transparent area redraw the whole target
+class UICompositor
+{
+private:
+
+    IVideoDriver *m_Driver;
+    ITexture *m_Target;
+    dimension2d<u32> m_Size;
+
+    std::vector< rect<s32> > m_DirtyRects;
+    std::vector< rect<s32> > m_TransparentRects;
+    bool m_FullRedraw;
+
+    //stats
+    int m_ComposeCount;
+    int m_FullComposeCount;
+    unsigned long long m_LastComposeTime; // microseconds
+
+public:
+    UICompositor();
+    ~UICompositor();
+
+    //returns false if render targets are not supported, caller should draw directly
+    bool init(IVideoDriver *tdriver, dimension2d<u32> tsize);
+    bool isValid() { return m_Target != NULL;}
+
+    //areas left transparent by the static layers (3d view)
+    void addTransparentRect(const rect<s32> &trect) { m_TransparentRects.push_back(trect);}
+
+    void markDirty(const rect<s32> &trect);
+    void markAllDirty() { m_FullRedraw = true;}
+    bool isDirty() { return m_FullRedraw || !m_DirtyRects.empty();}
+
+    //redraw dirty areas into the target, drawfunc draws the static layers clipped to the
+    //given rect (NULL = whole target).  returns number of areas redrawn
+    int compose(std::function<void(const rect<s32> *cliprect)> drawfunc);
+    //draw cached target to the current render target
+    void draw();
+
+    int getComposeCount() { return m_ComposeCount;}
+    int getFullComposeCount() { return m_FullComposeCount;}
+    unsigned long long getLastComposeTime() { return m_LastComposeTime;}
+};
+
+#endif // CLASS_UICOMPOSITOR
@@ -0,0 +1,309 @@
+#include "alloctrack.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+AllocTracker *AllocTracker::m_Instance = NULL;
+
+//counters live in static storage so counting never allocates, and new can be called
+//before main during static initialization
+static AllocCounters g_AllocCounters[ALLOC_MAX_THREADS];
+static std::atomic<int> g_AllocThreadCount(0);
+static thread_local AllocCounters *t_AllocCounters = NULL;
+
+//call site sampling, sites are only written by the sampled thread
+static std::atomic<int> g_SampleRate(0);
+static std::atomic<AllocCounters*> g_SampleThread(NULL);
+static thread_local int t_SampleCounter = 0;
+static AllocSite g_AllocSites[ALLOC_SAMPLE_SITES];
+
+static AllocCounters *getThreadCounters()
+{
+    if(t_AllocCounters == NULL)
+    {
+        int tindex = g_AllocThreadCount.fetch_add(1);
+        if(tindex >= ALLOC_MAX_THREADS) tindex = ALLOC_MAX_THREADS - 1;
+
+        t_AllocCounters = &g_AllocCounters[tindex];
+    }
+
+    return t_AllocCounters;
+}
+
+#if ALLOC_TRACKING
+
+static void recordSite(void *address)
+{
+    //open addressing on the return address, sites past a full table are not recorded
+    unsigned int tslot = (unsigned int)( (uintptr_t(address) >> 4) % ALLOC_SAMPLE_SITES);
+
+    for(int i = 0; i < ALLOC_SAMPLE_SITES; i++)
+    {
+        AllocSite *tsite = &g_AllocSites[(tslot + i) % ALLOC_SAMPLE_SITES];
+
+        if(tsite->address == address) { tsite->count++; return;}
+        if(tsite->address == NULL)
+        {
+            tsite->address = address;
+            tsite->count = 1;
+            return;
+        }
+    }
+}
+
+static void countAlloc(std::size_t size, void *caller)
+{
+    AllocCounters *tcounters = getThreadCounters();
+
+    tcounters->allocs.fetch_add(1, std::memory_order_relaxed);
+    tcounters->bytes.fetch_add(size, std::memory_order_relaxed);
+
+    int samplerate = g_SampleRate.load(std::memory_order_relaxed);
+    if(samplerate > 0 && g_SampleThread.load(std::memory_order_relaxed) == tcounters)
+    {
+        if(++t_SampleCounter >= samplerate)
+        {
+            t_SampleCounter = 0;
+            recordSite(caller);
+        }
+    }
+}
+
+static void countFree()
+{
+    getThreadCounters()->frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __GNUC__
+#define ALLOC_CALLER __builtin_return_address(0)
+#else
+#define ALLOC_CALLER NULL
+#endif
+
+void *operator new(std::size_t size)
+{
+    countAlloc(size, ALLOC_CALLER);
+
+    void *tptr = malloc(size ? size : 1);
+    if(tptr == NULL) throw std::bad_alloc();
+
+    return tptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    countAlloc(size, ALLOC_CALLER);
+
+    void *tptr = malloc(size ? size : 1);
+    if(tptr == NULL) throw std::bad_alloc();
+
+    return tptr;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    countAlloc(size, ALLOC_CALLER);
+
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    countAlloc(size, ALLOC_CALLER);
+
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *tptr) noexcept
+{
+    if(tptr == NULL) return;
+
+    countFree();
+    free(tptr);
+}
+
+void operator delete[](void *tptr) noexcept
+{
+    if(tptr == NULL) return;
+
+    countFree();
+    free(tptr);
+}
+
+void operator delete(void *tptr, const std::nothrow_t&) noexcept
+{
+    if(tptr == NULL) return;
+
+    countFree();
+    free(tptr);
+}
+
+void operator delete[](void *tptr, const std::nothrow_t&) noexcept
+{
+    if(tptr == NULL) return;
+
+    countFree();
+    free(tptr);
+}
+
+#endif // ALLOC_TRACKING
+
+AllocTracker::AllocTracker()
+{
+    m_FrameStartAllocs = 0;
+    m_FrameStartBytes = 0;
+    m_FrameStartTotal = 0;
+    m_LastFrameAllocs = 0;
+    m_LastFrameBytes = 0;
+    m_LastFrameTotal = 0;
+
+    reset();
+}
+
+AllocTracker::~AllocTracker()
+{
+
+}
+
+unsigned long long AllocTracker::getThreadAllocs()
+{
+    if(!isEnabled()) return 0;
+
+    return getThreadCounters()->allocs.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocTracker::getThreadBytes()
+{
+    if(!isEnabled()) return 0;
+
+    return getThreadCounters()->bytes.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocTracker::getTotalAllocs()
+{
+    if(!isEnabled()) return 0;
+
+    int threadcount = std::min(g_AllocThreadCount.load(), ALLOC_MAX_THREADS);
+
+    unsigned long long ttotal = 0;
+    for(int i = 0; i < threadcount; i++) ttotal += g_AllocCounters[i].allocs.load(std::memory_order_relaxed);
+
+    return ttotal;
+}
+
+unsigned long long AllocTracker::getTotalFrees()
+{
+    if(!isEnabled()) return 0;
+
+    int threadcount = std::min(g_AllocThreadCount.load(), ALLOC_MAX_THREADS);
+
+    unsigned long long ttotal = 0;
+    for(int i = 0; i < threadcount; i++) ttotal += g_AllocCounters[i].frees.load(std::memory_order_relaxed);
+
+    return ttotal;
+}
+
+void AllocTracker::reset()
+{
+    m_Frames = 0;
+    m_AllocFrames = 0;
+    m_MaxFrameAllocs = 0;
+    m_SumFrameAllocs = 0;
+}
+
+void AllocTracker::beginFrame()
+{
+    if(!isEnabled()) return;
+
+    m_FrameStartAllocs = getThreadAllocs();
+    m_FrameStartBytes = getThreadBytes();
+    m_FrameStartTotal = getTotalAllocs();
+}
+
+void AllocTracker::endFrame()
+{
+    if(!isEnabled()) return;
+
+    m_LastFrameAllocs = getThreadAllocs() - m_FrameStartAllocs;
+    m_LastFrameBytes = getThreadBytes() - m_FrameStartBytes;
+    m_LastFrameTotal = getTotalAllocs() - m_FrameStartTotal;
+
+    m_Frames++;
+    if(m_LastFrameAllocs) m_AllocFrames++;
+    if(m_LastFrameAllocs > m_MaxFrameAllocs) m_MaxFrameAllocs = m_LastFrameAllocs;
+    m_SumFrameAllocs += m_LastFrameAllocs;
+}
+
+void AllocTracker::setSampling(int samplerate)
+{
+    if(!isEnabled()) return;
+    if(samplerate < 0) samplerate = 0;
+
+    t_SampleCounter = 0;
+    g_SampleThread = getThreadCounters();
+    g_SampleRate = samplerate;
+}
+
+int AllocTracker::getSampleRate()
+{
+    return g_SampleRate.load();
+}
+
+int AllocTracker::getTopSites(AllocSite *tsites, int maxsites)
+{
+    if(tsites == NULL || maxsites <= 0) return 0;
+
+    //copy on the stack, sorting must not allocate either
+    AllocSite sorted[ALLOC_SAMPLE_SITES];
+    int sitecount = 0;
+    for(int i = 0; i < ALLOC_SAMPLE_SITES; i++)
+    {
+        if(g_AllocSites[i].address != NULL) sorted[sitecount++] = g_AllocSites[i];
+    }
+
+    std::sort(sorted, sorted + sitecount, [](const AllocSite &a, const AllocSite &b){ return a.count > b.count;});
+
+    if(sitecount > maxsites) sitecount = maxsites;
+    for(int i = 0; i < sitecount; i++) tsites[i] = sorted[i];
+
+    return sitecount;
+}
+
+void AllocTracker::clearSites()
+{
+    for(int i = 0; i < ALLOC_SAMPLE_SITES; i++)
+    {
+        g_AllocSites[i].address = NULL;
+        g_AllocSites[i].count = 0;
+    }
+}
+
+void AllocTracker::printStats()
+{
+    if(!isEnabled())
+    {
+        std::cout << "Allocation tracking disabled, build with DEBUG defined\n";
+        return;
+    }
+
+    std::cout << "Allocations, last frame : " << m_LastFrameAllocs << " main thread (" << m_LastFrameBytes << " bytes), "
+              << m_LastFrameTotal << " all threads\n";
+    std::cout << "Since reset : " << m_Frames << " frames, " << m_AllocFrames << " allocated (target 0), avg "
+              << getAvgFrameAllocs() << " max " << m_MaxFrameAllocs << std::endl;
+    std::cout << "Totals : " << getTotalAllocs() << " allocs, " << getTotalFrees() << " frees\n";
+
+    if(getSampleRate() <= 0) return;
+
+    AllocSite tsites[16];
+    int sitecount = getTopSites(tsites, 16);
+
+    std::cout << "Sampled sites (1 in " << getSampleRate() << ") :\n";
+    for(int i = 0; i < sitecount; i++)
+    {
+        std::cout << "  " << std::setw(8) << tsites[i].count << "  " << tsites[i].address << std::endl;
+    }
+}
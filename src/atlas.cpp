@@ -0,0 +1,216 @@
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "graphics.hpp"
+
+//pack tallest images first, shelves waste less space that way
+struct AtlasPackItem
+{
+    int region;
+    int width;
+    int height;
+};
+
+static bool atlasPackCompare(const AtlasPackItem &a, const AtlasPackItem &b)
+{
+    if(a.height != b.height) return a.height > b.height;
+    return a.width > b.width;
+}
+
+TextureAtlas::TextureAtlas()
+{
+    m_PageSize = ATLAS_PAGE_SIZE;
+    m_Scale = 1;
+    m_Name = "atlas";
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    for(int i = 0; i < int(m_Pending.size()); i++)
+    {
+        if(m_Pending[i] != NULL) m_Pending[i]->drop();
+    }
+}
+
+int TextureAtlas::addImageSet(std::string setname, std::vector<IImage*> *images)
+{
+    if(images == NULL) return -1;
+
+    AtlasSet newset;
+    newset.name = setname;
+    newset.start = int(m_Regions.size());
+    newset.count = int(images->size());
+    m_Sets.push_back(newset);
+
+    for(int i = 0; i < int(images->size()); i++)
+    {
+        AtlasRegion newregion;
+        newregion.page = -1;
+        m_Regions.push_back(newregion);
+
+        (*images)[i]->grab();
+        m_Pending.push_back( (*images)[i]);
+    }
+
+    return newset.start;
+}
+
+int TextureAtlas::build(IVideoDriver *driver, int tscale)
+{
+    if(driver == NULL) return -1;
+    if(tscale < 1) tscale = 1;
+    m_Scale = tscale;
+
+    //page size limited by what the driver supports
+    m_PageSize = ATLAS_PAGE_SIZE;
+    if(int(driver->getMaxTextureSize().Width) < m_PageSize) m_PageSize = int(driver->getMaxTextureSize().Width);
+    if(int(driver->getMaxTextureSize().Height) < m_PageSize) m_PageSize = int(driver->getMaxTextureSize().Height);
+
+    //gather pending images
+    std::vector<AtlasPackItem> items;
+    for(int i = 0; i < int(m_Pending.size()); i++)
+    {
+        if(m_Pending[i] == NULL) continue;
+
+        AtlasPackItem newitem;
+        newitem.region = i;
+        newitem.width = int(m_Pending[i]->getDimension().Width) * m_Scale;
+        newitem.height = int(m_Pending[i]->getDimension().Height) * m_Scale;
+
+        if(newitem.width + ATLAS_PADDING > m_PageSize || newitem.height + ATLAS_PADDING > m_PageSize)
+        {
+            std::cout << "Error building atlas, image " << i << " is larger than page size " << m_PageSize << std::endl;
+            return -2;
+        }
+
+        items.push_back(newitem);
+    }
+
+    std::sort(items.begin(), items.end(), atlasPackCompare);
+
+    //shelf pack, pages and positions only (no pixels yet)
+    std::vector<int> pageheights;
+    int pagebase = int(m_Pages.size());
+    int page = pagebase;
+    int shelfx = ATLAS_PADDING;
+    int shelfy = ATLAS_PADDING;
+    int shelfheight = 0;
+
+    if(!items.empty()) pageheights.push_back(0);
+
+    for(int i = 0; i < int(items.size()); i++)
+    {
+        //next shelf
+        if(shelfx + items[i].width + ATLAS_PADDING > m_PageSize)
+        {
+            shelfy += shelfheight + ATLAS_PADDING;
+            shelfx = ATLAS_PADDING;
+            shelfheight = 0;
+        }
+
+        //next page
+        if(shelfy + items[i].height + ATLAS_PADDING > m_PageSize)
+        {
+            page++;
+            pageheights.push_back(0);
+            shelfx = ATLAS_PADDING;
+            shelfy = ATLAS_PADDING;
+            shelfheight = 0;
+        }
+
+        AtlasRegion *tregion = &m_Regions[items[i].region];
+        tregion->page = page;
+        tregion->pixels = rect<s32>(shelfx, shelfy, shelfx + items[i].width, shelfy + items[i].height);
+
+        shelfx += items[i].width + ATLAS_PADDING;
+        if(items[i].height > shelfheight) shelfheight = items[i].height;
+        if(shelfy + shelfheight + ATLAS_PADDING > pageheights.back()) pageheights.back() = shelfy + shelfheight + ATLAS_PADDING;
+    }
+
+    //compose and upload each page, height trimmed to what was used
+    for(int i = 0; i < int(pageheights.size()); i++)
+    {
+        int pageheight = pageheights[i];
+
+        IImage *pageimg = driver->createImage(ECF_A1R5G5B5, dimension2d<u32>(m_PageSize, pageheight));
+        if(pageimg == NULL) return -3;
+        pageimg->fill(SColor(TRANSPARENCY_COLOR));
+
+        for(int n = 0; n < int(items.size()); n++)
+        {
+            AtlasRegion *tregion = &m_Regions[items[n].region];
+            if(tregion->page != pagebase + i) continue;
+
+            IImage *srcimg = m_Pending[items[n].region];
+
+            if(m_Scale == 1) srcimg->copyTo(pageimg, tregion->pixels.UpperLeftCorner);
+            else
+            {
+                IImage *scaledimg = driver->createImage(ECF_A1R5G5B5, dimension2d<u32>(items[n].width, items[n].height));
+                srcimg->copyToScaling(scaledimg);
+                scaledimg->copyTo(pageimg, tregion->pixels.UpperLeftCorner);
+                scaledimg->drop();
+            }
+
+            tregion->uv = rect<f32>( f32(tregion->pixels.UpperLeftCorner.X) / f32(m_PageSize), f32(tregion->pixels.UpperLeftCorner.Y) / f32(pageheight),
+                                     f32(tregion->pixels.LowerRightCorner.X) / f32(m_PageSize), f32(tregion->pixels.LowerRightCorner.Y) / f32(pageheight));
+        }
+
+        std::stringstream pagename;
+        pagename << m_Name << "_" << pagebase + i;
+
+        ITexture *newtxt = driver->addTexture(pagename.str().c_str(), pageimg);
+        pageimg->drop();
+        if(newtxt == NULL) return -4;
+
+        //set transparency color
+        driver->makeColorKeyTexture(newtxt, SColor(TRANSPARENCY_COLOR));
+
+        m_Pages.push_back(newtxt);
+    }
+
+    //images are no longer needed
+    for(int i = 0; i < int(m_Pending.size()); i++)
+    {
+        if(m_Pending[i] != NULL) m_Pending[i]->drop();
+        m_Pending[i] = NULL;
+    }
+
+    return int(m_Pages.size());
+}
+
+const AtlasRegion *TextureAtlas::getRegion(int index)
+{
+    if(index < 0 || index >= int(m_Regions.size())) return NULL;
+    if(m_Regions[index].page < 0) return NULL; // not built yet
+
+    return &m_Regions[index];
+}
+
+const AtlasSet *TextureAtlas::getSet(std::string setname)
+{
+    for(int i = 0; i < int(m_Sets.size()); i++)
+    {
+        if(m_Sets[i].name == setname) return &m_Sets[i];
+    }
+
+    return NULL;
+}
+
+ITexture *TextureAtlas::getPage(int page)
+{
+    if(page < 0 || page >= int(m_Pages.size())) return NULL;
+
+    return m_Pages[page];
+}
+
+ITexture *TextureAtlas::getRegionTexture(int index)
+{
+    const AtlasRegion *tregion = getRegion(index);
+    if(tregion == NULL) return NULL;
+
+    return getPage(tregion->page);
+}
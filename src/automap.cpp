@@ -0,0 +1,168 @@
+#include "automap.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "level.hpp"
+
+Automap::Automap()
+{
+    m_Driver = NULL;
+    m_Target = NULL;
+    m_Level = NULL;
+    m_Clear = true;
+
+    m_Open = false;
+    m_Zoom = 2;
+
+    m_LastDrawCount = 0;
+    m_TotalDrawCount = 0;
+}
+
+Automap::~Automap()
+{
+    if(m_Target != NULL && m_Driver != NULL) m_Driver->removeTexture(m_Target);
+}
+
+bool Automap::init(IVideoDriver *tdriver)
+{
+    if(tdriver == NULL) return false;
+
+    m_Driver = tdriver;
+
+    if(!m_Driver->queryFeature(EVDF_RENDER_TO_TARGET))
+    {
+        std::cout << "Render targets not supported, automap disabled\n";
+        return false;
+    }
+
+    m_Target = m_Driver->addRenderTargetTexture(dimension2d<u32>(TILE_COLS*AUTOMAP_TILE_PIXELS, TILE_ROWS*AUTOMAP_TILE_PIXELS),
+                                                "automap", ECF_A8R8G8B8);
+    if(m_Target == NULL)
+    {
+        std::cout << "Error creating automap render target\n";
+        return false;
+    }
+
+    m_Clear = true;
+
+    return true;
+}
+
+int Automap::reveal(Level *tlevel, vector2di ttile)
+{
+    if(tlevel == NULL) return 0;
+
+    int revealcount = 0;
+    for(int y = ttile.Y - AUTOMAP_REVEAL_RADIUS; y <= ttile.Y + AUTOMAP_REVEAL_RADIUS; y++)
+    {
+        for(int x = ttile.X - AUTOMAP_REVEAL_RADIUS; x <= ttile.X + AUTOMAP_REVEAL_RADIUS; x++)
+        {
+            if(!tlevel->setExplored(x, y)) continue;
+
+            //another level's tiles are drawn when it becomes current
+            if(tlevel == m_Level) m_Pending.push_back(vector2di(x, y));
+            revealcount++;
+        }
+    }
+
+    return revealcount;
+}
+
+void Automap::drawTile(int x, int y)
+{
+    Tile *ttile = m_Level->getTile(x, y);
+    if(ttile == NULL || ttile->getType() == TILETYPE_SOLID) return;
+
+    //parchment colour, higher floors are lighter
+    int height = ttile->getHeight();
+    SColor floorcolor(255, 96 + height*8, 80 + height*7, 56 + height*5);
+
+    const int tsize = AUTOMAP_TILE_PIXELS;
+    position2d<s32> tpos(x*tsize, y*tsize);
+
+    //diagonals fill the open half a row at a time
+    int ttype = ttile->getType();
+    if(ttype >= TILETYPE_D_SE && ttype <= TILETYPE_D_NW)
+    {
+        for(int r = 0; r < tsize; r++)
+        {
+            int left = 0;
+            int right = tsize;
+            if(ttype == TILETYPE_D_SE) left = tsize-1-r;
+            else if(ttype == TILETYPE_D_SW) right = r+1;
+            else if(ttype == TILETYPE_D_NE) left = r;
+            else right = tsize-r;
+
+            m_Driver->draw2DRectangle(floorcolor, rect<s32>(tpos.X + left, tpos.Y + r, tpos.X + right, tpos.Y + r + 1));
+        }
+    }
+    else m_Driver->draw2DRectangle(floorcolor, rect<s32>(tpos, dimension2d<s32>(tsize, tsize)));
+
+    if(ttile->hasDoor()) m_Driver->draw2DRectangle(SColor(255, 64, 40, 16), rect<s32>(tpos.X + 1, tpos.Y + 1, tpos.X + tsize-1, tpos.Y + tsize-1));
+}
+
+int Automap::update(Level *tlevel)
+{
+    m_LastDrawCount = 0;
+    if(m_Target == NULL || tlevel == NULL) return 0;
+
+    //new level, every tile it already has explored is queued once
+    if(tlevel != m_Level)
+    {
+        m_Level = tlevel;
+        m_Pending.clear();
+        m_Clear = true;
+
+        for(int y = 0; y < TILE_ROWS; y++)
+            for(int x = 0; x < TILE_COLS; x++) if(m_Level->isExplored(x, y)) m_Pending.push_back(vector2di(x, y));
+    }
+
+    if(m_Pending.empty() && !m_Clear) return 0;
+
+    //old tiles stay in the target, only pending ones are drawn over them
+    m_Driver->setRenderTarget(m_Target, m_Clear, false, SColor(255,0,0,0));
+    m_Clear = false;
+
+    int drawcount = std::min(int(m_Pending.size()), AUTOMAP_TILES_PER_FRAME);
+    for(int i = 0; i < drawcount; i++) drawTile(m_Pending[i].X, m_Pending[i].Y);
+    m_Pending.erase(m_Pending.begin(), m_Pending.begin() + drawcount);
+
+    m_Driver->setRenderTarget(0, false, false);
+
+    m_LastDrawCount = drawcount;
+    m_TotalDrawCount += drawcount;
+
+    return drawcount;
+}
+
+void Automap::draw(const rect<s32> &viewrect, vector2df center)
+{
+    if(m_Target == NULL) return;
+
+    m_Driver->draw2DRectangle(SColor(255,0,0,0), viewrect);
+
+    //visible part of the target, kept inside the texture
+    dimension2d<s32> tsize(m_Target->getSize().Width, m_Target->getSize().Height);
+    dimension2d<s32> srcsize(viewrect.getWidth()/m_Zoom, viewrect.getHeight()/m_Zoom);
+    if(srcsize.Width > tsize.Width) srcsize.Width = tsize.Width;
+    if(srcsize.Height > tsize.Height) srcsize.Height = tsize.Height;
+
+    position2d<s32> srcpos( s32(center.X*AUTOMAP_TILE_PIXELS) - srcsize.Width/2, s32(center.Y*AUTOMAP_TILE_PIXELS) - srcsize.Height/2);
+    srcpos.X = core::clamp(srcpos.X, 0, tsize.Width - srcsize.Width);
+    srcpos.Y = core::clamp(srcpos.Y, 0, tsize.Height - srcsize.Height);
+
+    rect<s32> srcrect(srcpos, srcsize);
+    rect<s32> dstrect(viewrect.UpperLeftCorner, dimension2d<s32>(srcsize.Width*m_Zoom, srcsize.Height*m_Zoom));
+    m_Driver->draw2DImage(m_Target, dstrect, srcrect, &viewrect);
+
+    //player marker
+    position2d<s32> ppos = dstrect.UpperLeftCorner + position2d<s32>( s32( (center.X*AUTOMAP_TILE_PIXELS - srcpos.X)*m_Zoom),
+                                                                      s32( (center.Y*AUTOMAP_TILE_PIXELS - srcpos.Y)*m_Zoom));
+    m_Driver->draw2DRectangle(SColor(255,255,0,0), rect<s32>(ppos.X - m_Zoom, ppos.Y - m_Zoom, ppos.X + m_Zoom, ppos.Y + m_Zoom), &viewrect);
+}
+
+void Automap::zoom(int steps)
+{
+    m_Zoom = core::clamp(m_Zoom + steps, 1, AUTOMAP_MAX_ZOOM);
+}
@@ -0,0 +1,630 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "game.hpp"
+#include "tools.hpp"
+#include "capture.hpp"
+
+//scripted views for the capture scenario.  the row shots stand on the open tile nearest the
+//middle column of rows spread over the level and look east and west along the row, so the
+//captures cover more of the map than the views from the player start
+struct CaptureShot
+{
+    const char *name;
+    f32 yaw;
+    bool automap;
+    int row; // tile row to stand on, -1 is the player start
+};
+
+static const CaptureShot g_CaptureShots[] = { {"start_n", 0.f, false, -1}, {"start_e", 90.f, false, -1}, {"start_s", 180.f, false, -1},
+                                              {"start_w", 270.f, false, -1}, {"automap", 0.f, true, -1},
+                                              {"row16_e", 90.f, false, 16}, {"row16_w", 270.f, false, 16},
+                                              {"row32_e", 90.f, false, 32}, {"row32_w", 270.f, false, 32},
+                                              {"row48_e", 90.f, false, 48}, {"row48_w", 270.f, false, 48} };
+
+//open tile of a row closest to the middle column, -1 if the whole row is solid
+static int findOpenColumn(Level *tlevel, int row)
+{
+    for(int i = 0; i < TILE_COLS; i++)
+    {
+        //middle, then alternating outwards
+        int x = TILE_COLS/2 + ( (i % 2) ? -(i+1)/2 : i/2);
+
+        Tile *ttile = tlevel->getTile(x, row);
+        if(ttile != NULL && ttile->getType() != TILETYPE_SOLID) return x;
+    }
+
+    return -1;
+}
+
+//////////////////////////////////////////////////////
+//  RESULTS
+void BenchmarkEntry::setValue(std::string key, double value)
+{
+    for(int i = 0; i < int(values.size()); i++)
+    {
+        if(values[i].key == key) { values[i].value = value; return;}
+    }
+
+    BenchmarkValue newvalue;
+    newvalue.key = key;
+    newvalue.value = value;
+    values.push_back(newvalue);
+}
+
+void BenchmarkEntry::setSampleStats(std::string prefix, std::vector<u32> samples)
+{
+    setValue(prefix + "count", double(samples.size()));
+    if(samples.empty()) return;
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0;
+    for(int i = 0; i < int(samples.size()); i++) total += double(samples[i]);
+
+    setValue(prefix + "avg_us", total / double(samples.size()));
+    setValue(prefix + "max_us", double(samples.back()));
+    setValue(prefix + "p50_us", double(samples[ int((samples.size()-1)*0.50f)]));
+    setValue(prefix + "p95_us", double(samples[ int((samples.size()-1)*0.95f)]));
+    setValue(prefix + "p99_us", double(samples[ int((samples.size()-1)*0.99f)]));
+}
+
+BenchmarkEntry *BenchmarkScenario::addEntry(std::string name)
+{
+    entries.push_back(BenchmarkEntry());
+    entries.back().name = name;
+
+    return &entries.back();
+}
+
+//////////////////////////////////////////////////////
+//  BENCHMARK
+Benchmark::Benchmark(Game *ngame, const BenchmarkConfig &nconfig)
+{
+    gptr = ngame;
+    m_Config = nconfig;
+    m_CaptureFailures = 0;
+}
+
+Benchmark::~Benchmark()
+{
+
+}
+
+BenchmarkConfig Benchmark::getDefaultConfig()
+{
+    BenchmarkConfig tconfig;
+    tconfig.enabled = false;
+    tconfig.driver = BENCHDRIVER_NULL;
+    tconfig.outFile = BENCHMARK_DEFAULT_OUTPUT;
+    tconfig.walkSeconds = BENCHMARK_DEFAULT_WALK_SECONDS;
+    tconfig.pickCount = BENCHMARK_DEFAULT_PICKS;
+    tconfig.captureTolerance = CAPTURE_DEFAULT_TOLERANCE;
+
+    return tconfig;
+}
+
+int Benchmark::parseArgs(int argc, char *argv[], BenchmarkConfig *tconfig)
+{
+    if(tconfig == NULL) return -1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string targ(argv[i]);
+        bool hasvalue = (i + 1 < argc);
+
+        if(targ == "--benchmark") tconfig->enabled = true;
+        else if(targ == "--bench-driver" && hasvalue)
+        {
+            std::string tdriver(argv[++i]);
+            if(tdriver == "null") tconfig->driver = BENCHDRIVER_NULL;
+            else if(tdriver == "soft") tconfig->driver = BENCHDRIVER_SOFTWARE;
+            else { std::cout << "Unknown benchmark driver : " << tdriver << std::endl; return -1;}
+        }
+        else if(targ == "--bench-out" && hasvalue) tconfig->outFile = argv[++i];
+        else if(targ == "--bench-walk" && hasvalue) tconfig->walkSeconds = atoi(argv[++i]);
+        else if(targ == "--bench-picks" && hasvalue) tconfig->pickCount = atoi(argv[++i]);
+        else if(targ == "--record" && hasvalue) tconfig->recordFile = argv[++i];
+        else if(targ == "--replay" && hasvalue) tconfig->replayFile = argv[++i];
+        else if(targ == "--trace" && hasvalue) tconfig->traceFile = argv[++i];
+        else if(targ == "--capture" && hasvalue) tconfig->captureDir = argv[++i];
+        else if(targ == "--golden" && hasvalue) tconfig->goldenDir = argv[++i];
+        else if(targ == "--capture-tolerance" && hasvalue) tconfig->captureTolerance = atoi(argv[++i]);
+        else
+        {
+            std::cout << "Unknown argument : " << targ << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void Benchmark::printUsage()
+{
+    std::cout << "Options:\n";
+    std::cout << "  --benchmark            run headless benchmark and exit\n";
+    std::cout << "  --bench-driver <name>  null (default) or soft (burnings video)\n";
+    std::cout << "  --bench-out <file>     json output, default " << BENCHMARK_DEFAULT_OUTPUT << "\n";
+    std::cout << "  --bench-walk <sec>     simulated seconds of scripted walking, 0 to skip\n";
+    std::cout << "  --bench-picks <count>  number of picking rays, 0 to skip\n";
+    std::cout << "  --record <file>        record input to a demo file\n";
+    std::cout << "  --replay <file>        replay a demo, unpaced as a scenario with --benchmark\n";
+    std::cout << "  --trace <file>         write a chrome trace of the whole run on exit\n";
+    std::cout << "  --capture <dir>        with --benchmark, write world view captures to an existing directory.\n";
+    std::cout << "                         needs --bench-driver soft, which opens a window (use xvfb-run without a display)\n";
+    std::cout << "  --golden <dir>         compare captures against golden images, mismatches fail the run\n";
+    std::cout << "  --capture-tolerance <n> per channel difference still matching, default " << CAPTURE_DEFAULT_TOLERANCE << "\n";
+}
+
+BenchmarkScenario *Benchmark::addScenario(std::string name)
+{
+    m_Scenarios.push_back(BenchmarkScenario());
+    m_Scenarios.back().name = name;
+
+    return &m_Scenarios.back();
+}
+
+int Benchmark::run()
+{
+    std::cout << "Running benchmark scenarios...\n";
+
+    runStartup();
+    runLevelGeometry();
+    //before anything moves the player or advances animations, so every run sees the same frames
+    if(!m_Config.captureDir.empty()) runCapture();
+    if(m_Config.walkSeconds > 0) runWalk();
+    if(m_Config.pickCount > 0) runPicking();
+    if(!m_Config.replayFile.empty()) runReplay();
+    //last, so peaks include every scenario
+    runMemory();
+
+    if(!writeJSON(m_Config.outFile))
+    {
+        std::cout << "Error writing benchmark results to " << m_Config.outFile << std::endl;
+        return -1;
+    }
+
+    std::cout << "Benchmark results written to " << m_Config.outFile << std::endl;
+
+    if(m_CaptureFailures)
+    {
+        std::cout << m_CaptureFailures << " captures did not match their golden images\n";
+        return -2;
+    }
+
+    return 0;
+}
+
+void Benchmark::runStartup()
+{
+    BenchmarkScenario *tscenario = addScenario("startup");
+
+    unsigned long long loadend = 0;
+
+    //one entry per load phase, times relative to game start
+    for(int i = 0; i < int(gptr->m_LoadPhases.size()); i++)
+    {
+        LoadPhase *tphase = gptr->m_LoadPhases[i];
+        unsigned long long starttime = tphase->starttime.load();
+        unsigned long long endtime = tphase->endtime.load();
+
+        BenchmarkEntry *tentry = tscenario->addEntry(tphase->name);
+        tentry->setValue("start_ms", double(starttime - gptr->m_StartTime)/1000.0);
+        tentry->setValue("ms", double(endtime - starttime)/1000.0);
+        tentry->setValue("main_thread", tphase->job->mainThread ? 1 : 0);
+
+        if(endtime > loadend) loadend = endtime;
+    }
+
+    tscenario->setValue("total_ms", double(loadend - gptr->m_StartTime)/1000.0);
+    tscenario->setValue("workers", gptr->m_Jobs->getWorkerCount());
+}
+
+void Benchmark::runLevelGeometry()
+{
+    BenchmarkScenario *tscenario = addScenario("level_geometry");
+
+    unsigned long long totaltime = 0;
+
+    //current level was built during startup, every other level is built and torn down again
+    for(int i = 0; i < int(gptr->mLevels.size()); i++)
+    {
+        if(gptr->m_LevelManager->getState(i) != LEVELSTATE_UNLOADED) continue;
+
+        Level *tlevel = &gptr->mLevels[i];
+        std::vector< std::vector<TileMeshDesc> > meshdescs;
+
+        unsigned long long starttime = getMicroseconds();
+        if(!tlevel->generateLevelMeshes(&meshdescs))
+        {
+            std::cout << "Benchmark : error generating level " << i << std::endl;
+            continue;
+        }
+        unsigned long long gentime = getMicroseconds();
+
+        int meshcount = 0;
+        for(int n = 0; n < int(meshdescs.size()); n++) meshcount += int(meshdescs[n].size());
+
+        tlevel->createLevelNodes(&meshdescs, 0, TILE_ROWS, false);
+        unsigned long long nodetime = getMicroseconds();
+
+        tlevel->clearGeometry();
+        unsigned long long cleartime = getMicroseconds();
+
+        std::stringstream levelname;
+        levelname << "level_" << i;
+        BenchmarkEntry *tentry = tscenario->addEntry(levelname.str());
+        tentry->setValue("generate_ms", double(gentime - starttime)/1000.0);
+        tentry->setValue("nodes_ms", double(nodetime - gentime)/1000.0);
+        tentry->setValue("clear_ms", double(cleartime - nodetime)/1000.0);
+        tentry->setValue("meshes", meshcount);
+
+        totaltime += cleartime - starttime;
+    }
+
+    tscenario->setValue("total_ms", double(totaltime)/1000.0);
+}
+
+void Benchmark::runCapture()
+{
+    BenchmarkScenario *tscenario = addScenario("capture");
+
+    //the null driver draws nothing, only the software driver can be read back.  it still
+    //opens a window, so on linux it needs an x server (xvfb-run for unattended runs)
+    if(m_Config.driver != BENCHDRIVER_SOFTWARE)
+    {
+        std::cout << "Benchmark : capture needs --bench-driver soft\n";
+        tscenario->setValue("error", 1);
+        m_CaptureFailures++;
+        return;
+    }
+
+    IVideoDriver *tdriver = gptr->m_Driver;
+    const rect<s32> worldrect(SCREEN_WORLD_POS_X, SCREEN_WORLD_POS_Y, SCREEN_WORLD_POS_X + SCREEN_WORLD_WIDTH, SCREEN_WORLD_POS_Y + SCREEN_WORLD_HEIGHT);
+    const int shotcount = int(sizeof(g_CaptureShots) / sizeof(CaptureShot));
+
+    //view is put back afterwards so later scenarios start from the same place
+    vector3df startpos = gptr->m_Player->getPosition();
+    vector3df startrot = gptr->m_Player->getRotation();
+    vector2di starttile = gptr->m_LastPlayerTile;
+    bool mapopen = gptr->m_Automap->isOpen();
+
+    //time stands still, colour cycles and texture scrolling don't move between runs
+    u32 now = gptr->m_Device->getTimer()->getTime();
+    gptr->frameDeltaTime = 0.f;
+
+    std::vector<u32> frametimes;
+    int failures = 0;
+
+    for(int i = 0; i < shotcount; i++)
+    {
+        if(!gptr->m_Device->run()) break;
+
+        const CaptureShot *tshot = &g_CaptureShots[i];
+        if(tshot->row < 0)
+        {
+            gptr->m_Player->setPosition(startpos);
+            gptr->m_LastPlayerTile = starttile;
+        }
+        else
+        {
+            int column = findOpenColumn(&gptr->mLevels[gptr->m_CurrentLevel], tshot->row);
+            if(column < 0 || !gptr->teleportPlayer(gptr->m_CurrentLevel, vector2di(column, tshot->row)))
+            {
+                std::cout << "Benchmark : no open tile for capture " << tshot->name << std::endl;
+                tscenario->addEntry(tshot->name)->setValue("skipped", 1);
+                continue;
+            }
+        }
+        gptr->m_Player->setRotation(vector3df(0, tshot->yaw, 0));
+        gptr->m_Automap->setOpen(tshot->automap);
+
+        //first frame settles the camera, the second is timed and captured
+        gptr->runFrame(now);
+        unsigned long long framestart = getMicroseconds();
+        gptr->runFrame(now);
+        u32 frametime = u32(getMicroseconds() - framestart);
+        frametimes.push_back(frametime);
+
+        BenchmarkEntry *tentry = tscenario->addEntry(tshot->name);
+        tentry->setValue("frame_us", frametime);
+
+        //only the world view, the scroll and cursor change between runs
+        IImage *timage = captureFrame(tdriver, worldrect);
+        if(timage == NULL)
+        {
+            tentry->setValue("error", 1);
+            failures++;
+            continue;
+        }
+
+        std::string tfile = m_Config.captureDir + "/" + tshot->name + CAPTURE_IMAGE_EXT;
+        if(!tdriver->writeImageToFile(timage, tfile.c_str())) std::cout << "Benchmark : error writing " << tfile << std::endl;
+
+        if(!m_Config.goldenDir.empty())
+        {
+            std::string goldenfile = m_Config.goldenDir + "/" + tshot->name + CAPTURE_IMAGE_EXT;
+            IImage *tgolden = tdriver->createImageFromFile(goldenfile.c_str());
+
+            if(tgolden == NULL)
+            {
+                std::cout << "Benchmark : no golden image " << goldenfile << std::endl;
+                tentry->setValue("missing_golden", 1);
+                failures++;
+            }
+            else
+            {
+                IImage *tdiff = tdriver->createImage(ECF_A8R8G8B8, timage->getDimension());
+                ImageCompareResult tresult;
+                compareImages(timage, tgolden, m_Config.captureTolerance, &tresult, tdiff);
+
+                tentry->setValue("size_match", tresult.sizematch ? 1 : 0);
+                tentry->setValue("bad_pixels", tresult.badpixels);
+                tentry->setValue("max_diff", tresult.maxdiff);
+                tentry->setValue("mean_diff", tresult.meandiff);
+                tentry->setValue("passed", tresult.passed ? 1 : 0);
+
+                //diff image goes next to the capture
+                if(!tresult.passed)
+                {
+                    std::cout << "Benchmark : capture " << tshot->name << " differs from golden, " << tresult.badpixels << " pixels\n";
+                    std::string difffile = m_Config.captureDir + "/" + tshot->name + "_diff" + CAPTURE_IMAGE_EXT;
+                    if(tresult.sizematch) tdriver->writeImageToFile(tdiff, difffile.c_str());
+                    failures++;
+                }
+
+                tdiff->drop();
+                tgolden->drop();
+            }
+        }
+
+        timage->drop();
+    }
+
+    gptr->m_Player->setPosition(startpos);
+    gptr->m_Player->setRotation(startrot);
+    gptr->m_LastPlayerTile = starttile;
+    gptr->m_Automap->setOpen(mapopen);
+
+    tscenario->setSampleStats("frame_", frametimes);
+    tscenario->setValue("shots", double(frametimes.size()));
+    tscenario->setValue("failures", failures);
+    tscenario->setValue("tolerance", m_Config.captureTolerance);
+
+    m_CaptureFailures += failures;
+}
+
+void Benchmark::runWalk()
+{
+    BenchmarkScenario *tscenario = addScenario("walk");
+
+    int framecount = (m_Config.walkSeconds*1000) / BENCHMARK_STEP_MS;
+    u32 now = gptr->m_Device->getTimer()->getTime();
+    std::vector<u32> frametimes;
+    frametimes.reserve(framecount);
+
+    gptr->m_Profiler->reset();
+    gptr->m_AllocTracker->reset();
+    unsigned long long starttime = getMicroseconds();
+
+    for(int i = 0; i < framecount; i++)
+    {
+        if(!gptr->m_Device->run()) break;
+
+        //hold forward, turn right for half a second every 3 seconds
+        u32 simtime = u32(i)*BENCHMARK_STEP_MS;
+        gptr->m_Receiver->setKeyState(KEY_KEY_W, true);
+        gptr->m_Receiver->setKeyState(KEY_KEY_D, (simtime % 3000) < 500);
+
+        now += BENCHMARK_STEP_MS;
+        gptr->frameDeltaTime = float(BENCHMARK_STEP_MS) / 1000.f;
+
+        unsigned long long framestart = getMicroseconds();
+        gptr->runFrame(now);
+        frametimes.push_back( u32(getMicroseconds() - framestart));
+    }
+
+    gptr->m_Receiver->setKeyState(KEY_KEY_W, false);
+    gptr->m_Receiver->setKeyState(KEY_KEY_D, false);
+
+    unsigned long long walltime = getMicroseconds() - starttime;
+
+    tscenario->setValue("simulated_seconds", m_Config.walkSeconds);
+    tscenario->setValue("wall_ms", double(walltime)/1000.0);
+    if(walltime) tscenario->setValue("fps", double(frametimes.size()) * 1000000.0 / double(walltime));
+    tscenario->setSampleStats("frame_", frametimes);
+
+    //steady state target is zero heap allocations per frame
+    //release builds don't count, leave the values out rather than report zeros
+    AllocTracker *ttracker = gptr->m_AllocTracker;
+    tscenario->setValue("alloc_tracking", ttracker->isEnabled() ? 1 : 0);
+    if(ttracker->isEnabled())
+    {
+        tscenario->setValue("allocs_per_frame_avg", ttracker->getAvgFrameAllocs());
+        tscenario->setValue("allocs_per_frame_max", double(ttracker->getMaxFrameAllocs()));
+        tscenario->setValue("allocating_frames", ttracker->getAllocFrameCount());
+    }
+
+    //profiler scopes cover the last PROFILER_FRAME_HISTORY frames
+    Profiler *tprofiler = gptr->m_Profiler;
+    for(int i = 0; i < tprofiler->getScopeCount(); i++)
+    {
+        ProfilerStats tstats;
+        if(!tprofiler->getStats(i, &tstats)) continue;
+
+        BenchmarkEntry *tentry = tscenario->addEntry(tprofiler->getScope(i)->name);
+        tentry->setValue("avg_us", tstats.avg);
+        tentry->setValue("max_us", tstats.max);
+        tentry->setValue("p50_us", tstats.p50);
+        tentry->setValue("p95_us", tstats.p95);
+        tentry->setValue("p99_us", tstats.p99);
+        if(ttracker->isEnabled()) tentry->setValue("allocs_last_frame", tprofiler->getScopeAllocs(i));
+    }
+}
+
+void Benchmark::runPicking()
+{
+    BenchmarkScenario *tscenario = addScenario("picking");
+
+    std::vector<u32> picktimes;
+    picktimes.reserve(m_Config.pickCount);
+    int spritehits = 0;
+    int maphits = 0;
+
+    //fixed seed lcg, same rays every run
+    u32 seed = BENCHMARK_SEED;
+
+    for(int i = 0; i < m_Config.pickCount; i++)
+    {
+        seed = seed*1103515245 + 12345;
+        int px = int((seed >> 16) % SCREEN_WIDTH);
+        seed = seed*1103515245 + 12345;
+        int py = int((seed >> 16) % SCREEN_HEIGHT);
+
+        unsigned long long starttime = getMicroseconds();
+
+        //same order as a mouse click, objects first then map
+        line3df tray = gptr->m_ColMgr->getRayFromScreenCoordinates(position2d<s32>(px, py), gptr->m_Camera);
+        if(gptr->m_SpriteBatch->pick(tray) != SPRITEBATCH_NONE) spritehits++;
+        else if(gptr->m_ColMgr->getSceneNodeFromRayBB(tray, ID_IsMap) != NULL) maphits++;
+
+        picktimes.push_back( u32(getMicroseconds() - starttime));
+    }
+
+    tscenario->setSampleStats("pick_", picktimes);
+    tscenario->setValue("sprite_hits", spritehits);
+    tscenario->setValue("map_hits", maphits);
+}
+
+void Benchmark::runReplay()
+{
+    BenchmarkScenario *tscenario = addScenario("replay");
+
+    if(!gptr->startDemoReplay(m_Config.replayFile))
+    {
+        tscenario->setValue("error", 1);
+        return;
+    }
+
+    Demo *tdemo = gptr->m_Demo;
+    std::vector<u32> frametimes;
+    frametimes.reserve(tdemo->getTickCount());
+
+    gptr->m_Profiler->reset();
+    unsigned long long starttime = getMicroseconds();
+
+    //not paced, runs as fast as the driver allows
+    while(tdemo->isReplaying())
+    {
+        if(!gptr->m_Device->run()) break;
+
+        gptr->frameDeltaTime = float(DEMO_TICK_MS) / 1000.f;
+
+        unsigned long long framestart = getMicroseconds();
+        gptr->runFrame(gptr->m_DemoBaseTime + tdemo->getTickTime());
+        frametimes.push_back( u32(getMicroseconds() - framestart));
+    }
+
+    //device closed before the end
+    if(tdemo->isReplaying()) gptr->stopDemo();
+
+    unsigned long long walltime = getMicroseconds() - starttime;
+    double simulatedms = double(frametimes.size()) * DEMO_TICK_MS;
+
+    tscenario->setValue("ticks", double(frametimes.size()));
+    tscenario->setValue("simulated_ms", simulatedms);
+    tscenario->setValue("wall_ms", double(walltime)/1000.0);
+    if(walltime) tscenario->setValue("speedup", simulatedms * 1000.0 / double(walltime));
+    tscenario->setValue("mismatches", tdemo->getMismatches());
+    tscenario->setValue("first_mismatch", tdemo->getFirstMismatch());
+    tscenario->setSampleStats("frame_", frametimes);
+}
+
+void Benchmark::runMemory()
+{
+    BenchmarkScenario *tscenario = addScenario("memory");
+    MemStats *tmem = gptr->m_MemStats;
+
+    for(int i = 0; i < MEMCAT_TOTAL; i++)
+    {
+        BenchmarkEntry *tentry = tscenario->addEntry(MemStats::getName(i));
+        tentry->setValue("current_bytes", double(tmem->getCurrent(i)));
+        tentry->setValue("peak_bytes", double(tmem->getPeak(i)));
+    }
+
+    tscenario->setValue("current_bytes", double(tmem->getTotalCurrent()));
+    tscenario->setValue("peak_bytes", double(tmem->getTotalPeak()));
+    tscenario->setValue("level_manager_resident_bytes", double(gptr->m_LevelManager->getResidentBytes()));
+}
+
+//escape string for json output
+static std::string jsonString(const std::string &tstring)
+{
+    std::stringstream jss;
+    jss << "\"";
+
+    for(int i = 0; i < int(tstring.length()); i++)
+    {
+        unsigned char tchar = tstring[i];
+
+        if(tchar == '"' || tchar == '\\') jss << "\\" << tchar;
+        else if(tchar < 0x20) jss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(tchar) << std::dec;
+        else jss << tchar;
+    }
+
+    jss << "\"";
+    return jss.str();
+}
+
+static void writeJSONValues(std::ofstream *ofile, const std::vector<BenchmarkValue> &tvalues, std::string indent)
+{
+    for(int i = 0; i < int(tvalues.size()); i++)
+    {
+        *ofile << ",\n" << indent << jsonString(tvalues[i].key) << ": " << tvalues[i].value;
+    }
+}
+
+bool Benchmark::writeJSON(std::string tfilename)
+{
+    std::ofstream ofile;
+    ofile.open(tfilename.c_str());
+    if(!ofile.is_open()) return false;
+
+    ofile << std::fixed << std::setprecision(3);
+
+    ofile << "{\n";
+    ofile << "  \"driver\": " << jsonString(m_Config.driver == BENCHDRIVER_SOFTWARE ? "soft" : "null") << ",\n";
+    ofile << "  \"step_ms\": " << BENCHMARK_STEP_MS << ",\n";
+    ofile << "  \"scenarios\": [";
+
+    for(int i = 0; i < int(m_Scenarios.size()); i++)
+    {
+        BenchmarkScenario *tscenario = &m_Scenarios[i];
+
+        if(i) ofile << ",";
+        ofile << "\n    {\n      \"name\": " << jsonString(tscenario->name);
+        writeJSONValues(&ofile, tscenario->values, "      ");
+
+        ofile << ",\n      \"entries\": [";
+        for(int n = 0; n < int(tscenario->entries.size()); n++)
+        {
+            if(n) ofile << ",";
+            ofile << "\n        {\"name\": " << jsonString(tscenario->entries[n].name);
+            writeJSONValues(&ofile, tscenario->entries[n].values, "         ");
+            ofile << "}";
+        }
+        ofile << "\n      ]\n    }";
+    }
+
+    ofile << "\n  ]\n}\n";
+    ofile.close();
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "capture.hpp"
+
+#include <cstdlib>
+
+IImage *captureFrame(IVideoDriver *tdriver, const rect<s32> &trect)
+{
+    if(tdriver == NULL) return NULL;
+
+    IImage *tshot = tdriver->createScreenShot();
+    if(tshot == NULL) return NULL;
+
+    IImage *tcrop = tdriver->createImage(ECF_A8R8G8B8, dimension2d<u32>(trect.getWidth(), trect.getHeight()));
+    tshot->copyTo(tcrop, position2d<s32>(0,0), trect);
+    tshot->drop();
+
+    return tcrop;
+}
+
+bool compareImages(IImage *timage, IImage *tgolden, int tolerance, ImageCompareResult *tresult, IImage *tdiff)
+{
+    if(timage == NULL || tgolden == NULL || tresult == NULL) return false;
+
+    tresult->sizematch = (timage->getDimension() == tgolden->getDimension());
+    tresult->badpixels = 0;
+    tresult->maxdiff = 0;
+    tresult->meandiff = 0;
+    tresult->passed = false;
+
+    if(!tresult->sizematch) return false;
+
+    dimension2d<u32> tsize = timage->getDimension();
+    if(tdiff != NULL && tdiff->getDimension() != tsize) tdiff = NULL;
+
+    double totaldiff = 0;
+    for(u32 y = 0; y < tsize.Height; y++)
+    {
+        for(u32 x = 0; x < tsize.Width; x++)
+        {
+            SColor c1 = timage->getPixel(x, y);
+            SColor c2 = tgolden->getPixel(x, y);
+
+            int rdiff = abs(int(c1.getRed()) - int(c2.getRed()));
+            int gdiff = abs(int(c1.getGreen()) - int(c2.getGreen()));
+            int bdiff = abs(int(c1.getBlue()) - int(c2.getBlue()));
+            int pixeldiff = core::max_(rdiff, gdiff, bdiff);
+
+            totaldiff += rdiff + gdiff + bdiff;
+            if(pixeldiff > tresult->maxdiff) tresult->maxdiff = pixeldiff;
+
+            bool bad = pixeldiff > tolerance;
+            if(bad) tresult->badpixels++;
+
+            if(tdiff != NULL)
+            {
+                if(bad) tdiff->setPixel(x, y, SColor(255, 255, 0, 0));
+                else tdiff->setPixel(x, y, SColor(255, c1.getRed()/4, c1.getGreen()/4, c1.getBlue()/4));
+            }
+        }
+    }
+
+    u32 pixelcount = tsize.Width * tsize.Height;
+    if(pixelcount) tresult->meandiff = totaldiff / double(pixelcount*3);
+    tresult->passed = tresult->badpixels <= int(pixelcount * CAPTURE_MAX_BAD_FRACTION);
+
+    return tresult->passed;
+}
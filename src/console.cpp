@@ -1,4 +1,5 @@
 #include "console.hpp"
+#include <cstdlib>
 #include <sstream>
 
 Console *Console::m_Instance = NULL;
@@ -7,6 +8,9 @@ Console::Console()
 {
     //get game ref
     gptr = Game::getInstance();
+
+    registerCommands();
+    registerVars();
 }
 
 Console::~Console()
@@ -19,75 +23,506 @@ void Console::addMessage(std::string msgstring, int fonttype, SColor fcolor)
     gptr->addMessage(msgstring, fonttype, fcolor);
 }
 
+void Console::splitWords(const std::string &cmdstring, std::vector<std::string> *words)
+{
+    words->clear();
+
+    //one copy per word, repeated spaces are skipped
+    size_t tstart = cmdstring.find_first_not_of(' ');
+    while(tstart != std::string::npos)
+    {
+        size_t tend = cmdstring.find_first_of(' ', tstart);
+        if(tend == std::string::npos) tend = cmdstring.length();
+
+        words->push_back( cmdstring.substr(tstart, tend - tstart));
+        tstart = cmdstring.find_first_not_of(' ', tend);
+    }
+}
+
 void Console::parse(std::string cmdstring)
 {
-    std::vector<std::string> words;
+    splitWords(cmdstring, &m_Words);
+    if(m_Words.empty()) return;
 
-    //parse out each word from strings and store in vector
-    size_t tpos = cmdstring.find_first_of(' ');
-    while(tpos != std::string::npos)
+    std::unordered_map<std::string, ConsoleCommand>::iterator cmdit = m_Commands.find(m_Words[0]);
+    if(cmdit != m_Commands.end())
     {
-        words.push_back( cmdstring.substr(0, tpos));
-        cmdstring = cmdstring.substr(tpos+1);
-        tpos = cmdstring.find_first_of(' ');
+        cmdit->second.func(m_Words);
+        return;
     }
-    words.push_back(cmdstring);
 
-    if( int(words.size()) > 0)
+    //"name" prints a value, "name value" sets it
+    std::unordered_map<std::string, ConsoleVar>::iterator varit = m_Vars.find(m_Words[0]);
+    if(varit != m_Vars.end())
     {
-        if(words[0] == "light")
+        ConsoleVar *tvar = &varit->second;
+
+        if(int(m_Words.size()) >= 2)
         {
-            if( int(words.size()) == 5)
-            {
-                if(words[1] == "a")
-                {
-                    //x,y,z = constant, linear, quadratic
-                    vector3df attenuation;
-                    attenuation.X = atof(words[2].c_str());
-                    attenuation.Y = atof(words[3].c_str());
-                    attenuation.Z = atof(words[4].c_str());
-
-                    gptr->m_CameraLight->getLightData().Attenuation = attenuation;
-                    addMessage("Setting light attenuation:");
-                    std::stringstream attss;
-                    attss << words[2] << "," << words[3] << "," << words[4];
-                    addMessage(attss.str());
-                }
+            if(!tvar->set) addMessage(m_Words[0] + " is read only");
+            else if(!tvar->set(m_Words[1])) addMessage("Invalid value for " + m_Words[0]);
+        }
 
-            }
-            else if( int(words.size()) == 3)
+        addMessage(m_Words[0] + " = " + tvar->get());
+        return;
+    }
+
+    addMessage("Unknown command " + m_Words[0]);
+}
+
+void Console::registerCommand(std::string name, ConsoleFunc func, std::string help)
+{
+    ConsoleCommand newcmd;
+    newcmd.func = func;
+    newcmd.help = help;
+
+    m_Vars.erase(name);
+    m_Commands[name] = newcmd;
+    m_Names.insert(name);
+}
+
+void Console::registerInt(std::string name, std::function<int()> get, std::function<void(int)> set, int minval, int maxval, std::string help)
+{
+    ConsoleVar newvar;
+    newvar.help = help;
+    newvar.get = [get]
+    {
+        std::stringstream valss;
+        valss << get();
+        return valss.str();
+    };
+    if(set) newvar.set = [set, minval, maxval](const std::string &value)
+    {
+        char *tend = NULL;
+        long tval = strtol(value.c_str(), &tend, 10);
+        if(tend == value.c_str() || *tend != '\0') return false;
+
+        set( core::clamp(int(tval), minval, maxval));
+        return true;
+    };
+
+    m_Commands.erase(name);
+    m_Vars[name] = newvar;
+    m_Names.insert(name);
+}
+
+void Console::registerFloat(std::string name, std::function<f32()> get, std::function<void(f32)> set, f32 minval, f32 maxval, std::string help)
+{
+    ConsoleVar newvar;
+    newvar.help = help;
+    newvar.get = [get]
+    {
+        std::stringstream valss;
+        valss << get();
+        return valss.str();
+    };
+    if(set) newvar.set = [set, minval, maxval](const std::string &value)
+    {
+        char *tend = NULL;
+        f32 tval = f32(strtod(value.c_str(), &tend));
+        if(tend == value.c_str() || *tend != '\0') return false;
+
+        set( core::clamp(tval, minval, maxval));
+        return true;
+    };
+
+    m_Commands.erase(name);
+    m_Vars[name] = newvar;
+    m_Names.insert(name);
+}
+
+void Console::registerBool(std::string name, std::function<bool()> get, std::function<void(bool)> set, std::string help)
+{
+    ConsoleVar newvar;
+    newvar.help = help;
+    newvar.get = [get]{ return std::string(get() ? "1" : "0");};
+    if(set) newvar.set = [set](const std::string &value)
+    {
+        if(value == "1" || value == "on") set(true);
+        else if(value == "0" || value == "off") set(false);
+        else return false;
+
+        return true;
+    };
+
+    m_Commands.erase(name);
+    m_Vars[name] = newvar;
+    m_Names.insert(name);
+}
+
+int Console::complete(std::string *tstring, std::vector<std::string> *matches)
+{
+    if(tstring == NULL || matches == NULL) return 0;
+    matches->clear();
+
+    //only the command name completes
+    if(tstring->find(' ') != std::string::npos) return 0;
+
+    //names sharing the prefix are next to each other in the sorted set
+    for(std::set<std::string>::iterator it = m_Names.lower_bound(*tstring); it != m_Names.end(); ++it)
+    {
+        if(it->compare(0, tstring->length(), *tstring) != 0) break;
+        matches->push_back(*it);
+    }
+
+    if(matches->empty()) return 0;
+    if(int(matches->size()) == 1)
+    {
+        *tstring = (*matches)[0] + " ";
+        return 1;
+    }
+
+    //extend to the longest prefix all candidates share
+    size_t common = (*matches)[0].length();
+    for(int i = 1; i < int(matches->size()); i++)
+    {
+        size_t n = 0;
+        while(n < common && n < (*matches)[i].length() && (*matches)[i][n] == (*matches)[0][n]) n++;
+        common = n;
+    }
+    *tstring = (*matches)[0].substr(0, common);
+
+    return int(matches->size());
+}
+
+void Console::registerCommands()
+{
+    registerCommand("help", [this](const std::vector<std::string> &words)
+    {
+        //"help name" describes one command or value, "help" lists them all
+        if(int(words.size()) == 2)
+        {
+            std::unordered_map<std::string, ConsoleCommand>::iterator cmdit = m_Commands.find(words[1]);
+            std::unordered_map<std::string, ConsoleVar>::iterator varit = m_Vars.find(words[1]);
+            if(cmdit != m_Commands.end()) addMessage(words[1] + ": " + cmdit->second.help);
+            else if(varit != m_Vars.end()) addMessage(words[1] + ": " + varit->second.help);
+            else addMessage("Unknown command " + words[1]);
+            return;
+        }
+
+        std::string namelist;
+        for(std::set<std::string>::iterator it = m_Names.begin(); it != m_Names.end(); ++it) namelist += *it + " ";
+        addMessage(namelist);
+    }, "'help name' describes a command or value");
+
+    registerCommand("light", [this](const std::vector<std::string> &words)
+    {
+        if( int(words.size()) == 5)
+        {
+            if(words[1] == "a")
             {
-                if(words[1] == "r")
-                {
-                    float lradius = atof(words[2].c_str());
-                    gptr->m_CameraLight->setRadius(lradius);
-                    std::stringstream lradss;
-                    lradss << "Setting light radius = " << lradius;
-                    addMessage(lradss.str());
-                }
+                //x,y,z = constant, linear, quadratic
+                vector3df attenuation;
+                attenuation.X = atof(words[2].c_str());
+                attenuation.Y = atof(words[3].c_str());
+                attenuation.Z = atof(words[4].c_str());
+
+                gptr->m_CameraLight->getLightData().Attenuation = attenuation;
+                addMessage("Setting light attenuation:");
+                std::stringstream attss;
+                attss << words[2] << "," << words[3] << "," << words[4];
+                addMessage(attss.str());
             }
+
         }
-        else if(words[0] == "stringdump")
+        else if( int(words.size()) == 3)
         {
-            std::cout << "Dumping strings to stringdump.txt\n";
-            addMessage("Dumping strings.");
-            gptr->dbg_stringdump();
+            if(words[1] == "r")
+            {
+                float lradius = atof(words[2].c_str());
+                gptr->m_CameraLight->setRadius(lradius);
+                std::stringstream lradss;
+                lradss << "Setting light radius = " << lradius;
+                addMessage(lradss.str());
+            }
         }
-        else if(words[0] == "uianim")
+    }, "'light a x y z' sets attenuation, 'light r n' sets radius");
+
+    registerCommand("stringdump", [this](const std::vector<std::string> &words)
+    {
+        std::cout << "Dumping strings to stringdump.txt\n";
+        addMessage("Dumping strings.");
+        gptr->dbg_stringdump();
+    }, "write all game strings to stringdump.txt");
+
+    registerCommand("uianim", [this](const std::vector<std::string> &words)
+    {
+        if(int(words.size()) == 2)
         {
-            if(int(words.size()) == 2)
+            int aindex = atoi(words[1].c_str());
+
+            if(aindex >= 0 && aindex < int(gptr->m_UIAnimations.size()) )
             {
-                int aindex = atoi(words[1].c_str());
-
-                if(aindex >= 0 && aindex < int(gptr->m_UIAnimations.size()) )
-                {
-                    addMessage( std::string("Animating main UI " + gptr->m_UIAnimations[aindex].name) );
-                    gptr->m_UIAnimations[aindex].state = 1;
-                }
-                else addMessage("uianim index out of bounds");
+                addMessage( std::string("Animating main UI " + gptr->m_UIAnimations[aindex].name) );
+                gptr->m_UIAnimations[aindex].state = 1;
             }
-            else addMessage("uinim incorrect parameters");
+            else addMessage("uianim index out of bounds");
+        }
+        else addMessage("uinim incorrect parameters");
 
+    }, "'uianim n' plays main UI animation n");
+
+    registerCommand("jobs", [this](const std::vector<std::string> &words)
+    {
+        JobSystem *tjobs = gptr->m_Jobs;
+        if(tjobs == NULL) return;
+
+        std::stringstream jobsss;
+        jobsss << "Job workers:" << tjobs->getWorkerCount();
+        addMessage(jobsss.str());
+
+        for(int i = 0; i < tjobs->getWorkerCount(); i++)
+        {
+            jobsss.str("");
+            jobsss << i << ": " << int(tjobs->getWorkerUtilization(i)*100) << "% " << tjobs->getWorkerJobsRun(i) << " jobs " << tjobs->getWorkerSteals(i) << " steals";
+            addMessage(jobsss.str());
         }
-    }
+
+        //"jobs r" starts a new measurement window
+        if(int(words.size()) == 2 && words[1] == "r") tjobs->resetStats();
+    }, "job worker stats, 'jobs r' resets them");
+
+    registerCommand("startup", [this](const std::vector<std::string> &words)
+    {
+        std::stringstream startss;
+        startss << "First frame:" << gptr->m_FirstFrameTime/1000 << "ms";
+        addMessage(startss.str());
+
+        //full per phase breakdown goes to stdout
+        gptr->printLoadPhases();
+    }, "time to first frame and load phases");
+
+    registerCommand("perf", [this](const std::vector<std::string> &words)
+    {
+        Profiler *tprofiler = gptr->m_Profiler;
+
+        //"perf r" clears history, "perf p" prints to stdout, "perf" toggles the overlay
+        if(int(words.size()) == 2 && words[1] == "r") tprofiler->reset();
+        else if(int(words.size()) == 2 && words[1] == "p") tprofiler->printStats();
+        else tprofiler->setOverlayVisible(!tprofiler->isOverlayVisible());
+    }, "toggle frame time overlay, 'perf r' resets, 'perf p' prints");
+
+    registerCommand("level", [this](const std::vector<std::string> &words)
+    {
+        LevelManager *tmanager = gptr->m_LevelManager;
+        if(tmanager == NULL) return;
+
+        //"level n" goes to level n, "level b mb" sets the resident budget
+        if(int(words.size()) == 2) gptr->changeLevel(atoi(words[1].c_str()));
+        else if(int(words.size()) == 3 && words[1] == "b") tmanager->setBudget(unsigned(atoi(words[2].c_str()))*1024*1024);
+
+        std::stringstream levelss;
+        levelss << "Level:" << gptr->m_CurrentLevel << " Resident:" << tmanager->getResidentBytes()/1024 << "KB";
+        addMessage(levelss.str());
+
+        levelss.str("");
+        levelss << "Last change:" << tmanager->getLastTransitionTime() << "us Misses:" << tmanager->getMisses();
+        addMessage(levelss.str());
+
+        tmanager->printDebug();
+    }, "'level n' changes level, 'level b mb' sets resident budget");
+
+    registerCommand("mem", [this](const std::vector<std::string> &words)
+    {
+        MemStats *tmem = gptr->m_MemStats;
+
+        long long texbytes = 0;
+        for(int i = MEMCAT_TEX_WALL64; i <= MEMCAT_TEX_FONTS; i++) texbytes += tmem->getCurrent(i);
+
+        std::stringstream memss;
+        memss << "Mem:" << tmem->getTotalCurrent()/1024 << "KB Peak:" << tmem->getTotalPeak()/1024 << "KB";
+        addMessage(memss.str());
+        memss.str("");
+        memss << "Tex:" << texbytes/1024 << "KB Mesh:" << (tmem->getCurrent(MEMCAT_MESH_VERTICES) + tmem->getCurrent(MEMCAT_MESH_INDICES))/1024
+              << "KB Col:" << tmem->getCurrent(MEMCAT_COLLISION)/1024 << "KB";
+        addMessage(memss.str());
+
+        //objects still allocated in each level pool, these never shrink if instances leak
+        int usedobjects = 0;
+        for(int i = 0; i < int(gptr->mLevels.size()); i++) usedobjects += gptr->mLevels[i].getObjectPool()->getUsedCount();
+        memss.str("");
+        memss << "Objects in use:" << usedobjects;
+        addMessage(memss.str());
+
+        //every category goes to stdout
+        tmem->printStats();
+    }, "memory use by category");
+
+    registerCommand("alloc", [this](const std::vector<std::string> &words)
+    {
+        AllocTracker *ttracker = gptr->m_AllocTracker;
+        if(!ttracker->isEnabled())
+        {
+            addMessage("Allocation tracking disabled in this build");
+            return;
+        }
+
+        //"alloc r" restarts steady state counting, "alloc s n" samples every nth main thread allocation
+        if(int(words.size()) == 2 && words[1] == "r") ttracker->reset();
+        else if(int(words.size()) == 3 && words[1] == "s")
+        {
+            ttracker->clearSites();
+            ttracker->setSampling(atoi(words[2].c_str()));
+        }
+
+        std::stringstream allocss;
+        allocss << "Allocs last frame:" << ttracker->getLastFrameAllocs() << " All threads:" << ttracker->getLastFrameTotalAllocs();
+        addMessage(allocss.str());
+        allocss.str("");
+        allocss << "Frames:" << ttracker->getFrameCount() << " Allocating:" << ttracker->getAllocFrameCount() << " Max:" << ttracker->getMaxFrameAllocs();
+        addMessage(allocss.str());
+
+        //per phase counts and sampled sites go to stdout
+        ttracker->printStats();
+        gptr->m_Profiler->printStats();
+    }, "allocation counts, 'alloc r' resets, 'alloc s n' samples");
+
+    registerCommand("trace", [this](const std::vector<std::string> &words)
+    {
+        Tracer *ttracer = gptr->m_Tracer;
+
+        //"trace w file" writes the trace so far, "trace" toggles recording
+        if(int(words.size()) >= 2 && words[1] == "w")
+        {
+            std::string tfilename = (int(words.size()) == 3) ? words[2] : std::string(TRACE_DEFAULT_OUTPUT);
+            if(ttracer->write(tfilename)) addMessage("Trace written to " + tfilename);
+            else addMessage("Error writing trace to " + tfilename);
+        }
+        else
+        {
+            if(ttracer->isEnabled()) ttracer->stop();
+            else ttracer->start();
+
+            std::stringstream tracess;
+            tracess << "Tracing " << (ttracer->isEnabled() ? "on" : "off") << ", " << ttracer->getEventCount() << " events";
+            if(ttracer->getDroppedCount()) tracess << ", " << ttracer->getDroppedCount() << " dropped";
+            addMessage(tracess.str());
+        }
+    }, "toggle tracing, 'trace w file' writes it");
+
+    registerCommand("demo", [this](const std::vector<std::string> &words)
+    {
+        //"demo rec file" / "demo play file" start before the next frame, "demo stop" ends now
+        if(int(words.size()) == 3 && (words[1] == "rec" || words[1] == "play"))
+        {
+            gptr->m_PendingDemoState = (words[1] == "rec") ? DEMO_RECORDING : DEMO_REPLAYING;
+            gptr->m_PendingDemoFile = words[2];
+        }
+        else if(int(words.size()) == 2 && words[1] == "stop") gptr->stopDemo();
+        else addMessage("demo rec <file>, demo play <file> or demo stop");
+    }, "'demo rec file', 'demo play file' or 'demo stop'");
+
+    registerCommand("pal", [this](const std::vector<std::string> &words)
+    {
+        PaletteManager *tpal = &gptr->m_PaletteManager;
+
+        //"pal c" toggles colour cycling
+        if(int(words.size()) == 2 && words[1] == "c") tpal->setCycling(!tpal->isCycling());
+
+        std::stringstream palss;
+        palss << "Palette:" << (tpal->isShaderMode() ? "shader" : "software") << " Indexed:" << tpal->getTextureCount()
+              << " Cycling:" << (tpal->isCycling() ? "on" : "off");
+        addMessage(palss.str());
+        palss.str("");
+        palss << "Last remap:" << tpal->getLastRemapCount() << " textures";
+        addMessage(palss.str());
+    }, "palette stats, 'pal c' toggles colour cycling");
+
+    registerCommand("map", [this](const std::vector<std::string> &words)
+    {
+        Automap *tmap = gptr->m_Automap;
+
+        std::stringstream mapss;
+        mapss << "Automap:" << (tmap->isValid() ? "" : "no target ") << "Zoom:" << tmap->getZoom() << " Pending:" << tmap->getPendingCount()
+              << " Drawn:" << tmap->getLastDrawCount() << "/" << tmap->getTotalDrawCount();
+        addMessage(mapss.str());
+    }, "automap stats");
+
+    registerCommand("texanim", [this](const std::vector<std::string> &words)
+    {
+        TextureAnimator *tanim = &gptr->m_TextureAnimator;
+
+        //"texanim s" stops / starts terrain animation
+        if(int(words.size()) == 2 && words[1] == "s") tanim->setEnabled(!tanim->isEnabled());
+
+        std::stringstream animss;
+        animss << "Animated textures:" << tanim->getGroupCount() << " Updated:" << tanim->getLastUpdateCount()
+               << " Running:" << (tanim->isEnabled() ? "yes" : "no");
+        addMessage(animss.str());
+    }, "animated texture stats, 'texanim s' pauses");
+
+    registerCommand("shade", [this](const std::vector<std::string> &words)
+    {
+        //"shade t" toggles table and dynamic lighting, "shade l n" sets the light level
+        bool shadeok = true;
+        if(int(words.size()) == 2 && words[1] == "t")
+        {
+            shadeok = gptr->setShading( (gptr->m_ShadingMode == SHADING_TABLE) ? SHADING_DYNAMIC : SHADING_TABLE, gptr->m_ShadeLevel);
+        }
+        else if(int(words.size()) == 3 && words[1] == "l") shadeok = gptr->setShading(gptr->m_ShadingMode, atoi(words[2].c_str()));
+        if(!shadeok) addMessage("No such light level, shading unchanged");
+
+        std::stringstream shadess;
+        shadess << "Shading:" << (gptr->m_ShadingMode == SHADING_TABLE ? "table" : "dynamic") << " Level:" << gptr->m_ShadeLevel
+                << "/" << gptr->m_ShadeTable.getLightLevelCount() << " Range:" << gptr->m_ShadeTable.getRange(gptr->m_ShadeLevel);
+        addMessage(shadess.str());
+    }, "'shade t' toggles table lighting, 'shade l n' sets light level");
+
+    registerCommand("sched", [this](const std::vector<std::string> &words)
+    {
+        EntityScheduler *tsched = gptr->m_Scheduler;
+        if(tsched == NULL) return;
+
+        if(int(words.size()) == 3)
+        {
+            //radius in tiles
+            if(words[1] == "r") tsched->setRadius(atoi(words[2].c_str()));
+            //update budget in microseconds
+            else if(words[1] == "b") tsched->setBudget(u32(atoi(words[2].c_str())));
+        }
+
+        std::stringstream schedss;
+        schedss << "Active:" << tsched->getActiveCount() << " Asleep:" << tsched->getSleepingCount();
+        addMessage(schedss.str());
+        schedss.str("");
+        schedss << "Radius:" << tsched->getRadius() << " Budget:" << tsched->getBudget() << "us Overruns:" << tsched->getBudgetOverruns();
+        addMessage(schedss.str());
+    }, "entity scheduler stats, 'sched r tiles', 'sched b us'");
+}
+
+void Console::registerVars()
+{
+    //render
+    registerFloat("cull_distance", [this]{ return gptr->m_Camera->getFarValue();},
+                  [this](f32 value){ gptr->m_Camera->setFarValue(value);}, 1.f, 1000.f, "camera far plane in world units");
+    registerFloat("light_radius", [this]{ return gptr->m_CameraLight->getRadius();},
+                  [this](f32 value){ gptr->m_CameraLight->setRadius(value);}, 0.f, 1000.f, "camera light radius in world units");
+    //shade_level is registered once shades.dat is loaded, its range depends on the file
+    registerBool("pal_cycle", [this]{ return gptr->m_PaletteManager.isCycling();},
+                 [this](bool value){ gptr->m_PaletteManager.setCycling(value);}, "water and lava colour cycling");
+    registerBool("texanim_run", [this]{ return gptr->m_TextureAnimator.isEnabled();},
+                 [this](bool value){ gptr->m_TextureAnimator.setEnabled(value);}, "water and lava texture scrolling");
+    registerInt("map_zoom", [this]{ return gptr->m_Automap->getZoom();},
+                [this](int value){ gptr->m_Automap->zoom(value - gptr->m_Automap->getZoom());}, 1, AUTOMAP_MAX_ZOOM, "automap screen pixels per texel");
+
+    //level streaming
+    registerInt("level_budget", [this]{ return gptr->m_LevelManager ? int(gptr->m_LevelManager->getBudget()/(1024*1024)) : 0;},
+                [this](int value){ if(gptr->m_LevelManager) gptr->m_LevelManager->setBudget(unsigned(value)*1024*1024);},
+                1, 4096, "megabytes of level geometry kept resident");
+    registerInt("level_rows", [this]{ return gptr->m_LevelManager ? gptr->m_LevelManager->getRowsPerFrame() : 0;},
+                [this](int value){ if(gptr->m_LevelManager) gptr->m_LevelManager->setRowsPerFrame(value);},
+                1, TILE_ROWS, "tile rows of a prebuilt level given scene nodes per frame");
+
+    //entity updates
+    registerInt("sched_radius", [this]{ return gptr->m_Scheduler ? gptr->m_Scheduler->getRadius() : 0;},
+                [this](int value){ if(gptr->m_Scheduler) gptr->m_Scheduler->setRadius(value);}, 1, TILE_COLS, "entity wake radius in tiles");
+    registerInt("sched_budget", [this]{ return gptr->m_Scheduler ? int(gptr->m_Scheduler->getBudget()) : 0;},
+                [this](int value){ if(gptr->m_Scheduler) gptr->m_Scheduler->setBudget(u32(value));}, 0, 1000000, "entity update budget in microseconds");
+
+    //workers are started once, so the count is read only
+    registerInt("jobs_workers", [this]{ return gptr->m_Jobs ? gptr->m_Jobs->getWorkerCount() : 0;}, std::function<void(int)>(), 0, 0,
+                "job worker threads");
+
+    //debug
+    registerBool("dbg_noclip", [this]{ return gptr->dbg_noclip;}, [this](bool value){ gptr->dbg_noclip = value;}, "walk through walls");
 }
@@ -0,0 +1,315 @@
+#include "demo.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+//little endian file helpers
+static void writeValue(std::ofstream *ofile, u32 value, int length)
+{
+    for(int i = 0; i < length; i++)
+    {
+        char tbyte = char( (value >> (i*8)) & 0xff);
+        ofile->write(&tbyte, 1);
+    }
+}
+
+static void writeFloat(std::ofstream *ofile, f32 value)
+{
+    u32 tbits = 0;
+    memcpy(&tbits, &value, sizeof(tbits));
+    writeValue(ofile, tbits, 4);
+}
+
+static void writeVector(std::ofstream *ofile, const vector3df &tvec)
+{
+    writeFloat(ofile, tvec.X);
+    writeFloat(ofile, tvec.Y);
+    writeFloat(ofile, tvec.Z);
+}
+
+static bool readValue(std::ifstream *ifile, u32 *value, int length)
+{
+    unsigned char tbytes[4];
+    if(!ifile->read( (char*)tbytes, length)) return false;
+
+    *value = 0;
+    for(int i = 0; i < length; i++) *value |= u32(tbytes[i]) << (i*8);
+
+    return true;
+}
+
+static bool readFloat(std::ifstream *ifile, f32 *value)
+{
+    u32 tbits = 0;
+    if(!readValue(ifile, &tbits, 4)) return false;
+
+    memcpy(value, &tbits, sizeof(tbits));
+    return true;
+}
+
+static bool readVector(std::ifstream *ifile, vector3df *tvec)
+{
+    return readFloat(ifile, &tvec->X) && readFloat(ifile, &tvec->Y) && readFloat(ifile, &tvec->Z);
+}
+
+Demo::Demo()
+{
+    m_State = DEMO_IDLE;
+    m_TickIndex = 0;
+    m_Mismatches = 0;
+    m_FirstMismatch = -1;
+}
+
+Demo::~Demo()
+{
+
+}
+
+bool Demo::startRecording(std::string tfilename, const DemoStart &tstart)
+{
+    if(m_State != DEMO_IDLE) return false;
+
+    m_Filename = tfilename;
+    m_Start = tstart;
+    m_Ticks.clear();
+    m_Ticks.push_back(DemoTick());
+    m_TickIndex = 0;
+
+    m_State = DEMO_RECORDING;
+
+    return true;
+}
+
+void Demo::recordEvent(const SEvent &tevent)
+{
+    if(m_State != DEMO_RECORDING) return;
+
+    //only input the simulation reacts to
+    if(tevent.EventType != EET_KEY_INPUT_EVENT && tevent.EventType != EET_MOUSE_INPUT_EVENT) return;
+
+    m_Ticks.back().events.push_back(tevent);
+}
+
+bool Demo::startReplay()
+{
+    if(m_State != DEMO_IDLE || m_Ticks.empty()) return false;
+
+    m_TickIndex = 0;
+    m_Mismatches = 0;
+    m_FirstMismatch = -1;
+
+    m_State = DEMO_REPLAYING;
+
+    return true;
+}
+
+const std::vector<SEvent> *Demo::getReplayEvents()
+{
+    if(m_State != DEMO_REPLAYING || m_TickIndex >= int(m_Ticks.size())) return NULL;
+
+    return &m_Ticks[m_TickIndex].events;
+}
+
+bool Demo::endTick(u32 checksum)
+{
+    if(m_State == DEMO_RECORDING)
+    {
+        m_Ticks.back().checksum = checksum;
+        m_Ticks.push_back(DemoTick());
+        m_TickIndex++;
+
+        return true;
+    }
+    else if(m_State == DEMO_REPLAYING)
+    {
+        if(m_TickIndex >= int(m_Ticks.size())) return false;
+
+        //replay drifted from the recording
+        if(m_Ticks[m_TickIndex].checksum != checksum)
+        {
+            if(m_FirstMismatch < 0) m_FirstMismatch = m_TickIndex;
+            m_Mismatches++;
+        }
+
+        m_TickIndex++;
+
+        return m_TickIndex < int(m_Ticks.size());
+    }
+
+    return false;
+}
+
+bool Demo::stop()
+{
+    bool saved = true;
+
+    if(m_State == DEMO_RECORDING)
+    {
+        //last tick was never finished
+        m_Ticks.pop_back();
+        saved = save(m_Filename);
+    }
+
+    m_State = DEMO_IDLE;
+
+    return saved;
+}
+
+bool Demo::save(std::string tfilename)
+{
+    std::ofstream ofile;
+    ofile.open(tfilename.c_str(), std::ios_base::binary);
+    if(!ofile.is_open()) return false;
+
+    //header
+    ofile.write(DEMO_MAGIC, 4);
+    writeValue(&ofile, DEMO_VERSION, 2);
+    writeValue(&ofile, DEMO_TICK_MS, 2);
+
+    //starting state
+    writeValue(&ofile, u32(m_Start.level), 4);
+    writeVector(&ofile, m_Start.position);
+    writeVector(&ofile, m_Start.rotation);
+    writeVector(&ofile, m_Start.velocity);
+    writeValue(&ofile, u32(m_Start.mousePosition.X), 4);
+    writeValue(&ofile, u32(m_Start.mousePosition.Y), 4);
+    writeValue(&ofile, u32(m_Start.lastTile.X), 4);
+    writeValue(&ofile, u32(m_Start.lastTile.Y), 4);
+    writeValue(&ofile, u32(m_Start.inputContext), 4);
+
+    //ticks, most are just an empty event count and the checksum
+    writeValue(&ofile, u32(m_Ticks.size()), 4);
+    for(int i = 0; i < int(m_Ticks.size()); i++)
+    {
+        const std::vector<SEvent> *tevents = &m_Ticks[i].events;
+        writeValue(&ofile, u32(tevents->size()), 2);
+
+        for(int n = 0; n < int(tevents->size()); n++)
+        {
+            const SEvent *tevent = &(*tevents)[n];
+
+            if(tevent->EventType == EET_KEY_INPUT_EVENT)
+            {
+                writeValue(&ofile, DEMOEVENT_KEY, 1);
+                writeValue(&ofile, u32(tevent->KeyInput.Key), 1);
+                writeValue(&ofile, u32(tevent->KeyInput.Char), 2);
+                writeValue(&ofile, (tevent->KeyInput.PressedDown ? 1 : 0) | (tevent->KeyInput.Shift ? 2 : 0) | (tevent->KeyInput.Control ? 4 : 0), 1);
+            }
+            else
+            {
+                writeValue(&ofile, DEMOEVENT_MOUSE, 1);
+                writeValue(&ofile, u32(tevent->MouseInput.X), 2);
+                writeValue(&ofile, u32(tevent->MouseInput.Y), 2);
+                writeFloat(&ofile, tevent->MouseInput.Wheel);
+                writeValue(&ofile, u32(tevent->MouseInput.Event), 1);
+                writeValue(&ofile, u32(tevent->MouseInput.ButtonStates), 1);
+                writeValue(&ofile, (tevent->MouseInput.Shift ? 1 : 0) | (tevent->MouseInput.Control ? 2 : 0), 1);
+            }
+        }
+
+        writeValue(&ofile, m_Ticks[i].checksum, 4);
+    }
+
+    ofile.close();
+
+    return true;
+}
+
+bool Demo::load(std::string tfilename)
+{
+    if(m_State != DEMO_IDLE) return false;
+
+    std::ifstream ifile;
+    ifile.open(tfilename.c_str(), std::ios_base::binary);
+    if(!ifile.is_open()) return false;
+
+    char magic[4];
+    u32 version = 0;
+    u32 tickms = 0;
+    ifile.read(magic, 4);
+    if(!ifile || strncmp(magic, DEMO_MAGIC, 4)) { std::cout << "Not a demo file : " << tfilename << std::endl; return false;}
+    if(!readValue(&ifile, &version, 2) || version != DEMO_VERSION) { std::cout << "Unsupported demo version " << version << std::endl; return false;}
+    if(!readValue(&ifile, &tickms, 2) || tickms != DEMO_TICK_MS) { std::cout << "Demo tick of " << tickms << "ms does not match " << DEMO_TICK_MS << "ms\n"; return false;}
+
+    DemoStart tstart;
+    u32 tvalue[7];
+    if(!readValue(&ifile, &tvalue[0], 4)) return false;
+    if(!readVector(&ifile, &tstart.position) || !readVector(&ifile, &tstart.rotation) || !readVector(&ifile, &tstart.velocity)) return false;
+    for(int i = 1; i < 6; i++) if(!readValue(&ifile, &tvalue[i], 4)) return false;
+    tstart.level = int(tvalue[0]);
+    tstart.mousePosition = vector2di( int(tvalue[1]), int(tvalue[2]));
+    tstart.lastTile = vector2di( int(tvalue[3]), int(tvalue[4]));
+    tstart.inputContext = int(tvalue[5]);
+
+    u32 tickcount = 0;
+    if(!readValue(&ifile, &tickcount, 4)) return false;
+
+    //every tick is at least an event count and a checksum, a count the rest of the file
+    //can't hold is a bad header and must not size the reserve
+    std::streampos tickstart = ifile.tellg();
+    ifile.seekg(0, std::ios_base::end);
+    unsigned long long remaining = (unsigned long long)(ifile.tellg() - tickstart);
+    ifile.seekg(tickstart);
+    if(!ifile || (unsigned long long)(tickcount) * 6 > remaining) { std::cout << "Demo tick count " << tickcount << " exceeds file size\n"; return false;}
+
+    std::vector<DemoTick> ticks;
+    ticks.reserve(tickcount);
+    for(u32 i = 0; i < tickcount; i++)
+    {
+        DemoTick newtick;
+        u32 eventcount = 0;
+        if(!readValue(&ifile, &eventcount, 2)) { std::cout << "Demo truncated at tick " << i << std::endl; return false;}
+
+        for(u32 n = 0; n < eventcount; n++)
+        {
+            SEvent newevent;
+            u32 ttype = 0;
+            u32 tval[6];
+            if(!readValue(&ifile, &ttype, 1)) return false;
+
+            if(ttype == DEMOEVENT_KEY)
+            {
+                if(!readValue(&ifile, &tval[0], 1) || !readValue(&ifile, &tval[1], 2) || !readValue(&ifile, &tval[2], 1)) return false;
+
+                newevent.EventType = EET_KEY_INPUT_EVENT;
+                newevent.KeyInput.Key = EKEY_CODE(tval[0]);
+                newevent.KeyInput.Char = wchar_t(tval[1]);
+                newevent.KeyInput.PressedDown = (tval[2] & 1) != 0;
+                newevent.KeyInput.Shift = (tval[2] & 2) != 0;
+                newevent.KeyInput.Control = (tval[2] & 4) != 0;
+            }
+            else if(ttype == DEMOEVENT_MOUSE)
+            {
+                f32 wheel = 0;
+                if(!readValue(&ifile, &tval[0], 2) || !readValue(&ifile, &tval[1], 2) || !readFloat(&ifile, &wheel) ||
+                   !readValue(&ifile, &tval[2], 1) || !readValue(&ifile, &tval[3], 1) || !readValue(&ifile, &tval[4], 1)) return false;
+
+                newevent.EventType = EET_MOUSE_INPUT_EVENT;
+                newevent.MouseInput.X = s16(tval[0]);
+                newevent.MouseInput.Y = s16(tval[1]);
+                newevent.MouseInput.Wheel = wheel;
+                newevent.MouseInput.Event = EMOUSE_INPUT_EVENT(tval[2]);
+                newevent.MouseInput.ButtonStates = tval[3];
+                newevent.MouseInput.Shift = (tval[4] & 1) != 0;
+                newevent.MouseInput.Control = (tval[4] & 2) != 0;
+            }
+            else { std::cout << "Bad demo event type " << ttype << " at tick " << i << std::endl; return false;}
+
+            newtick.events.push_back(newevent);
+        }
+
+        if(!readValue(&ifile, &newtick.checksum, 4)) return false;
+
+        ticks.push_back(newtick);
+    }
+
+    ifile.close();
+
+    m_Filename = tfilename;
+    m_Start = tstart;
+    m_Ticks.swap(ticks);
+    m_TickIndex = 0;
+
+    return true;
+}
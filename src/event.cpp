@@ -4,24 +4,94 @@ MyEventReceiver::MyEventReceiver(Game *ngame)
 {
     gptr = ngame;
 
+    m_DroppedEvents = 0;
+
     //null out all keys
     for(int i = 0; i < KEY_KEY_CODES_COUNT; i++) Keys[i] = false;
 }
 
 bool MyEventReceiver::OnEvent(const SEvent &event)
 {
-    //eventque.push_back(&event);
+    //log text is only valid during this call, don't queue it
+    if(event.EventType == EET_LOG_TEXT_EVENT) return true;
+
+    //queue event for next tick, if the queue is full the event is lost
+    if(!m_EventQueue.push(event))
+    {
+        m_DroppedEvents++;
+        std::cout << "Event queue full, event dropped!\n";
+    }
+
+    //return true, event has been taken
+    return true;
+}
+
+int MyEventReceiver::drainEvents()
+{
+    if(gptr == NULL)
+    {
+        std::cout << "Error in event receiver : game reference not set!\n";
+        return 0;
+    }
+
+    int eventcount = 0;
+    SEvent event;
+
+    while(m_EventQueue.pop(&event))
+    {
+        //demo captures input exactly as the game sees it
+        if(gptr->m_Demo->isRecording()) gptr->m_Demo->recordEvent(event);
+
+        dispatchEvent(event);
+        eventcount++;
+    }
+
+    return eventcount;
+}
 
+void MyEventReceiver::dispatchEvent(const SEvent &event)
+{
     //capture state of key presses
     if(event.EventType == EET_KEY_INPUT_EVENT)
     {
         Keys[event.KeyInput.Key] = event.KeyInput.PressedDown;
     }
 
-    if(gptr == NULL) std::cout << "Error in event receiver : game reference not set!\n";
     gptr->processEvent(&event);
+}
 
+int MyEventReceiver::discardEvents()
+{
+    int eventcount = 0;
+    SEvent event;
 
-    //return false, tell irrlicht this event is not done yet
-    return true;
+    while(m_EventQueue.pop(&event))
+    {
+        if(event.EventType == EET_KEY_INPUT_EVENT && event.KeyInput.Key == KEY_ESCAPE && event.KeyInput.PressedDown)
+        {
+            if(gptr != NULL) gptr->getDevice()->closeDevice();
+        }
+
+        eventcount++;
+    }
+
+    return eventcount;
+}
+
+int MyEventReceiver::skipEvents()
+{
+    int eventcount = 0;
+    SEvent event;
+
+    while(m_EventQueue.pop(&event))
+    {
+        if(event.EventType == EET_KEY_INPUT_EVENT)
+        {
+            Keys[event.KeyInput.Key] = event.KeyInput.PressedDown;
+        }
+
+        eventcount++;
+    }
+
+    return eventcount;
 }
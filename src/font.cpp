@@ -8,212 +8,168 @@
 Game *gptr = Game::getInstance();
 
 
-int loadFont(std::string tfilename, UWFont *font)
+static const char *g_FontFiles[FONT_TOTAL] = {"font5x6p.sys", "font4x5p.sys", "font5x6i.sys", "fontbig.sys", "fontbutn.sys", "fontchar.sys"};
+
+//decode .sys font data into one unscaled image per glyph
+static int parseFont(const std::vector<unsigned char> &fdata, UWFont *font, std::vector<IImage*> *glyphs, IVideoDriver *tdriver)
 {
-    //note : this assume a 64x64 font image
-
-    //height and width of texture sheet
-    const int sheetdim = 12;
-
-    if(font == NULL) return -1; // font is null
-
-    //get driver ref
-    IVideoDriver *m_Driver = gptr->getDriver();
-
-    //open font (.sys) file
-    std::ifstream ifile;
-    ifile.open(tfilename.c_str(), std::ios_base::binary);
-
-    //check if file loaded properly
-    if(!ifile.is_open()) return -2; // error unable to open file
-
-    //determine file size
-    std::streampos fsize = 0;
-    ifile.seekg(0, std::ios::end);
-    fsize = ifile.tellg();
-    ifile.seekg(0);
-
-    //store binary font data
-    std::vector< std::vector<bool> > fontbin;
-
-    //read in header
-    //unknown byte
-    unsigned char unkbuf[2];
-    int unkbyte = 0;
-    readBin(&ifile, unkbuf, 2);
-    unkbyte = lsbSum(unkbuf, 2);
-
-    //character size (in bytes)
-    unsigned char charsizebuf[2];
-    int charbytes = 0;
-    readBin(&ifile, charsizebuf, 2);
-    charbytes = lsbSum(charsizebuf, 2);
-
-    //width of blank space character
-    unsigned char wblankspacebuf[2];
-    int blankwidthpx = 0;
-    readBin(&ifile, wblankspacebuf, 2);
-    blankwidthpx = lsbSum(wblankspacebuf, 2);
-
-    //font height
-    unsigned char fontheightbuf[2];
-    int heightpx = 0;
-    readBin(&ifile, fontheightbuf, 2);
-    heightpx = lsbSum(fontheightbuf, 2);
-
-    //width of character row in bytes
-    unsigned char wcharrowsizebuf[2];
-    int widthbytes = 0;
-    readBin(&ifile, wcharrowsizebuf, 2);
-    widthbytes = lsbSum(wcharrowsizebuf, 2);
-
-    //max width of character in pixels
-    unsigned char maxpixelwidthbuf[2];
-    int maxwidthpx = 0;
-    readBin(&ifile, maxpixelwidthbuf, 2);
-    maxwidthpx = lsbSum(maxpixelwidthbuf, 2);
-
-    //characters to read
-    int charstoread = (fsize - 12) / (charbytes + 1); // header is 12 bytes, charsize + 1 currentcharwidth byte
-
-    //set fonts character count
-    font->m_Count = charstoread;
+    //header is 12 bytes
+    if(int(fdata.size()) < 12) return -1;
 
-    //set font height
-    font->m_Height = heightpx * SCREEN_SCALE;
+    unsigned char *hdr = (unsigned char*)(&fdata[0]);
 
-    //debug info
-    std::cout << std::hex;
-    std::cout << "unk val           = 0x" << unkbyte << std::endl;
-    std::cout << "char bytes        = 0x" << charbytes << std::endl;
-    std::cout << "width bytes       = 0x" << widthbytes << std::endl;
-    std::cout << "blank width px    = 0x" << blankwidthpx << std::endl;
-    std::cout << "height px         = 0x" << heightpx << std::endl;
-    std::cout << "max width px      = 0x" << maxwidthpx << std::endl;
-    std::cout << std::dec;
-
-    int widestcharacter = maxwidthpx; // when creating texture, assume each character as widest font
-                             // the UWFont rect will determine clip size
-    std::vector<int> charwidths;
-
-    //STORE FONT IN MONO TEXTURE
-    // note : texture is stored in uwfont object
-    IImage *newimg = NULL;
-
-    //read in each character data (charbytes + 1 byte)
-    for(int j = 0; j < charstoread; j++)
-    {
-        bool isblankspace = true;
+    //unknown word, character size (in bytes), width of blank space character, font height,
+    //width of character row in bytes, max width of character in pixels
+    int charbytes = lsbSum(hdr + 2, 2);
+    int blankwidthpx = lsbSum(hdr + 4, 2);
+    int heightpx = lsbSum(hdr + 6, 2);
+    int widthbytes = lsbSum(hdr + 8, 2);
+    int maxwidthpx = lsbSum(hdr + 10, 2);
 
-        //read in binary font data
-        unsigned char fontdatabuf[charbytes];
-        readBin(&ifile, fontdatabuf, charbytes);
-        fontbin.push_back( printByteToBin(fontdatabuf, charbytes));
+    if(charbytes <= 0 || heightpx <= 0 || widthbytes <= 0 || widthbytes * heightpx > charbytes) return -2;
 
-        //read in current character width in pixels
-        unsigned char currentwidthpxbuf[1];
-        int currentwidthpx = 0;
-        readBin(&ifile, currentwidthpxbuf, 1);
-        currentwidthpx = int(currentwidthpxbuf[0]);
-        if(currentwidthpx > widestcharacter) widestcharacter = currentwidthpx; // find widest character
+    //characters to read, charsize + 1 currentcharwidth byte each
+    int charstoread = (int(fdata.size()) - 12) / (charbytes + 1);
+    if(charstoread <= 0) return -3;
 
-        //if current width is 0, assume maximum pixel width value
-        if(currentwidthpx == 0) currentwidthpx = maxwidthpx;
+    font->m_Count = charstoread;
+    font->m_Height = heightpx * SCREEN_SCALE;
 
-        //determine if character is blank character (no data)
-        for(int i = 0; i < int(fontbin[j].size()); i++)
-        {
-            //search for any data found, then it's not a blank space
-            if(fontbin[j][i] && isblankspace) isblankspace = false;
+    int widestcharacter = maxwidthpx;
 
-            //if font is determined not to be a blank space, stop looking
-            if(!isblankspace) break;
-        }
+    for(int j = 0; j < charstoread; j++)
+    {
+        const unsigned char *chardata = &fdata[12 + j*(charbytes + 1)];
 
-        //if is a blank space, set current pixel width to blank space width
+        //current character width in pixels, 0 means max width
+        int currentwidthpx = int(chardata[charbytes]);
+        if(currentwidthpx > widestcharacter) widestcharacter = currentwidthpx;
+        if(currentwidthpx == 0) currentwidthpx = maxwidthpx;
+
+        //a character with no data is a blank space
+        bool isblankspace = true;
+        for(int i = 0; i < charbytes && isblankspace; i++) if(chardata[i]) isblankspace = false;
         if(isblankspace) currentwidthpx = blankwidthpx;
 
-        //store character width
-        charwidths.push_back(currentwidthpx);
+        //atlas can't pack empty images
+        IImage *newimg = tdriver->createImage(ECF_A1R5G5B5, dimension2d<u32>(currentwidthpx > 0 ? currentwidthpx : 1, heightpx));
+        if(newimg == NULL) return -4;
+        newimg->fill(SColor(TRANSPARENCY_COLOR));
 
+        //rows are widthbytes wide, msb is leftmost pixel
+        for(int y = 0; y < heightpx; y++)
+        {
+            for(int x = 0; x < currentwidthpx && x < widthbytes*8; x++)
+            {
+                if( (chardata[y*widthbytes + x/8] >> (7 - x%8)) & 0x01) newimg->setPixel(x, y, SColor(255,255,255,255));
+            }
+        }
 
+        glyphs->push_back(newimg);
     }
 
-    //save widest character value
     font->m_WidestCharacter = widestcharacter * SCREEN_SCALE;
 
-    //create clip rects
-    for(int j = 0; j < charstoread; j++)
+    return 0;
+}
+
+FontManager::FontManager()
+{
+    for(int i = 0; i < FONT_TOTAL; i++)
     {
-        //create font clipping rect
-        core::rect<s32> fontrect(position2d<s32>( int(j%sheetdim) * widestcharacter * SCREEN_SCALE, int(j/sheetdim) * heightpx * SCREEN_SCALE),
-                                 dimension2d<u32>(charwidths[j]*SCREEN_SCALE, heightpx*SCREEN_SCALE));
-        font->m_Clips.push_back(fontrect);
+        m_Fonts[i].m_Texture = NULL;
+        m_Fonts[i].m_Height = 0;
+        m_Fonts[i].m_WidestCharacter = 0;
+        m_Fonts[i].m_Count = 0;
+        m_Loaded[i] = false;
     }
 
-    //create new image and copy binary font data to image
-    newimg = m_Driver->createImage(ECF_A1R5G5B5, dimension2d<u32>(widestcharacter * sheetdim * SCREEN_SCALE, heightpx * sheetdim * SCREEN_SCALE));
-    newimg->fill(SColor(TRANSPARENCY_COLOR) );
-    if(newimg == NULL) return -5; // error creating image
+    m_Atlas.setName("fontatlas");
+}
+
+FontManager::~FontManager()
+{
+
+}
+
+int FontManager::loadFonts(IVideoDriver *tdriver, std::string tpath)
+{
+    if(tdriver == NULL) return -1;
+
+    std::vector<unsigned char> fdata;
+    std::vector<IImage*> glyphs[FONT_TOTAL];
+    int firstregion[FONT_TOTAL];
 
-    for(int i = 0; i < int(fontbin.size()); i++)
+    for(int i = 0; i < FONT_TOTAL; i++)
     {
-        int binpos = 0;
+        firstregion[i] = -1;
 
-        for(int n = 0; n < heightpx; n++)
+        //whole file is read in one go and decoded from memory
+        int errorcode = 0;
+        if(!readFile(tpath + g_FontFiles[i], &fdata)) errorcode = -2;
+        else errorcode = parseFont(fdata, &m_Fonts[i], &glyphs[i], tdriver);
+
+        if(errorcode)
         {
-            for(int k = binpos; k < binpos + widthbytes*8; k++)
-            {
-                //if reading beyond current font width, ignore
-                if(k - binpos >= font->m_Clips[i].getWidth()) continue;
-
-                if(fontbin[i][k])
-                {
-                    for(int q = 0; q < SCREEN_SCALE; q++)
-                    {
-                        for(int w = 0; w < SCREEN_SCALE; w++)
-                        {
-                            newimg->setPixel( font->m_Clips[i].UpperLeftCorner.X + ((k - binpos)*SCREEN_SCALE)+w,
-                                              font->m_Clips[i].UpperLeftCorner.Y + (int(k/(widthbytes*8))*SCREEN_SCALE)+q,
-                                              SColor(255,255,255,255));
-                        }
-                    }
-
-                }
-            }
+            std::cout << "Error loading font " << g_FontFiles[i] << ", ERROR CODE " << errorcode << std::endl;
+            for(int n = 0; n < int(glyphs[i].size()); n++) glyphs[i][n]->drop();
+            glyphs[i].clear();
 
-            //advance binary position
-            binpos += widthbytes*8;
+            //can't draw any text without the normal font
+            if(i == FONT_NORMAL) return -3;
+            continue;
         }
+
+        //atlas grabs the glyph images
+        firstregion[i] = m_Atlas.addImageSet(g_FontFiles[i], &glyphs[i]);
+        for(int n = 0; n < int(glyphs[i].size()); n++) glyphs[i][n]->drop();
+
+        m_Loaded[i] = true;
     }
 
-    //create scaled image
-    //IImage *scaledimage = m_Driver->createImage(ECF_A1R5G5B5, dimension2d<u32>(widestcharacter * sheetdim * SCREEN_SCALE, heightpx * sheetdim * SCREEN_SCALE));
-    //newimg->copyToScaling(scaledimage);
+    //every font draws from one texture, so all glyphs must fit on a single atlas page
+    int pagecount = m_Atlas.build(tdriver, SCREEN_SCALE);
+    if(pagecount <= 0) return -4;
+    if(pagecount > 1)
+    {
+        std::cout << "Error, font atlas needed " << pagecount << " pages, fonts only support one\n";
+        return -6;
+    }
 
+    //glyph tables
+    for(int i = 0; i < FONT_TOTAL; i++)
+    {
+        if(!m_Loaded[i]) continue;
 
-    //create texture name
-    std::stringstream texturename;
-    texturename << "font";
+        m_Fonts[i].m_Clips.clear();
+        for(int n = 0; n < m_Fonts[i].m_Count; n++)
+        {
+            const AtlasRegion *tregion = m_Atlas.getRegion(firstregion[i] + n);
+            if(tregion == NULL) return -5;
 
-    //create texture from image
-    //font->m_Texture = m_Driver->addTexture( texturename.str().c_str(), scaledimage );
-    font->m_Texture = m_Driver->addTexture( texturename.str().c_str(), newimg );
+            m_Fonts[i].m_Clips.push_back(tregion->pixels);
+        }
+        m_Fonts[i].m_Texture = m_Atlas.getPage(0);
 
-    //set transparency color (pink, 255,0,255)
-    //note : this is palette index #0, set automatically when
-    //       loading in palettes (see loadPalette())
-    m_Driver->makeColorKeyTexture(font->m_Texture,  SColor(TRANSPARENCY_COLOR));
+        std::cout << g_FontFiles[i] << " : " << m_Fonts[i].m_Count << " glyphs, height " << m_Fonts[i].m_Height << std::endl;
+    }
 
-    if(font->m_Texture == NULL) return -12; // error creating texture
+    return 0;
+}
 
-    //drop image, no longer needed
-    newimg->drop();
-    //scaledimage->drop();
+UWFont *FontManager::getFont(int fonttype)
+{
+    //missing fonts use the normal font
+    if(fonttype < 0 || fonttype >= FONT_TOTAL || !m_Loaded[fonttype]) return &m_Fonts[FONT_NORMAL];
 
-    ifile.close();
+    return &m_Fonts[fonttype];
+}
 
-    return 0;
+bool FontManager::isLoaded(int fonttype)
+{
+    if(fonttype < 0 || fonttype >= FONT_TOTAL) return false;
+
+    return m_Loaded[fonttype];
 }
 
 
@@ -223,7 +179,7 @@ bool drawFontChar(UWFont *tfont, int charnum, position2d<s32> tpos, SColor tcolo
 {
     if(tfont == NULL) return false;
 
-    if(charnum < 0 || charnum >= 127) return false;
+    if(charnum < 0 || charnum >= 127 || charnum >= int(tfont->m_Clips.size()) ) return false;
 
     gptr->getDriver()->draw2DImage( tfont->m_Texture,
                           tpos,
@@ -234,27 +190,22 @@ bool drawFontChar(UWFont *tfont, int charnum, position2d<s32> tpos, SColor tcolo
     return true;
 }
 
-bool drawFontString(UWFont *tfont, std::string tstring, position2d<s32> tpos, SColor tcolor)
+bool drawFontString(UWFont *tfont, const std::string &tstring, position2d<s32> tpos, SColor tcolor, const rect<s32> *cliprect)
 {
     if(tfont == NULL) return false;
 
-    //draw each character in string
-    for(int i = 0; i < tstring.length(); i++)
-    {
-        int charval = int(tstring[i]);
+    //single strings go through a shared batch, main thread only
+    static TextBatch stringbatch;
 
-        //if able to draw character, advance position by characters width
-        if(drawFontChar(tfont, charval, tpos, tcolor))
-        {
-            //advance tpos by character width
-            tpos.X += tfont->m_Clips[charval].getWidth();
-        }
-    }
+    //draw whole string in one call
+    stringbatch.begin(cliprect);
+    stringbatch.addString(tfont, tstring, tpos, tcolor);
+    stringbatch.end(gptr->getDriver());
 
     return true;
 }
 
-int getStringWidth(UWFont *tfont, std::string tstring)
+int getStringWidth(UWFont *tfont, const std::string &tstring)
 {
     if(tfont == NULL) return 0;
 
@@ -266,7 +217,7 @@ int getStringWidth(UWFont *tfont, std::string tstring)
         int charval = int( tstring[i]);
 
         //make sure character is valid
-        if(charval >= 0 && charval < 127)
+        if(charval >= 0 && charval < 127 && charval < int(tfont->m_Clips.size()) )
         {
             //add character width
             totwidth += tfont->m_Clips[charval].getWidth();
@@ -276,3 +227,158 @@ int getStringWidth(UWFont *tfont, std::string tstring)
 
     return totwidth;
 }
+
+int shapeString(UWFont *tfont, const std::string &tstring, GlyphRun *trun, int kerning)
+{
+    if(trun == NULL) return 0;
+
+    trun->count = 0;
+    trun->width = 0;
+
+    if(tfont == NULL) return 0;
+
+    int xpos = 0;
+    for(int i = 0; i < int(tstring.length()) && trun->count < GLYPHRUN_MAX_GLYPHS; i++)
+    {
+        int charval = int(tstring[i]);
+
+        //skip characters the font doesn't have
+        if(charval < 0 || charval >= 127 || charval >= int(tfont->m_Clips.size()) ) continue;
+
+        trun->offsets[trun->count] = s16(xpos);
+        trun->glyphs[trun->count] = u8(charval);
+        trun->count++;
+
+        xpos += tfont->m_Clips[charval].getWidth() + kerning;
+    }
+
+    trun->width = xpos;
+
+    return xpos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+//  TEXT BATCH
+TextBatch::TextBatch()
+{
+    m_RunCount = 0;
+    m_HasClip = false;
+
+    m_GlyphCount = 0;
+    m_DrawCalls = 0;
+}
+
+TextBatch::~TextBatch()
+{
+
+}
+
+void TextBatch::begin(const rect<s32> *cliprect)
+{
+    //runs are emptied but keep their storage
+    for(int i = 0; i < m_RunCount; i++)
+    {
+        m_Runs[i].positions.set_used(0);
+        m_Runs[i].clips.set_used(0);
+    }
+    m_RunCount = 0;
+
+    m_HasClip = (cliprect != NULL);
+    if(m_HasClip) m_ClipRect = *cliprect;
+}
+
+TextRun *TextBatch::getRun(ITexture *ttexture, SColor tcolor)
+{
+    for(int i = 0; i < m_RunCount; i++)
+    {
+        if(m_Runs[i].texture == ttexture && m_Runs[i].color == tcolor) return &m_Runs[i];
+    }
+
+    //new run, reuse old storage if there is any
+    if(m_RunCount >= int(m_Runs.size()))
+    {
+        m_Runs.push_back(TextRun());
+        m_Runs.back().positions.reallocate(TEXTBATCH_RESERVE_GLYPHS);
+        m_Runs.back().clips.reallocate(TEXTBATCH_RESERVE_GLYPHS);
+    }
+
+    TextRun *trun = &m_Runs[m_RunCount++];
+    trun->texture = ttexture;
+    trun->color = tcolor;
+
+    return trun;
+}
+
+int TextBatch::addString(UWFont *tfont, const std::string &tstring, position2d<s32> tpos, SColor tcolor, int kerning)
+{
+    if(tfont == NULL || tfont->m_Texture == NULL) return 0;
+
+    //whole line is outside clip
+    if(m_HasClip && (tpos.Y >= m_ClipRect.LowerRightCorner.Y || tpos.Y + tfont->m_Height <= m_ClipRect.UpperLeftCorner.Y) )
+        return getStringWidth(tfont, tstring) + kerning*int(tstring.length());
+
+    TextRun *trun = getRun(tfont->m_Texture, tcolor);
+    int startx = tpos.X;
+
+    for(int i = 0; i < int(tstring.length()); i++)
+    {
+        int charval = int(tstring[i]);
+
+        //skip characters the font doesn't have
+        if(charval < 0 || charval >= 127 || charval >= int(tfont->m_Clips.size()) ) continue;
+
+        const rect<s32> &tclip = tfont->m_Clips[charval];
+
+        //only glyphs that touch the clip rect are drawn
+        if(!m_HasClip || (tpos.X < m_ClipRect.LowerRightCorner.X && tpos.X + tclip.getWidth() > m_ClipRect.UpperLeftCorner.X) )
+        {
+            trun->positions.push_back(tpos);
+            trun->clips.push_back(tclip);
+        }
+
+        //advance by character width
+        tpos.X += tclip.getWidth() + kerning;
+    }
+
+    return tpos.X - startx;
+}
+
+void TextBatch::addRun(UWFont *tfont, const GlyphRun &trun, position2d<s32> tpos, SColor tcolor)
+{
+    if(tfont == NULL || tfont->m_Texture == NULL || trun.count <= 0) return;
+
+    //whole line is outside clip
+    if(m_HasClip && (tpos.Y >= m_ClipRect.LowerRightCorner.Y || tpos.Y + tfont->m_Height <= m_ClipRect.UpperLeftCorner.Y) ) return;
+
+    TextRun *ttextrun = getRun(tfont->m_Texture, tcolor);
+
+    for(int i = 0; i < trun.count; i++)
+    {
+        const rect<s32> &tclip = tfont->m_Clips[trun.glyphs[i]];
+        position2d<s32> gpos(tpos.X + trun.offsets[i], tpos.Y);
+
+        if(m_HasClip && (gpos.X >= m_ClipRect.LowerRightCorner.X || gpos.X + tclip.getWidth() <= m_ClipRect.UpperLeftCorner.X) ) continue;
+
+        ttextrun->positions.push_back(gpos);
+        ttextrun->clips.push_back(tclip);
+    }
+}
+
+void TextBatch::end(IVideoDriver *tdriver)
+{
+    m_GlyphCount = 0;
+    m_DrawCalls = 0;
+
+    if(tdriver == NULL) return;
+
+    for(int i = 0; i < m_RunCount; i++)
+    {
+        if(m_Runs[i].positions.empty()) continue;
+
+        tdriver->draw2DImageBatch(m_Runs[i].texture, m_Runs[i].positions, m_Runs[i].clips,
+                                  m_HasClip ? &m_ClipRect : NULL, m_Runs[i].color, true);
+
+        m_GlyphCount += int(m_Runs[i].positions.size());
+        m_DrawCalls++;
+    }
+}
@@ -1,6 +1,7 @@
 #include "game.hpp"
 #include "tools.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 Game *Game::mInstance = NULL;
@@ -14,13 +15,38 @@ Game::Game()
     m_Mouse = NULL;
     m_Receiver = NULL;
     m_Player = NULL;
+    m_Scheduler = NULL;
+    m_SpriteBatch = NULL;
     m_InputContext = IMODE_PLAY;
     m_PreviousInputContext = IMODE_PLAY;
 
     m_CurrentLevel = 0;
-
+    m_LevelManager = NULL;
+    m_LastPlayerTile = vector2di(-1,-1);
+
+    m_Jobs = NULL;
+    m_Profiler = Profiler::getInstance();
+    m_Tracer = Tracer::getInstance();
+    m_MemStats = MemStats::getInstance();
+    m_AllocTracker = AllocTracker::getInstance();
+    m_Demo = new Demo;
+    m_DemoBaseTime = 0;
+    m_UICompositor = NULL;
+    m_Automap = NULL;
+    m_FontNormal = NULL;
+    m_PendingDemoState = DEMO_IDLE;
     m_DoShutdown = false; //shutdown flag to let threads know they need to die
 
+    m_LoadFailed = false;
+    m_BenchConfig = Benchmark::getDefaultConfig();
+    m_StartTime = 0;
+    m_FirstFrameTime = 0;
+
+    m_ShadingMode = SHADING_TABLE;
+    m_ShadeLevel = 0;
+    m_VertexShadeRect = rect<s32>(0,0,0,0);
+    m_VertexShadeLevel = -1;
+
     //debug parameters
     dbg_noclip = false;
     dbg_nolighting = false;
@@ -37,6 +63,18 @@ Game::Game()
 
 Game::~Game()
 {
+    //make sure no helper threads outlive the game
+    stopThreads();
+
+    if(m_Scheduler != NULL) delete m_Scheduler;
+    if(m_LevelManager != NULL) delete m_LevelManager;
+    delete m_Demo;
+    if(m_UICompositor != NULL) delete m_UICompositor;
+    if(m_Automap != NULL) delete m_Automap;
+
+    for(int i = 0; i < int(m_LoadPhases.size()); i++) delete m_LoadPhases[i];
+    m_LoadPhases.clear();
+
     //destroy rendering device
     m_Device->drop();
 }
@@ -47,180 +85,495 @@ int Game::start()
 {
     int errorcode = 0;
 
+    m_StartTime = getMicroseconds();
+
+    //trace from launch so the load phases are on the timeline
+    m_Tracer->setThreadName("main");
+    if(!m_BenchConfig.traceFile.empty()) m_Tracer->start();
+
     std::cout << "Game started.\n";
 
     std::cout << "Initializing console...";
     m_Console = Console::getInstance();
     std::cout << "done.\n";
 
+    std::cout << "Starting job workers...";
+    m_Jobs = JobSystem::getInstance();
+        {
+            TRACE_SCOPE("startWorkers");
+            errorcode = m_Jobs->init();
+        }
+        if(errorcode < 0) {std::cout << "Error starting job workers!  ERROR CODE " << errorcode << "\n"; return -1;}
+        else std::cout << errorcode << " workers.\n";
+
     //init irrlicht
     std::cout << "Initialzing irrlicht...";
-        errorcode = initIrrlicht();
+        {
+            TRACE_SCOPE("initIrrlicht");
+            errorcode = initIrrlicht();
+        }
         if(errorcode) {std::cout << "Error initializing irrlicht!  ERROR CODE " << errorcode << "\n"; return -1;}
         else std::cout << "done.\n";
 
+    //fonts are needed to draw the loading screen, so they are loaded up front
     std::cout << "Loading fonts...\n";
-        errorcode = loadFont("UWDATA\\font5x6p.sys", &m_FontNormal);
-        if(errorcode) {std::cout << "Error loading normal font 5x6p!  ERROR CODE " << errorcode << "\n"; return -1;}
-        std::cout << std::endl;
-
-    std::cout << "Initializing camera...";
-    loadScreen("Initializing camera...");
-        errorcode = initCamera();
-        if(errorcode) {std::cout << "Error initializing camera!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "done.\n";
+        {
+            TRACE_SCOPE("loadFonts");
+            errorcode = m_Fonts.loadFonts(m_Driver, "UWDATA\\");
+            m_FontNormal = m_Fonts.getFont(FONT_NORMAL);
+            m_MemStats->add(MEMCAT_TEX_FONTS, MemStats::getTextureBytes(m_Fonts.getTexture()));
+        }
+        if(errorcode) {std::cout << "Error loading fonts!  ERROR CODE " << errorcode << "\n"; return -1;}
         std::cout << std::endl;
 
-    //load UW data
-    std::cout << "Loading strings...";
-    loadScreen("Loading strings...");
-        errorcode = loadStrings(&m_StringBlocks);
-        if(errorcode < 0) {std::cout << "Error loading string data!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "done.\n";
-        std::cout << "Loaded " << errorcode << " strings.\n";
+    //everything else loads in the background while the loading screen is drawn
+    std::cout << "Loading game data...\n";
+        {
+            TRACE_SCOPE("runLoadPhases");
+            errorcode = runLoadPhases();
+        }
+        printLoadPhases();
+        if(errorcode) {std::cout << "Error loading game data!  ERROR CODE " << errorcode << "\n"; stopThreads(); return -1;}
+        std::cout << "Loaded " << m_StringBlocks.size() << " string blocks, " << m_Palettes.size() << " palettes, "
+                  << m_Wall64TXT.size() + m_Floor32TXT.size() << " textures, " << m_SpriteAtlas.getRegionCount() << " sprites, "
+                  << mLevels.size() << " levels.\n";
         //print test string, should = "Hey, its all the game strings"
         std::cout << m_StringBlocks[0].strings[0] << std::endl;
-
-    std::cout << "Loading palette data...\n";
-    loadScreen("Loading palettes...");
-        errorcode = loadPalette(&m_Palettes);
-        if(errorcode) { std::cout << "Error loading palette!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "....." << m_Palettes.size() << " palettes loaded.\n";
-        errorcode = loadAuxPalette(&m_AuxPalettes);
-        if(errorcode) { std::cout << "Error loading aux palette!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "....." << m_AuxPalettes.size() << " aux palettes loaded.\n";
-
-    std::cout << "Loading textures...\n";
-    loadScreen("Loading textures...");
-        errorcode = loadTexture("UWDATA\\w64.tr", &m_Wall64TXT);
-        if(errorcode) { std::cout << "Error loading textures!  ERROR CODE " << errorcode << "\n"; return -1;}
-            else std::cout << "....." << m_Wall64TXT.size() << " wall64 textures loaded.\n";
-        errorcode = loadTexture("UWDATA\\f32.tr", &m_Floor32TXT);
-        if(errorcode) { std::cout << "Error loading textures!  ERROR CODE " << errorcode << "\n"; return -1;}
-            else std::cout << "....." << m_Floor32TXT.size() << " floor32 textures loaded.\n";
         std::cout << std::endl;
 
-    std::cout << "Loading graphics...\n";
-    loadScreen("Loading graphics...");
-    //note : this needs to be fixed, throws bad alloc, need to investigate parsing for graphics load
-        errorcode = loadGraphic("UWDATA\\charhead.gr", &m_CharHeadTXT);
-        if(errorcode) {std::cout << "Error loading charhead graphic!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "....." << m_CharHeadTXT.size() << " character portrait graphics loaded.\n";
-        errorcode = loadGraphic("UWDATA\\cursors.gr", &m_CursorsTXT);
-        if(errorcode) {std::cout << "Error loading cursors graphic!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "....." << m_CursorsTXT.size() << " cursor graphics loaded.\n";
-        errorcode = loadGraphic("UWDATA\\objects.gr", &m_ObjectsTXT);
-        if(errorcode) {std::cout << "Error loading object graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "....." << m_ObjectsTXT.size() << " object graphics loaded.\n";
-        errorcode = loadGraphic("UWDATA\\question.gr", &m_QuestionTXT);
-        if(errorcode) {std::cout << "Error loading question mark graphic!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadGraphic("UWDATA\\inv.gr", &m_InventoryTXT);
-        if(errorcode) {std::cout << "Error loading inventory graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadGraphic("UWDATA\\scrledge.gr", &m_ScrollEdgeTXT);
-        if(errorcode) {std::cout << "Error loading scroll graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadGraphic("UWDATA\\optbtns.gr", &m_ModeButtonsTXT);
-        if(errorcode) {std::cout << "Error loading mode button graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadGraphic("UWDATA\\optb.gr", &m_ModeButtonsMiscTXT);
-        if(errorcode) {std::cout << "Error loading mode button misc graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadGraphic("UWDATA\\dragons.gr", &m_DragonsTXT);
-        if(errorcode) {std::cout << "Error loading dragon graphics!  ERROR CODE " << errorcode << "\n"; return -1;}
-        std::cout << std::endl;
+    //mLevels[0].printDebug();
 
-    std::cout << "Loading bitmaps...";
-    loadScreen("Loading bitmaps...");
-        errorcode = loadBitmap("UWDATA\\pres1.byt", &m_BitmapsTXT, 5);
-        if(errorcode) {std::cout << "Error loading bitmap!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadBitmap("UWDATA\\pres2.byt", &m_BitmapsTXT, 5);
-        if(errorcode) {std::cout << "Error loading bitmap!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadBitmap("UWDATA\\main.byt", &m_BitmapsTXT, 0);
-        if(errorcode) {std::cout << "Error loading bitmap!  ERROR CODE " << errorcode << "\n"; return -1;}
-        errorcode = loadBitmap("UWDATA\\opscr.byt", &m_BitmapsTXT, 2);
-        if(errorcode) {std::cout << "Error loading bitmap!  ERROR CODE " << errorcode << "\n"; return -1;}
-        std::cout << "done.\n";
-        std::cout << std::endl;
+    if(m_BenchConfig.enabled)
+    {
+        Benchmark tbench(this, m_BenchConfig);
+        errorcode = tbench.run();
+        stopThreads();
+        return errorcode;
+    }
 
+    //demo from the command line starts with the first frame
+    if(!m_BenchConfig.recordFile.empty()) { m_PendingDemoState = DEMO_RECORDING; m_PendingDemoFile = m_BenchConfig.recordFile;}
+    else if(!m_BenchConfig.replayFile.empty()) { m_PendingDemoState = DEMO_REPLAYING; m_PendingDemoFile = m_BenchConfig.replayFile;}
 
+    if(!DEBUG_NO_START)
+    {
+    //start main loop
+    std::cout << "Starting main loop...\n";
+    mainLoop();
+    }
 
+    stopThreads();
 
-    std::cout << "Initializing objects...";
-    loadScreen("Initializing objects...");
-        errorcode = initObjects();
-        if(errorcode < 0) {std::cout << "Error initializing objects!  ERROR CODE " << errorcode << "\n"; return-1;}
-        else std::cout << errorcode << " objects initialized.\n";
+    return 0;
+}
 
+LoadPhase *Game::addLoadPhase(std::string name, std::function<int()> func, bool mainthread, std::vector<LoadPhase*> deps)
+{
+    LoadPhase *newphase = new LoadPhase;
+    newphase->name = name;
+    newphase->starttime = 0;
+    newphase->endtime = 0;
+    newphase->errorcode = 0;
 
-    std::cout << "Initializing mouse...";
-    loadScreen("Initializing mousea...");
-        errorcode = initMouse();
-        if(errorcode) {std::cout << "Error initializing mouse!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "done.\n";
+    newphase->job = m_Jobs->createJob([this, newphase, func]
+    {
+        newphase->starttime = getMicroseconds();
 
-    std::cout << "Initializing main UI...";
-    loadScreen("Initializing UI...");
-        errorcode = initMainUI();
-        if(errorcode) {std::cout << "Error initializing main UI!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "done.\n";
+        //once any phase fails, the rest are skipped
+        if(!m_LoadFailed.load())
+        {
+            TRACE_SCOPE(newphase->name.c_str());
+            newphase->errorcode = func();
+            if(newphase->errorcode.load()) m_LoadFailed = true;
+        }
 
-    std::cout << "Loading level data...";
-    loadScreen("Loading level data...");
-        errorcode = loadLevel(&mLevels);
-        if(errorcode) {std::cout << "Error loading level data!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << mLevels.size() << " levels loaded.\n";
+        newphase->endtime = getMicroseconds();
+    }, mainthread);
 
-    //mLevels[0].printDebug();
+    for(int i = 0; i < int(deps.size()); i++)
+    {
+        if(deps[i] != NULL) m_Jobs->addDependency(newphase->job, deps[i]->job);
+    }
 
-    std::cout << "Initializing player...";
-    loadScreen("Initializing player...");
-        errorcode = initPlayer();
-        if(errorcode) {std::cout << "Error initializing player!  ERROR CODE " << errorcode << "\n"; return -1;}
-        else std::cout << "done.\n";
+    m_LoadPhases.push_back(newphase);
+
+    return newphase;
+}
+
+int Game::runLoadPhases()
+{
+    //decoded images wait here until their upload phase runs on the main thread
+    std::vector<IImage*> wallimages;
+    std::vector<IImage*> floorimages;
+    std::vector< std::vector<u8> > wallindices;
+    std::vector< std::vector<u8> > floorindices;
+
+    const int graphiccount = 7;
+    const std::string graphicfiles[graphiccount] = {"UWDATA\\charhead.gr", "UWDATA\\question.gr", "UWDATA\\inv.gr", "UWDATA\\scrledge.gr",
+                                                    "UWDATA\\optbtns.gr", "UWDATA\\optb.gr", "UWDATA\\dragons.gr"};
+    std::vector<ITexture*> *graphiclists[graphiccount] = {&m_CharHeadTXT, &m_QuestionTXT, &m_InventoryTXT, &m_ScrollEdgeTXT,
+                                                          &m_ModeButtonsTXT, &m_ModeButtonsMiscTXT, &m_DragonsTXT};
+    const int graphiccategories[graphiccount] = {MEMCAT_TEX_CHARHEAD, MEMCAT_TEX_QUESTION, MEMCAT_TEX_INVENTORY, MEMCAT_TEX_SCROLLEDGE,
+                                                 MEMCAT_TEX_MODEBUTTONS, MEMCAT_TEX_MODEBUTTONSMISC, MEMCAT_TEX_DRAGONS};
+    std::vector< std::vector<IImage*> > graphicimages(graphiccount);
+
+    const int bitmapcount = 4;
+    const std::string bitmapfiles[bitmapcount] = {"UWDATA\\pres1.byt", "UWDATA\\pres2.byt", "UWDATA\\main.byt", "UWDATA\\opscr.byt"};
+    const int bitmappals[bitmapcount] = {5, 5, 0, 2};
+    std::vector< std::vector<IImage*> > bitmapimages(bitmapcount);
+
+    //palettes and strings first, everything decoded depends on the palettes
+    LoadPhase *palettes = addLoadPhase("palettes", [this]
+    {
+        int errorcode = loadPalette(&m_Palettes);
+        if(errorcode) return errorcode;
+        return loadAuxPalette(&m_AuxPalettes);
+    }, false);
+
+    LoadPhase *strings = addLoadPhase("strings", [this]
+    {
+        int errorcode = loadStrings(&m_StringBlocks);
+        if(errorcode < 0) return errorcode;
+
+        long long stringbytes = 0;
+        for(int i = 0; i < int(m_StringBlocks.size()); i++)
+        {
+            stringbytes += sizeof(stringBlock) + m_StringBlocks[i].strings.capacity() * sizeof(std::string);
+            for(int n = 0; n < int(m_StringBlocks[i].strings.size()); n++) stringbytes += m_StringBlocks[i].strings[n].capacity();
+        }
+        m_MemStats->add(MEMCAT_STRINGS, stringbytes);
+
+        return 0;
+    }, false);
+
+    LoadPhase *camera = addLoadPhase("camera", [this]{ return initCamera();}, true);
+
+    LoadPhase *shadetables = addLoadPhase("shade tables", [this]{ return m_ShadeTable.load("UWDATA\\");}, false);
+
+    //textures, graphics and bitmaps decode in parallel, uploads run on the main thread
+    LoadPhase *texdecode = addLoadPhase("textures", [&wallimages, &floorimages, &wallindices, &floorindices]
+    {
+        int errorcode = decodeTexture("UWDATA\\w64.tr", &wallimages, &wallindices);
+        if(errorcode) return errorcode;
+        return decodeTexture("UWDATA\\f32.tr", &floorimages, &floorindices);
+    }, false, {palettes});
+
+    LoadPhase *texupload = addLoadPhase("texture upload", [this, &wallimages, &floorimages, &wallindices, &floorindices]
+    {
+        //palette is applied at draw time, water and lava entries of palette 0 cycle
+        m_PaletteManager.init(m_Driver, m_Palettes[0], PALETTE_USE_SHADER);
+        m_PaletteManager.addCycle(PALCYCLE_LAVA_START, PALCYCLE_LAVA_COUNT);
+        m_PaletteManager.addCycle(PALCYCLE_WATER_START, PALCYCLE_WATER_COUNT);
+
+        int errorcode = m_PaletteManager.uploadIndexed(&wallimages, &wallindices, &m_Wall64TXT, "w64");
+        if(errorcode) return errorcode;
+        errorcode = m_PaletteManager.uploadIndexed(&floorimages, &floorindices, &m_Floor32TXT, "f32");
+        if(errorcode) return errorcode;
+
+        m_MemStats->addTextures(MEMCAT_TEX_WALL64, &m_Wall64TXT);
+        m_MemStats->addTextures(MEMCAT_TEX_FLOOR32, &m_Floor32TXT);
+
+        //animated terrain draws through one shared texture per source
+        m_TextureAnimator.init(m_Driver);
+        errorcode = m_TextureAnimator.addTerrainAnimations("UWDATA\\terrain.dat", &m_Wall64TXT, &m_Floor32TXT);
+        if(errorcode) std::cout << "Error " << errorcode << " loading terrain animations\n";
+        for(int i = 0; i < m_TextureAnimator.getGroupCount(); i++)
+        {
+            TextureAnimGroup *tgroup = m_TextureAnimator.getGroup(i);
+            m_PaletteManager.addAlias(tgroup->target, tgroup->source);
+
+            //falls are wall textures, water and lava floors are floor textures
+            bool walltexture = std::find(m_Wall64TXT.begin(), m_Wall64TXT.end(), tgroup->source) != m_Wall64TXT.end();
+            m_MemStats->add(walltexture ? MEMCAT_TEX_WALL64 : MEMCAT_TEX_FLOOR32, MemStats::getTextureBytes(tgroup->target));
+        }
+        return 0;
+    }, true, {texdecode});
+
+    //shading needs the palette texture and camera, meshes created later pick up the mode
+    addLoadPhase("shading", [this]
+    {
+        m_PaletteManager.setLightMaps(m_ShadeTable.getLightMaps());
+        m_ShadeTable.computeIntensities(m_Palettes[0]);
+
+        //without shades.dat there is nothing to shade by
+        if(m_ShadeTable.getLightLevelCount() <= 0)
+        {
+            std::cout << "No shade tables, using dynamic lighting\n";
+            m_ShadingMode = SHADING_DYNAMIC;
+        }
+        else m_Console->registerInt("shade_level", [this]{ return m_ShadeLevel;}, [this](int value){ setShading(m_ShadingMode, value);},
+                                    0, m_ShadeTable.getLightLevelCount()-1, "shades.dat light level, 0 is brightest");
+
+        setShading(m_ShadingMode, m_ShadeLevel);
+        return 0;
+    }, true, {shadetables, texupload, camera});
+
+    LoadPhase *grdecode = addLoadPhase("graphics", [this, &graphicfiles, &graphicimages]
+    {
+        std::vector<int> errorcodes(graphiccount, 0);
+        m_Jobs->parallelFor(0, graphiccount, 1, [&graphicfiles, &graphicimages, &errorcodes](int start, int end)
+        {
+            for(int i = start; i < end; i++) errorcodes[i] = decodeGraphic(graphicfiles[i], &graphicimages[i]);
+        });
+
+        for(int i = 0; i < graphiccount; i++)
+        {
+            if(errorcodes[i]) {std::cout << "Error decoding " << graphicfiles[i] << std::endl; return errorcodes[i];}
+        }
+        return 0;
+    }, false, {palettes});
+
+    LoadPhase *atlasdecode = addLoadPhase("sprite atlas", [this]{ return decodeSpriteAtlas();}, false, {palettes});
+
+    LoadPhase *grupload = addLoadPhase("graphics upload", [this, &graphiclists, &graphiccategories, &graphicimages]
+    {
+        for(int i = 0; i < graphiccount; i++)
+        {
+            int errorcode = uploadGraphics(&graphicimages[i], graphiclists[i], "txt");
+            if(errorcode) return errorcode;
+            m_MemStats->addTextures(graphiccategories[i], graphiclists[i]);
+        }
+
+        //pages are scaled like all other 2d graphics
+        int pagecount = m_SpriteAtlas.build(m_Driver, SCREEN_SCALE);
+        if(pagecount < 0) return pagecount;
+
+        for(int i = 0; i < pagecount; i++) m_MemStats->add(MEMCAT_TEX_SPRITEATLAS, MemStats::getTextureBytes(m_SpriteAtlas.getPage(i)));
+        return 0;
+    }, true, {grdecode, atlasdecode});
+
+    LoadPhase *bmpdecode = addLoadPhase("bitmaps", [this, &bitmapfiles, &bitmappals, &bitmapimages]
+    {
+        std::vector<int> errorcodes(bitmapcount, 0);
+        m_Jobs->parallelFor(0, bitmapcount, 1, [&bitmapfiles, &bitmappals, &bitmapimages, &errorcodes](int start, int end)
+        {
+            for(int i = start; i < end; i++) errorcodes[i] = decodeBitmap(bitmapfiles[i], &bitmapimages[i], bitmappals[i]);
+        });
+
+        for(int i = 0; i < bitmapcount; i++)
+        {
+            if(errorcodes[i]) {std::cout << "Error decoding " << bitmapfiles[i] << std::endl; return errorcodes[i];}
+        }
+        return 0;
+    }, false, {palettes});
+
+    addLoadPhase("bitmap upload", [this, &bitmapfiles, &bitmapimages]
+    {
+        //bitmaps keep their file order in the texture list
+        for(int i = 0; i < bitmapcount; i++)
+        {
+            int errorcode = uploadGraphics(&bitmapimages[i], &m_BitmapsTXT, "txt_" + bitmapfiles[i]);
+            if(errorcode) return errorcode;
+        }
+
+        m_MemStats->addTextures(MEMCAT_TEX_BITMAPS, &m_BitmapsTXT);
+        return 0;
+    }, true, {bmpdecode});
+
+    //game objects and ui need the uploaded graphics
+    LoadPhase *objects = addLoadPhase("objects", [this]
+    {
+        int errorcode = initObjects();
+        if(errorcode < 0) return errorcode;
+        return 0;
+    }, true, {grupload});
+
+    addLoadPhase("mouse", [this]{ return initMouse();}, true, {grupload});
+
+    addLoadPhase("main ui", [this]{ return initMainUI();}, true, {grupload, strings});
+
+    //level parse only reads files and object definitions
+    LoadPhase *leveldata = addLoadPhase("level data", [this]
+    {
+        int errorcode = loadLevel(&mLevels);
+        if(errorcode) return errorcode;
+
+        //object pools are allocated once per level, templates once for the game
+        m_MemStats->add(MEMCAT_OBJECTS, (long long)(mLevels.size()) * OBJECT_POOL_SIZE * sizeof(ObjectInstance));
+        m_MemStats->add(MEMCAT_OBJECTS, (long long)(m_Objects.size()) * sizeof(Object));
+
+        m_LevelManager = new LevelManager(&mLevels);
+        return 0;
+    }, false, {objects});
+
+    LoadPhase *player = addLoadPhase("player", [this]{ return initPlayer();}, true, {leveldata});
+
+    //objects are woken/hibernated around the player as they move
+    addLoadPhase("entity scheduler", [this]
+    {
+        m_Scheduler = new EntityScheduler(this);
+        int errorcode = m_Scheduler->buildFromLevel(&mLevels[m_CurrentLevel], m_Device->getTimer()->getTime());
+        if(errorcode < 0) return errorcode;
+
+        //sprites don't depend on the active set, every object of the level is drawn
+        setLevelSprites(&mLevels[m_CurrentLevel], true);
+        return 0;
+    }, true, {leveldata, player});
 
     if(!DEBUG_NO_START)
     {
-    //generate level geometry
-    std::cout << "Generating level geometry...\n";
-    loadScreen("Generating level geometry...");
-        errorcode = mLevels[0].buildLevelGeometry();
-        if(!errorcode) { std::cout << "Error generating level geometry!!  ERROR CODE " << errorcode << "\n"; return -1;}
-        std::cout << mLevels[m_CurrentLevel].getMeshes().size() << " meshes generated for level " << m_CurrentLevel << std::endl;
-        std::cout << std::endl;
+        //meshes are generated on the workers, scene nodes on the main thread
+        LoadPhase *geometry = addLoadPhase("level geometry", [this]
+        {
+            if(!m_LevelManager->generateLevel(m_CurrentLevel)) return -1;
+            return 0;
+        }, false, {leveldata, texupload});
 
-    //create threads
-    loadScreen("Launching threads...");
-    MouseUpdateThread *mouseupdatethread = new MouseUpdateThread(m_Mouse, &m_DoShutdown);
-    m_Threads.push_back(mouseupdatethread);
+        //adjacent levels are prebuilt in the background once the game is running
+        addLoadPhase("level scene nodes", [this]
+        {
+            if(!m_LevelManager->setCurrentLevel(m_CurrentLevel)) return -1;
+            return 0;
+        }, true, {geometry, camera});
+    }
 
-    //start threads
-    for(int i = 0; i < int(m_Threads.size()); i++) m_Threads[i]->StartInternalThread();
+    //phases with no dependencies start right away
+    for(int i = 0; i < int(m_LoadPhases.size()); i++) m_Jobs->submit(m_LoadPhases[i]->job);
 
-    //start main loop
-    std::cout << "Starting main loop...\n";
-    loadScreen("Starting...");
-    mainLoop();
+    //keep the window alive and draw progress until every phase is done
+    int donecount = 0;
+    while(donecount < int(m_LoadPhases.size()) && !m_LoadFailed.load())
+    {
+        //closing the window or escape aborts loading
+        if(!m_Device->run()) {m_LoadFailed = true; break;}
+        m_Receiver->skipEvents();
+        if(m_Receiver->isKeyPressed(KEY_ESCAPE)) {m_LoadFailed = true; break;}
 
-    m_DoShutdown = true;
+        //run main thread phases until this frames budget is used
+        unsigned long long framestart = getMicroseconds();
+        int jobsrun = 0;
+        while(getMicroseconds() - framestart < LOAD_FRAME_BUDGET && m_Jobs->runMainThreadJobs(1) > 0) jobsrun++;
+
+        drawLoadScreen();
+
+        //nothing for the main thread, give the workers the cpu
+        if(!jobsrun) m_Device->yield();
+
+        donecount = 0;
+        for(int i = 0; i < int(m_LoadPhases.size()); i++) if(m_LoadPhases[i]->job->done.load()) donecount++;
     }
 
-    /*
-    for(int i = 0; i < int(m_Threads.size()); i++)
+    //on failure, let running phases finish, phases not yet started are skipped
+    for(int i = 0; i < int(m_LoadPhases.size()); i++) m_Jobs->wait(m_LoadPhases[i]->job);
+
+    //drop any decoded images that never got uploaded
+    for(int i = 0; i < int(wallimages.size()); i++) wallimages[i]->drop();
+    for(int i = 0; i < int(floorimages.size()); i++) floorimages[i]->drop();
+    for(int i = 0; i < graphiccount; i++)
+        for(int n = 0; n < int(graphicimages[i].size()); n++) graphicimages[i][n]->drop();
+    for(int i = 0; i < bitmapcount; i++)
+        for(int n = 0; n < int(bitmapimages[i].size()); n++) bitmapimages[i][n]->drop();
+
+    if(m_LoadFailed.load())
     {
-        m_Threads[i]->WaitForInternalThreadToExit();
+        for(int i = 0; i < int(m_LoadPhases.size()); i++)
+        {
+            if(m_LoadPhases[i]->errorcode.load()) return m_LoadPhases[i]->errorcode.load();
+        }
+        return -1; // aborted by user
     }
-    */
 
     return 0;
 }
 
-void Game::loadScreen(std::string loadmessage)
+void Game::drawLoadScreen()
 {
+    const int lineheight = m_FontNormal->m_Height + 2*SCREEN_SCALE;
+    unsigned long long now = getMicroseconds();
+    int donecount = 0;
+
     //clear scene
     m_Driver->beginScene(true, true, SColor(255,0,0,0));
 
-    drawFontString(&m_FontNormal, loadmessage, vector2d<s32>(0,0), SColor(255,255,255,255));
+    drawFontString(m_FontNormal, "Loading...", vector2d<s32>(4*SCREEN_SCALE, 4*SCREEN_SCALE), SColor(255,255,255,255));
+
+    //one line per phase, done phases show how long they took
+    for(int i = 0; i < int(m_LoadPhases.size()); i++)
+    {
+        LoadPhase *tphase = m_LoadPhases[i];
+        unsigned long long starttime = tphase->starttime.load();
+        unsigned long long endtime = tphase->endtime.load();
+
+        std::stringstream phasestr;
+        SColor phasecolor(255,96,96,96);
+
+        phasestr << tphase->name;
+        if(endtime)
+        {
+            phasestr << " - " << (endtime - starttime)/1000 << "ms";
+            phasecolor = SColor(255,255,255,255);
+            donecount++;
+        }
+        else if(starttime)
+        {
+            phasestr << " - " << (now - starttime)/1000 << "ms...";
+            phasecolor = SColor(255,255,255,0);
+        }
+
+        drawFontString(m_FontNormal, phasestr.str(), vector2d<s32>(8*SCREEN_SCALE, 4*SCREEN_SCALE + (i+1)*lineheight), phasecolor);
+    }
+
+    //progress bar along the bottom
+    rect<s32> barrect(8*SCREEN_SCALE, SCREEN_HEIGHT - 16*SCREEN_SCALE, SCREEN_WIDTH - 8*SCREEN_SCALE, SCREEN_HEIGHT - 8*SCREEN_SCALE);
+    rect<s32> fillrect = barrect;
+    if(!m_LoadPhases.empty()) fillrect.LowerRightCorner.X = barrect.UpperLeftCorner.X + (barrect.getWidth()*donecount) / int(m_LoadPhases.size());
+    else fillrect.LowerRightCorner.X = barrect.UpperLeftCorner.X;
+
+    m_Driver->draw2DRectangle(SColor(255,48,48,48), barrect);
+    m_Driver->draw2DRectangle(SColor(255,160,128,64), fillrect);
+
+    std::stringstream totalstr;
+    totalstr << donecount << "/" << m_LoadPhases.size() << " - " << (now - m_StartTime)/1000 << "ms";
+    drawFontString(m_FontNormal, totalstr.str(), vector2d<s32>(barrect.UpperLeftCorner.X, barrect.UpperLeftCorner.Y - lineheight), SColor(255,255,255,255));
 
     //done and display
-    m_Driver->endScene();
+    {
+        TRACE_SCOPE("endScene");
+        m_Driver->endScene();
+    }
+}
+
+void Game::printLoadPhases()
+{
+    unsigned long long loadstart = 0;
+    unsigned long long loadend = 0;
+
+    for(int i = 0; i < int(m_LoadPhases.size()); i++)
+    {
+        LoadPhase *tphase = m_LoadPhases[i];
+        unsigned long long starttime = tphase->starttime.load();
+        unsigned long long endtime = tphase->endtime.load();
+
+        std::cout << "....." << tphase->name << " : ";
+        if(!endtime) std::cout << "not finished";
+        else std::cout << (endtime - starttime)/1000 << "ms (started at " << (starttime - m_StartTime)/1000 << "ms)";
+        if(tphase->errorcode.load()) std::cout << " ERROR CODE " << tphase->errorcode.load();
+        std::cout << std::endl;
+
+        if(starttime && (!loadstart || starttime < loadstart)) loadstart = starttime;
+        if(endtime > loadend) loadend = endtime;
+    }
+
+    if(loadend) std::cout << "Load phases took " << (loadend - loadstart)/1000 << "ms, " << (loadend - m_StartTime)/1000 << "ms since start.\n";
+    if(m_FirstFrameTime) std::cout << "Time to first interactive frame : " << m_FirstFrameTime/1000 << "ms\n";
+}
 
+void Game::stopThreads()
+{
+    //let threads know they need to die, job workers are joined before returning
+    m_DoShutdown = true;
+
+    //background level builds need the workers to finish
+    if(m_LevelManager != NULL) m_LevelManager->cancelBuilds();
+
+    if(m_Jobs != NULL) m_Jobs->shutdown();
+
+    //all threads are done adding events
+    if(m_Tracer->isEnabled())
+    {
+        m_Tracer->stop();
+        m_Tracer->write(m_BenchConfig.traceFile.empty() ? TRACE_DEFAULT_OUTPUT : m_BenchConfig.traceFile);
+    }
 }
 
 int Game::initIrrlicht()
@@ -231,8 +584,16 @@ int Game::initIrrlicht()
     //init receiver
     m_Receiver = new MyEventReceiver(this);
 
+    //benchmarks run without a gpu
+    video::E_DRIVER_TYPE drivertype = video::EDT_OPENGL;
+    if(m_BenchConfig.enabled)
+    {
+        if(m_BenchConfig.driver == BENCHDRIVER_SOFTWARE) drivertype = video::EDT_BURNINGSVIDEO;
+        else drivertype = video::EDT_NULL;
+    }
+
     //init device
-    m_Device = createDevice( video::EDT_OPENGL, dimension2d<u32>(SCREEN_WIDTH, SCREEN_HEIGHT), 16, FULLSCREEN, false, false, m_Receiver);
+    m_Device = createDevice( drivertype, dimension2d<u32>(SCREEN_WIDTH, SCREEN_HEIGHT), 16, FULLSCREEN && !m_BenchConfig.enabled, false, false, m_Receiver);
     if(!m_Device) return -2; // error device unable to be created successfully
     m_Device->setWindowCaption(L"UWproj");
 
@@ -356,9 +717,6 @@ int Game::initPlayer()
 //  MAIN LOOP
 void Game::mainLoop()
 {
-    bool drawaxis = true;
-
-
     //texture testing
     //m_Mouse->setDebugTexture(&m_DragonsTXT);
 
@@ -376,137 +734,262 @@ void Game::mainLoop()
     //main loop
     while(m_Device->run())
     {
-        //update mouse position
-        //m_Mouse->updatePosition();
-
-        //std::cout << "Mouse:" << m_MousePos.X << "," << m_MousePos.Y << std::endl;
+        //demos only start between frames, so the first tick runs entirely on the fixed timestep
+        if(m_PendingDemoState == DEMO_RECORDING) startDemoRecord(m_PendingDemoFile);
+        else if(m_PendingDemoState == DEMO_REPLAYING) startDemoReplay(m_PendingDemoFile);
+        m_PendingDemoState = DEMO_IDLE;
 
         // Work out a frame delta time.
         const u32 now = m_Device->getTimer()->getTime();
-        frameDeltaTime = (f32)(now - then) / 1000.f; // Time in seconds
-        then = now;
 
+        //demos step a fixed timestep, kept in pace with real time
+        if(m_Demo->isActive())
+        {
+            u32 simnow = m_DemoBaseTime + m_Demo->getTickTime();
+            if(simnow > now) { m_Device->yield(); continue;}
 
-        //processEvents();
-        handleInputs();
+            frameDeltaTime = f32(DEMO_TICK_MS) / 1000.f;
+            then = now;
 
-        //update camera / collision
-        updateCamera();
+            runFrame(simnow);
+        }
+        else
+        {
+            frameDeltaTime = (f32)(now - then) / 1000.f; // Time in seconds
+            then = now;
 
+            runFrame(now);
+        }
 
-        //clear scene
-        m_Driver->beginScene(true, true, SColor(255,0,0,0));
-        //set 3d view position and size
-        if(dbg_showmainui) m_Driver->setViewPort(rect<s32>(SCREEN_WORLD_POS_X, SCREEN_WORLD_POS_Y, SCREEN_WORLD_POS_X + SCREEN_WORLD_WIDTH, SCREEN_WORLD_POS_Y + SCREEN_WORLD_HEIGHT));
+        int fps = m_Driver->getFPS();
 
-        /*
-        //current floor plane
-        plane3df myplane(vector3df(0,0,-25), vector3df(0,0,1));
-        //line from camera to mouse cursor
-        line3df myline = m_IMgr->getRayFromScreenCoordinates(m_MousePos);
-        vector3df myint;
-        //get intersection of camera_mouse_line to the floor plane
-        myplane.getIntersectionWithLimitedLine(myline.end, myline.start, myint);
-        */
+        if (lastFPS != fps)
+        {
+            core::stringw tmp(L"UWproj [");
+            tmp += m_Driver->getName();
+            tmp += L"] fps: ";
+            tmp += fps;
 
-        //test draw bounding box for grid 0 0
-        //mymap[0][0]->setDebugDataVisible(irr::scene::EDS_BBOX);
+            m_Device->setWindowCaption(tmp.c_str());
+            lastFPS = fps;
+        }
 
+    }
 
-        //make grid transparent if mouse is touching it
-        /*
-        for(int i = 0; i < int(mymap.size()); i++)
+    return;
+}
+
+//one tick of the game, frameDeltaTime must be set for this frame
+void Game::runFrame(u32 now)
+{
+    bool drawaxis = true;
+
+    TRACE_SCOPE("frame");
+    m_Profiler->beginFrame();
+    m_AllocTracker->beginFrame();
+
+    //process events queued by m_Device->run(), or the recorded ones when replaying, then held keys
+    {
+        TRACE_SCOPE("events");
+        if(m_Demo->isReplaying())
         {
-            for(int n = 0; n < int(mymap[i].size()); n++)
+            m_Receiver->discardEvents();
+
+            const std::vector<SEvent> *tevents = m_Demo->getReplayEvents();
+            if(tevents != NULL)
             {
-                if(mymap[i][n] == NULL) continue;
+                for(int i = 0; i < int(tevents->size()); i++) m_Receiver->dispatchEvent( (*tevents)[i]);
+            }
+        }
+        else m_Receiver->drainEvents();
+    }
+    handleInputs();
 
-                if( mymap[i][n]->getTransformedBoundingBox().isPointInside(myint) )
-                {
-                    mymap[i][n]->setMaterialType(video::EMT_TRANSPARENT_ADD_COLOR);
+    //continuations from job workers that need the main thread
+    {
+        TRACE_SCOPE("mainThreadJobs");
+        m_Jobs->runMainThreadJobs();
+    }
 
-                    if(mouseLeftClicked)
-                    {
-                        mymap[i][n]->remove();
-                        mymap[i][n] = NULL;
-                    }
+    //update camera / collision
+    updateCamera();
 
+    //stepping onto a new tile may set off a move trigger
+    vector3df ppos = m_Player->getPosition();
+    vector2di ptile( int(ppos.Z)/UNIT_SCALE, int(ppos.X)/UNIT_SCALE);
+    if(ptile != m_LastPlayerTile)
+    {
+        m_LastPlayerTile = ptile;
+        checkMoveTriggers(ptile);
+        m_Automap->reveal(&mLevels[m_CurrentLevel], ptile);
+    }
+
+    //wake / update objects near player
+    vector3df playerpos = m_Camera->getPosition();
+    {
+        TRACE_SCOPE("scheduler");
+        m_Scheduler->tick(now, vector2di( int(playerpos.Z)/UNIT_SCALE, int(playerpos.X)/UNIT_SCALE));
+    }
+
+    //prebuild levels the player can reach, unload far ones
+    {
+        TRACE_SCOPE("levelManager");
+        m_LevelManager->update();
+    }
+
+    //colour cycling, only the textures using cycled entries are touched
+    {
+        TRACE_SCOPE("palette");
+        m_PaletteManager.update(u32(frameDeltaTime*1000.f + 0.5f));
+    }
+
+    //one texture rewrite per animated terrain texture, sources change when remapped in software
+    {
+        TRACE_SCOPE("texanim");
+        m_TextureAnimator.update(u32(frameDeltaTime*1000.f + 0.5f), m_PaletteManager.getLastRemapped());
+    }
+
+    //distance shade of the tiles around the camera when the palette shader can't do it
+    {
+        TRACE_SCOPE("shading");
+        updateVertexShading();
+    }
+
+    //simulation for this tick is done
+    if(m_Demo->isActive())
+    {
+        if(!m_Demo->endTick(getSimChecksum())) stopDemo();
+    }
+
+
+    //clear scene
+    m_Driver->beginScene(true, true, SColor(255,0,0,0));
+    //set 3d view position and size
+    if(dbg_showmainui) m_Driver->setViewPort(rect<s32>(SCREEN_WORLD_POS_X, SCREEN_WORLD_POS_Y, SCREEN_WORLD_POS_X + SCREEN_WORLD_WIDTH, SCREEN_WORLD_POS_Y + SCREEN_WORLD_HEIGHT));
+
+    /*
+    //current floor plane
+    plane3df myplane(vector3df(0,0,-25), vector3df(0,0,1));
+    //line from camera to mouse cursor
+    line3df myline = m_IMgr->getRayFromScreenCoordinates(m_MousePos);
+    vector3df myint;
+    //get intersection of camera_mouse_line to the floor plane
+    myplane.getIntersectionWithLimitedLine(myline.end, myline.start, myint);
+    */
+
+    //test draw bounding box for grid 0 0
+    //mymap[0][0]->setDebugDataVisible(irr::scene::EDS_BBOX);
+
+
+    //make grid transparent if mouse is touching it
+    /*
+    for(int i = 0; i < int(mymap.size()); i++)
+    {
+        for(int n = 0; n < int(mymap[i].size()); n++)
+        {
+            if(mymap[i][n] == NULL) continue;
+
+            if( mymap[i][n]->getTransformedBoundingBox().isPointInside(myint) )
+            {
+                mymap[i][n]->setMaterialType(video::EMT_TRANSPARENT_ADD_COLOR);
+
+                if(mouseLeftClicked)
+                {
+                    mymap[i][n]->remove();
+                    mymap[i][n] = NULL;
                 }
-                else mymap[i][n]->setMaterialType(video::EMT_SOLID);
+
             }
+            else mymap[i][n]->setMaterialType(video::EMT_SOLID);
         }
-        */
+    }
+    */
 
 
-        //draw scene
+    //draw scene
+    {
+        PROFILE_SCOPE("drawAll");
         m_SMgr->drawAll();
+    }
 
 
 
-        //draw axis
-        if(drawaxis)
-        {
-            SMaterial mymat;
-            mymat.setFlag(video::EMF_LIGHTING, false);
-            m_Driver->setMaterial(mymat);
-            m_Driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
-            m_Driver->draw3DLine(vector3df(0,0,0), vector3df(0,0,100), SColor(255,0,0,255)); // z-axis blue
-            m_Driver->draw3DLine(vector3df(0,0,0), vector3df(100,0,0), SColor(255,255,0,0)); // x-axis red
-            m_Driver->draw3DLine(vector3df(0,0,0), vector3df(0,100,0), SColor(255,000,255,0)); // y-axis green
+    //draw axis
+    if(drawaxis)
+    {
+        SMaterial mymat;
+        mymat.setFlag(video::EMF_LIGHTING, false);
+        m_Driver->setMaterial(mymat);
+        m_Driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+        m_Driver->draw3DLine(vector3df(0,0,0), vector3df(0,0,100), SColor(255,0,0,255)); // z-axis blue
+        m_Driver->draw3DLine(vector3df(0,0,0), vector3df(100,0,0), SColor(255,255,0,0)); // x-axis red
+        m_Driver->draw3DLine(vector3df(0,0,0), vector3df(0,100,0), SColor(255,000,255,0)); // y-axis green
+
+        //draw 3d line from camera to mouse click
+        m_Driver->draw3DLine(m_Mouse->m_CameraMouseRay.start, m_Mouse->m_CameraMouseRay.end, SColor(255,255,0,0));
+    }
 
-            //draw 3d line from camera to mouse click
-            m_Driver->draw3DLine(m_Mouse->m_CameraMouseRay.start, m_Mouse->m_CameraMouseRay.end, SColor(255,255,0,0));
-        }
 
+    //draw gui
+    if(dbg_showmainui)
+    {
+        m_Driver->setViewPort(rect<s32>(0,0,SCREEN_WIDTH, SCREEN_HEIGHT));
 
-        //draw gui
-        if(dbg_showmainui)
-        {
-            m_Driver->setViewPort(rect<s32>(0,0,SCREEN_WIDTH, SCREEN_HEIGHT));
+        //m_GUIEnv->drawAll();
 
-            //m_GUIEnv->drawAll();
+        //newly explored tiles go into the cached map even while it is closed
+        m_Automap->update(&mLevels[m_CurrentLevel]);
 
-            drawMainUI();
+        drawMainUI();
 
-            if(dbg_dodrawpal) dbg_drawpal(&m_Palettes[0]);
+        //map covers the world view
+        if(m_Automap->isOpen())
+        {
+            vector3df ppos = m_Player->getPosition();
+            m_Automap->draw(rect<s32>(SCREEN_WORLD_POS_X, SCREEN_WORLD_POS_Y, SCREEN_WORLD_POS_X + SCREEN_WORLD_WIDTH, SCREEN_WORLD_POS_Y + SCREEN_WORLD_HEIGHT),
+                            vector2df(ppos.Z/UNIT_SCALE, ppos.X/UNIT_SCALE));
         }
 
-        for(int n = 0; n < int(m_UIInventorySlots.size()); n++)dbg_drawrect(m_UIInventorySlots[n]);
+        if(dbg_dodrawpal) dbg_drawpal(&m_Palettes[0]);
+    }
 
+    for(int n = 0; n < int(m_UIInventorySlots.size()); n++)dbg_drawrect(m_UIInventorySlots[n]);
 
 
-        /*
-        m_Driver->setMaterial(SMaterial());
-        m_Driver->setTransform(video::ETS_WORLD, IdentityMatrix);
-        m_Driver->draw3DLine( vector3df(0,0,0), vector3df(100,0,0), SColor(0,255,0,0));
-        */
 
-        //draw mouse
-        m_Mouse->draw();
+    /*
+    m_Driver->setMaterial(SMaterial());
+    m_Driver->setTransform(video::ETS_WORLD, IdentityMatrix);
+    m_Driver->draw3DLine( vector3df(0,0,0), vector3df(100,0,0), SColor(0,255,0,0));
+    */
 
-        //done and display
-        m_Driver->endScene();
+    //draw mouse
+    m_Mouse->draw();
 
-        int fps = m_Driver->getFPS();
+    //frame timing overlay, not counted in the frame it shows
+    m_AllocTracker->endFrame();
+    m_Profiler->endFrame();
+    if(m_Profiler->isOverlayVisible()) m_Profiler->drawOverlay(m_Driver, m_FontNormal, position2d<s32>(2*SCREEN_SCALE, 2*SCREEN_SCALE));
 
-        if (lastFPS != fps)
-        {
-            core::stringw tmp(L"UWproj [");
-            tmp += m_Driver->getName();
-            tmp += L"] fps: ";
-            tmp += fps;
+    //done and display
+    m_Driver->endScene();
 
-            m_Device->setWindowCaption(tmp.c_str());
-            lastFPS = fps;
-        }
+    //startup is over once the first playable frame is on screen
+    if(!m_FirstFrameTime)
+    {
+        m_FirstFrameTime = getMicroseconds() - m_StartTime;
+        std::cout << "Time to first interactive frame : " << m_FirstFrameTime/1000 << "ms\n";
 
+        std::stringstream ttfstr;
+        ttfstr << "Started in " << m_FirstFrameTime/1000 << "ms";
+        m_Scroll->addMessage(ttfstr.str());
     }
-
-    return;
 }
 
 void Game::handleInputs()
 {
+    PROFILE_SCOPE("handleInputs");
+
     if(m_InputContext == IMODE_PLAY)
     {
         //check if keys are held for movement
@@ -566,6 +1049,8 @@ void Game::handleInputs()
 
 void Game::processEvent(const SEvent *event)
 {
+    //mouse position comes from mouse events
+    if(event->EventType == EET_MOUSE_INPUT_EVENT && m_Mouse != NULL) m_Mouse->setPosition(event->MouseInput.X, event->MouseInput.Y);
 
     //input mode is scroll entry mode
     if(m_InputContext == IMODE_SCROLL_ENTRY)
@@ -630,6 +1115,10 @@ void Game::processEvent(const SEvent *event)
                 else if(event->KeyInput.Key == KEY_KEY_T)
                 {
                 }
+                else if(event->KeyInput.Key == KEY_KEY_M)
+                {
+                    m_Automap->setOpen(!m_Automap->isOpen());
+                }
                 else if(event->KeyInput.Key == KEY_KEY_Z)
                 {
                     if(m_Mouse->isDebugMode())
@@ -648,7 +1137,15 @@ void Game::processEvent(const SEvent *event)
                     std::cout << "Camera ID = " << m_Camera->getID() << ", Camera Target ID = " << m_CameraTarget->getID() << std::endl;
                     if(ttile != NULL)
                     {
-                        ttile->printDebug();
+                        ttile->printDebug(mLevels[m_CurrentLevel].getObjectPool());
+
+                        //print npc info for any mobile objects on tile
+                        const std::vector<ObjectHandle> &tobjs = ttile->getObjects();
+                        for(int i = 0; i < int(tobjs.size()); i++)
+                        {
+                            int slot = ObjectPool::getIndex(tobjs[i]);
+                            if(mLevels[m_CurrentLevel].getNPCs()->isActive(slot)) mLevels[m_CurrentLevel].getNPCs()->printDebug(slot);
+                        }
                     }
                     else std::cout << "Current tile = NULL!\n";
                 }
@@ -765,37 +1262,36 @@ void Game::processEvent(const SEvent *event)
                 */
 
                 //first try to get an object
-                ISceneNode *selectedSceneNode = m_ColMgr->getSceneNodeFromRayBB(m_Mouse->m_CameraMouseRay, ID_IsObject);
-                if(selectedSceneNode != NULL)
+                int spriteid = m_SpriteBatch->pick(m_Mouse->m_CameraMouseRay);
+                ISceneNode *selectedSceneNode = NULL;
+                if(spriteid != SPRITEBATCH_NONE)
                 {
                     std::cout << "OBJ HIT!\n";
-                    std::cout << "Name of hit node = " << selectedSceneNode->getName() << std::endl;
 
-                    //get object id from node name
-                    std::string objidstr = std::string(selectedSceneNode->getName());
-
-                    objidstr = objidstr.substr(4);
-                    int tid = atoi(objidstr.c_str());
-                    std::cout << "object instance id:" << tid << std::endl;
+                    //sprite user data is the object handle
+                    const Sprite *tsprite = m_SpriteBatch->getSprite(spriteid);
+                    ObjectHandle thandle = tsprite->userdata;
+                    std::cout << "object handle:0x" << std::hex << thandle << std::dec << std::endl;
                     //find object
-                    ObjectInstance *objptr = NULL;
-                    for(int j = 0; j < int(mLevels[m_CurrentLevel].getObjectsMaster()->size()); j++)
-                    {
-                        if( (*mLevels[m_CurrentLevel].getObjectsMaster())[j]->getInstanceID() == tid)
-                        {
-                            objptr = (*mLevels[m_CurrentLevel].getObjectsMaster())[j];
-                            break;
-                        }
-                    }
+                    ObjectPool *objpool = mLevels[m_CurrentLevel].getObjectPool();
+                    ObjectInstance *objptr = objpool->get(thandle);
 
                     if(objptr != NULL)
                     {
-                        std::cout << "Object ID " << tid << " found.  Object name=" << getString(3, objptr->getRefID()) << std::endl;
+                        std::cout << "Object handle " << thandle << " found.  Object name=" << getString(3, objptr->getRefID()) << std::endl;
                         lookAtObject(objptr);
 
                         //debug
-                        objptr->setBillboard(NULL);
-                        m_Player->setInventorySlot(0, objptr);
+                        //move object from level into player inventory
+                        if(m_Player->setInventorySlot(0, objptr))
+                        {
+                            //sprite sits on the tile the object is linked to
+                            vector3df spos = tsprite->position;
+                            Tile *ttile = mLevels[m_CurrentLevel].getTile(int(spos.Z)/UNIT_SCALE, int(spos.X)/UNIT_SCALE);
+                            if(ttile != NULL) ttile->removeObject(thandle);
+                            m_Scheduler->removeEntity(thandle);
+                            objpool->release(thandle);
+                        }
                     }
 
 
@@ -820,8 +1316,18 @@ void Game::processEvent(const SEvent *event)
             //else mouse wheel moved
             else if(event->MouseInput.Event == EMIE_MOUSE_WHEEL)
             {
+                //over the scroll, wheel moves through message history
+                if(m_Scroll->getScrollRect().isPointInside(position2d<s32>(event->MouseInput.X, event->MouseInput.Y)))
+                {
+                    m_Scroll->scroll(event->MouseInput.Wheel > 0 ? -1 : 1);
+                }
+                //map open, wheel zooms it
+                else if(m_Automap->isOpen())
+                {
+                    m_Automap->zoom(event->MouseInput.Wheel > 0 ? 1 : -1);
+                }
                 //mouse wheel up
-                if(event->MouseInput.Wheel > 0)
+                else if(event->MouseInput.Wheel > 0)
                 {
                     m_Camera->setFOV( m_Camera->getFOV()*0.9);
                 }
@@ -853,10 +1359,7 @@ bool Game::setInputContext(int ncontext)
 
 int Game::drawMainUI()
 {
-    const static rect<s32> screen_rect( position2d<s32>(0,0), dimension2d<u32>(SCREEN_WIDTH, SCREEN_HEIGHT));
-    const static rect<s32> scroll_edge_rect( position2d<s32>(0,0), dimension2d<u32>(m_ScrollEdgeTXT[0]->getSize()) );
-
-    const static SColor m_ScrollFillColor = m_Palettes[0][SCROLL_PAL_INDEX];
+    PROFILE_SCOPE("drawMainUI");
 
     //update animation states
     for(int i = 0; i < int(m_UIAnimations.size()); i++)
@@ -898,58 +1401,94 @@ int Game::drawMainUI()
         }
     }
 
+    //scroll and its edges are redrawn together whenever messages change
+    rect<s32> scroll_region( position2d<s32>(SCROLL_EDGE_LEFT), dimension2d<u32>(m_ScrollEdgeTXT[0]->getSize()) );
+    scroll_region.addInternalPoint( position2d<s32>(SCROLL_EDGE_RIGHT) + position2d<s32>(m_ScrollEdgeTXT[5]->getSize().Width, m_ScrollEdgeTXT[5]->getSize().Height) );
+
+    //static layers come from the cached composite, only dirty areas are redrawn
+    if(m_UICompositor != NULL && m_UICompositor->isValid())
+    {
+        if(m_Scroll->isDirty()) m_UICompositor->markDirty(scroll_region);
+        if(m_Player->isInventoryDirty())
+        {
+            for(int i = 0; i < int(m_UIInventorySlots.size()); i++) m_UICompositor->markDirty(m_UIInventorySlots[i]);
+        }
+
+        m_UICompositor->compose([this](const rect<s32> *cliprect){ drawStaticUI(cliprect);});
+        m_UICompositor->draw();
+    }
+    else drawStaticUI(NULL);
+
+    m_Scroll->clearDirty();
+    m_Player->clearInventoryDirty();
+
+    //animated layers are drawn over the composite every frame
+    //left dragon legs, anim index 1
+    m_Driver->draw2DImage( m_DragonsTXT[2 + m_UIAnimations[1].current],
+                           position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(4*SCREEN_SCALE,21*SCREEN_SCALE),
+                           rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[2 + m_UIAnimations[1].current]->getSize() ) ),
+                           NULL,
+                           SColor(255,255,255,255),
+                           true);
+    //left dragon tail, anim index 0
+    m_Driver->draw2DImage( m_DragonsTXT[14 + m_UIAnimations[0].current],
+                          position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(4*SCREEN_SCALE,-69*SCREEN_SCALE),
+                          rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[14 + m_UIAnimations[0].current]->getSize()) ),
+                          NULL,
+                          SColor(255,255,255,255),
+                          true);
+
+    //scroll input cursor
+    m_Scroll->drawCursor();
+
+    return 0;
+}
+
+void Game::drawStaticUI(const rect<s32> *cliprect)
+{
+    PROFILE_SCOPE("drawStaticUI");
+
+    const static rect<s32> screen_rect( position2d<s32>(0,0), dimension2d<u32>(SCREEN_WIDTH, SCREEN_HEIGHT));
+    const static rect<s32> scroll_edge_rect( position2d<s32>(0,0), dimension2d<u32>(m_ScrollEdgeTXT[0]->getSize()) );
+
+    const static SColor m_ScrollFillColor = m_Palettes[0][SCROLL_PAL_INDEX];
+
     //draw main ui graphic
-    m_Driver->draw2DImage( m_BitmapsTXT[2], position2d<s32>(0,0), screen_rect, NULL, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_BitmapsTXT[2], position2d<s32>(0,0), screen_rect, cliprect, SColor(255,255,255,255), true);
 
     //draw scroll components (edges and main scroll window)
     int scrolledgestate = m_Scroll->getScrollEdgeState();
-    m_Driver->draw2DRectangle(m_ScrollFillColor, m_Scroll->getScrollRect());
-    m_Driver->draw2DImage( m_ScrollEdgeTXT[scrolledgestate], position2d<s32>(SCROLL_EDGE_LEFT), scroll_edge_rect, NULL, SColor(255,255,255,255), true);
-    m_Driver->draw2DImage( m_ScrollEdgeTXT[scrolledgestate+5], position2d<s32>(SCROLL_EDGE_RIGHT), scroll_edge_rect, NULL, SColor(255,255,255,255), true);
+    m_Driver->draw2DRectangle(m_ScrollFillColor, m_Scroll->getScrollRect(), cliprect);
+    m_Driver->draw2DImage( m_ScrollEdgeTXT[scrolledgestate], position2d<s32>(SCROLL_EDGE_LEFT), scroll_edge_rect, cliprect, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_ScrollEdgeTXT[scrolledgestate+5], position2d<s32>(SCROLL_EDGE_RIGHT), scroll_edge_rect, cliprect, SColor(255,255,255,255), true);
 
     //draw scroll messages
-    m_Scroll->draw();
+    if(cliprect == NULL || cliprect->isRectCollided(m_Scroll->getScrollRect())) m_Scroll->draw(cliprect);
 
     //draw ui dragons
     //left dragon 36,134
     //body
-    m_Driver->draw2DImage( m_DragonsTXT[0], position2d<s32>(UI_DRAGON_LEFT), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[0]->getSize()) ), NULL, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_DragonsTXT[0], position2d<s32>(UI_DRAGON_LEFT), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[0]->getSize()) ), cliprect, SColor(255,255,255,255), true);
     //head clipped
     m_Driver->draw2DImage( m_DragonsTXT[1],
                            position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(0,11*SCREEN_SCALE),
                            rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[1]->getSize() + dimension2d<u32>(-25*SCREEN_SCALE,-11*SCREEN_SCALE)) ),
                            //rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[1]->getSize()) ),
-                           NULL,
+                           cliprect,
                            SColor(255,255,255,255),
                            true);
-    //head animated
+    //head
     m_Driver->draw2DImage( m_DragonsTXT[6],
                            position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(12*SCREEN_SCALE,11*SCREEN_SCALE),
                            rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[6]->getSize() ) ),
-                           NULL,
-                           SColor(255,255,255,255),
-                           true);
-    //legs animated
-    //anim index 1
-    m_Driver->draw2DImage( m_DragonsTXT[2 + m_UIAnimations[1].current],
-                           position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(4*SCREEN_SCALE,21*SCREEN_SCALE),
-                           rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[2 + m_UIAnimations[1].current]->getSize() ) ),
-                           NULL,
+                           cliprect,
                            SColor(255,255,255,255),
                            true);
-    //tail
-    //anim index 0
-    m_Driver->draw2DImage( m_DragonsTXT[14 + m_UIAnimations[0].current],
-                          position2d<s32>(UI_DRAGON_LEFT) + position2d<s32>(4*SCREEN_SCALE,-69*SCREEN_SCALE),
-                          rect<s32>(position2d<s32>(0,0),dimension2d<u32>(m_DragonsTXT[14 + m_UIAnimations[0].current]->getSize()) ),
-                          NULL,
-                          SColor(255,255,255,255),
-                          true);
 
     //right dragon
-    m_Driver->draw2DImage( m_DragonsTXT[18], position2d<s32>(UI_DRAGON_RIGHT), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[18]->getSize()) ), NULL, SColor(255,255,255,255), true);
-    m_Driver->draw2DImage( m_DragonsTXT[19], position2d<s32>(UI_DRAGON_RIGHT) + position2d<s32>(-24*SCREEN_SCALE, 11*SCREEN_SCALE), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[19]->getSize()) ), NULL, SColor(255,255,255,255), true);
-    m_Driver->draw2DImage( m_DragonsTXT[32], position2d<s32>(UI_DRAGON_RIGHT) + position2d<s32>(-4*SCREEN_SCALE, -69*SCREEN_SCALE), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[32]->getSize()) ), NULL, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_DragonsTXT[18], position2d<s32>(UI_DRAGON_RIGHT), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[18]->getSize()) ), cliprect, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_DragonsTXT[19], position2d<s32>(UI_DRAGON_RIGHT) + position2d<s32>(-24*SCREEN_SCALE, 11*SCREEN_SCALE), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[19]->getSize()) ), cliprect, SColor(255,255,255,255), true);
+    m_Driver->draw2DImage( m_DragonsTXT[32], position2d<s32>(UI_DRAGON_RIGHT) + position2d<s32>(-4*SCREEN_SCALE, -69*SCREEN_SCALE), rect<s32>(position2d<s32>(0,0), dimension2d<u32>(m_DragonsTXT[32]->getSize()) ), cliprect, SColor(255,255,255,255), true);
 
 
     //draw inventory
@@ -958,13 +1497,15 @@ int Game::drawMainUI()
         ObjectInstance *tobj = m_Player->getInventorySlot(i);
         if(tobj != NULL)
         {
-            m_Driver->draw2DImage( tobj->getTexture(), m_UIInventorySlots[i].UpperLeftCorner, rect<s32>(position2d<s32>(0,0), dimension2d<u32>(tobj->getTexture()->getSize())), NULL, SColor(255,255,255,255), true);
+            m_Driver->draw2DImage( tobj->getTexture(), m_UIInventorySlots[i].UpperLeftCorner, tobj->getImageRect(), cliprect, SColor(255,255,255,255), true);
         }
     }
 }
 
 void Game::updateCamera()
 {
+    PROFILE_SCOPE("updateCamera");
+
     //adjust camera position with velocity vector
     //m_CameraPos += m_CameraVel;
 
@@ -1042,6 +1583,8 @@ void Game::updateCamera()
 
 bool Game::processCollision(vector3df *pos, vector3df *vel)
 {
+    PROFILE_SCOPE("processCollision");
+
     if(dbg_noclip) return true;
     else if(pos == NULL || vel == NULL) return false;
 
@@ -1066,7 +1609,8 @@ bool Game::processCollision(vector3df *pos, vector3df *vel)
     //else std::cout << "vel:" << vel->X << "," << vel->Y << "," << vel->Z << std::endl;
 
     //get all adjacent tiles
-    std::vector<Tile*> adjtiles = mLevels[m_CurrentLevel].getAdjacentTilesAt(tpos.X, tpos.Y);
+    Tile *adjtiles[4];
+    mLevels[m_CurrentLevel].getAdjacentTilesAt(tpos.X, tpos.Y, adjtiles);
 
     vector2df diagvel(0,0);
 
@@ -1276,7 +1820,6 @@ Object *Game::getObject(int id)
 
 int Game::initObjects()
 {
-    //std::cout << "object graphics count : " << m_ObjectsTXT.size() << std::endl;
     //std::cout << "object strings        : " << m_StringBlocks[3].strings.size() << std::endl;
 
     //supports up to 512 objects
@@ -1304,25 +1847,78 @@ int Game::initObjects()
    01c0-01cf  Explosions/splats, fountain, silver tree, moving things
    */
 
+   const AtlasSet *objset = m_SpriteAtlas.getSet("objects");
+
    for(int i = 0; i < 512; i++)
    {
        Object *newobject = new Object;
-       if(i < int(m_ObjectsTXT.size()) ) newobject->setTexture( m_ObjectsTXT[i]);
+
+       //point object at its region of the sprite atlas
+       if(objset != NULL && i < objset->count)
+       {
+           const AtlasRegion *tregion = m_SpriteAtlas.getRegion(objset->start + i);
+           if(tregion != NULL) newobject->setTexture( m_SpriteAtlas.getPage(tregion->page), tregion->pixels, tregion->uv);
+       }
 
        m_Objects.push_back(newobject);
    }
 
+    //all object sprites are drawn by one batch node, chunked by SPRITE_CHUNK_TILES tiles
+    m_SpriteBatch = new SpriteBatch(m_SMgr->getRootSceneNode(), m_SMgr, ID_IsNotPickable, SPRITE_CHUNK_TILES*UNIT_SCALE,
+                                    (TILE_ROWS + SPRITE_CHUNK_TILES - 1)/SPRITE_CHUNK_TILES, (TILE_COLS + SPRITE_CHUNK_TILES - 1)/SPRITE_CHUNK_TILES);
+    //scene manager holds a reference
+    m_SpriteBatch->drop();
+    configSpriteBatch(m_SpriteBatch);
+
 
     return int(m_Objects.size());
 }
 
+int Game::decodeSpriteAtlas()
+{
+    //sprite sets packed into the atlas
+    const int setcount = 4;
+    const std::string setnames[setcount] = {"objects", "cursors", "tmobj", "tmflat"};
+    const std::string setfiles[setcount] = {"UWDATA\\objects.gr", "UWDATA\\cursors.gr", "UWDATA\\tmobj.gr", "UWDATA\\tmflat.gr"};
+
+    //decode all sets in parallel
+    std::vector< std::vector<IImage*> > images(setcount);
+    std::vector<int> errorcodes(setcount, 0);
+    m_Jobs->parallelFor(0, setcount, 1, [&setfiles, &images, &errorcodes](int start, int end)
+    {
+        for(int i = start; i < end; i++) errorcodes[i] = decodeGraphic(setfiles[i], &images[i]);
+    });
+
+    int errorcode = 0;
+    for(int i = 0; i < setcount; i++)
+    {
+        //atlas grabs the images it keeps, sets are added in order so region indices are stable
+        if(!errorcodes[i] && !errorcode) m_SpriteAtlas.addImageSet(setnames[i], &images[i]);
+        for(int n = 0; n < int(images[i].size()); n++) images[i][n]->drop();
+
+        if(errorcodes[i])
+        {
+            std::cout << "Error decoding " << setfiles[i] << std::endl;
+            errorcode = -1;
+        }
+    }
+    //pages are built and uploaded on the main thread
+    return errorcode;
+}
+
 int Game::initMouse()
 {
     //create mouse and link to game
     m_Mouse = new Mouse(this);
 
+    //get starting position, after this mouse events update it
+    m_Mouse->updatePosition();
+
     //set mouse texture to cursor
-    m_Mouse->setTexture(m_CursorsTXT[0]);
+    const AtlasSet *cursorset = m_SpriteAtlas.getSet("cursors");
+    if(cursorset == NULL || cursorset->count <= 0) return -1;
+    const AtlasRegion *tregion = m_SpriteAtlas.getRegion(cursorset->start);
+    m_Mouse->setTexture(m_SpriteAtlas.getPage(tregion->page), tregion->pixels);
 
     return 0;
 }
@@ -1340,6 +1936,18 @@ int Game::initMainUI()
     //create scroll object
     m_Scroll = new Scroll(this);
 
+    //cache static ui layers, the world view is left transparent
+    m_UICompositor = new UICompositor;
+    if(m_UICompositor->init(m_Driver, dimension2d<u32>(SCREEN_WIDTH, SCREEN_HEIGHT)))
+    {
+        m_UICompositor->addTransparentRect(rect<s32>(SCREEN_WORLD_POS_X, SCREEN_WORLD_POS_Y,
+                                                     SCREEN_WORLD_POS_X + SCREEN_WORLD_WIDTH, SCREEN_WORLD_POS_Y + SCREEN_WORLD_HEIGHT));
+    }
+
+    //automap target is filled as tiles are explored
+    m_Automap = new Automap;
+    m_Automap->init(m_Driver);
+
     //create inventory slots
     m_UIInventorySlots.resize(INV_TOTALSLOTS);
     for(int i = 0; i < 2; i++)
@@ -1376,8 +1984,11 @@ bool Game::configMeshSceneNode(IMeshSceneNode *tnode)
     if(tnode == NULL) return false;
 
     tnode->setMaterialFlag(video::EMF_BACK_FACE_CULLING, true);
-    if(dbg_nolighting) tnode->setMaterialFlag(video::EMF_LIGHTING, false);
+    if(dbg_nolighting || m_ShadingMode == SHADING_TABLE) tnode->setMaterialFlag(video::EMF_LIGHTING, false);
     else tnode->setMaterialFlag(video::EMF_LIGHTING, true);
+    //shading table darkens with distance in the palette shader, or through vertex colours.
+    //a new node starts at the darkest shade until it comes in range
+    if(hasVertexShading()) shadeMeshNode(tnode, NULL);
     //tnode->setMaterialFlag(video::EMF_TEXTURE_WRAP, true);
     //tnode->setMaterialFlag(video::EMF_NORMALIZE_NORMALS, true);
     //tnode->setMaterialFlag(video::EMF_BLEND_OPERATION, true);
@@ -1386,6 +1997,12 @@ bool Game::configMeshSceneNode(IMeshSceneNode *tnode)
     tnode->setMaterialFlag(video::EMF_TRILINEAR_FILTER, false );
     tnode->setMaterialFlag(video::EMF_ANISOTROPIC_FILTER, false );
 
+    //indexed textures look up the palette in a shader
+    if(m_PaletteManager.isShaderMode())
+    {
+        for(u32 i = 0; i < tnode->getMaterialCount(); i++) m_PaletteManager.configMaterial(&tnode->getMaterial(i));
+    }
+
     //automatic culling
     tnode->setAutomaticCulling(EAC_FRUSTUM_SPHERE ) ;
 
@@ -1408,6 +2025,7 @@ bool Game::configMeshSceneNode(IMeshSceneNode *tnode)
         if(tnode->getTriangleSelector() != NULL)
         {
             std::cout << "node already has triangle selector.\n";
+            m_MemStats->removeTriangleSelector(tnode->getTriangleSelector());
         }
 
         if(USE_OCTREE)
@@ -1422,43 +2040,37 @@ bool Game::configMeshSceneNode(IMeshSceneNode *tnode)
             tnode->setTriangleSelector(m_TriangleSelector);
             m_TriangleSelector->drop();
         }
+
+        m_MemStats->addTriangleSelector(m_TriangleSelector);
     }
 
     return true;
 }
 
-bool Game::configBillboardSceneNode(IBillboardSceneNode *tnode)
+bool Game::configSpriteBatch(SpriteBatch *tbatch)
 {
-    if(tnode == NULL) return false;
-
-     //tnode->setMaterialFlag(video::EMF_BACK_FACE_CULLING, true);
-    if(dbg_nolighting) tnode->setMaterialFlag(video::EMF_LIGHTING, false);
-    else tnode->setMaterialFlag(video::EMF_LIGHTING, true);
-    tnode->setMaterialFlag(video::EMF_BILINEAR_FILTER, false );
-    tnode->setMaterialFlag(video::EMF_TRILINEAR_FILTER, false );
-    tnode->setMaterialFlag(video::EMF_ANISOTROPIC_FILTER, false );
+    if(tbatch == NULL) return false;
 
-    //automatic culling
-    tnode->setAutomaticCulling(EAC_FRUSTUM_SPHERE ) ;
+    //material is shared by all sprites, only needs setting when debug options change
+    if(dbg_nolighting || m_ShadingMode == SHADING_TABLE) tbatch->setMaterialFlag(video::EMF_LIGHTING, false);
+    else tbatch->setMaterialFlag(video::EMF_LIGHTING, true);
+    if(m_ShadingMode == SHADING_TABLE && !dbg_nolighting) tbatch->setShading(&m_ShadeTable, m_ShadeTable.getRange(m_ShadeLevel));
+    else tbatch->setShading(NULL, 0.f);
+    tbatch->setMaterialFlag(video::EMF_BILINEAR_FILTER, false );
+    tbatch->setMaterialFlag(video::EMF_TRILINEAR_FILTER, false );
+    tbatch->setMaterialFlag(video::EMF_ANISOTROPIC_FILTER, false );
 
     //alpha
-    tnode->setMaterialFlag(EMF_COLOR_MASK, true);
-    tnode->setMaterialType(EMT_TRANSPARENT_ALPHA_CHANNEL);
+    tbatch->setMaterialFlag(EMF_COLOR_MASK, true);
+    tbatch->setMaterialType(EMT_TRANSPARENT_ALPHA_CHANNEL);
 
     //show bounding box debug data
-    if(dbg_showboundingbox) tnode->setDebugDataVisible(EDS_BBOX);
-    else tnode->setDebugDataVisible(EDS_OFF);
+    if(dbg_showboundingbox) tbatch->setDebugDataVisible(EDS_BBOX);
+    else tbatch->setDebugDataVisible(EDS_OFF);
 
-    //texture repeating
-    tnode->getMaterial(0).getTextureMatrix(0).setScale(1);
-    tnode->getMaterial(0).TextureLayer->TextureWrapU = video::ETC_REPEAT;
-    tnode->getMaterial(0).TextureLayer->TextureWrapV = video::ETC_REPEAT;
-
-    //update
-    tnode->updateAbsolutePosition();
-
-    //register collision stuff
-    //if(CONFIG_FOR_COLLISION) configureForCollision(tnode);
+    //texture clamping
+    tbatch->getMaterial(0).TextureLayer[0].TextureWrapU = video::ETC_CLAMP_TO_EDGE;
+    tbatch->getMaterial(0).TextureLayer[0].TextureWrapV = video::ETC_CLAMP_TO_EDGE;
 
     return true;
 }
@@ -1467,57 +2079,31 @@ bool Game::updateObject(ObjectInstance *tobj, Tile *ttile)
 {
     if(tobj == NULL) return false;
 
-    //get billboard object
-    IBillboardSceneNode *tbb = tobj->getBillboard();
-
-    //if tile is null, object is not on a tile, so if billboard is not null, drop it
-    if(ttile == NULL && tbb != NULL)
+    //if tile is null, object is not on a tile, so remove its sprite
+    if(ttile == NULL)
     {
-        tbb->drop();
-        tbb = NULL;
+        tobj->setSprite(SPRITEBATCH_NONE);
+        return true;
     }
 
-    //if billboard has not been created, but needs to be
-    if(tbb == NULL && ttile != NULL)
-    {
-        //create billboard node
-        //std::cout << "Creating billboard scene node...\n";
-        tbb = m_SMgr->addBillboardSceneNode();
-
-        //set id to pickable id
-        tbb->setID(ID_IsObject);
-        std::stringstream objnamess;
-        objnamess << "OBJ_" << tobj->getInstanceID();
-        tbb->setName(objnamess.str().c_str());
+    vector2di tilepos = ttile->getPosition();
+    vector3di objpos = tobj->getPosition();
 
-        //link billboard node to object
-        //std::cout << "Setting billboard scene node to object...\n";
-        tobj->setBillboard(tbb);
+    const float conversion = float(UNIT_SCALE)/float(TILE_UNIT);
 
-        //set billboard texture to object id
-        //std::cout << "Setting billboards texture from object id...\n";
-        tbb->setMaterialTexture(0, tobj->getTexture());
-    }
+    vector3df spritepos( (tilepos.Y*UNIT_SCALE) + conversion*float(TILE_UNIT-objpos.Y),
+                         ( float(objpos.Z) / TILE_UNIT)+(float(OBJECT_SCALE)/2),
+                         (tilepos.X*UNIT_SCALE) + conversion*float(objpos.X) );
+    dimension2d<f32> spritesize(OBJECT_SCALE, OBJECT_SCALE);
 
-    //if billboard is not null
-    if(tbb != NULL)
+    //create sprite if object does not have one yet, otherwise move it
+    if(tobj->getSprite() == SPRITEBATCH_NONE)
     {
-        vector2di tilepos = ttile->getPosition();
-        vector3di objpos = tobj->getPosition();
-
-        tbb->setSize(dimension2d<f32>(OBJECT_SCALE,OBJECT_SCALE) );
-
-        //configure billboard common settings
-        //std::cout << "Configuring billboard node...\n";
-        configBillboardSceneNode(tbb);
-
-        const float conversion = float(UNIT_SCALE)/float(TILE_UNIT);
-
-        vector3df debugpos( (tilepos.Y*UNIT_SCALE) + conversion*float(TILE_UNIT-objpos.Y),
-                            ( float(objpos.Z) / TILE_UNIT)+(float(OBJECT_SCALE)/2),
-                            (tilepos.X*UNIT_SCALE) + conversion*float(objpos.X) );
-        tbb->setPosition( debugpos);
+        int spriteid = m_SpriteBatch->addSprite(spritepos, spritesize, tobj->getTexture(), tobj->getHandle(), tobj->getUVRect());
+        if(spriteid == SPRITEBATCH_NONE) return false;
+        tobj->setSprite(spriteid);
     }
+    else m_SpriteBatch->updateSprite(tobj->getSprite(), spritepos, spritesize, tobj->getTexture(), tobj->getUVRect());
 
     return true;
 }
@@ -1656,6 +2242,11 @@ void Game::sendToConsole(std::string nstring)
     m_Console->parse(nstring);
 }
 
+int Game::completeConsoleInput(std::string *tstring, std::vector<std::string> *matches)
+{
+    return m_Console->complete(tstring, matches);
+}
+
 std::string Game::getString(int blockindex, int stringindex)
 {
 
@@ -1697,6 +2288,134 @@ std::string Game::lookAtObject(ObjectInstance *tobj)
     return processeddesc;
 }
 
+bool Game::setShading(int mode, int lightlevel)
+{
+    //an unknown light level changes nothing
+    f32 trange = m_ShadeTable.getRange(lightlevel);
+    if(trange <= 0.f)
+    {
+        std::cout << "No shade table for light level " << lightlevel << ", " << m_ShadeTable.getLightLevelCount() << " levels\n";
+        if(m_ShadeTable.getLightLevelCount() > 0 || mode == SHADING_TABLE) return false;
+    }
+
+    m_ShadingMode = mode;
+    if(trange > 0.f) m_ShadeLevel = lightlevel;
+
+    if(m_ShadingMode == SHADING_TABLE)
+    {
+        //everything past the range is at the darkest shade, so nothing past it needs drawing
+        m_CameraLight->setVisible(false);
+        m_PaletteManager.setShadeRange(0.f, trange);
+        m_Camera->setFarValue(trange);
+    }
+    else
+    {
+        m_CameraLight->setVisible(true);
+        m_PaletteManager.setShadeRange(0.f, 0.f);
+        m_Camera->setFarValue(m_LightRadius/1.6);
+    }
+
+    //level may not be loaded yet, its meshes are configured with the mode when created
+    if(m_CurrentLevel >= 0 && m_CurrentLevel < int(mLevels.size())) reconfigureAllLevelMeshes();
+    reconfigureAllLevelObjects();
+
+    return true;
+}
+
+bool Game::isVertexShading()
+{
+    return m_ShadingMode == SHADING_TABLE && hasVertexShading() && !dbg_nolighting;
+}
+
+void Game::shadeMeshNode(IMeshSceneNode *tnode, const vector3df *eyepos)
+{
+    IMesh *tmesh = tnode->getMesh();
+    if(tmesh == NULL) return;
+
+    //without an eye position the node is set to its shade out of range
+    bool shading = isVertexShading();
+    f32 trange = m_ShadeTable.getRange(m_ShadeLevel);
+    SColor tcolor(255,255,255,255);
+    if(shading) tcolor = m_ShadeTable.getShadeColor(trange, trange);
+
+    const matrix4 &ttransform = tnode->getAbsoluteTransformation();
+    for(u32 i = 0; i < tmesh->getMeshBufferCount(); i++)
+    {
+        IMeshBuffer *tbuf = tmesh->getMeshBuffer(i);
+        if(tbuf->getVertexType() != EVT_STANDARD) continue;
+
+        S3DVertex *tverts = (S3DVertex*)tbuf->getVertices();
+        for(u32 n = 0; n < tbuf->getVertexCount(); n++)
+        {
+            if(shading && eyepos != NULL)
+            {
+                vector3df tpos;
+                ttransform.transformVect(tpos, tverts[n].Pos);
+                tcolor = m_ShadeTable.getShadeColor(tpos.getDistanceFrom(*eyepos), trange);
+            }
+            tverts[n].Color = tcolor;
+        }
+
+        tbuf->setDirty(EBT_VERTEX);
+    }
+}
+
+void Game::updateVertexShading()
+{
+    if(m_CurrentLevel < 0 || m_CurrentLevel >= int(mLevels.size())) return;
+    Level *tlevel = &mLevels[m_CurrentLevel];
+
+    //another level's rect means nothing here, its tiles were never shaded from it
+    if(m_VertexShadeLevel != m_CurrentLevel)
+    {
+        m_VertexShadeRect = rect<s32>(0,0,0,0);
+        m_VertexShadeLevel = m_CurrentLevel;
+    }
+
+    rect<s32> newrect(0,0,0,0);
+    vector3df eyepos = m_Camera->getAbsolutePosition();
+    if(isVertexShading())
+    {
+        //every tile with a corner inside the range, tiles are x = Z and y = X in world units
+        int radius = int(m_ShadeTable.getRange(m_ShadeLevel)/UNIT_SCALE) + 1;
+        int ex = int(eyepos.Z)/UNIT_SCALE;
+        int ey = int(eyepos.X)/UNIT_SCALE;
+        newrect = rect<s32>(core::max_(ex - radius, 0), core::max_(ey - radius, 0),
+                            core::min_(ex + radius + 1, TILE_COLS), core::min_(ey + radius + 1, TILE_ROWS));
+    }
+
+    //tiles that left the range go back to the darkest shade
+    for(int y = m_VertexShadeRect.UpperLeftCorner.Y; y < m_VertexShadeRect.LowerRightCorner.Y; y++)
+    {
+        for(int x = m_VertexShadeRect.UpperLeftCorner.X; x < m_VertexShadeRect.LowerRightCorner.X; x++)
+        {
+            if(x >= newrect.UpperLeftCorner.X && x < newrect.LowerRightCorner.X &&
+               y >= newrect.UpperLeftCorner.Y && y < newrect.LowerRightCorner.Y) continue;
+
+            Tile *ttile = tlevel->getTile(x, y);
+            if(ttile == NULL) continue;
+
+            const std::vector<IMeshSceneNode*> &tmeshes = ttile->getMeshes();
+            for(int i = 0; i < int(tmeshes.size()); i++) shadeMeshNode(tmeshes[i], NULL);
+        }
+    }
+
+    //the camera moves most frames, so every tile in range is shaded again
+    for(int y = newrect.UpperLeftCorner.Y; y < newrect.LowerRightCorner.Y; y++)
+    {
+        for(int x = newrect.UpperLeftCorner.X; x < newrect.LowerRightCorner.X; x++)
+        {
+            Tile *ttile = tlevel->getTile(x, y);
+            if(ttile == NULL) continue;
+
+            const std::vector<IMeshSceneNode*> &tmeshes = ttile->getMeshes();
+            for(int i = 0; i < int(tmeshes.size()); i++) shadeMeshNode(tmeshes[i], &eyepos);
+        }
+    }
+
+    m_VertexShadeRect = newrect;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 //  DEBUG
 void Game::reconfigureAllLevelMeshes()
@@ -1715,25 +2434,222 @@ void Game::reconfigureAllLevelMeshes()
     std::cout << "done.\n";
 }
 
-void Game::reconfigureAllLevelObjects()
+bool Game::changeLevel(int nlevel)
 {
-    std::cout << "Reconfiguring all level objects...\n";
-    for(int i = 0; i < TILE_ROWS; i++)
+    if(m_LevelManager == NULL) return false;
+    if(nlevel < 0 || nlevel >= int(mLevels.size())) return false;
+    if(nlevel == m_CurrentLevel) return true;
+
+    u32 now = m_Device->getTimer()->getTime();
+
+    //release sprites of the old level, they are created again if we come back
+    m_Scheduler->hibernateAll(now);
+    setLevelSprites(&mLevels[m_CurrentLevel], false);
+
+    if(!m_LevelManager->setCurrentLevel(nlevel))
+    {
+        std::cout << "Error changing to level " << nlevel << std::endl;
+        return false;
+    }
+
+    m_CurrentLevel = nlevel;
+    m_Scheduler->buildFromLevel(&mLevels[m_CurrentLevel], now);
+    setLevelSprites(&mLevels[m_CurrentLevel], true);
+
+    std::cout << "Changed to level " << m_CurrentLevel << " in " << m_LevelManager->getLastTransitionTime() << "us\n";
+
+    return true;
+}
+
+bool Game::teleportPlayer(int nlevel, vector2di ntile)
+{
+    if(!changeLevel(nlevel)) return false;
+
+    Tile *ttile = mLevels[m_CurrentLevel].getTile(ntile.X, ntile.Y);
+    if(ttile == NULL) return false;
+
+    //center of tile, player position is at floor level, the camera adds the standing height
+    m_Player->setPosition( vector3df( ntile.Y*UNIT_SCALE + UNIT_SCALE/2.f, ttile->getHeight(), ntile.X*UNIT_SCALE + UNIT_SCALE/2.f));
+    m_Player->setVelocity( vector3df(0,0,0));
+
+    //don't set off a trigger on the tile we land on
+    m_LastPlayerTile = ntile;
+
+    return true;
+}
+
+void Game::checkMoveTriggers(vector2di ttile)
+{
+    Tile *tile = mLevels[m_CurrentLevel].getTile(ttile.X, ttile.Y);
+    if(tile == NULL) return;
+
+    ObjectPool *objpool = mLevels[m_CurrentLevel].getObjectPool();
+    const std::vector<ObjectHandle> &tobjs = tile->getObjects();
+
+    for(int i = 0; i < int(tobjs.size()); i++)
+    {
+        ObjectInstance *tobj = objpool->get(tobjs[i]);
+        if(tobj == NULL || tobj->getRefID() != OBJECT_ID_MOVE_TRIGGER) continue;
+
+        //trigger links to its trap through the quantity field
+        if(tobj->isQuantity()) continue;
+        ObjectInstance *ttrap = objpool->getAt(tobj->getQuantity());
+        if(ttrap == NULL || ttrap->getRefID() != OBJECT_ID_TELEPORT_TRAP) continue;
+
+        //trap quality/owner are the destination tile (uw y axis is flipped), zpos the level (1 based, 0 = same level)
+        int tlevel = m_CurrentLevel;
+        if(ttrap->getPosition().Z != 0) tlevel = ttrap->getPosition().Z - 1;
+
+        teleportPlayer(tlevel, vector2di(ttrap->getQuality(), TILE_ROWS - 1 - ttrap->getOwner()));
+        return;
+    }
+}
+
+bool Game::startDemoRecord(std::string tfilename)
+{
+    if(m_Demo->isActive()) stopDemo();
+
+    DemoStart tstart;
+    tstart.level = m_CurrentLevel;
+    tstart.position = m_Player->getPosition();
+    tstart.rotation = m_Player->getRotation();
+    tstart.velocity = m_Player->getVelocity();
+    tstart.mousePosition = *m_Mouse->getMousePosition();
+    tstart.lastTile = m_LastPlayerTile;
+    tstart.inputContext = m_InputContext;
+
+    if(!m_Demo->startRecording(tfilename, tstart)) return false;
+
+    //keys already held were pressed before the recording, forget them so replay matches
+    m_Receiver->clearKeys();
+    m_DemoBaseTime = m_Device->getTimer()->getTime();
+
+    std::cout << "Recording demo to " << tfilename << std::endl;
+
+    return true;
+}
+
+bool Game::startDemoReplay(std::string tfilename)
+{
+    if(m_Demo->isActive()) stopDemo();
+
+    if(!m_Demo->load(tfilename))
+    {
+        std::cout << "Error loading demo " << tfilename << std::endl;
+        return false;
+    }
+
+    //restore state the demo was recorded from
+    const DemoStart *tstart = m_Demo->getStart();
+    if(!changeLevel(tstart->level)) return false;
+    m_Player->setPosition(tstart->position);
+    m_Player->setRotation(tstart->rotation);
+    m_Player->setVelocity(tstart->velocity);
+    m_Mouse->setPosition(tstart->mousePosition.X, tstart->mousePosition.Y);
+    m_LastPlayerTile = tstart->lastTile;
+    setInputContext(tstart->inputContext);
+    m_Receiver->clearKeys();
+
+    if(!m_Demo->startReplay()) return false;
+    m_DemoBaseTime = m_Device->getTimer()->getTime();
+
+    std::cout << "Replaying demo " << tfilename << ", " << m_Demo->getTickCount() << " ticks\n";
+
+    return true;
+}
+
+void Game::stopDemo()
+{
+    if(m_Demo->isRecording())
     {
-        for(int n = 0; n < TILE_COLS; n++)
+        int tickcount = m_Demo->getTickIndex();
+        if(m_Demo->stop()) std::cout << "Demo saved to " << m_Demo->getFilename() << ", " << tickcount << " ticks\n";
+        else std::cout << "Error saving demo to " << m_Demo->getFilename() << std::endl;
+    }
+    else if(m_Demo->isReplaying())
+    {
+        m_Demo->stop();
+
+        std::stringstream demoss;
+        if(m_Demo->getMismatches()) demoss << "Demo diverged at tick " << m_Demo->getFirstMismatch() << ", " << m_Demo->getMismatches() << " ticks mismatched";
+        else demoss << "Demo replayed " << m_Demo->getTickIndex() << " ticks, no mismatches";
+        std::cout << demoss.str() << std::endl;
+        m_Scroll->addMessage(demoss.str());
+    }
+
+    //released keys were never seen by the receiver
+    m_Receiver->clearKeys();
+}
+
+//fnv-1a over the state a replay has to reproduce exactly
+u32 Game::getSimChecksum()
+{
+    u32 hash = 2166136261u;
+    vector3df tstate[3] = {m_Player->getPosition(), m_Player->getRotation(), m_Player->getVelocity()};
+
+    auto hashbytes = [&hash](const void *data, int length)
+    {
+        const unsigned char *tbytes = (const unsigned char*)data;
+        for(int i = 0; i < length; i++)
         {
-            Tile *ttile = mLevels[m_CurrentLevel].getTile(n,i);
+            hash ^= tbytes[i];
+            hash *= 16777619u;
+        }
+    };
+
+    hashbytes(tstate, sizeof(tstate));
+    hashbytes(&m_CurrentLevel, sizeof(m_CurrentLevel));
+    hashbytes(&m_InputContext, sizeof(m_InputContext));
+
+    return hash;
+}
+
+void Game::onEntityWake(ObjectHandle thandle, vector2di ttile, u32 elapsed)
+{
+    ObjectInstance *tobj = mLevels[m_CurrentLevel].getObjectPool()->get(thandle);
+    if(tobj == NULL) return;
 
-            std::vector<ObjectInstance*> objs = ttile->getObjects();
+    //object may have been moved while asleep, put its sprite where it is now
+    updateObject(tobj, mLevels[m_CurrentLevel].getTile(ttile.X, ttile.Y));
+}
+
+void Game::onEntityHibernate(ObjectHandle thandle, vector2di ttile)
+{
+    //sleeping only pauses simulation, the sprite stays and the sprite batch culls it
+}
+
+void Game::setLevelSprites(Level *tlevel, bool visible)
+{
+    if(tlevel == NULL) return;
+
+    ObjectPool *tpool = tlevel->getObjectPool();
+    for(int y = 0; y < TILE_ROWS; y++)
+    {
+        for(int x = 0; x < TILE_COLS; x++)
+        {
+            Tile *ttile = tlevel->getTile(x, y);
+            const std::vector<ObjectHandle> &tobjs = ttile->getObjects();
 
-            for(int k = 0; k < int(objs.size()); k++)
+            for(int i = 0; i < int(tobjs.size()); i++)
             {
-                updateObject(objs[k], ttile);
+                ObjectInstance *tobj = tpool->get(tobjs[i]);
+                if(tobj == NULL) continue;
+
+                if(visible) updateObject(tobj, ttile);
+                else tobj->setSprite(SPRITEBATCH_NONE);
             }
         }
     }
 }
 
+void Game::reconfigureAllLevelObjects()
+{
+    std::cout << "Reconfiguring all level objects...\n";
+
+    //all objects share the sprite batch material
+    configSpriteBatch(m_SpriteBatch);
+}
+
 void Game::dbg_drawpal(std::vector<SColor> *tpal)
 {
     const int palsize = 4;
@@ -1751,7 +2667,7 @@ void Game::dbg_drawpal(std::vector<SColor> *tpal)
     }
 
     //draw normal font too
-    m_Driver->draw2DImage(m_FontNormal.m_Texture, position2d<s32>(palsize*16*SCREEN_SCALE, 0));
+    m_Driver->draw2DImage(m_FontNormal->m_Texture, position2d<s32>(palsize*16*SCREEN_SCALE, 0));
 
     //if mouse is inside pal window rect
     position2d<s32> mpos( int(m_Mouse->getMousePositionX()), int(m_Mouse->getMousePositionY()) );
@@ -1764,7 +2680,7 @@ void Game::dbg_drawpal(std::vector<SColor> *tpal)
         std::stringstream mss;
         mss << "#" << mindex;
 
-        drawFontString(&m_FontNormal, mss.str(), *m_Mouse->getMousePosition() + vector2di(16,16));
+        drawFontString(m_FontNormal, mss.str(), *m_Mouse->getMousePosition() + vector2di(16,16));
     }
 }
 
@@ -90,9 +90,9 @@ int loadAuxPalette(std::vector< std::vector<SColor> > *pals)
     return 0;
 }
 
-int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist)
+int decodeTexture(std::string tfilename, std::vector<IImage*> *ilist, std::vector< std::vector<u8> > *indices)
 {
-    if(tlist == NULL) return -1; //error texture list is null
+    if(ilist == NULL) return -1; //error image list is null
 
     //get game reference
     Game *gptr = NULL;
@@ -133,10 +133,9 @@ int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist)
         //std::cout << std::dec << "texture offset " << i << ": 0x" << std::hex << offsets.back() << std::endl;
     }
 
-    //read each texture from file offset into an opengl texture
+    //read each texture from file offset into an image
     for(int i = 0; i < txtcount; i++)
     {
-        ITexture *newtxt = NULL;
         IImage *newimg = NULL;
         int palSel = 0; //  wall/floor textures always use palette 0
 
@@ -146,6 +145,13 @@ int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist)
         //create image using texture dimension size
         newimg = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(txtdim, txtdim));
 
+        std::vector<u8> *tindices = NULL;
+        if(indices != NULL)
+        {
+            indices->push_back(std::vector<u8>(txtdim*txtdim));
+            tindices = &indices->back();
+        }
+
         //offset points to dim^2 bytes long data where each byte points to palette index
         for(int n = 0; n < txtdim; n++)
         {
@@ -156,37 +162,74 @@ int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist)
                 //error reading?
                 if(!readBin(&ifile, pindex, 1))
                 {
-                    std::cout << "Error reading texture at 0x" << std::hex << offsets[i] << std::endl;
+                    std::cout << "Error reading texture at 0x" << std::hex << offsets[i] << std::dec << std::endl;
+                    newimg->drop();
                     return -8; // error reading texture at offset
                 }
 
 
                 //set the pixel at x,y using current selected palette with read in palette index #
                 newimg->setPixel(p, n, (*gptr->getPalletes())[palSel][int(pindex[0])]);
+                if(tindices != NULL) (*tindices)[n*txtdim + p] = pindex[0];
             }
         }
 
+        //push image into image list
+        ilist->push_back(newimg);
+    }
+    ifile.close();
+
+    return 0;
+}
+
+int uploadTextures(std::vector<IImage*> *ilist, std::vector<ITexture*> *tlist)
+{
+    if(ilist == NULL || tlist == NULL) return -1; // error list is null
+
+    //get game reference
+    Game *gptr = NULL;
+    gptr = Game::getInstance();
+
+    int errorcode = 0;
+
+    for(int i = 0; i < int(ilist->size()); i++)
+    {
         //create texture name
         std::stringstream texturename;
         texturename << "txt_" << i;
 
         //create texture from image
-        newtxt = gptr->getDriver()->addTexture( texturename.str().c_str(), newimg );
+        ITexture *newtxt = gptr->getDriver()->addTexture( texturename.str().c_str(), (*ilist)[i] );
 
         //push texture into texture list
-        tlist->push_back(newtxt);
+        if(newtxt == NULL) errorcode = -12; // error creating texture
+        else tlist->push_back(newtxt);
 
         //drop image, no longer needed
-        newimg->drop();
+        (*ilist)[i]->drop();
     }
-    ifile.close();
+    ilist->clear();
 
-    return 0;
+    return errorcode;
 }
 
-int loadGraphic(std::string tfilename, std::vector<ITexture*> *tlist)
+int loadTexture(std::string tfilename, std::vector<ITexture*> *tlist)
 {
-    if(tlist == NULL) return false;
+    if(tlist == NULL) return -1; //error texture list is null
+
+    std::vector<IImage*> images;
+    int errorcode = decodeTexture(tfilename, &images);
+
+    //upload whatever was decoded, so images are always dropped
+    int uploaderror = uploadTextures(&images, tlist);
+
+    if(errorcode) return errorcode;
+    return uploaderror;
+}
+
+int decodeGraphic(std::string tfilename, std::vector<IImage*> *ilist)
+{
+    if(ilist == NULL) return false;
 
     //get game reference
     Game *gptr = NULL;
@@ -251,8 +294,7 @@ int loadGraphic(std::string tfilename, std::vector<ITexture*> *tlist)
         int bauxpal;
         int bsize;
 
-        //texture
-        ITexture *newtxt = NULL;
+        //image
         IImage *newimg = NULL;
         int palSel = 0; //  note : 4-bit images use aux pals, standard images use pal 0
 
@@ -452,43 +494,85 @@ int loadGraphic(std::string tfilename, std::vector<ITexture*> *tlist)
         }
 
 
-        //create texture name
-        std::stringstream texturename;
-        texturename << "txt_" << i;
+        //push image into image list, caller owns it
+        ilist->push_back(newimg);
+    }
+
+    ifile.close();
+
+    std::cout << std::dec;
+
+    return 0;
+}
 
+int uploadGraphics(std::vector<IImage*> *ilist, std::vector<ITexture*> *tlist, std::string tname)
+{
+    if(ilist == NULL || tlist == NULL) return -1; // error list is null
 
+    //get game reference
+    Game *gptr = NULL;
+    gptr = Game::getInstance();
+
+    int errorcode = 0;
+
+    for(int i = 0; i < int(ilist->size()); i++)
+    {
+        IImage *timg = (*ilist)[i];
+        ITexture *newtxt = NULL;
+
+        //create texture name
+        std::stringstream texturename;
+        texturename << tname << "_" << i;
 
         //create texture from image
-        IImage *stretchedimage = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(bwidth*SCREEN_SCALE, bheight*SCREEN_SCALE));
-        newimg->copyToScaling(stretchedimage);
+        IImage *stretchedimage = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(timg->getDimension().Width*SCREEN_SCALE, timg->getDimension().Height*SCREEN_SCALE));
+        timg->copyToScaling(stretchedimage);
         newtxt = gptr->getDriver()->addTexture( texturename.str().c_str(), stretchedimage );
+        stretchedimage->drop();
+
         //set transparency color (pink, 255,0,255)
         //note : this is palette index #0, set automatically when
         //       loading in palettes (see loadPalette())
-        gptr->getDriver()->makeColorKeyTexture(newtxt,  SColor(TRANSPARENCY_COLOR));
+        if(newtxt == NULL) errorcode = -12; // error creating texture
+        else
+        {
+            gptr->getDriver()->makeColorKeyTexture(newtxt,  SColor(TRANSPARENCY_COLOR));
 
-        if(newtxt == NULL) return -12; // error creating texture
-        //push texture into texture list
-        tlist->push_back(newtxt);
+            //push texture into texture list
+            tlist->push_back(newtxt);
+        }
 
         //drop image, no longer needed
-        newimg->drop();
-        stretchedimage->drop();
+        timg->drop();
     }
+    ilist->clear();
 
-    ifile.close();
+    return errorcode;
+}
 
-    std::cout << std::dec;
+int loadGraphic(std::string tfilename, std::vector<ITexture*> *tlist)
+{
+    if(tlist == NULL) return false;
 
-    return 0;
+    std::vector<IImage*> images;
+    int errorcode = decodeGraphic(tfilename, &images);
+
+    //only upload if decoding succeeded
+    if(errorcode)
+    {
+        for(int i = 0; i < int(images.size()); i++) images[i]->drop();
+        return errorcode;
+    }
+
+    return uploadGraphics(&images, tlist, "txt");
 }
 
-int loadBitmap(std::string tfilename, std::vector<ITexture*> *tlist, int tpalindex)
+int decodeBitmap(std::string tfilename, std::vector<IImage*> *ilist, int tpalindex)
 {
     const int bitmap_width = 320;
     const int bitmap_height = 200;
 
-    if(tlist == NULL) return -1; // vector list is null
+    if(ilist == NULL) return -1; // vector list is null
 
     //get game reference
     Game *gptr = NULL;
@@ -508,8 +592,6 @@ int loadBitmap(std::string tfilename, std::vector<ITexture*> *tlist, int tpalind
         return -3;
     }
 
-    //texture
-    ITexture *newtxt = NULL;
     IImage *newimg = NULL;
     //create new image using bitmap dimensions
     newimg = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(bitmap_width, bitmap_height));
@@ -527,28 +609,21 @@ int loadBitmap(std::string tfilename, std::vector<ITexture*> *tlist, int tpalind
         }
     }
 
-    //create texture name
-    std::stringstream texturename;
-    texturename << "txt_" << tfilename;
-
-    //create texture from image
-    IImage *stretchedimage = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(bitmap_width*SCREEN_SCALE, bitmap_height*SCREEN_SCALE));
-    newimg->copyToScaling(stretchedimage);
-    newtxt = gptr->getDriver()->addTexture( texturename.str().c_str(), stretchedimage );
-    //set transparency color (pink, 255,0,255)
-    //note : this is palette index #0, set automatically when
-    //       loading in palettes (see loadPalette())
-    gptr->getDriver()->makeColorKeyTexture(newtxt,  SColor(TRANSPARENCY_COLOR));
-
-    //push texture into texture list
-    tlist->push_back(newtxt);
-
-    //drop image, no longer needed
-    newimg->drop();
-    stretchedimage->drop();
+    //push image into image list
+    ilist->push_back(newimg);
 
     ifile.close();
 
     return 0;
 }
 
+int loadBitmap(std::string tfilename, std::vector<ITexture*> *tlist, int tpalindex)
+{
+    if(tlist == NULL) return -1; // vector list is null
+
+    std::vector<IImage*> images;
+    int errorcode = decodeBitmap(tfilename, &images, tpalindex);
+    if(errorcode) return errorcode;
+
+    return uploadGraphics(&images, tlist, "txt_" + tfilename);
+}
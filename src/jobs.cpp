@@ -0,0 +1,454 @@
+#include "jobs.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include "tools.hpp"
+#include "trace.hpp"
+
+JobSystem *JobSystem::m_Instance = NULL;
+
+//index of worker owning the current thread, -1 for main / other threads
+static thread_local int t_WorkerIndex = -1;
+
+//run job on calling thread unless it was cancelled
+static void executeJob(JobHandle tjob)
+{
+    tjob->started = true;
+    if(!tjob->cancelled.load() && tjob->func)
+    {
+        TRACE_SCOPE("job");
+        tjob->func();
+    }
+}
+
+//////////////////////////////////////////////////////
+//  WORKER
+JobWorker::JobWorker(JobSystem *njobs, int nindex)
+{
+    m_Jobs = njobs;
+    m_Index = nindex;
+
+    m_BusyTime = 0;
+    m_JobsRun = 0;
+    m_Steals = 0;
+}
+
+JobWorker::~JobWorker()
+{
+
+}
+
+void JobWorker::InternalThreadEntry()
+{
+    t_WorkerIndex = m_Index;
+
+    std::stringstream tname;
+    tname << "worker " << m_Index;
+    Tracer::getInstance()->setThreadName(tname.str());
+
+    while(!m_Jobs->isShuttingDown())
+    {
+        unsigned long long starttime = getMicroseconds();
+
+        if(m_Jobs->runPendingJob(m_Index))
+        {
+            m_BusyTime += getMicroseconds() - starttime;
+            m_JobsRun++;
+        }
+        //nothing to do, sleep until work is queued
+        else m_Jobs->waitForWork(m_Index);
+    }
+}
+
+//////////////////////////////////////////////////////
+//  JOB SYSTEM
+JobSystem::JobSystem()
+{
+    m_Shutdown = false;
+    m_NextWorker = 0;
+    m_QueuedCount = 0;
+    m_MainThreadID = std::this_thread::get_id();
+    m_StatsStartTime = getMicroseconds();
+}
+
+JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+int JobSystem::init(int workercount)
+{
+    //already started
+    if(!m_Workers.empty()) return int(m_Workers.size());
+
+    //one worker per core, the main thread takes the last core
+    if(workercount <= 0) workercount = int(std::thread::hardware_concurrency()) - 1;
+    if(workercount < JOBS_MIN_WORKERS) workercount = JOBS_MIN_WORKERS;
+
+    m_Shutdown = false;
+    m_MainThreadID = std::this_thread::get_id();
+
+    for(int i = 0; i < workercount; i++) m_Workers.push_back(new JobWorker(this, i));
+
+    //start after all workers exist, so stealing never sees a partial list
+    for(int i = 0; i < workercount; i++)
+    {
+        if(!m_Workers[i]->StartInternalThread())
+        {
+            std::cout << "Error starting job worker " << i << std::endl;
+            shutdown();
+            return -1;
+        }
+    }
+
+    resetStats();
+
+    return workercount;
+}
+
+void JobSystem::shutdown()
+{
+    m_Shutdown = true;
+
+    {
+        std::lock_guard<std::mutex> lk(m_WakeLock);
+    }
+    m_WakeCondition.notify_all();
+
+    //every worker is stopped before any is deleted, a worker still in wait() steals from the others
+    for(int i = 0; i < int(m_Workers.size()); i++) m_Workers[i]->WaitForInternalThreadToExit();
+
+    //jobs left behind are finished as cancelled so nothing waits on them forever.  finishing
+    //can queue dependents, so keep going until every queue stays empty
+    bool drained = false;
+    while(!drained)
+    {
+        drained = true;
+
+        for(int i = 0; i < int(m_Workers.size()); i++)
+        {
+            JobHandle tjob;
+            while( (tjob = popLocal(i)) != NULL)
+            {
+                tjob->cancelled = true;
+                executeJob(tjob);
+                finish(tjob);
+                drained = false;
+            }
+        }
+
+        JobHandle tjob;
+        {
+            std::lock_guard<std::mutex> lk(m_MainQueueLock);
+            if(!m_MainQueue.empty())
+            {
+                tjob = m_MainQueue.front();
+                m_MainQueue.pop_front();
+            }
+        }
+        if(tjob != NULL)
+        {
+            tjob->cancelled = true;
+            executeJob(tjob);
+            finish(tjob);
+            drained = false;
+        }
+    }
+
+    for(int i = 0; i < int(m_Workers.size()); i++) delete m_Workers[i];
+    m_Workers.clear();
+
+    m_QueuedCount = 0;
+}
+
+JobHandle JobSystem::createJob(std::function<void()> nfunc, bool mainthread)
+{
+    JobHandle newjob(new Job);
+    newjob->func = nfunc;
+    newjob->mainThread = mainthread;
+    newjob->pendingDeps = 1;
+    newjob->started = false;
+    newjob->done = false;
+    newjob->cancelled = false;
+
+    return newjob;
+}
+
+bool JobSystem::addDependency(JobHandle tjob, JobHandle tdependency)
+{
+    if(tjob == NULL || tdependency == NULL) return false;
+
+    std::lock_guard<std::mutex> lk(tdependency->depLock);
+
+    //already finished, nothing to wait on
+    if(tdependency->done.load()) return true;
+
+    tjob->pendingDeps++;
+    tdependency->dependents.push_back(tjob);
+
+    return true;
+}
+
+void JobSystem::submit(JobHandle tjob)
+{
+    if(tjob == NULL) return;
+
+    //release the hold taken at creation
+    if(--tjob->pendingDeps == 0) enqueue(tjob);
+}
+
+JobHandle JobSystem::schedule(std::function<void()> nfunc, bool mainthread)
+{
+    JobHandle newjob = createJob(nfunc, mainthread);
+    submit(newjob);
+
+    return newjob;
+}
+
+JobHandle JobSystem::then(JobHandle tdependency, std::function<void()> nfunc, bool mainthread)
+{
+    JobHandle newjob = createJob(nfunc, mainthread);
+    addDependency(newjob, tdependency);
+    submit(newjob);
+
+    return newjob;
+}
+
+void JobSystem::cancel(JobHandle tjob)
+{
+    if(tjob == NULL) return;
+
+    tjob->cancelled = true;
+}
+
+void JobSystem::enqueue(JobHandle tjob)
+{
+    //main thread jobs wait for the main loop
+    if(tjob->mainThread)
+    {
+        std::lock_guard<std::mutex> lk(m_MainQueueLock);
+        m_MainQueue.push_back(tjob);
+        return;
+    }
+
+    //no workers running, just run it here
+    if(m_Workers.empty())
+    {
+        executeJob(tjob);
+        finish(tjob);
+        return;
+    }
+
+    //workers push to their own deque, other threads spread jobs round robin
+    int windex = t_WorkerIndex;
+    if(windex < 0) windex = int(m_NextWorker++ % m_Workers.size());
+
+    {
+        std::lock_guard<std::mutex> lk(m_Workers[windex]->m_QueueLock);
+        m_Workers[windex]->m_Queue.push_back(tjob);
+    }
+    m_QueuedCount++;
+
+    //take wake lock so a worker can't miss the notify between checking and sleeping
+    {
+        std::lock_guard<std::mutex> lk(m_WakeLock);
+    }
+    m_WakeCondition.notify_one();
+}
+
+void JobSystem::finish(JobHandle tjob)
+{
+    std::vector<JobHandle> readyjobs;
+
+    {
+        std::lock_guard<std::mutex> lk(tjob->depLock);
+        tjob->done = true;
+        readyjobs.swap(tjob->dependents);
+    }
+
+    //release dependents, any that have nothing else to wait on are queued
+    for(int i = 0; i < int(readyjobs.size()); i++)
+    {
+        if(--readyjobs[i]->pendingDeps == 0) enqueue(readyjobs[i]);
+    }
+}
+
+JobHandle JobSystem::popLocal(int workerindex)
+{
+    if(workerindex < 0 || workerindex >= int(m_Workers.size())) return JobHandle();
+
+    JobWorker *tworker = m_Workers[workerindex];
+    std::lock_guard<std::mutex> lk(tworker->m_QueueLock);
+
+    if(tworker->m_Queue.empty()) return JobHandle();
+
+    //newest first, its data is most likely still in cache
+    JobHandle tjob = tworker->m_Queue.back();
+    tworker->m_Queue.pop_back();
+    m_QueuedCount--;
+
+    return tjob;
+}
+
+JobHandle JobSystem::steal(int thiefindex)
+{
+    int workercount = int(m_Workers.size());
+
+    for(int i = 1; i <= workercount; i++)
+    {
+        int victim = (thiefindex + i) % workercount;
+        if(victim < 0) victim += workercount;
+        if(victim == thiefindex) continue;
+
+        JobWorker *tworker = m_Workers[victim];
+        std::lock_guard<std::mutex> lk(tworker->m_QueueLock);
+
+        if(tworker->m_Queue.empty()) continue;
+
+        //oldest first, usually the biggest piece of remaining work
+        JobHandle tjob = tworker->m_Queue.front();
+        tworker->m_Queue.pop_front();
+        m_QueuedCount--;
+
+        if(thiefindex >= 0) m_Workers[thiefindex]->m_Steals++;
+
+        return tjob;
+    }
+
+    return JobHandle();
+}
+
+bool JobSystem::runPendingJob(int workerindex)
+{
+    JobHandle tjob = popLocal(workerindex);
+    if(tjob == NULL) tjob = steal(workerindex);
+    if(tjob == NULL) return false;
+
+    executeJob(tjob);
+    finish(tjob);
+
+    return true;
+}
+
+bool JobSystem::waitForWork(int workerindex)
+{
+    std::unique_lock<std::mutex> lk(m_WakeLock);
+
+    //timeout is only a safety net, enqueue and shutdown both notify
+    return m_WakeCondition.wait_for(lk, std::chrono::milliseconds(50),
+                                    [this]{ return m_QueuedCount.load() > 0 || m_Shutdown.load();});
+}
+
+void JobSystem::wait(JobHandle tjob)
+{
+    if(tjob == NULL) return;
+
+    while(!tjob->done.load())
+    {
+        //help out instead of blocking
+        if(isMainThread() && runMainThreadJobs(1) > 0) continue;
+        if(runPendingJob(t_WorkerIndex)) continue;
+
+        //shutting down with nothing left here to run, shutdown() finishes the rest
+        if(m_Shutdown.load()) return;
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(int start, int end, int grain, std::function<void(int,int)> nfunc)
+{
+    if(end <= start) return;
+    if(grain < 1) grain = 1;
+
+    //not worth splitting
+    if(end - start <= grain || m_Workers.empty())
+    {
+        nfunc(start, end);
+        return;
+    }
+
+    std::vector<JobHandle> chunks;
+    for(int i = start; i < end; i += grain)
+    {
+        int chunkend = i + grain;
+        if(chunkend > end) chunkend = end;
+
+        chunks.push_back(schedule([nfunc, i, chunkend]{ nfunc(i, chunkend);}));
+    }
+
+    for(int i = 0; i < int(chunks.size()); i++) wait(chunks[i]);
+}
+
+int JobSystem::runMainThreadJobs(int maxjobs)
+{
+    if(!isMainThread()) return 0;
+
+    int jobcount = 0;
+
+    while(maxjobs < 0 || jobcount < maxjobs)
+    {
+        JobHandle tjob;
+
+        {
+            std::lock_guard<std::mutex> lk(m_MainQueueLock);
+            if(m_MainQueue.empty()) break;
+            tjob = m_MainQueue.front();
+            m_MainQueue.pop_front();
+        }
+
+        executeJob(tjob);
+        finish(tjob);
+        jobcount++;
+    }
+
+    return jobcount;
+}
+
+float JobSystem::getWorkerUtilization(int workerindex)
+{
+    if(workerindex < 0 || workerindex >= int(m_Workers.size())) return 0;
+
+    unsigned long long elapsed = getMicroseconds() - m_StatsStartTime;
+    if(elapsed == 0) return 0;
+
+    return float(m_Workers[workerindex]->m_BusyTime.load()) / float(elapsed);
+}
+
+int JobSystem::getWorkerJobsRun(int workerindex)
+{
+    if(workerindex < 0 || workerindex >= int(m_Workers.size())) return 0;
+
+    return m_Workers[workerindex]->m_JobsRun.load();
+}
+
+int JobSystem::getWorkerSteals(int workerindex)
+{
+    if(workerindex < 0 || workerindex >= int(m_Workers.size())) return 0;
+
+    return m_Workers[workerindex]->m_Steals.load();
+}
+
+void JobSystem::resetStats()
+{
+    for(int i = 0; i < int(m_Workers.size()); i++)
+    {
+        m_Workers[i]->m_BusyTime = 0;
+        m_Workers[i]->m_JobsRun = 0;
+        m_Workers[i]->m_Steals = 0;
+    }
+
+    m_StatsStartTime = getMicroseconds();
+}
+
+void JobSystem::printStats()
+{
+    std::cout << "Job workers : " << m_Workers.size() << std::endl;
+
+    for(int i = 0; i < int(m_Workers.size()); i++)
+    {
+        std::cout << "Worker " << i << " : " << int(getWorkerUtilization(i)*100) << "% busy, "
+                  << getWorkerJobsRun(i) << " jobs, " << getWorkerSteals(i) << " steals\n";
+    }
+}
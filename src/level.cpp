@@ -6,6 +6,9 @@
 #include "game.hpp"
 #include "tools.hpp"
 #include "object.hpp"
+#include "jobs.hpp"
+#include "trace.hpp"
+#include "memstats.hpp"
 
 int loadLevel(std::vector<Level> *levels)
 {
@@ -104,6 +107,8 @@ int loadLevel(std::vector<Level> *levels)
     //read in level data
     // note : UW1 only has 9 levels
     // note : UW1 maps are 64x64 tiles * 4 bytes
+    //reserve levels so they are not copied (along with their object pools) while loading
+    levels->reserve(levels->size() + 9);
     for(int i = 0; i < 9; i++)
     {
         //create level
@@ -115,6 +120,20 @@ int loadLevel(std::vector<Level> *levels)
         //set ceiling texture index from texture map (level uses one for whole map)
         levels->back().setCeilingTextureIndex( texturemap[i][txtmapwalls+txtmapfloors-1]);
 
+        //automap blocks follow the texture maps, empty until the level is visited
+        //note: same tile order as the level data, flipped on y axis
+        if( int(blockoffsets.size()) > (9*3)+i && blockoffsets[(9*3)+i] != std::streampos(0))
+        {
+            ifile.seekg(blockoffsets[(9*3)+i]);
+            for(int n = TILE_ROWS-1; n >= 0; n--)
+            {
+                unsigned char maprow[TILE_COLS];
+                if(!readBin(&ifile, maprow, TILE_COLS)) break;
+
+                for(int p = 0; p < TILE_COLS; p++) if(maprow[p]) levels->back().setExplored(p, n);
+            }
+        }
+
         //jump file position pointer to offset to begin reading in level data
         ifile.seekg(blockoffsets[i]);
 
@@ -175,6 +194,46 @@ int loadLevel(std::vector<Level> *levels)
 
         //read in level objects
 
+        //read free lists first so the object pool knows which slots are in use
+        //note : free list counts are stored as number of entries minus 1
+        unsigned char freecountbuf[2];
+        std::vector<int> mobilefree;
+        std::vector<int> staticfree;
+        readBinAt(&ifile, freecountbuf, 2, blockoffsets[i] + std::streampos(0x7c02));
+        int mobilefreecount = lsbSum(freecountbuf, 2) + 1;
+        readBin(&ifile, freecountbuf, 2);
+        int staticfreecount = lsbSum(freecountbuf, 2) + 1;
+
+        //sanity check free list counts
+        if(mobilefreecount < 0 || mobilefreecount > OBJECT_POOL_MOBILE - OBJECT_POOL_FIRST_MOBILE) mobilefreecount = 0;
+        if(staticfreecount < 0 || staticfreecount > OBJECT_POOL_SIZE - OBJECT_POOL_MOBILE) staticfreecount = 0;
+
+        ifile.seekg( blockoffsets[i] + std::streampos(0x7300));
+        for(int n = 0; n < mobilefreecount; n++)
+        {
+            unsigned char freebuf[2];
+            readBin(&ifile, freebuf, 2);
+            mobilefree.push_back( lsbSum(freebuf, 2));
+        }
+
+        ifile.seekg( blockoffsets[i] + std::streampos(0x74fc));
+        for(int n = 0; n < staticfreecount; n++)
+        {
+            unsigned char freebuf[2];
+            readBin(&ifile, freebuf, 2);
+            staticfree.push_back( lsbSum(freebuf, 2));
+        }
+
+        //get level object pool
+        ObjectPool *objpool = levels->back().getObjectPool();
+
+        //if free lists are bad, fall back to treating every slot as used
+        if(!objpool->setFreeLists(mobilefree, staticfree))
+        {
+            std::cout << "Invalid object free lists for level " << i << ", ignoring.\n";
+            objpool->setFreeLists(std::vector<int>(), std::vector<int>());
+        }
+
         //jump to master list for mobile objects in block (offset 0x4000)
         //total of 1024 objects (256 mobile(npc), and 768 static objects)
         //build master list index starting with mobile objects
@@ -193,10 +252,43 @@ int loadLevel(std::vector<Level> *levels)
             objinfo = lsbSum(objinfobuf, 2);
             int objid = getBitVal(objinfo, 0, 8);
 
-            //create new object instance of object id
-            ObjectInstance *newobj = new ObjectInstance( gptr->getObject(objid) );
-            //add new object to master object list
-            levels->back().addObject(newobj);
+            //object position
+            unsigned char objposbuf[2];
+            readBin(&ifile, objposbuf, 2);
+            int objpos = lsbSum(objposbuf, 2);
+
+            //object quality / chain
+            unsigned char objqualbuf[2];
+            readBin(&ifile, objqualbuf, 2);
+            int objqualdat = lsbSum(objqualbuf, 2);
+
+            //object link / special
+            unsigned char objlinkbuf[2];
+            readBin(&ifile, objlinkbuf, 2);
+            int objectlinkdat = lsbSum(objlinkbuf, 2);
+
+            //mobile (npc) objects have an additional 19 bytes of data
+            //mobile objects are the first 256 object in master list
+            unsigned char mobdata[NPC_MOBILE_DATA_SIZE];
+            if( n < OBJECT_POOL_MOBILE)
+            {
+                readBin(&ifile, mobdata, NPC_MOBILE_DATA_SIZE);
+            }
+
+            //place object instance in its master list slot (free slots are skipped)
+            ObjectInstance *newobj = objpool->getAt(n);
+            if(newobj == NULL) continue;
+
+            //decode npc data into level npc table
+            //note : slot 1 is the player, monsters are object ids 0x40-0x7f
+            if( n < OBJECT_POOL_MOBILE)
+            {
+                NPCTable *npcs = levels->back().getNPCs();
+                npcs->parseMobileData(n, mobdata);
+                if(n > 1 && objid >= 0x40 && objid <= 0x7f) npcs->setActive(n, true);
+            }
+
+            objpool->allocateAt(n, gptr->getObject(objid));
 
             //populate the rest of object flags/info
             newobj->setFlags( getBitVal(objinfo, 8, 4));
@@ -205,10 +297,6 @@ int loadLevel(std::vector<Level> *levels)
             newobj->setInvisible( getBitVal(objinfo, 14, 1));
             newobj->setIsQuantity( getBitVal(objinfo, 15, 1));
 
-            //object position
-            unsigned char objposbuf[2];
-            readBin(&ifile, objposbuf, 2);
-            int objpos = lsbSum(objposbuf, 2);
             newobj->setAngle( getBitVal(objpos, 7, 3));
             vector3di opos;
             opos.Z = getBitVal(objpos, 0, 7);
@@ -216,34 +304,13 @@ int loadLevel(std::vector<Level> *levels)
             opos.X = getBitVal(objpos, 13, 3);
             newobj->setPosition(opos);
 
-
-            //object quality / chain
-            unsigned char objqualbuf[2];
-            readBin(&ifile, objqualbuf, 2);
-            int objqualdat = lsbSum(objqualbuf, 2);
             newobj->setQuality( getBitVal(objqualdat, 0, 6) );
             newobj->setNext( getBitVal(objqualdat, 6, 10) );
 
-            //object link / special
-            unsigned char objlinkbuf[2];
-            readBin(&ifile, objlinkbuf, 2);
-            int objectlinkdat = lsbSum(objlinkbuf, 2);
             newobj->setOwner( getBitVal(objectlinkdat, 0, 6));
             newobj->setQuantity( getBitVal(objectlinkdat, 6, 10));
-
-            //mobile (npc) objects have an additional 19 bytes of data
-            //mobile objects are the first 256 object in master list
-            if( n < 256)
-            {
-                //temp mob dat
-                unsigned char mobdata[19];
-                readBin(&ifile, mobdata, 19);
-            }
         }
 
-        //get master objects list
-        std::vector<ObjectInstance*> *objlist = levels->back().getObjectsMaster();
-
         //add objects to tiles
         for(int n = 0; n < TILE_ROWS; n++)
         {
@@ -260,17 +327,23 @@ int loadLevel(std::vector<Level> *levels)
 
                 //note : object 0 means empty, no objects on tile
                 //add each linked object to tile object list
-                while(objindex != 0 && i == gptr->getCurrentLevel()) // for now, only process current level
+                //all levels are linked, the level manager can switch to any of them
+                while(objindex != 0)
                 {
 
                         //retrieve object from master list
-                        ObjectInstance *tobj = (*objlist)[objindex];
+                        ObjectInstance *tobj = objpool->getAt(objindex);
 
-                        //add object to tile objects list
-                        ttile->addObject(tobj);
+                        //broken chain, link points to a free slot
+                        if(tobj == NULL)
+                        {
+                            std::cout << "Object chain for tile " << p << "," << n << " links to free slot " << objindex << std::endl;
+                            break;
+                        }
 
-                        //update tile's object
-                        gptr->updateObject(tobj, ttile);
+                        //add object to tile objects list
+                        //sprites are created by the entity scheduler when the object is woken
+                        ttile->addObject(tobj->getHandle());
 
                         //get next linked object
                         objindex = tobj->getNext();
@@ -297,6 +370,8 @@ Level::Level()
     mTiles.resize(TILE_ROWS);
     for(int i = 0; i < TILE_COLS; i++)
         for(int n = 0; n < TILE_COLS; n++) mTiles[i].push_back(Tile(n, i));
+
+    m_Explored.resize(TILE_COLS*TILE_ROWS, 0);
 }
 
 Level::~Level()
@@ -304,6 +379,15 @@ Level::~Level()
 
 }
 
+void Level::unloadObjects()
+{
+    //drop tile object links, then release every pool slot at once
+    for(int i = 0; i < int(mTiles.size()); i++)
+        for(int n = 0; n < int(mTiles[i].size()); n++) mTiles[i][n].clearObjects();
+
+    m_ObjectPool.clear();
+}
+
 Tile *Level::getTile(int x, int y)
 {
     //is tile valid?
@@ -313,48 +397,131 @@ Tile *Level::getTile(int x, int y)
     return &mTiles[y][x];
 }
 
-std::vector<Tile*> Level::getAdjacentTilesAt(int x, int y)
+// adjacents must hold 4 tiles, indexed by direction
+void Level::getAdjacentTilesAt(int x, int y, Tile **adjacents)
 {
-    std::vector<Tile*> adjacents;
+    adjacents[NORTH] = getTile(x, y-1);
+    adjacents[EAST] = getTile(x+1, y);
+    adjacents[SOUTH] = getTile(x, y+1);
+    adjacents[WEST] = getTile(x-1, y);
+}
+
+// high level level generation, call each tile to build its geometry
+bool Level::buildLevelGeometry()
+{
+    TRACE_SCOPE("buildLevelGeometry");
+
+    std::vector< std::vector<TileMeshDesc> > meshdescs;
 
-    adjacents.push_back( getTile(x, y-1));
-    adjacents.push_back( getTile(x+1, y));
-    adjacents.push_back( getTile(x, y+1));
-    adjacents.push_back( getTile(x-1, y));
+    if(!generateLevelMeshes(&meshdescs)) return false;
 
-    return adjacents;
+    return createLevelNodes(&meshdescs);
 }
 
-bool Level::addObject(ObjectInstance *nobj)
+// generate meshes for every tile, rows of tiles are split across job workers
+// on failure all generated meshes are released and meshdescs is left empty
+bool Level::generateLevelMeshes(std::vector< std::vector<TileMeshDesc> > *meshdescs)
 {
-    if(nobj == NULL) return false;
+    if(meshdescs == NULL) return false;
+
+    TRACE_SCOPE("generateLevelMeshes");
+
+    meshdescs->clear();
+    meshdescs->resize(TILE_ROWS * TILE_COLS);
+    std::atomic<bool> failed(false);
+
+    //generate meshes for rows of tiles on job workers
+    JobSystem::getInstance()->parallelFor(0, TILE_ROWS, LEVEL_GEOMETRY_ROWS_PER_JOB, [this, meshdescs, &failed](int start, int end)
+    {
+        TRACE_SCOPE("generateTileRows");
+
+        for(int i = start; i < end; i++)
+        {
+            for(int n = 0; n < TILE_COLS; n++)
+            {
+                if(!generateTileMeshes(n, i, &(*meshdescs)[i*TILE_COLS + n]))
+                {
+                    std::cout << "Error building tile geometry for " << n << "," << i << std::endl;
+                    failed = true;
+                }
+            }
+        }
+    });
 
-    m_ObjectsMaster.push_back(nobj);
+    //release generated meshes if any tile failed
+    if(failed)
+    {
+        for(int i = 0; i < int(meshdescs->size()); i++)
+        {
+            for(int n = 0; n < int((*meshdescs)[i].size()); n++) (*meshdescs)[i][n].mesh->drop();
+        }
+        meshdescs->clear();
+        return false;
+    }
 
     return true;
 }
 
-// high level level generation, call each tile to build its geometry
-bool Level::buildLevelGeometry()
+// scene nodes can only be created on the main thread
+// rows can be done a few at a time to spread the work over several frames
+bool Level::createLevelNodes(std::vector< std::vector<TileMeshDesc> > *meshdescs, int startrow, int endrow, bool visible)
 {
-    for(int i = 0; i < TILE_ROWS; i++)
+    if(meshdescs == NULL) return false;
+    if(int(meshdescs->size()) != TILE_ROWS * TILE_COLS) return false;
+
+    if(startrow < 0) startrow = 0;
+    if(endrow > TILE_ROWS) endrow = TILE_ROWS;
+
+    TRACE_SCOPE("createLevelNodes");
+
+    for(int i = startrow; i < endrow; i++)
     {
         for(int n = 0; n < TILE_COLS; n++)
         {
-            if(!buildTileGeometry(n, i))
-            {
-                std::cout << "Error building tile geometry for " << n << "," << i << std::endl;
-                return false;
-            }
+            if(!createTileNodes(n, i, &(*meshdescs)[i*TILE_COLS + n], visible)) return false;
         }
     }
 
     return true;
 }
 
+// remove all tile scene nodes, returns number of nodes removed
+int Level::clearGeometry()
+{
+    int nodecount = 0;
+
+    for(int i = 0; i < int(mTiles.size()); i++)
+        for(int n = 0; n < int(mTiles[i].size()); n++) nodecount += mTiles[i][n].clearGeometry();
+
+    return nodecount;
+}
+
+void Level::setGeometryVisible(bool nvisible)
+{
+    for(int i = 0; i < int(mTiles.size()); i++)
+    {
+        for(int n = 0; n < int(mTiles[i].size()); n++)
+        {
+            const std::vector<IMeshSceneNode*> &tmeshes = mTiles[i][n].getMeshes();
+            for(int p = 0; p < int(tmeshes.size()); p++) tmeshes[p]->setVisible(nvisible);
+        }
+    }
+}
+
 // this will build all the required meshes needed for given tile
 // includes translating and rotating necessary geometry for tile
 bool Level::buildTileGeometry(int x, int y)
+{
+    std::vector<TileMeshDesc> meshdescs;
+
+    if(!generateTileMeshes(x, y, &meshdescs)) return false;
+
+    return createTileNodes(x, y, &meshdescs);
+}
+
+// generate meshes and their placement for given tile
+// does not touch the scene, so this can run on a job worker
+bool Level::generateTileMeshes(int x, int y, std::vector<TileMeshDesc> *meshdescs)
 {
     //get target tile at x,y coordinate
     Tile *ttile = getTile(x,y);
@@ -366,18 +533,6 @@ bool Level::buildTileGeometry(int x, int y)
     std::vector<int> theight_ew(4,0);
     std::vector<int> bheight_ew(4,0);
 
-    //container for nodes
-    std::vector<IMeshSceneNode*> scenenodelist;
-
-    //create strings to identify nodes for walls, ceil, floor
-    std::stringstream tilenamess;
-    tilenamess << "TILE_" << y*TILE_ROWS + x;
-    std::string wallname = tilenamess.str() + "_W";
-    std::string ceilname = tilenamess.str() + "_C";
-    std::string floorname = tilenamess.str() + "_F";
-
-
-
     //adjacent tiles
     Tile *tilenorth = NULL;
     Tile *tilesouth = NULL;
@@ -387,10 +542,11 @@ bool Level::buildTileGeometry(int x, int y)
     //get external resources
     Game *gptr = NULL;
     gptr = Game::getInstance();
-    ISceneManager *m_SMgr = gptr->getSceneManager();
     const std::vector<ITexture*> *w64txt = gptr->getWall64Textures();
     const std::vector<ITexture*> *f32txt = gptr->getFloor32Textures();
 
+    if(meshdescs == NULL) return false;
+
     //valid tile?
     if(ttile == NULL) return false;
 
@@ -400,9 +556,6 @@ bool Level::buildTileGeometry(int x, int y)
     //ignore geometry for solid tiles
     if(ttype == TILETYPE_SOLID) return true;
 
-    //clear tile geometry
-    ttile->clearGeometry();
-
     //get adjacent tiles (need to calculate adjacent wall heights)
     tilenorth = getTile(x, y-1);
     tilesouth = getTile(x, y+1);
@@ -666,132 +819,100 @@ bool Level::buildTileGeometry(int x, int y)
     //  MESH GENERATION
 
     //generate floor mesh
-    SMesh *floormesh = NULL;
+    TileMeshDesc floordesc;
+    floordesc.mesh = NULL;
+    floordesc.part = TILEPART_FLOOR;
 
     // if diagonal type, generate alternate floor (triangle)
-    if(ttype >=2 && ttype <= 5) floormesh = generateFloorMesh(bheight_ns[0], bheight_ns[1], bheight_ns[2]);
+    if(ttype >=2 && ttype <= 5) floordesc.mesh = generateFloorMesh(bheight_ns[0], bheight_ns[1], bheight_ns[2]);
     // else generate a full floor
-    else floormesh = generateFloorMesh(bheight_ns[0], bheight_ns[1], bheight_ns[2], bheight_ns[3]);
+    else floordesc.mesh = generateFloorMesh(bheight_ns[0], bheight_ns[1], bheight_ns[2], bheight_ns[3]);
 
-
-    //create floor node
-    if(floormesh != NULL)
+    //place floor
+    if(floordesc.mesh != NULL)
     {
-        //create mesh in scene
-        IMeshSceneNode *tnode = NULL;
-        if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(floormesh);
-        else tnode = m_SMgr->addMeshSceneNode(floormesh);
-
         //orient mesh depending on type
         switch(ttype)
         {
         case TILETYPE_D_NE:
-            tnode->setRotation(vector3df(0, 90, 0));
-            tnode->setPosition( vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE)+UNIT_SCALE) );
+            floordesc.rotation = vector3df(0, 90, 0);
+            floordesc.position = vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE)+UNIT_SCALE);
             break;
         case TILETYPE_D_NW:
-            tnode->setRotation(vector3df(0, 0, 0));
-            tnode->setPosition( vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE) ) );
+            floordesc.rotation = vector3df(0, 0, 0);
+            floordesc.position = vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE) );
             break;
         case TILETYPE_D_SE:
-            tnode->setRotation(vector3df(0, 180, 0));
-            tnode->setPosition( vector3df( y*UNIT_SCALE+UNIT_SCALE,0, (x*UNIT_SCALE)+UNIT_SCALE ) );
+            floordesc.rotation = vector3df(0, 180, 0);
+            floordesc.position = vector3df( y*UNIT_SCALE+UNIT_SCALE,0, (x*UNIT_SCALE)+UNIT_SCALE );
             break;
         case TILETYPE_D_SW:
-            tnode->setRotation(vector3df(0, -90, 0));
-            tnode->setPosition( vector3df( y*UNIT_SCALE+UNIT_SCALE,0, (x*UNIT_SCALE) ) );
+            floordesc.rotation = vector3df(0, -90, 0);
+            floordesc.position = vector3df( y*UNIT_SCALE+UNIT_SCALE,0, (x*UNIT_SCALE) );
             break;
         default:
-            tnode->setPosition( vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE)) );
+            floordesc.rotation = vector3df(0, 0, 0);
+            floordesc.position = vector3df( y*UNIT_SCALE,0, (x*UNIT_SCALE));
             break;
         }
 
-        //set floor texture and abs position
-        tnode->setMaterialTexture(0, (*f32txt)[ttile->getFloorTXT()]);
-
-        tnode->setName(floorname.c_str());
-
-        //add mesh and node to list
-        scenenodelist.push_back(tnode);
-
-        //drop mesh
-        floormesh->drop();
+        //set floor texture
+        floordesc.texture = gptr->getDisplayTexture( (*f32txt)[ttile->getFloorTXT()]);
 
+        meshdescs->push_back(floordesc);
     }
 
     //ceiling mesh generation
-    SMesh *ceilmesh = NULL;
-        //generate mesh
-        ceilmesh = generateFloorMesh(0,0,0,0);
-
-        //create mesh in scene
-        IMeshSceneNode *cnode = NULL;
-        if(USE_OCTREE) cnode = m_SMgr->addOctreeSceneNode(ceilmesh);
-        else cnode = m_SMgr->addMeshSceneNode(ceilmesh);
-
-        cnode->setName(ceilname.c_str());
+    TileMeshDesc ceildesc;
+    ceildesc.part = TILEPART_CEILING;
+    ceildesc.mesh = generateFloorMesh(0,0,0,0);
 
         //rotate ceiling to face down and position ceiling to top of level height
-        cnode->setRotation(vector3df(0,0,180));
-        cnode->setPosition(vector3df(y*UNIT_SCALE+UNIT_SCALE, CEIL_HEIGHT+1, x*UNIT_SCALE));
-        cnode->setMaterialTexture(0, (*f32txt)[m_CeilingTextureIndex]); // note, ceiling is always 10th floor texture?
+        ceildesc.rotation = vector3df(0,0,180);
+        ceildesc.position = vector3df(y*UNIT_SCALE+UNIT_SCALE, CEIL_HEIGHT+1, x*UNIT_SCALE);
+        ceildesc.texture = gptr->getDisplayTexture( (*f32txt)[m_CeilingTextureIndex]); // note, ceiling is always 10th floor texture?
 
-        //add node to tile node list
-        scenenodelist.push_back(cnode);
-    //drop ceiling mesh
-    ceilmesh->drop();
+        meshdescs->push_back(ceildesc);
 
     //wall mesh generation
+    //all walls of a tile share the wall texture
+    TileMeshDesc walldesc;
+    walldesc.part = TILEPART_WALL;
+    walldesc.texture = gptr->getDisplayTexture( (*w64txt)[ttile->getWallTXT()]);
+
     //diagonal walls
     if(ttype >= 2 && ttype <= 5)
     {
         //create a diagonal wall mesh
-        SMesh *dwallmesh = NULL;
-
         if(ttype == TILETYPE_D_SE || ttype == TILETYPE_D_SW)
-            dwallmesh = generateDiagonalWallMesh(theight_ns[NW], theight_ns[NE], bheight_ns[NE], bheight_ns[NW]);
-        else dwallmesh = generateDiagonalWallMesh(theight_ns[SW], theight_ns[SE], bheight_ns[SE], bheight_ns[SW]);
+            walldesc.mesh = generateDiagonalWallMesh(theight_ns[NW], theight_ns[NE], bheight_ns[NE], bheight_ns[NW]);
+        else walldesc.mesh = generateDiagonalWallMesh(theight_ns[SW], theight_ns[SE], bheight_ns[SE], bheight_ns[SW]);
 
-
-        if(dwallmesh != NULL)
+        if(walldesc.mesh != NULL)
         {
-            //create mesh in scene
-            IMeshSceneNode *tnode = NULL;
-            if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(dwallmesh);
-            else tnode = m_SMgr->addMeshSceneNode(dwallmesh);
-
-            //orient scene node
+            //orient mesh
             switch(ttype)
             {
             case TILETYPE_D_SE:
-                tnode->setPosition( vector3df( y*UNIT_SCALE + UNIT_SCALE,0, x*UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,-90,0) );
+                walldesc.position = vector3df( y*UNIT_SCALE + UNIT_SCALE,0, x*UNIT_SCALE );
+                walldesc.rotation = vector3df(0,-90,0);
                 break;
             case TILETYPE_D_NE:
-                tnode->setPosition( vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE) );
-                tnode->setRotation( vector3df(0,180,0) );
+                walldesc.position = vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE);
+                walldesc.rotation = vector3df(0,180,0);
                 break;
             case TILETYPE_D_NW:
-                tnode->setPosition( vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE) );
-                tnode->setRotation( vector3df(0,90,0) );
+                walldesc.position = vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE);
+                walldesc.rotation = vector3df(0,90,0);
                 break;
             case TILETYPE_D_SW:
             default:
-                tnode->setPosition( vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,0,0) );
+                walldesc.position = vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE );
+                walldesc.rotation = vector3df(0,0,0);
                 break;
             }
 
-            //set wall texture (common for all walls of tile)
-            tnode->setMaterialTexture(0, (*w64txt)[ttile->getWallTXT()]);
-
-            tnode->setName(wallname.c_str());
-
-            //add mesh and node to list
-            scenenodelist.push_back(tnode);
-
-            //drop mesh
-            dwallmesh->drop();
+            meshdescs->push_back(walldesc);
         }
 
     }
@@ -800,139 +921,129 @@ bool Level::buildTileGeometry(int x, int y)
     if(ttype != TILETYPE_D_SE && ttype != TILETYPE_D_SW)
     {
             //generate wall mesh
-            SMesh *wallmesh = generateWallMesh( theight_ns[NW], theight_ns[NE], bheight_ns[NE], bheight_ns[NW]);
+            walldesc.mesh = generateWallMesh( theight_ns[NW], theight_ns[NE], bheight_ns[NE], bheight_ns[NW]);
 
             //if a valid wall mesh was generated
-            if(wallmesh != NULL)
+            if(walldesc.mesh != NULL)
             {
-                //create mesh in scene
-                IMeshSceneNode *tnode = NULL;
-                if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(wallmesh);
-                else tnode = m_SMgr->addMeshSceneNode(wallmesh);
-
-                tnode->setName(wallname.c_str());
-
-                //orient scene node
-                tnode->setPosition( vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,0,0) );
+                //orient mesh
+                walldesc.position = vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE );
+                walldesc.rotation = vector3df(0,0,0);
 
-                //set wall texture (common for all walls of tile)
-                tnode->setMaterialTexture(0, (*w64txt)[ttile->getWallTXT()]);
-
-                //add mesh and node to list
-                scenenodelist.push_back(tnode);
-
-                //drop mesh
-                wallmesh->drop();
+                meshdescs->push_back(walldesc);
             }
     }
     //south wall
     if(ttype != TILETYPE_D_NE && ttype != TILETYPE_D_NW)
     {
             //generate wall mesh
-            SMesh *wallmesh = generateWallMesh( theight_ns[SE], theight_ns[SW], bheight_ns[SW], bheight_ns[SE]);
+            walldesc.mesh = generateWallMesh( theight_ns[SE], theight_ns[SW], bheight_ns[SW], bheight_ns[SE]);
 
             //if a valid wall mesh was generated
-            if(wallmesh != NULL)
+            if(walldesc.mesh != NULL)
             {
-                //create mesh in scene
-                IMeshSceneNode *tnode = NULL;
-                if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(wallmesh);
-                else tnode = m_SMgr->addMeshSceneNode(wallmesh);
-
-                tnode->setName(wallname.c_str());
+                //orient mesh
+                walldesc.position = vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE );
+                walldesc.rotation = vector3df(0,180,0);
 
-                //orient scene node
-                tnode->setPosition( vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,180,0) );
-
-                //set wall texture (common for all walls of tile)
-                tnode->setMaterialTexture(0, (*w64txt)[ttile->getWallTXT()]);
-
-                //add mesh and node to list
-                scenenodelist.push_back(tnode);
-
-                //drop mesh
-                wallmesh->drop();
+                meshdescs->push_back(walldesc);
             }
     }
     //west wall
     if(ttype != TILETYPE_D_SE && ttype != TILETYPE_D_NE)
     {
             //generate wall mesh
-            SMesh *wallmesh = generateWallMesh( theight_ew[SW], theight_ew[NW], bheight_ew[NW], bheight_ew[SW]);
+            walldesc.mesh = generateWallMesh( theight_ew[SW], theight_ew[NW], bheight_ew[NW], bheight_ew[SW]);
 
             //if a valid wall mesh was generated
-            if(wallmesh != NULL)
+            if(walldesc.mesh != NULL)
             {
-                //create mesh in scene
-                IMeshSceneNode *tnode = NULL;
-                if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(wallmesh);
-                else tnode = m_SMgr->addMeshSceneNode(wallmesh);
-
-                tnode->setName(wallname.c_str());
-
-                //orient scene node
-                tnode->setPosition( vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,-90,0) );
-
-                //set wall texture (common for all walls of tile)
-                tnode->setMaterialTexture(0, (*w64txt)[ttile->getWallTXT()]);
+                //orient mesh
+                walldesc.position = vector3df( y*UNIT_SCALE+UNIT_SCALE,0, x*UNIT_SCALE );
+                walldesc.rotation = vector3df(0,-90,0);
 
-                //add mesh and node to list
-                scenenodelist.push_back(tnode);
-
-                //drop mesh
-                wallmesh->drop();
+                meshdescs->push_back(walldesc);
             }
     }
     //east wall
     if(ttype != TILETYPE_D_SW && ttype != TILETYPE_D_NW)
     {
             //generate wall mesh
-            SMesh *wallmesh = generateWallMesh( theight_ew[NE], theight_ew[SE], bheight_ew[SE], bheight_ew[NE]);
+            walldesc.mesh = generateWallMesh( theight_ew[NE], theight_ew[SE], bheight_ew[SE], bheight_ew[NE]);
 
             //if a valid wall mesh was generated
-            if(wallmesh != NULL)
+            if(walldesc.mesh != NULL)
             {
-                //create mesh in scene
-                IMeshSceneNode *tnode = NULL;
-                if(USE_OCTREE) tnode = m_SMgr->addOctreeSceneNode(wallmesh);
-                else tnode = m_SMgr->addMeshSceneNode(wallmesh);
+                //orient mesh
+                walldesc.position = vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE );
+                walldesc.rotation = vector3df(0,90,0);
 
-                tnode->setName(wallname.c_str());
+                meshdescs->push_back(walldesc);
+            }
+    }
 
-                //orient scene node
-                tnode->setPosition( vector3df( y*UNIT_SCALE,0, x*UNIT_SCALE+UNIT_SCALE ) );
-                tnode->setRotation( vector3df(0,90,0) );
+    return true;
+}
 
-                //set wall texture (common for all walls of tile)
-                tnode->setMaterialTexture(0, (*w64txt)[ttile->getWallTXT()]);
+// create scene nodes for meshes generated by generateTileMeshes, main thread only
+// the meshes are dropped once the nodes hold them
+bool Level::createTileNodes(int x, int y, std::vector<TileMeshDesc> *meshdescs, bool visible)
+{
+    //get target tile at x,y coordinate
+    Tile *ttile = getTile(x,y);
 
-                //add mesh and node to list
-                scenenodelist.push_back(tnode);
+    //get external resources
+    Game *gptr = NULL;
+    gptr = Game::getInstance();
+    ISceneManager *m_SMgr = gptr->getSceneManager();
 
-                //drop mesh
-                wallmesh->drop();
-            }
-    }
+    if(meshdescs == NULL) return false;
 
+    //valid tile?
+    if(ttile == NULL) return false;
 
-    //perform common operations to all meshes\scene nodes
-    for(int i = 0; i < int(scenenodelist.size()); i++)
+    //ignore geometry for solid tiles
+    if(ttile->getType() == TILETYPE_SOLID) return true;
+
+    //clear tile geometry
+    ttile->clearGeometry();
+
+    //create strings to identify nodes for walls, ceil, floor
+    std::stringstream tilenamess;
+    tilenamess << "TILE_" << y*TILE_ROWS + x;
+    std::string partnames[TILEPART_TOTAL];
+    partnames[TILEPART_FLOOR] = tilenamess.str() + "_F";
+    partnames[TILEPART_CEILING] = tilenamess.str() + "_C";
+    partnames[TILEPART_WALL] = tilenamess.str() + "_W";
+
+    for(int i = 0; i < int(meshdescs->size()); i++)
     {
-        //select target mesh and scene node
-        IMeshSceneNode *tnode = scenenodelist[i];
+        TileMeshDesc *tdesc = &(*meshdescs)[i];
+
+        //create mesh in scene
+        //octree nodes draw from their own copy of the vertices, vertex shading needs the mesh itself
+        IMeshSceneNode *tnode = NULL;
+        if(USE_OCTREE && !gptr->hasVertexShading()) tnode = m_SMgr->addOctreeSceneNode(tdesc->mesh);
+        else tnode = m_SMgr->addMeshSceneNode(tdesc->mesh);
+
+        //orient scene node
+        tnode->setPosition(tdesc->position);
+        tnode->setRotation(tdesc->rotation);
+        tnode->setMaterialTexture(0, tdesc->texture);
+        tnode->setName(partnames[tdesc->part].c_str());
+        tnode->setVisible(visible);
+
+        //drop mesh
+        tdesc->mesh->drop();
+        tdesc->mesh = NULL;
 
         //update scene node with common flags
         gptr->configMeshSceneNode(tnode);
 
         //add scene node reference to tile
         ttile->addMesh(tnode);
-
     }
 
-
     return true;
 }
 
@@ -1149,6 +1260,22 @@ SMesh *Level::generateDiagonalWallMesh(int tl, int tr, int br, int bl)
     return mesh;
 }
 
+bool Level::isExplored(int x, int y)
+{
+    if(x < 0 || y < 0 || x >= TILE_COLS || y >= TILE_ROWS) return false;
+
+    return m_Explored[y*TILE_COLS + x] != 0;
+}
+
+bool Level::setExplored(int x, int y)
+{
+    if(x < 0 || y < 0 || x >= TILE_COLS || y >= TILE_ROWS) return false;
+    if(m_Explored[y*TILE_COLS + x]) return false;
+
+    m_Explored[y*TILE_COLS + x] = 1;
+    return true;
+}
+
 std::vector<IMeshSceneNode*> Level::getMeshes()
 {
     std::vector<IMeshSceneNode*> meshes;
@@ -1157,7 +1284,7 @@ std::vector<IMeshSceneNode*> Level::getMeshes()
     {
         for(int n = 0; n < int(mTiles[i].size()); n++)
         {
-            std::vector<IMeshSceneNode*> tmeshes = mTiles[i][n].getMeshes();
+            const std::vector<IMeshSceneNode*> &tmeshes = mTiles[i][n].getMeshes();
 
             for(int p = 0; p < int(tmeshes.size()); p++)
             {
@@ -1243,23 +1370,39 @@ Tile::Tile(int xpos, int ypos)
 
 Tile::~Tile()
 {
-    clearGeometry();
+    //scene nodes belong to the scene manager, levels remove them with clearGeometry()
 }
 
-bool Tile::addObject(ObjectInstance *tobj)
+bool Tile::addObject(ObjectHandle tobj)
 {
-    if(tobj == NULL) return false;
+    if(tobj == OBJECT_HANDLE_NULL) return false;
 
     mObjects.push_back(tobj);
     return true;
 }
 
+bool Tile::removeObject(ObjectHandle tobj)
+{
+    for(int i = 0; i < int(mObjects.size()); i++)
+    {
+        if(mObjects[i] == tobj)
+        {
+            mObjects.erase(mObjects.begin() + i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 int Tile::clearGeometry()
 {
+    //remove from scene, scene manager holds the only reference
     int meshcount = int(mMeshes.size());
     for(int i = 0; i < meshcount; i++)
     {
-        mMeshes[i]->drop();
+        MemStats::getInstance()->removeMeshNode(mMeshes[i]);
+        mMeshes[i]->remove();
     }
     mMeshes.clear();
 
@@ -1270,16 +1413,17 @@ bool Tile::addMesh(IMeshSceneNode *tmesh)
 {
     if(tmesh == NULL) return false;
 
+    MemStats::getInstance()->addMeshNode(tmesh);
     mMeshes.push_back(tmesh);
     return true;
 }
 
-std::vector<IMeshSceneNode*> Tile::getMeshes()
+const std::vector<IMeshSceneNode*> &Tile::getMeshes()
 {
     return mMeshes;
 }
 
-void Tile::printDebug()
+void Tile::printDebug(ObjectPool *tpool)
 {
 
     std::cout << "\nTILE INFO:\n";
@@ -1335,7 +1479,11 @@ void Tile::printDebug()
     for(int i = 0; i < int(mObjects.size()); i++)
     {
         //debug
-        mObjects[i]->printDebug();
+        ObjectInstance *tobj = NULL;
+        if(tpool != NULL) tobj = tpool->get(mObjects[i]);
+
+        if(tobj != NULL) tobj->printDebug();
+        else std::cout << "Object handle 0x" << std::hex << mObjects[i] << std::dec << " is not valid\n";
     }
 
 }
@@ -0,0 +1,333 @@
+#include "levelmanager.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+#include "game.hpp"
+#include "tools.hpp"
+
+//rough size of generated geometry, mesh buffers plus collision triangles
+static unsigned int getMeshDescBytes(std::vector< std::vector<TileMeshDesc> > *meshdescs)
+{
+    unsigned int bytes = 0;
+
+    for(int i = 0; i < int(meshdescs->size()); i++)
+    {
+        for(int n = 0; n < int((*meshdescs)[i].size()); n++)
+        {
+            SMesh *tmesh = (*meshdescs)[i][n].mesh;
+            if(tmesh == NULL) continue;
+
+            for(int p = 0; p < int(tmesh->getMeshBufferCount()); p++)
+            {
+                IMeshBuffer *tbuffer = tmesh->getMeshBuffer(p);
+                bytes += tbuffer->getVertexCount()*sizeof(S3DVertex) + tbuffer->getIndexCount()*sizeof(u16);
+                if(CONFIG_FOR_COLLISION) bytes += (tbuffer->getIndexCount()/3)*sizeof(triangle3df);
+            }
+        }
+    }
+
+    return bytes;
+}
+
+LevelManager::LevelManager(std::vector<Level> *nlevels)
+{
+    m_Levels = nlevels;
+    m_Jobs = JobSystem::getInstance();
+
+    m_Current = -1;
+    m_Budget = LEVELMANAGER_DEFAULT_BUDGET*1024*1024;
+    m_RowsPerFrame = LEVELMANAGER_ROWS_PER_FRAME;
+
+    m_Transitions = 0;
+    m_Misses = 0;
+    m_LastTransitionTime = 0;
+
+    for(int i = 0; i < int(m_Levels->size()); i++)
+    {
+        LevelSlot *newslot = new LevelSlot;
+        newslot->state = LEVELSTATE_UNLOADED;
+        newslot->nextRow = 0;
+        newslot->bytes = 0;
+        newslot->hasAdjacent = false;
+
+        m_Slots.push_back(newslot);
+    }
+}
+
+LevelManager::~LevelManager()
+{
+    cancelBuilds();
+
+    for(int i = 0; i < int(m_Slots.size()); i++) delete m_Slots[i];
+    m_Slots.clear();
+}
+
+bool LevelManager::generateLevel(int levelindex)
+{
+    if(!isValid(levelindex)) return false;
+
+    LevelSlot *tslot = m_Slots[levelindex];
+    std::vector< std::vector<TileMeshDesc> > meshdescs;
+
+    if(!(*m_Levels)[levelindex].generateLevelMeshes(&meshdescs))
+    {
+        std::cout << "Error generating meshes for level " << levelindex << std::endl;
+        tslot->state = LEVELSTATE_UNLOADED;
+        return false;
+    }
+
+    tslot->meshDescs.swap(meshdescs);
+    tslot->nextRow = 0;
+    tslot->bytes = getMeshDescBytes(&tslot->meshDescs);
+
+    //publish last, main thread only touches the meshes once it sees this
+    tslot->state = LEVELSTATE_BUILT;
+
+    return true;
+}
+
+bool LevelManager::prebuild(int levelindex)
+{
+    if(!isValid(levelindex)) return false;
+
+    LevelSlot *tslot = m_Slots[levelindex];
+    if(tslot->state.load() != LEVELSTATE_UNLOADED) return false;
+
+    tslot->state = LEVELSTATE_BUILDING;
+    tslot->job = m_Jobs->schedule([this, levelindex]{ generateLevel(levelindex);});
+
+    return true;
+}
+
+bool LevelManager::unload(int levelindex)
+{
+    if(!isValid(levelindex)) return false;
+    if(levelindex == m_Current) return false;
+
+    LevelSlot *tslot = m_Slots[levelindex];
+    int tstate = tslot->state.load();
+
+    //worker still owns the meshes
+    if(tstate == LEVELSTATE_BUILDING) return false;
+    if(tstate == LEVELSTATE_UNLOADED) return true;
+
+    (*m_Levels)[levelindex].clearGeometry();
+
+    //meshes of rows that never became scene nodes
+    for(int i = 0; i < int(tslot->meshDescs.size()); i++)
+    {
+        for(int n = 0; n < int(tslot->meshDescs[i].size()); n++)
+        {
+            if(tslot->meshDescs[i][n].mesh != NULL) tslot->meshDescs[i][n].mesh->drop();
+        }
+    }
+    tslot->meshDescs.clear();
+
+    tslot->nextRow = 0;
+    tslot->bytes = 0;
+    tslot->state = LEVELSTATE_UNLOADED;
+
+    return true;
+}
+
+void LevelManager::cancelBuilds()
+{
+    for(int i = 0; i < int(m_Slots.size()); i++)
+    {
+        LevelSlot *tslot = m_Slots[i];
+        if(tslot->state.load() != LEVELSTATE_BUILDING) continue;
+
+        //builds that already started have to finish
+        m_Jobs->cancel(tslot->job);
+        m_Jobs->wait(tslot->job);
+
+        if(tslot->state.load() == LEVELSTATE_BUILDING) tslot->state = LEVELSTATE_UNLOADED;
+    }
+}
+
+void LevelManager::createPendingNodes(int levelindex, int rowcount)
+{
+    LevelSlot *tslot = m_Slots[levelindex];
+    int endrow = tslot->nextRow + rowcount;
+
+    //only the current level is visible
+    if(!(*m_Levels)[levelindex].createLevelNodes(&tslot->meshDescs, tslot->nextRow, endrow, levelindex == m_Current))
+    {
+        std::cout << "Error creating scene nodes for level " << levelindex << std::endl;
+
+        //current level keeps whatever was created
+        if(levelindex != m_Current) unload(levelindex);
+        return;
+    }
+
+    tslot->nextRow = endrow;
+    if(tslot->nextRow >= TILE_ROWS)
+    {
+        tslot->meshDescs.clear();
+        tslot->state = LEVELSTATE_RESIDENT;
+    }
+}
+
+bool LevelManager::setCurrentLevel(int levelindex)
+{
+    if(!isValid(levelindex)) return false;
+
+    unsigned long long starttime = getMicroseconds();
+    LevelSlot *tslot = m_Slots[levelindex];
+
+    if(tslot->state.load() != LEVELSTATE_RESIDENT) m_Misses++;
+
+    //not prebuilt in time, finish it now
+    if(tslot->state.load() == LEVELSTATE_BUILDING) m_Jobs->wait(tslot->job);
+    if(tslot->state.load() == LEVELSTATE_UNLOADED && !generateLevel(levelindex)) return false;
+
+    //swap visibility, then add any nodes still pending directly as visible
+    if(m_Current >= 0 && m_Current != levelindex) (*m_Levels)[m_Current].setGeometryVisible(false);
+    m_Current = levelindex;
+    (*m_Levels)[m_Current].setGeometryVisible(true);
+
+    if(tslot->state.load() == LEVELSTATE_BUILT) createPendingNodes(levelindex, TILE_ROWS);
+
+    m_Transitions++;
+    m_LastTransitionTime = getMicroseconds() - starttime;
+
+    return tslot->state.load() == LEVELSTATE_RESIDENT;
+}
+
+void LevelManager::update()
+{
+    //turn one prebuilt level into scene nodes a few rows at a time
+    for(int i = 0; i < int(m_Slots.size()); i++)
+    {
+        if(m_Slots[i]->state.load() != LEVELSTATE_BUILT) continue;
+
+        createPendingNodes(i, m_RowsPerFrame);
+        break;
+    }
+
+    if(!isValid(m_Current)) return;
+
+    //prebuild levels reachable from the current one while there is room
+    std::vector<int> adjacent = getAdjacentLevels(m_Current);
+    for(int i = 0; i < int(adjacent.size()); i++)
+    {
+        if(getResidentBytes() >= m_Budget) break;
+        prebuild(adjacent[i]);
+    }
+
+    evict();
+}
+
+void LevelManager::evict()
+{
+    std::vector<int> adjacent = getAdjacentLevels(m_Current);
+
+    while(getResidentBytes() > m_Budget)
+    {
+        //farthest level that the player can't reach directly
+        int victim = -1;
+        int farthest = 0;
+
+        for(int i = 0; i < int(m_Slots.size()); i++)
+        {
+            int tstate = m_Slots[i]->state.load();
+            if(tstate != LEVELSTATE_BUILT && tstate != LEVELSTATE_RESIDENT) continue;
+            if(i == m_Current) continue;
+
+            bool isadjacent = false;
+            for(int n = 0; n < int(adjacent.size()); n++) if(adjacent[n] == i) isadjacent = true;
+            if(isadjacent) continue;
+
+            if(abs(i - m_Current) > farthest)
+            {
+                farthest = abs(i - m_Current);
+                victim = i;
+            }
+        }
+
+        if(victim < 0) break;
+
+        unload(victim);
+    }
+}
+
+std::vector<int> LevelManager::getAdjacentLevels(int levelindex)
+{
+    if(!isValid(levelindex)) return std::vector<int>();
+
+    LevelSlot *tslot = m_Slots[levelindex];
+    if(tslot->hasAdjacent) return tslot->adjacent;
+
+    //stairs connect each level to the ones above and below
+    if(isValid(levelindex-1)) tslot->adjacent.push_back(levelindex-1);
+    if(isValid(levelindex+1)) tslot->adjacent.push_back(levelindex+1);
+
+    //teleport traps store their destination level in zpos (1 based, 0 = same level)
+    ObjectPool *objpool = (*m_Levels)[levelindex].getObjectPool();
+    for(int i = 0; i < OBJECT_POOL_SIZE; i++)
+    {
+        ObjectInstance *tobj = objpool->getAt(i);
+        if(tobj == NULL || tobj->getRefID() != OBJECT_ID_TELEPORT_TRAP) continue;
+
+        int tlevel = tobj->getPosition().Z - 1;
+        if(tlevel == levelindex || !isValid(tlevel)) continue;
+
+        bool found = false;
+        for(int n = 0; n < int(tslot->adjacent.size()); n++) if(tslot->adjacent[n] == tlevel) found = true;
+        if(!found) tslot->adjacent.push_back(tlevel);
+    }
+
+    tslot->hasAdjacent = true;
+
+    return tslot->adjacent;
+}
+
+int LevelManager::getState(int levelindex)
+{
+    if(!isValid(levelindex)) return LEVELSTATE_UNLOADED;
+
+    return m_Slots[levelindex]->state.load();
+}
+
+unsigned int LevelManager::getLevelBytes(int levelindex)
+{
+    if(!isValid(levelindex)) return 0;
+
+    int tstate = m_Slots[levelindex]->state.load();
+    if(tstate != LEVELSTATE_BUILT && tstate != LEVELSTATE_RESIDENT) return 0;
+
+    return m_Slots[levelindex]->bytes;
+}
+
+unsigned int LevelManager::getResidentBytes()
+{
+    unsigned int bytes = 0;
+
+    for(int i = 0; i < int(m_Slots.size()); i++) bytes += getLevelBytes(i);
+
+    return bytes;
+}
+
+void LevelManager::printDebug()
+{
+    const std::string statenames[] = {"unloaded", "building", "built", "resident"};
+
+    std::cout << "Current level : " << m_Current << std::endl;
+    std::cout << "Resident : " << getResidentBytes()/1024 << "KB of " << m_Budget/1024 << "KB budget\n";
+
+    for(int i = 0; i < int(m_Slots.size()); i++)
+    {
+        std::cout << "Level " << i << " : " << statenames[getState(i)] << ", " << getLevelBytes(i)/1024 << "KB";
+
+        if(m_Slots[i]->hasAdjacent)
+        {
+            std::cout << ", leads to";
+            for(int n = 0; n < int(m_Slots[i]->adjacent.size()); n++) std::cout << " " << m_Slots[i]->adjacent[n];
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Transitions : " << m_Transitions << " (" << m_Misses << " not prebuilt), last took "
+              << m_LastTransitionTime << "us\n";
+}
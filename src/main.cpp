@@ -7,7 +7,16 @@ int main(int argc, char *argv[])
     Game *game;
     game = Game::getInstance();
 
-    game->start();
+    //command line options
+    BenchmarkConfig benchconfig = Benchmark::getDefaultConfig();
+    if(Benchmark::parseArgs(argc, argv, &benchconfig))
+    {
+        Benchmark::printUsage();
+        return 1;
+    }
+    game->setBenchmarkConfig(benchconfig);
+
+    if(game->start()) return 1;
 
     return 0;
 }
@@ -0,0 +1,176 @@
+#include "memstats.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+MemStats *MemStats::m_Instance = NULL;
+
+static const char *g_MemCategoryNames[MEMCAT_TOTAL] = {"tex_wall64", "tex_floor32", "tex_charhead", "tex_question", "tex_inventory",
+                                                       "tex_scrolledge", "tex_modebuttons", "tex_modebuttonsmisc", "tex_dragons",
+                                                       "tex_bitmaps", "tex_spriteatlas", "tex_fonts", "mesh_vertices", "mesh_indices",
+                                                       "collision", "strings", "objects"};
+
+MemStats::MemStats()
+{
+    for(int i = 0; i < MEMCAT_TOTAL; i++)
+    {
+        m_Current[i] = 0;
+        m_Peak[i] = 0;
+    }
+}
+
+MemStats::~MemStats()
+{
+
+}
+
+void MemStats::add(int category, long long bytes)
+{
+    if(category < 0 || category >= MEMCAT_TOTAL) return;
+
+    long long tcurrent = m_Current[category].fetch_add(bytes) + bytes;
+
+    //raise peak, another thread may be raising it too
+    long long tpeak = m_Peak[category].load();
+    while(tcurrent > tpeak && !m_Peak[category].compare_exchange_weak(tpeak, tcurrent));
+}
+
+void MemStats::remove(int category, long long bytes)
+{
+    if(category < 0 || category >= MEMCAT_TOTAL) return;
+
+    m_Current[category].fetch_sub(bytes);
+}
+
+long long MemStats::getTextureBytes(ITexture *ttexture)
+{
+    if(ttexture == NULL) return 0;
+
+    //driver size, may be padded to a power of two
+    dimension2d<u32> tsize = ttexture->getSize();
+    long long tbytes = (long long)(tsize.Width) * tsize.Height * IImage::getBitsPerPixelFromFormat(ttexture->getColorFormat()) / 8;
+
+    //full mip chain adds a third
+    if(ttexture->hasMipMaps()) tbytes += tbytes / 3;
+
+    return tbytes;
+}
+
+void MemStats::addTextures(int category, const std::vector<ITexture*> *tlist)
+{
+    if(tlist == NULL) return;
+
+    long long tbytes = 0;
+    for(int i = 0; i < int(tlist->size()); i++) tbytes += getTextureBytes( (*tlist)[i]);
+
+    add(category, tbytes);
+}
+
+static void getMeshBytes(IMesh *tmesh, long long *vertexbytes, long long *indexbytes)
+{
+    *vertexbytes = 0;
+    *indexbytes = 0;
+
+    if(tmesh == NULL) return;
+
+    for(u32 i = 0; i < tmesh->getMeshBufferCount(); i++)
+    {
+        IMeshBuffer *tbuffer = tmesh->getMeshBuffer(i);
+
+        *vertexbytes += (long long)(tbuffer->getVertexCount()) * getVertexPitchFromType(tbuffer->getVertexType());
+        *indexbytes += (long long)(tbuffer->getIndexCount()) * (tbuffer->getIndexType() == EIT_16BIT ? sizeof(u16) : sizeof(u32));
+    }
+}
+
+void MemStats::addMeshNode(IMeshSceneNode *tnode)
+{
+    if(tnode == NULL) return;
+
+    long long vertexbytes = 0;
+    long long indexbytes = 0;
+    getMeshBytes(tnode->getMesh(), &vertexbytes, &indexbytes);
+
+    add(MEMCAT_MESH_VERTICES, vertexbytes);
+    add(MEMCAT_MESH_INDICES, indexbytes);
+}
+
+void MemStats::removeMeshNode(IMeshSceneNode *tnode)
+{
+    if(tnode == NULL) return;
+
+    long long vertexbytes = 0;
+    long long indexbytes = 0;
+    getMeshBytes(tnode->getMesh(), &vertexbytes, &indexbytes);
+
+    remove(MEMCAT_MESH_VERTICES, vertexbytes);
+    remove(MEMCAT_MESH_INDICES, indexbytes);
+
+    //selector goes with the node
+    removeTriangleSelector(tnode->getTriangleSelector());
+}
+
+//selectors keep a transformed copy of every triangle
+void MemStats::addTriangleSelector(ITriangleSelector *tselector)
+{
+    if(tselector == NULL) return;
+
+    add(MEMCAT_COLLISION, (long long)(tselector->getTriangleCount()) * sizeof(triangle3df));
+}
+
+void MemStats::removeTriangleSelector(ITriangleSelector *tselector)
+{
+    if(tselector == NULL) return;
+
+    remove(MEMCAT_COLLISION, (long long)(tselector->getTriangleCount()) * sizeof(triangle3df));
+}
+
+const char *MemStats::getName(int category)
+{
+    if(category < 0 || category >= MEMCAT_TOTAL) return "";
+
+    return g_MemCategoryNames[category];
+}
+
+long long MemStats::getCurrent(int category)
+{
+    if(category < 0 || category >= MEMCAT_TOTAL) return 0;
+
+    return m_Current[category].load();
+}
+
+long long MemStats::getPeak(int category)
+{
+    if(category < 0 || category >= MEMCAT_TOTAL) return 0;
+
+    return m_Peak[category].load();
+}
+
+long long MemStats::getTotalCurrent()
+{
+    long long ttotal = 0;
+    for(int i = 0; i < MEMCAT_TOTAL; i++) ttotal += m_Current[i].load();
+
+    return ttotal;
+}
+
+long long MemStats::getTotalPeak()
+{
+    long long ttotal = 0;
+    for(int i = 0; i < MEMCAT_TOTAL; i++) ttotal += m_Peak[i].load();
+
+    return ttotal;
+}
+
+void MemStats::printStats()
+{
+    std::cout << "Memory (KB)             current       peak\n";
+
+    for(int i = 0; i < MEMCAT_TOTAL; i++)
+    {
+        std::cout << std::left << std::setw(20) << getName(i) << std::right
+                  << std::setw(11) << getCurrent(i)/1024 << std::setw(11) << getPeak(i)/1024 << std::endl;
+    }
+
+    std::cout << std::left << std::setw(20) << "total" << std::right
+              << std::setw(11) << getTotalCurrent()/1024 << std::setw(11) << getTotalPeak()/1024 << std::endl;
+}
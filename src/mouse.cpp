@@ -27,10 +27,19 @@ void Mouse::updatePosition()
 void Mouse::setTexture(ITexture *ttxt)
 {
     m_Texture = ttxt;
+    if(m_Texture != NULL) m_TextureRect = rect<s32>(position2d<s32>(0,0), m_Texture->getSize());
+}
+
+void Mouse::setTexture(ITexture *ttxt, rect<s32> tregion)
+{
+    m_Texture = ttxt;
+    m_TextureRect = tregion;
 }
 
 void Mouse::draw()
 {
+    PROFILE_SCOPE("Mouse::draw");
+
     if(m_Texture == NULL) return;
 
     if(dbg_textures != NULL)
@@ -41,12 +50,11 @@ void Mouse::draw()
     else
     {
         //get offset to center cursor graphic
-        vector2di tsize(m_Texture->getSize().Width, m_Texture->getSize().Height);
+        vector2di tsize(m_TextureRect.getWidth(), m_TextureRect.getHeight());
         tsize.X = tsize.X/2;
         tsize.Y = tsize.Y/2;
 
-        core::rect<s32> screen_rect( position2d<s32>(0,0), m_Texture->getSize());
-        m_Driver->draw2DImage( m_Texture, m_MousePos - tsize, screen_rect, NULL, SColor(255,255,255,255), true);
+        m_Driver->draw2DImage( m_Texture, m_MousePos - tsize, m_TextureRect, NULL, SColor(255,255,255,255), true);
     }
 
 }
@@ -60,29 +68,3 @@ int Mouse::increaseDebugTexture(int nval)
 
     return dbg_textureindex;
 }
-
-////////////////////////////////////////////////////////////
-//  MOUSE UPDATE THREAD
-MouseUpdateThread::MouseUpdateThread(Mouse *nmouse, bool *nshutdownflag)
-{
-    m_Mouse = nmouse;
-
-    shutdownflag = nshutdownflag;
-}
-
-MouseUpdateThread::~MouseUpdateThread()
-{
-
-}
-
-void MouseUpdateThread::InternalThreadEntry()
-{
-    std::cout << "Starting mouse update thread...\n";
-
-    while(!(*shutdownflag) )
-    {
-        m_Mouse->updatePosition();
-    }
-
-    pthread_exit(NULL);
-}
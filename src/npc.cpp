@@ -0,0 +1,156 @@
+#include "npc.hpp"
+
+#include <iostream>
+
+#include "tools.hpp"
+
+NPCTable::NPCTable()
+{
+    //allocate all slots up front
+    m_HP.resize(NPC_TABLE_SIZE);
+    m_Goal.resize(NPC_TABLE_SIZE);
+    m_Target.resize(NPC_TABLE_SIZE);
+    m_Heading.resize(NPC_TABLE_SIZE);
+    m_Attitude.resize(NPC_TABLE_SIZE);
+
+    m_Level.resize(NPC_TABLE_SIZE);
+    m_Height.resize(NPC_TABLE_SIZE);
+    m_HomeX.resize(NPC_TABLE_SIZE);
+    m_HomeY.resize(NPC_TABLE_SIZE);
+    m_Hunger.resize(NPC_TABLE_SIZE);
+    m_WhoAmI.resize(NPC_TABLE_SIZE);
+    m_TalkedTo.resize(NPC_TABLE_SIZE);
+
+    m_RawData.resize(NPC_TABLE_SIZE * NPC_MOBILE_DATA_SIZE);
+
+    m_IsActive.resize(NPC_TABLE_SIZE);
+    m_ActiveSlots.reserve(NPC_TABLE_SIZE);
+
+    clear();
+}
+
+NPCTable::~NPCTable()
+{
+
+}
+
+void NPCTable::clear()
+{
+    for(int i = 0; i < NPC_TABLE_SIZE; i++)
+    {
+        m_HP[i] = 0;
+        m_Goal[i] = 0;
+        m_Target[i] = 0;
+        m_Heading[i] = 0;
+        m_Attitude[i] = 0;
+        m_Level[i] = 0;
+        m_Height[i] = 0;
+        m_HomeX[i] = 0;
+        m_HomeY[i] = 0;
+        m_Hunger[i] = 0;
+        m_WhoAmI[i] = 0;
+        m_TalkedTo[i] = false;
+        m_IsActive[i] = false;
+    }
+
+    for(int i = 0; i < int(m_RawData.size()); i++) m_RawData[i] = 0;
+
+    m_ActiveSlots.clear();
+}
+
+bool NPCTable::parseMobileData(int slot, const unsigned char *data)
+{
+    if(!isValidSlot(slot) || data == NULL) return false;
+
+    //keep raw copy
+    for(int i = 0; i < NPC_MOBILE_DATA_SIZE; i++) m_RawData[slot*NPC_MOBILE_DATA_SIZE + i] = data[i];
+
+    //offsets are relative to the start of the extra info (object offset 0008)
+    // 0000 Int8  0-7 hp
+    m_HP[slot] = data[0];
+
+    // 0003 Int16 0-3 goal, 4-11 goal target
+    int goaldata = lsbSum( (unsigned char*)&data[3], 2);
+    m_Goal[slot] = u8(getBitVal(goaldata, 0, 4));
+    m_Target[slot] = u8(getBitVal(goaldata, 4, 8));
+
+    // 0005 Int16 0-3 level, 13 talked to, 14-15 attitude
+    int leveldata = lsbSum( (unsigned char*)&data[5], 2);
+    m_Level[slot] = u8(getBitVal(leveldata, 0, 4));
+    m_TalkedTo[slot] = getBitVal(leveldata, 13, 1);
+    m_Attitude[slot] = u8(getBitVal(leveldata, 14, 2));
+
+    // 0007 Int16 6-12 height
+    int heightdata = lsbSum( (unsigned char*)&data[7], 2);
+    m_Height[slot] = u8(getBitVal(heightdata, 6, 7));
+
+    // 000e Int16 4-9 y home, 10-15 x home
+    int homedata = lsbSum( (unsigned char*)&data[14], 2);
+    m_HomeY[slot] = u8(getBitVal(homedata, 4, 6));
+    m_HomeX[slot] = u8(getBitVal(homedata, 10, 6));
+
+    // 0010 Int8 0-4 heading
+    m_Heading[slot] = u8(getBitVal(int(data[16]), 0, 5));
+
+    // 0011 Int8 0-6 hunger
+    m_Hunger[slot] = u8(getBitVal(int(data[17]), 0, 7));
+
+    // 0012 Int8 whoami (conversation slot)
+    m_WhoAmI[slot] = data[18];
+
+    return true;
+}
+
+const unsigned char *NPCTable::getMobileData(int slot)
+{
+    if(!isValidSlot(slot)) return NULL;
+
+    return &m_RawData[slot*NPC_MOBILE_DATA_SIZE];
+}
+
+bool NPCTable::setActive(int slot, bool nactive)
+{
+    if(!isValidSlot(slot)) return false;
+
+    //no change
+    if(m_IsActive[slot] == nactive) return true;
+
+    m_IsActive[slot] = nactive;
+
+    if(nactive) m_ActiveSlots.push_back(u16(slot));
+    else
+    {
+        //swap remove, order of active slots does not matter
+        for(int i = 0; i < int(m_ActiveSlots.size()); i++)
+        {
+            if(m_ActiveSlots[i] == slot)
+            {
+                m_ActiveSlots[i] = m_ActiveSlots.back();
+                m_ActiveSlots.pop_back();
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void NPCTable::printDebug(int slot)
+{
+    if(!isValidSlot(slot)) return;
+
+    std::cout << "\nNPC (slot " << slot << "):\n";
+    std::cout << "----------------\n";
+    std::cout << "Active    : " << m_IsActive[slot] << std::endl;
+    std::cout << "HP        : " << int(m_HP[slot]) << std::endl;
+    std::cout << "Goal      : " << int(m_Goal[slot]) << std::endl;
+    std::cout << "Target    : " << int(m_Target[slot]) << std::endl;
+    std::cout << "Heading   : " << int(m_Heading[slot]) << std::endl;
+    std::cout << "Attitude  : " << int(m_Attitude[slot]) << std::endl;
+    std::cout << "Level     : " << int(m_Level[slot]) << std::endl;
+    std::cout << "Height    : " << int(m_Height[slot]) << std::endl;
+    std::cout << "Home      : " << int(m_HomeX[slot]) << "," << int(m_HomeY[slot]) << std::endl;
+    std::cout << "Hunger    : " << int(m_Hunger[slot]) << std::endl;
+    std::cout << "WhoAmI    : " << int(m_WhoAmI[slot]) << std::endl;
+    std::cout << "TalkedTo  : " << m_TalkedTo[slot] << std::endl;
+}
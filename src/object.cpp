@@ -15,7 +15,7 @@ Object::Object()
     m_TotalObjects++;
 
     //set default texture to question mark
-    m_TXT = gptr->getDefaultTexture();
+    setTexture(gptr->getDefaultTexture());
 }
 
 Object::~Object()
@@ -23,17 +23,41 @@ Object::~Object()
 
 }
 
+void Object::setTexture(ITexture *ntxt)
+{
+    m_TXT = ntxt;
+
+    m_UVRect = rect<f32>(0,0,1,1);
+    if(m_TXT != NULL) m_ImageRect = rect<s32>(position2d<s32>(0,0), m_TXT->getSize());
+    else m_ImageRect = rect<s32>(0,0,0,0);
+}
+
+void Object::setTexture(ITexture *npage, const rect<s32> &nimagerect, const rect<f32> &nuvrect)
+{
+    m_TXT = npage;
+    m_ImageRect = nimagerect;
+    m_UVRect = nuvrect;
+}
+
 //////////////////////////////////////////////////////
 //  OBJECT INSTANCE
-int ObjectInstance::m_InstanceCount = 0;
-
 ObjectInstance::ObjectInstance(Object *tobj)
 {
-    m_InstanceID = m_InstanceCount;
-    m_InstanceCount++;
+    m_Handle = 0;
+    m_Sprite = SPRITEBATCH_NONE;
+
+    reset(tobj);
+}
 
+ObjectInstance::~ObjectInstance()
+{
+
+}
+
+void ObjectInstance::reset(Object *tobj)
+{
+    //note : handle is owned by the pool, sprite must be removed by caller
     m_Ref = tobj;
-    m_Billboard = NULL;
 
     m_Position = vector3di(0,0,0);
     m_Angle = 0;
@@ -46,28 +70,39 @@ ObjectInstance::ObjectInstance(Object *tobj)
     m_Next = 0;
     m_Owner = 0;
     m_Quantity = 0;
-
 }
 
-ObjectInstance::~ObjectInstance()
+void ObjectInstance::copyFrom(const ObjectInstance &tobj)
 {
-
+    m_Ref = tobj.m_Ref;
+
+    m_Position = tobj.m_Position;
+    m_Angle = tobj.m_Angle;
+    m_Flags = tobj.m_Flags;
+    m_Enchanted = tobj.m_Enchanted;
+    m_DoorDir = tobj.m_DoorDir;
+    m_Invisible = tobj.m_Invisible;
+    m_IsQuantity = tobj.m_IsQuantity;
+    m_Quality = tobj.m_Quality;
+    m_Next = tobj.m_Next;
+    m_Owner = tobj.m_Owner;
+    m_Quantity = tobj.m_Quantity;
 }
 
-bool ObjectInstance::setBillboard(IBillboardSceneNode *tbb)
+bool ObjectInstance::setSprite(int nsprite)
 {
-    if(tbb == NULL)
+    if(nsprite == SPRITEBATCH_NONE)
     {
-        if(m_Billboard != NULL)
+        if(m_Sprite != SPRITEBATCH_NONE)
         {
-            std::cout << "Setting billboard to NULL\n";
-            m_Billboard->remove();
-            m_Billboard = NULL;
+            SpriteBatch *tbatch = Game::getInstance()->getSpriteBatch();
+            if(tbatch != NULL) tbatch->removeSprite(m_Sprite);
+            m_Sprite = SPRITEBATCH_NONE;
         }
     }
     else
     {
-        m_Billboard = tbb;
+        m_Sprite = nsprite;
     }
 
     return true;
@@ -81,7 +116,7 @@ void ObjectInstance::printDebug()
     std::cout << "----------------\n";
     std::cout << "Desc : " << gptr->getString(3, getRefID()) << std::endl;
     std::cout << "Ref ID   : 0x" << std::hex << getRefID() << std::dec << std::endl;
-    std::cout << "Instance ID : 0x" << std::hex << getInstanceID() << std::dec << std::endl;
+    std::cout << "Handle   : 0x" << std::hex << getHandle() << std::dec << std::endl;
     std::cout << "Flags : " << m_Flags << std::endl;
     std::cout << "Enchanted : " << m_Enchanted << std::endl;
     std::cout << "Door Dir  : " << m_DoorDir << std::endl;
@@ -93,11 +128,13 @@ void ObjectInstance::printDebug()
     std::cout << "Next      : 0x" << std::hex << m_Next << std::dec << std::endl;
     std::cout << "\nOwner   : 0x" << std::hex << m_Owner << " (" << std::dec << m_Owner << ")\n";
     std::cout << "Quant/Special : " << m_Quantity << " (0x" << std::hex << m_Quantity << ")\n" << std::dec;
-    std::cout << "Billboard     : ";
-    if(m_Billboard == NULL) std::cout << "NULL\n";
+    std::cout << "Sprite        : ";
+    const Sprite *tsprite = NULL;
+    if(gptr->getSpriteBatch() != NULL) tsprite = gptr->getSpriteBatch()->getSprite(m_Sprite);
+    if(tsprite == NULL) std::cout << "NONE\n";
     else
     {
-        vector3df bpos = m_Billboard->getPosition();
-        std::cout << bpos.X << "," << bpos.Y << "," << bpos.Z << std::endl;
+        vector3df spos = tsprite->position;
+        std::cout << m_Sprite << " at " << spos.X << "," << spos.Y << "," << spos.Z << std::endl;
     }
 }
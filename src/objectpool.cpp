@@ -0,0 +1,209 @@
+#include "objectpool.hpp"
+
+#include <iostream>
+
+ObjectPool::ObjectPool(int capacity, int mobilecount)
+{
+    //slot index has to fit the handle, slot 0 is always the null object
+    if(capacity < 2 || capacity > OBJECT_HANDLE_INDEX_MASK + 1) capacity = OBJECT_POOL_SIZE;
+    if(mobilecount < 1 || mobilecount > capacity) mobilecount = 1;
+    m_Capacity = capacity;
+    m_MobileCount = mobilecount;
+
+    //allocate all storage up front, nothing is allocated after this
+    m_Slots.resize(m_Capacity);
+    m_Generations.resize(m_Capacity, 1);
+    m_InUse.resize(m_Capacity, false);
+    m_MobileFree.resize(m_MobileCount);
+    m_StaticFree.resize(m_Capacity - m_MobileCount);
+
+    clear();
+}
+
+ObjectPool::~ObjectPool()
+{
+
+}
+
+void ObjectPool::clear()
+{
+    m_MobileFreeCount = 0;
+    m_StaticFreeCount = 0;
+    m_UsedCount = 0;
+
+    for(int i = 0; i < m_Capacity; i++)
+    {
+        //invalidate any outstanding handles to a used slot
+        if(m_InUse[i])
+        {
+            m_Slots[i].setSprite(SPRITEBATCH_NONE);
+            m_Generations[i]++;
+            if( (m_Generations[i] << OBJECT_HANDLE_INDEX_BITS) == 0) m_Generations[i] = 1;
+        }
+        m_InUse[i] = false;
+    }
+
+    //push free slots in reverse so that the end of each list is handed out first
+    for(int i = m_MobileCount-1; i >= OBJECT_POOL_FIRST_MOBILE; i--) m_MobileFree[m_MobileFreeCount++] = u16(i);
+    for(int i = m_Capacity-1; i >= m_MobileCount; i--) m_StaticFree[m_StaticFreeCount++] = u16(i);
+}
+
+bool ObjectPool::setFreeLists(const std::vector<int> &mobilefree, const std::vector<int> &staticfree)
+{
+    //start with every slot marked in use, except the null object
+    clear();
+    for(int i = 1; i < m_Capacity; i++) m_InUse[i] = true;
+    m_UsedCount = m_Capacity - 1;
+    m_MobileFreeCount = 0;
+    m_StaticFreeCount = 0;
+
+    for(int i = 0; i < int(mobilefree.size()); i++)
+    {
+        int index = mobilefree[i];
+        if(index < OBJECT_POOL_FIRST_MOBILE || index >= m_MobileCount || !m_InUse[index])
+        {
+            std::cout << "Error setting mobile free list, invalid slot " << index << std::endl;
+            return false;
+        }
+
+        m_InUse[index] = false;
+        m_MobileFree[m_MobileFreeCount++] = u16(index);
+        m_UsedCount--;
+    }
+
+    for(int i = 0; i < int(staticfree.size()); i++)
+    {
+        int index = staticfree[i];
+        if(index < m_MobileCount || index >= m_Capacity || !m_InUse[index])
+        {
+            std::cout << "Error setting static free list, invalid slot " << index << std::endl;
+            return false;
+        }
+
+        m_InUse[index] = false;
+        m_StaticFree[m_StaticFreeCount++] = u16(index);
+        m_UsedCount--;
+    }
+
+    return true;
+}
+
+bool ObjectPool::removeFromFreeList(int index)
+{
+    //only used when placing objects at fixed slots (loading), so linear search is fine
+    std::vector<u16> *flist = &m_StaticFree;
+    int *fcount = &m_StaticFreeCount;
+
+    if(isMobileIndex(index))
+    {
+        flist = &m_MobileFree;
+        fcount = &m_MobileFreeCount;
+    }
+
+    for(int i = 0; i < *fcount; i++)
+    {
+        if( int((*flist)[i]) == index)
+        {
+            //swap with top of stack and pop
+            (*flist)[i] = (*flist)[*fcount - 1];
+            (*fcount)--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+ObjectHandle ObjectPool::allocate(Object *tobj, bool mobile)
+{
+    int index = 0;
+
+    if(mobile)
+    {
+        if(m_MobileFreeCount <= 0) return OBJECT_HANDLE_NULL; // out of mobile slots
+        index = m_MobileFree[--m_MobileFreeCount];
+    }
+    else
+    {
+        if(m_StaticFreeCount <= 0) return OBJECT_HANDLE_NULL; // out of static slots
+        index = m_StaticFree[--m_StaticFreeCount];
+    }
+
+    m_InUse[index] = true;
+    m_UsedCount++;
+
+    m_Slots[index].reset(tobj);
+    m_Slots[index].setHandle(makeHandle(index));
+
+    return m_Slots[index].getHandle();
+}
+
+ObjectHandle ObjectPool::allocateAt(int index, Object *tobj)
+{
+    //slot 0 is the null object and can not be allocated
+    if(index <= 0 || index >= m_Capacity) return OBJECT_HANDLE_NULL;
+
+    if(!m_InUse[index])
+    {
+        if(!removeFromFreeList(index)) return OBJECT_HANDLE_NULL;
+
+        m_InUse[index] = true;
+        m_UsedCount++;
+    }
+
+    m_Slots[index].setSprite(SPRITEBATCH_NONE);
+    m_Slots[index].reset(tobj);
+    m_Slots[index].setHandle(makeHandle(index));
+
+    return m_Slots[index].getHandle();
+}
+
+bool ObjectPool::release(ObjectHandle thandle)
+{
+    ObjectInstance *tobj = get(thandle);
+    if(tobj == NULL) return false;
+
+    int index = getIndex(thandle);
+
+    //remove any sprite tied to object
+    tobj->setSprite(SPRITEBATCH_NONE);
+
+    //bump generation so existing handles to this slot become invalid
+    m_Generations[index]++;
+    if( (m_Generations[index] << OBJECT_HANDLE_INDEX_BITS) == 0) m_Generations[index] = 1;
+    m_InUse[index] = false;
+    m_UsedCount--;
+
+    if(isMobileIndex(index)) m_MobileFree[m_MobileFreeCount++] = u16(index);
+    else m_StaticFree[m_StaticFreeCount++] = u16(index);
+
+    return true;
+}
+
+ObjectInstance *ObjectPool::get(ObjectHandle thandle)
+{
+    if(thandle == OBJECT_HANDLE_NULL) return NULL;
+
+    int index = getIndex(thandle);
+
+    if(index >= m_Capacity || !m_InUse[index]) return NULL;
+    if(makeHandle(index) != thandle) return NULL; // stale handle
+
+    return &m_Slots[index];
+}
+
+ObjectInstance *ObjectPool::getAt(int index)
+{
+    if(index <= 0 || index >= m_Capacity) return NULL;
+    if(!m_InUse[index]) return NULL;
+
+    return &m_Slots[index];
+}
+
+ObjectHandle ObjectPool::getHandleAt(int index)
+{
+    if(index <= 0 || index >= m_Capacity) return OBJECT_HANDLE_NULL;
+    if(!m_InUse[index]) return OBJECT_HANDLE_NULL;
+
+    return makeHandle(index);
+}
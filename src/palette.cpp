@@ -0,0 +1,413 @@
+#include "palette.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include "graphics.hpp"
+
+//index is in the red channel, palette texture is 256 x shade levels.  lighting follows the
+//fixed function point light closely enough for the level geometry.  with a shade range set
+//the shade row is picked by eye distance instead, like the original light tables
+static const char *g_PaletteVertexShader =
+    "uniform int Lighting;\n"
+    "uniform vec2 ShadeRange;\n"
+    "varying float Shade;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = ftransform();\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    vec4 vpos = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    Shade = 0.0;\n"
+    "    if(ShadeRange.y > ShadeRange.x) Shade = clamp((length(vpos.xyz) - ShadeRange.x)/(ShadeRange.y - ShadeRange.x), 0.0, 1.0);\n"
+    "    vec4 color = vec4(1.0);\n"
+    "    if(Lighting != 0)\n"
+    "    {\n"
+    "        vec3 normal = normalize(gl_NormalMatrix * gl_Normal);\n"
+    "        vec3 ldir = gl_LightSource[0].position.xyz - vpos.xyz;\n"
+    "        float dist = length(ldir);\n"
+    "        float att = 1.0 / (gl_LightSource[0].constantAttenuation + gl_LightSource[0].linearAttenuation*dist\n"
+    "                           + gl_LightSource[0].quadraticAttenuation*dist*dist);\n"
+    "        color = gl_LightModel.ambient + gl_LightSource[0].diffuse * max(dot(normal, ldir/dist), 0.0) * att;\n"
+    "        color.a = 1.0;\n"
+    "    }\n"
+    "    gl_FrontColor = color;\n"
+    "}\n";
+
+static const char *g_PalettePixelShader =
+    "uniform sampler2D IndexTexture;\n"
+    "uniform sampler2D PaletteTexture;\n"
+    "varying float Shade;\n"
+    "void main()\n"
+    "{\n"
+    "    float index = texture2D(IndexTexture, gl_TexCoord[0].xy).r;\n"
+    "    float row = floor(Shade*15.0 + 0.5);\n"
+    "    vec4 color = texture2D(PaletteTexture, vec2((index*255.0 + 0.5)/256.0, (row + 0.5)/16.0));\n"
+    "    gl_FragColor = color * gl_Color;\n"
+    "}\n";
+
+class PaletteShaderCallback : public IShaderConstantSetCallBack
+{
+public:
+    bool m_Lighting;
+    f32 m_ShadeRange[2]; // eye distance where shading starts and reaches black
+
+    PaletteShaderCallback() { m_Lighting = true; m_ShadeRange[0] = 0.f; m_ShadeRange[1] = 0.f;}
+
+    virtual void OnSetMaterial(const SMaterial &material) { m_Lighting = material.Lighting;}
+
+    virtual void OnSetConstants(IMaterialRendererServices *services, s32 userData)
+    {
+        s32 indexlayer = 0;
+        s32 palettelayer = 1;
+        s32 lighting = m_Lighting ? 1 : 0;
+
+        services->setPixelShaderConstant("IndexTexture", &indexlayer, 1);
+        services->setPixelShaderConstant("PaletteTexture", &palettelayer, 1);
+        services->setVertexShaderConstant("Lighting", &lighting, 1);
+        services->setVertexShaderConstant("ShadeRange", m_ShadeRange, 2);
+    }
+};
+
+PaletteManager::PaletteManager()
+{
+    m_Driver = NULL;
+    m_Mode = PALMODE_SOFTWARE;
+
+    m_PaletteTexture = NULL;
+    m_ShaderCallback = NULL;
+    m_MaterialType = -1;
+    m_ShadeStart = 0.f;
+    m_ShadeEnd = 0.f;
+    m_Saved32Bit = false;
+    m_Saved16Bit = false;
+
+    m_CycleTime = 0;
+    m_Cycling = true;
+    m_RemapCount = 0;
+}
+
+PaletteManager::~PaletteManager()
+{
+    if(m_ShaderCallback != NULL) m_ShaderCallback->drop();
+}
+
+int PaletteManager::init(IVideoDriver *tdriver, const std::vector<SColor> &tpalette, bool useshader)
+{
+    if(tdriver == NULL) return -1;
+    if(int(tpalette.size()) != PALETTE_SIZE) return -2;
+
+    m_Driver = tdriver;
+    m_Palette = tpalette;
+    m_AppliedPalette = tpalette;
+    m_Mode = PALMODE_SOFTWARE;
+
+    if(!useshader) return m_Mode;
+
+    //shader mode needs glsl
+    IGPUProgrammingServices *gpu = m_Driver->getGPUProgrammingServices();
+    if(gpu == NULL || m_Driver->getDriverType() != EDT_OPENGL || !m_Driver->queryFeature(EVDF_ARB_GLSL) )
+    {
+        std::cout << "No GLSL support, palettes are applied in software\n";
+        return m_Mode;
+    }
+
+    //palette lookup texture, no filtering or mips so entries don't bleed.  32 bit, apply
+    //writes whole texels
+    bool mipflag = m_Driver->getTextureCreationFlag(ETCF_CREATE_MIP_MAPS);
+    m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, false);
+    setFull32Bit(true);
+
+    IImage *palimg = m_Driver->createImage(ECF_A8R8G8B8, dimension2d<u32>(PALETTE_SIZE, PALETTE_SHADE_ROWS));
+    for(int y = 0; y < PALETTE_SHADE_ROWS; y++)
+        for(int i = 0; i < PALETTE_SIZE; i++) palimg->setPixel(i, y, m_Palette[i]);
+    m_PaletteTexture = m_Driver->addTexture("palette_lut", palimg);
+    palimg->drop();
+
+    setFull32Bit(false);
+    m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, mipflag);
+
+    if(m_PaletteTexture == NULL || m_PaletteTexture->getColorFormat() != ECF_A8R8G8B8)
+    {
+        std::cout << "Error creating palette texture, palettes are applied in software\n";
+        if(m_PaletteTexture != NULL) m_Driver->removeTexture(m_PaletteTexture);
+        m_PaletteTexture = NULL;
+        return m_Mode;
+    }
+
+    m_ShaderCallback = new PaletteShaderCallback;
+    m_MaterialType = gpu->addHighLevelShaderMaterial(g_PaletteVertexShader, "main", EVST_VS_1_1,
+                                                     g_PalettePixelShader, "main", EPST_PS_1_1,
+                                                     m_ShaderCallback, EMT_SOLID);
+    if(m_MaterialType < 0)
+    {
+        std::cout << "Error compiling palette shader, palettes are applied in software\n";
+        m_Driver->removeTexture(m_PaletteTexture);
+        m_PaletteTexture = NULL;
+        return m_Mode;
+    }
+
+    m_Mode = PALMODE_SHADER;
+    m_ShaderCallback->m_ShadeRange[0] = m_ShadeStart;
+    m_ShaderCallback->m_ShadeRange[1] = m_ShadeEnd;
+
+    return m_Mode;
+}
+
+void PaletteManager::setFull32Bit(bool tfull)
+{
+    //texture bit depth flags are saved on the way in and put back on the way out
+    if(tfull)
+    {
+        m_Saved32Bit = m_Driver->getTextureCreationFlag(ETCF_ALWAYS_32_BIT);
+        m_Saved16Bit = m_Driver->getTextureCreationFlag(ETCF_ALWAYS_16_BIT);
+        m_Driver->setTextureCreationFlag(ETCF_ALWAYS_16_BIT, false);
+        m_Driver->setTextureCreationFlag(ETCF_ALWAYS_32_BIT, true);
+    }
+    else
+    {
+        m_Driver->setTextureCreationFlag(ETCF_ALWAYS_32_BIT, m_Saved32Bit);
+        m_Driver->setTextureCreationFlag(ETCF_ALWAYS_16_BIT, m_Saved16Bit);
+    }
+}
+
+void PaletteManager::setLightMaps(const std::vector< std::vector<u8> > *tmaps)
+{
+    m_LightMaps.clear();
+    if(tmaps == NULL || int(tmaps->size()) != PALETTE_SHADE_ROWS) return;
+    for(int i = 0; i < PALETTE_SHADE_ROWS; i++) if(int((*tmaps)[i].size()) != PALETTE_SIZE) return;
+
+    m_LightMaps = *tmaps;
+
+    //force every shade row to be rewritten on the next apply, software mode doesn't shade
+    if(m_Mode == PALMODE_SHADER) for(int i = 0; i < PALETTE_SIZE; i++) m_AppliedPalette[i].color = ~m_Palette[i].color;
+}
+
+void PaletteManager::setShadeRange(f32 start, f32 end)
+{
+    m_ShadeStart = start;
+    m_ShadeEnd = end;
+
+    if(m_ShaderCallback == NULL) return;
+    m_ShaderCallback->m_ShadeRange[0] = start;
+    m_ShaderCallback->m_ShadeRange[1] = end;
+}
+
+int PaletteManager::uploadIndexed(std::vector<IImage*> *ilist, std::vector< std::vector<u8> > *indices,
+                                  std::vector<ITexture*> *tlist, std::string tname)
+{
+    if(ilist == NULL || indices == NULL || tlist == NULL || m_Driver == NULL) return -1;
+    if(indices->size() != ilist->size()) return -2;
+
+    int firsttexture = int(tlist->size());
+    int errorcode = 0;
+
+    if(m_Mode == PALMODE_SHADER)
+    {
+        //averaged indices would be garbage, so no mips.  16 bit textures would cut the
+        //index in red to 5 bits
+        bool mipflag = m_Driver->getTextureCreationFlag(ETCF_CREATE_MIP_MAPS);
+        m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, false);
+        setFull32Bit(true);
+
+        for(int i = 0; i < int(ilist->size()); i++)
+        {
+            dimension2d<u32> tsize = (*ilist)[i]->getDimension();
+            (*ilist)[i]->drop();
+
+            //index goes in red, that's the channel the shader reads
+            IImage *indeximg = m_Driver->createImage(ECF_A8R8G8B8, tsize);
+            const std::vector<u8> &tindices = (*indices)[i];
+            for(u32 y = 0; y < tsize.Height; y++)
+                for(u32 x = 0; x < tsize.Width; x++) indeximg->setPixel(x, y, SColor(255, tindices[y*tsize.Width + x], 0, 0));
+
+            std::stringstream texturename;
+            texturename << tname << "_" << i;
+
+            ITexture *newtxt = m_Driver->addTexture(texturename.str().c_str(), indeximg);
+            indeximg->drop();
+
+            if(newtxt == NULL) errorcode = -12;
+            else tlist->push_back(newtxt);
+        }
+        ilist->clear();
+
+        setFull32Bit(false);
+        m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, mipflag);
+    }
+    else errorcode = uploadTextures(ilist, tlist);
+
+    if(errorcode) return errorcode;
+
+    //keep indices for remapping, the shader only needs them for palette usage
+    for(int i = 0; i < int(indices->size()); i++)
+    {
+        m_Entries.push_back(IndexedEntry());
+        IndexedEntry *tentry = &m_Entries.back();
+
+        tentry->texture = (*tlist)[firsttexture + i];
+        m_IndexedTextures.insert(tentry->texture);
+        tentry->size = tentry->texture->getOriginalSize();
+        tentry->indices.swap( (*indices)[i]);
+
+        memset(tentry->usage, 0, sizeof(tentry->usage));
+        for(int n = 0; n < int(tentry->indices.size()); n++) tentry->usage[tentry->indices[n] >> 5] |= (1 << (tentry->indices[n] & 31));
+
+        //shader mode doesn't remap, so the index copy isn't needed
+        if(m_Mode == PALMODE_SHADER) std::vector<u8>().swap(tentry->indices);
+    }
+    indices->clear();
+
+    //applies never allocate, even if every texture is remapped
+    m_Remapped.reserve(m_Entries.size());
+
+    return 0;
+}
+
+void PaletteManager::configMaterial(SMaterial *tmat)
+{
+    if(tmat == NULL || m_Mode != PALMODE_SHADER) return;
+    if(!isIndexed(tmat->getTexture(0))) return;
+
+    tmat->MaterialType = E_MATERIAL_TYPE(m_MaterialType);
+    tmat->setTexture(1, m_PaletteTexture);
+
+    //indices can't be filtered
+    for(int i = 0; i < 2; i++)
+    {
+        tmat->TextureLayer[i].BilinearFilter = false;
+        tmat->TextureLayer[i].TrilinearFilter = false;
+        tmat->TextureLayer[i].AnisotropicFilter = 0;
+    }
+    tmat->TextureLayer[1].TextureWrapU = ETC_CLAMP_TO_EDGE;
+    tmat->TextureLayer[1].TextureWrapV = ETC_CLAMP_TO_EDGE;
+    tmat->UseMipMaps = false;
+}
+
+void PaletteManager::setPalette(const std::vector<SColor> &tpalette)
+{
+    if(int(tpalette.size()) != PALETTE_SIZE) return;
+
+    m_Palette = tpalette;
+}
+
+void PaletteManager::addCycle(int start, int count)
+{
+    if(start < 0 || count < 2 || start + count > PALETTE_SIZE) return;
+
+    PaletteCycle newcycle;
+    newcycle.start = start;
+    newcycle.count = count;
+    m_Cycles.push_back(newcycle);
+}
+
+void PaletteManager::update(u32 deltams)
+{
+    if(m_Driver == NULL) return;
+
+    if(m_Cycling) m_CycleTime += deltams;
+
+    //rotate each cycle range one entry per step
+    while(m_CycleTime >= PALCYCLE_INTERVAL)
+    {
+        m_CycleTime -= PALCYCLE_INTERVAL;
+
+        for(int i = 0; i < int(m_Cycles.size()); i++)
+        {
+            SColor *tcolors = &m_Palette[m_Cycles[i].start];
+            SColor last = tcolors[m_Cycles[i].count-1];
+            for(int n = m_Cycles[i].count-1; n > 0; n--) tcolors[n] = tcolors[n-1];
+            tcolors[0] = last;
+        }
+    }
+
+    apply();
+}
+
+void PaletteManager::remapEntry(IndexedEntry *tentry)
+{
+    ITexture *ttexture = tentry->texture;
+    ECOLOR_FORMAT tformat = ttexture->getColorFormat();
+
+    if(tformat != ECF_A1R5G5B5 && tformat != ECF_A8R8G8B8) return;
+    if(ttexture->getSize() != tentry->size) return; // driver resized it, indices don't match
+
+    void *tdata = ttexture->lock(ETLM_WRITE_ONLY);
+    if(tdata == NULL) return;
+
+    u32 pitch = ttexture->getPitch();
+    for(u32 y = 0; y < tentry->size.Height; y++)
+    {
+        const u8 *rowindices = &tentry->indices[y*tentry->size.Width];
+
+        if(tformat == ECF_A8R8G8B8)
+        {
+            u32 *row = (u32*)( (u8*)(tdata) + y*pitch);
+            for(u32 x = 0; x < tentry->size.Width; x++) row[x] = m_Palette[rowindices[x]].color;
+        }
+        else
+        {
+            u16 *row = (u16*)( (u8*)(tdata) + y*pitch);
+            for(u32 x = 0; x < tentry->size.Width; x++) row[x] = A8R8G8B8toA1R5G5B5(m_Palette[rowindices[x]].color);
+        }
+    }
+
+    ttexture->unlock();
+}
+
+int PaletteManager::apply()
+{
+    m_RemapCount = 0;
+    m_Remapped.clear();
+
+    //which entries changed since the textures were last updated
+    u32 changed[PALETTE_SIZE/32];
+    bool anychanged = false;
+    memset(changed, 0, sizeof(changed));
+
+    for(int i = 0; i < PALETTE_SIZE; i++)
+    {
+        if(m_Palette[i] != m_AppliedPalette[i])
+        {
+            changed[i >> 5] |= (1 << (i & 31));
+            anychanged = true;
+        }
+    }
+    if(!anychanged) return 0;
+
+    if(m_Mode == PALMODE_SHADER)
+    {
+        //only the palette texels are rewritten, one row per shade level
+        if(m_PaletteTexture->getColorFormat() != ECF_A8R8G8B8) return -2;
+        u8 *tdata = (u8*)(m_PaletteTexture->lock(ETLM_WRITE_ONLY));
+        if(tdata == NULL) return -1;
+
+        u32 pitch = m_PaletteTexture->getPitch();
+        for(int y = 0; y < PALETTE_SHADE_ROWS; y++)
+        {
+            u32 *row = (u32*)(tdata + y*pitch);
+
+            if(m_LightMaps.empty()) for(int i = 0; i < PALETTE_SIZE; i++) row[i] = m_Palette[i].color;
+            else for(int i = 0; i < PALETTE_SIZE; i++) row[i] = m_Palette[m_LightMaps[y][i]].color;
+        }
+        m_PaletteTexture->unlock();
+    }
+    else
+    {
+        //only textures using a changed entry are rewritten
+        for(int i = 0; i < int(m_Entries.size()); i++)
+        {
+            bool uses = false;
+            for(int n = 0; n < PALETTE_SIZE/32 && !uses; n++) uses = (m_Entries[i].usage[n] & changed[n]) != 0;
+            if(!uses) continue;
+
+            remapEntry(&m_Entries[i]);
+            m_Remapped.push_back(m_Entries[i].texture);
+            m_RemapCount++;
+        }
+    }
+
+    m_AppliedPalette = m_Palette;
+
+    return m_RemapCount;
+}
@@ -2,13 +2,15 @@
 #include <iostream>
 
 Player::Player()
+    : m_InvObjects(INV_TOTALSLOTS + 1, 1)
 {
     //set player defaults
     m_Name = "Player";
 
     //create empty inventory slots
     m_InvSlots.resize(INV_TOTALSLOTS);
-    for(int i = 0; i < int(m_InvSlots.size()); i++) m_InvSlots[i] = NULL;
+    for(int i = 0; i < int(m_InvSlots.size()); i++) m_InvSlots[i] = OBJECT_HANDLE_NULL;
+    m_InventoryDirty = true;
 }
 
 Player::~Player()
@@ -24,7 +26,7 @@ ObjectInstance *Player::getInventorySlot(int slotnum)
         return NULL;
     }
 
-    return m_InvSlots[slotnum];
+    return m_InvObjects.get(m_InvSlots[slotnum]);
 }
 
 bool Player::setInventorySlot(int slotnum, ObjectInstance *tobj)
@@ -35,7 +37,7 @@ bool Player::setInventorySlot(int slotnum, ObjectInstance *tobj)
         return false;
     }
 
-    if(m_InvSlots[slotnum] != NULL)
+    if(m_InvSlots[slotnum] != OBJECT_HANDLE_NULL)
     {
         std::cout << "Inventory slot not empty!\n";
         return false;
@@ -47,31 +49,49 @@ bool Player::setInventorySlot(int slotnum, ObjectInstance *tobj)
         return false;
     }
 
-    m_InvSlots[slotnum] = tobj;
+    //copy object into inventory pool
+    ObjectHandle newhandle = m_InvObjects.allocate(tobj->getRef());
+    if(newhandle == OBJECT_HANDLE_NULL)
+    {
+        std::cout << "Error setting inv slot, inventory object pool is full!\n";
+        return false;
+    }
+    ObjectInstance *invobj = m_InvObjects.get(newhandle);
+    invobj->copyFrom(*tobj);
+
+    //chain link indexes the level's pool, it means nothing in the inventory
+    invobj->setNext(0);
+
+    m_InvSlots[slotnum] = newhandle;
+    m_InventoryDirty = true;
+
+    return true;
 }
 
-ObjectInstance *Player::popInventorySlot(int slotnum)
+bool Player::popInventorySlot(int slotnum, ObjectInstance *tobj)
 {
-    ObjectInstance *tobj = NULL;
-
     if(slotnum < 0 || slotnum >= INV_TOTALSLOTS)
     {
         std::cout << "Error getting player inv slot!  Slot " << slotnum << " not valid!\n";
-        return tobj;
+        return false;
     }
 
-    if(m_InvSlots[slotnum] == NULL)
+    //get object in slot
+    ObjectInstance *invobj = m_InvObjects.get(m_InvSlots[slotnum]);
+
+    if(invobj == NULL)
     {
         std::cout << "Error popping inv slot.  Slot is null!\n";
-        return tobj;
+        return false;
     }
 
-    //get object in slot
-    tobj = m_InvSlots[slotnum];
+    //copy object out if requested
+    if(tobj != NULL) tobj->copyFrom(*invobj);
 
-    //set slot to null
-    m_InvSlots[slotnum] = NULL;
+    //free object and set slot to null
+    m_InvObjects.release(m_InvSlots[slotnum]);
+    m_InvSlots[slotnum] = OBJECT_HANDLE_NULL;
+    m_InventoryDirty = true;
 
-    //return object
-    return tobj;
+    return true;
 }
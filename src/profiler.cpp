@@ -0,0 +1,282 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "tools.hpp"
+#include "alloctrack.hpp"
+
+Profiler *Profiler::m_Instance = NULL;
+
+Profiler::Profiler()
+{
+    m_History.resize(PROFILER_FRAME_HISTORY * PROFILER_MAX_SCOPES, 0);
+    m_FrameTimes.resize(PROFILER_FRAME_HISTORY, 0);
+
+    m_StackDepth = 0;
+    m_Overflow = 0;
+    m_InFrame = false;
+    m_ShowOverlay = false;
+    m_ThreadID = std::this_thread::get_id();
+
+    reset();
+}
+
+Profiler::~Profiler()
+{
+
+}
+
+void Profiler::reset()
+{
+    for(int i = 0; i < int(m_History.size()); i++) m_History[i] = 0;
+    for(int i = 0; i < int(m_FrameTimes.size()); i++) m_FrameTimes[i] = 0;
+    for(int i = 0; i < PROFILER_MAX_SCOPES; i++)
+    {
+        m_Current[i] = 0;
+        m_CurrentAllocs[i] = 0;
+        m_LastAllocs[i] = 0;
+    }
+
+    m_FrameIndex = 0;
+    m_FrameCount = 0;
+}
+
+void Profiler::beginFrame()
+{
+    //whoever runs frames owns the profiler
+    m_ThreadID = std::this_thread::get_id();
+
+    for(int i = 0; i < PROFILER_MAX_SCOPES; i++)
+    {
+        m_Current[i] = 0;
+        m_CurrentAllocs[i] = 0;
+    }
+    m_StackDepth = 0;
+    m_Overflow = 0;
+
+    m_FrameStart = getMicroseconds();
+    m_InFrame = true;
+}
+
+void Profiler::endFrame()
+{
+    if(!m_InFrame) return;
+    m_InFrame = false;
+
+    //copy frame into ring buffer
+    u32 *tframe = &m_History[m_FrameIndex * PROFILER_MAX_SCOPES];
+    for(int i = 0; i < PROFILER_MAX_SCOPES; i++)
+    {
+        tframe[i] = m_Current[i];
+        m_LastAllocs[i] = m_CurrentAllocs[i];
+    }
+    m_FrameTimes[m_FrameIndex] = u32(getMicroseconds() - m_FrameStart);
+
+    m_FrameIndex = (m_FrameIndex + 1) % PROFILER_FRAME_HISTORY;
+    if(m_FrameCount < PROFILER_FRAME_HISTORY) m_FrameCount++;
+}
+
+int Profiler::findScope(const char *name, int parent)
+{
+    for(int i = 0; i < int(m_Scopes.size()); i++)
+    {
+        if(m_Scopes[i].parent == parent && !strcmp(m_Scopes[i].name.c_str(), name)) return i;
+    }
+
+    //first time this scope is seen under this parent
+    if(int(m_Scopes.size()) >= PROFILER_MAX_SCOPES) return -1;
+
+    ProfilerScope newscope;
+    newscope.name = name;
+    newscope.parent = parent;
+    newscope.depth = 0;
+    if(parent >= 0) newscope.depth = m_Scopes[parent].depth + 1;
+
+    m_Scopes.push_back(newscope);
+
+    return int(m_Scopes.size()) - 1;
+}
+
+void Profiler::beginScope(const char *name)
+{
+    if(!m_InFrame || std::this_thread::get_id() != m_ThreadID) return;
+
+    if(m_Overflow || m_StackDepth >= PROFILER_MAX_DEPTH)
+    {
+        m_Overflow++;
+        return;
+    }
+
+    int parent = -1;
+    if(m_StackDepth > 0) parent = m_Stack[m_StackDepth-1];
+
+    //scope table full, the sample is dropped.  the parent's own time already includes it,
+    //and scopes opened inside are dropped too
+    int scopeindex = PROFILER_SCOPE_DROPPED;
+    if(parent != PROFILER_SCOPE_DROPPED) scopeindex = findScope(name, parent);
+    if(scopeindex < 0) scopeindex = PROFILER_SCOPE_DROPPED;
+
+    m_Stack[m_StackDepth] = scopeindex;
+    m_StackStart[m_StackDepth] = getMicroseconds();
+    m_StackAllocs[m_StackDepth] = AllocTracker::getThreadAllocs();
+    m_StackDepth++;
+}
+
+void Profiler::endScope()
+{
+    if(!m_InFrame || std::this_thread::get_id() != m_ThreadID) return;
+
+    if(m_Overflow)
+    {
+        m_Overflow--;
+        return;
+    }
+
+    if(m_StackDepth <= 0) return;
+    m_StackDepth--;
+
+    int scopeindex = m_Stack[m_StackDepth];
+    if(scopeindex >= 0)
+    {
+        m_Current[scopeindex] += u32(getMicroseconds() - m_StackStart[m_StackDepth]);
+        m_CurrentAllocs[scopeindex] += u32(AllocTracker::getThreadAllocs() - m_StackAllocs[m_StackDepth]);
+    }
+}
+
+u32 Profiler::getScopeAllocs(int scopeindex)
+{
+    if(scopeindex < 0 || scopeindex >= PROFILER_MAX_SCOPES) return 0;
+
+    return m_LastAllocs[scopeindex];
+}
+
+const ProfilerScope *Profiler::getScope(int scopeindex)
+{
+    if(scopeindex < 0 || scopeindex >= int(m_Scopes.size())) return NULL;
+
+    return &m_Scopes[scopeindex];
+}
+
+u32 Profiler::getPercentile(std::vector<u32> *tsamples, float tpercent)
+{
+    if(tsamples->empty()) return 0;
+
+    int tindex = int( float(tsamples->size() - 1) * tpercent);
+    std::nth_element(tsamples->begin(), tsamples->begin() + tindex, tsamples->end());
+
+    return (*tsamples)[tindex];
+}
+
+bool Profiler::getStats(int scopeindex, ProfilerStats *tstats)
+{
+    if(tstats == NULL) return false;
+    if(scopeindex >= int(m_Scopes.size())) return false;
+
+    std::vector<u32> samples;
+    samples.reserve(m_FrameCount);
+
+    for(int i = 0; i < m_FrameCount; i++)
+    {
+        if(scopeindex < 0) samples.push_back(m_FrameTimes[i]);
+        else samples.push_back(m_History[i*PROFILER_MAX_SCOPES + scopeindex]);
+    }
+
+    tstats->avg = 0;
+    tstats->max = 0;
+    for(int i = 0; i < int(samples.size()); i++)
+    {
+        tstats->avg += float(samples[i]);
+        if(samples[i] > tstats->max) tstats->max = samples[i];
+    }
+    if(!samples.empty()) tstats->avg /= float(samples.size());
+
+    tstats->p50 = getPercentile(&samples, 0.50f);
+    tstats->p95 = getPercentile(&samples, 0.95f);
+    tstats->p99 = getPercentile(&samples, 0.99f);
+
+    return true;
+}
+
+void Profiler::drawOverlay(IVideoDriver *tdriver, UWFont *tfont, position2d<s32> tpos)
+{
+    if(tdriver == NULL || tfont == NULL) return;
+
+    const int lineheight = tfont->m_Height + 2;
+    const int colwidth = getStringWidth(tfont, "000.00 ");
+    const int namewidth = getStringWidth(tfont, "000000000000000000");
+
+    //scopes are listed in tree order, children under their parent
+    std::vector<int> order;
+    std::vector<int> pending;
+    for(int i = int(m_Scopes.size()) - 1; i >= 0; i--) if(m_Scopes[i].parent < 0) pending.push_back(i);
+    while(!pending.empty())
+    {
+        int tscope = pending.back();
+        pending.pop_back();
+        order.push_back(tscope);
+
+        for(int i = int(m_Scopes.size()) - 1; i >= 0; i--) if(m_Scopes[i].parent == tscope) pending.push_back(i);
+    }
+
+    //background
+    rect<s32> bgrect(tpos, dimension2d<s32>(namewidth + colwidth*5, lineheight*(int(order.size()) + 2)));
+    tdriver->draw2DRectangle(SColor(160,0,0,0), bgrect);
+
+    //whole table is one batch, one draw per color
+    m_OverlayText.begin();
+
+    const std::string headers[] = {"avg", "max", "p50", "p95", "p99"};
+    m_OverlayText.addString(tfont, "ms", tpos, SColor(255,255,255,0));
+    for(int i = 0; i < 5; i++)
+        m_OverlayText.addString(tfont, headers[i], position2d<s32>(tpos.X + namewidth + colwidth*i, tpos.Y), SColor(255,255,255,0));
+
+    for(int i = -1; i < int(order.size()); i++)
+    {
+        ProfilerStats tstats;
+        std::string tname = "frame";
+        int tdepth = 0;
+
+        if(i >= 0)
+        {
+            tname = m_Scopes[order[i]].name;
+            tdepth = m_Scopes[order[i]].depth + 1;
+        }
+        if(!getStats(i < 0 ? -1 : order[i], &tstats)) continue;
+
+        position2d<s32> linepos(tpos.X, tpos.Y + lineheight*(i+2));
+        m_OverlayText.addString(tfont, std::string(tdepth, ' ') + tname, linepos, SColor(255,255,255,255));
+
+        u32 values[] = {u32(tstats.avg), tstats.max, tstats.p50, tstats.p95, tstats.p99};
+        for(int n = 0; n < 5; n++)
+        {
+            std::stringstream valss;
+            valss << std::fixed << std::setprecision(2) << float(values[n])/1000.f;
+            m_OverlayText.addString(tfont, valss.str(), position2d<s32>(linepos.X + namewidth + colwidth*n, linepos.Y), SColor(255,255,255,255));
+        }
+    }
+
+    m_OverlayText.end(tdriver);
+}
+
+void Profiler::printStats()
+{
+    std::cout << "Profiler, " << m_FrameCount << " frames (microseconds) : avg / max / p50 / p95 / p99, allocations last frame\n";
+
+    for(int i = -1; i < int(m_Scopes.size()); i++)
+    {
+        ProfilerStats tstats;
+        if(!getStats(i, &tstats)) continue;
+
+        if(i < 0) std::cout << "frame";
+        else std::cout << std::string(m_Scopes[i].depth*2 + 2, ' ') << m_Scopes[i].name;
+
+        std::cout << " : " << int(tstats.avg) << " / " << tstats.max << " / " << tstats.p50 << " / "
+                  << tstats.p95 << " / " << tstats.p99;
+        if(i >= 0) std::cout << ", " << m_LastAllocs[i];
+        std::cout << std::endl;
+    }
+}
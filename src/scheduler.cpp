@@ -0,0 +1,275 @@
+#include "scheduler.hpp"
+
+#include <iostream>
+
+#include "level.hpp"
+#include "tools.hpp"
+
+EntityScheduler::EntityScheduler(EntityClient *nclient)
+{
+    m_Client = nclient;
+
+    m_Radius = SCHEDULER_DEFAULT_RADIUS;
+    m_Budget = SCHEDULER_DEFAULT_BUDGET;
+
+    m_TileEntities.resize(TILE_ROWS * TILE_COLS);
+
+    clear();
+}
+
+EntityScheduler::~EntityScheduler()
+{
+
+}
+
+void EntityScheduler::clear()
+{
+    m_Entities.clear();
+    m_Active.clear();
+    for(int i = 0; i < int(m_TileEntities.size()); i++) m_TileEntities[i].clear();
+
+    m_CenterTile = vector2di(-1,-1);
+    m_NeedsRefresh = true;
+    m_Stamp = 0;
+    m_UpdateCursor = 0;
+
+    m_WokenThisTick = 0;
+    m_HibernatedThisTick = 0;
+    m_UpdatedThisTick = 0;
+    m_BudgetOverruns = 0;
+}
+
+void EntityScheduler::hibernateAll(u32 now)
+{
+    for(int i = 0; i < int(m_Active.size()); i++) hibernate(m_Active[i], now);
+    m_Active.clear();
+
+    m_NeedsRefresh = true;
+}
+
+int EntityScheduler::buildFromLevel(Level *tlevel, u32 now)
+{
+    if(tlevel == NULL) return -1;
+
+    clear();
+
+    for(int i = 0; i < TILE_ROWS; i++)
+    {
+        for(int n = 0; n < TILE_COLS; n++)
+        {
+            Tile *ttile = tlevel->getTile(n, i);
+            const std::vector<ObjectHandle> &tobjs = ttile->getObjects();
+
+            for(int k = 0; k < int(tobjs.size()); k++)
+            {
+                SchedulerEntity newentity;
+                newentity.handle = tobjs[k];
+                newentity.tile = vector2di(n, i);
+                newentity.active = false;
+                newentity.stamp = 0;
+                newentity.lastTime = now;
+                newentity.activeIndex = -1;
+
+                m_TileEntities[i*TILE_COLS + n].push_back( int(m_Entities.size()));
+                m_Entities.push_back(newentity);
+            }
+        }
+    }
+
+    m_Active.reserve(m_Entities.size());
+
+    return int(m_Entities.size());
+}
+
+int EntityScheduler::findEntity(ObjectHandle thandle)
+{
+    //only used when objects move or are removed, so a linear search is fine
+    for(int i = 0; i < int(m_Entities.size()); i++)
+    {
+        if(m_Entities[i].handle == thandle) return i;
+    }
+
+    return -1;
+}
+
+bool EntityScheduler::moveEntity(ObjectHandle thandle, vector2di ntile)
+{
+    int eindex = findEntity(thandle);
+    if(eindex < 0) return false;
+    if(ntile.X < 0 || ntile.X >= TILE_COLS || ntile.Y < 0 || ntile.Y >= TILE_ROWS) return false;
+
+    SchedulerEntity *tentity = &m_Entities[eindex];
+
+    //remove from old tile list
+    std::vector<int> *oldlist = &m_TileEntities[tentity->tile.Y*TILE_COLS + tentity->tile.X];
+    for(int i = 0; i < int(oldlist->size()); i++)
+    {
+        if( (*oldlist)[i] == eindex)
+        {
+            (*oldlist)[i] = oldlist->back();
+            oldlist->pop_back();
+            break;
+        }
+    }
+
+    //add to new tile list
+    tentity->tile = ntile;
+    m_TileEntities[ntile.Y*TILE_COLS + ntile.X].push_back(eindex);
+
+    //entity may have crossed the radius
+    m_NeedsRefresh = true;
+
+    return true;
+}
+
+bool EntityScheduler::removeEntity(ObjectHandle thandle)
+{
+    int eindex = findEntity(thandle);
+    if(eindex < 0) return false;
+
+    SchedulerEntity *tentity = &m_Entities[eindex];
+
+    //take out of active list without calling hibernate, object is gone
+    if(tentity->active)
+    {
+        int aindex = tentity->activeIndex;
+        m_Active[aindex] = m_Active.back();
+        m_Entities[m_Active[aindex]].activeIndex = aindex;
+        m_Active.pop_back();
+        tentity->active = false;
+        tentity->activeIndex = -1;
+    }
+
+    //remove from tile list, entity slot is kept but no longer reachable
+    std::vector<int> *tlist = &m_TileEntities[tentity->tile.Y*TILE_COLS + tentity->tile.X];
+    for(int i = 0; i < int(tlist->size()); i++)
+    {
+        if( (*tlist)[i] == eindex)
+        {
+            (*tlist)[i] = tlist->back();
+            tlist->pop_back();
+            break;
+        }
+    }
+
+    tentity->handle = OBJECT_HANDLE_NULL;
+
+    return true;
+}
+
+void EntityScheduler::setRadius(int nradius)
+{
+    if(nradius < 0) nradius = 0;
+
+    m_Radius = nradius;
+    m_NeedsRefresh = true;
+}
+
+void EntityScheduler::wake(int eindex, u32 now)
+{
+    SchedulerEntity *tentity = &m_Entities[eindex];
+
+    tentity->active = true;
+    tentity->activeIndex = int(m_Active.size());
+    m_Active.push_back(eindex);
+
+    //let client catch up on the time the entity was asleep
+    if(m_Client != NULL) m_Client->onEntityWake(tentity->handle, tentity->tile, now - tentity->lastTime);
+
+    tentity->lastTime = now;
+    m_WokenThisTick++;
+}
+
+void EntityScheduler::hibernate(int eindex, u32 now)
+{
+    SchedulerEntity *tentity = &m_Entities[eindex];
+
+    tentity->active = false;
+    tentity->activeIndex = -1;
+    tentity->lastTime = now;
+
+    if(m_Client != NULL) m_Client->onEntityHibernate(tentity->handle, tentity->tile);
+
+    m_HibernatedThisTick++;
+}
+
+void EntityScheduler::refreshActiveSet(u32 now)
+{
+    m_Stamp++;
+
+    //stamp and wake everything within radius of center tile
+    for(int i = m_CenterTile.Y - m_Radius; i <= m_CenterTile.Y + m_Radius; i++)
+    {
+        if(i < 0 || i >= TILE_ROWS) continue;
+
+        for(int n = m_CenterTile.X - m_Radius; n <= m_CenterTile.X + m_Radius; n++)
+        {
+            if(n < 0 || n >= TILE_COLS) continue;
+
+            std::vector<int> *tlist = &m_TileEntities[i*TILE_COLS + n];
+            for(int k = 0; k < int(tlist->size()); k++)
+            {
+                int eindex = (*tlist)[k];
+                m_Entities[eindex].stamp = m_Stamp;
+                if(!m_Entities[eindex].active) wake(eindex, now);
+            }
+        }
+    }
+
+    //anything active that was not stamped has left the radius
+    for(int i = 0; i < int(m_Active.size()); )
+    {
+        int eindex = m_Active[i];
+        if(m_Entities[eindex].stamp != m_Stamp)
+        {
+            m_Active[i] = m_Active.back();
+            m_Entities[m_Active[i]].activeIndex = i;
+            m_Active.pop_back();
+            hibernate(eindex, now);
+        }
+        else i++;
+    }
+
+    if(m_UpdateCursor >= int(m_Active.size())) m_UpdateCursor = 0;
+
+    m_NeedsRefresh = false;
+}
+
+void EntityScheduler::tick(u32 now, vector2di centertile)
+{
+    m_WokenThisTick = 0;
+    m_HibernatedThisTick = 0;
+    m_UpdatedThisTick = 0;
+
+    //active set only changes when center moves to a new tile (or settings/entities changed)
+    if(centertile != m_CenterTile || m_NeedsRefresh)
+    {
+        m_CenterTile = centertile;
+        refreshActiveSet(now);
+    }
+
+    if(m_Active.empty() || m_Client == NULL || !m_Client->hasEntityUpdates()) return;
+
+    //update active entities round robin until budget is used up
+    //entities not reached this tick get a larger dt next time
+    unsigned long long starttime = getMicroseconds();
+    int activecount = int(m_Active.size());
+
+    for(int i = 0; i < activecount; i++)
+    {
+        if(m_UpdateCursor >= activecount) m_UpdateCursor = 0;
+
+        SchedulerEntity *tentity = &m_Entities[m_Active[m_UpdateCursor]];
+        m_Client->onEntityUpdate(tentity->handle, tentity->tile, now - tentity->lastTime);
+        tentity->lastTime = now;
+
+        m_UpdateCursor++;
+        m_UpdatedThisTick++;
+
+        if(getMicroseconds() - starttime >= m_Budget)
+        {
+            if(m_UpdatedThisTick < activecount) m_BudgetOverruns++;
+            break;
+        }
+    }
+}
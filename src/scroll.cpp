@@ -5,12 +5,19 @@ Scroll::Scroll(Game *ngame)
 {
     //link references
     gptr = ngame;
-    m_FontNormal = gptr->getNormalFont();
 
     m_ScrollEdgeState = 0;
     m_ScrollStartIndex = 0;
+    m_Dirty = true;
+
+    //all message slots up front
+    m_MsgBuffer.resize(SCROLL_HISTORY);
+    m_MsgHead = 0;
+    m_MsgCount = 0;
 
     m_InputModeString = NULL;
+    m_InputRun.count = 0;
+    m_InputRun.width = 0;
     m_CursorGraphic = NULL;
 
     m_ScrollRect = rect<s32>(position2d<s32>(SCROLL_POS), dimension2d<u32>(SCROLL_DIM) );
@@ -36,14 +43,16 @@ bool Scroll::startInputMode(std::string *tstring, std::string promptstr)
 
     //get reference to target string, where input is going to be stored
     m_InputModeString = tstring;
+    m_InputRun.count = 0;
+    m_InputRun.width = 0;
 
     //draw prompt
     addMessage(promptstr, FONT_NORMAL);
 
     //create cursor graphic from current prompt font and color
-    UWFont *tfont = m_MsgBuffer.back().font;
+    UWFont *tfont = getLastMessage()->font;
     IImage *newimg = gptr->getDriver()->createImage(ECF_A1R5G5B5, dimension2d<u32>(tfont->m_WidestCharacter, tfont->m_Height ));
-    newimg->fill(m_MsgBuffer.back().color);
+    newimg->fill(getLastMessage()->color);
     m_CursorGraphic = gptr->getDriver()->addTexture( "temp", newimg );
     newimg->drop();
 
@@ -70,13 +79,16 @@ void Scroll::endInputMode()
     gptr->setInputContext( gptr->getPreviousInputContext());
 
     //add string to message buf (assumes last message was for prompt)
-    m_MsgBuffer.back().msg += *m_InputModeString;
+    ScrollMessage *lastmsg = getLastMessage();
+    lastmsg->msg += *m_InputModeString;
+    shapeString(lastmsg->font, lastmsg->msg, &lastmsg->run);
 
     //send string to console parser
     gptr->sendToConsole(*m_InputModeString);
 
     //copy input string and delete dynamic
     m_InputModeString = NULL;
+    m_Dirty = true;
 }
 
 void Scroll::addInputCharacter(int cval)
@@ -109,6 +121,22 @@ void Scroll::addInputCharacter(int cval)
         //remove character
         if(m_InputModeString->length() > 0) m_InputModeString->resize( m_InputModeString->length()-1);
         break;
+    case KEY_TAB:
+        //complete console command, candidates are listed above the prompt
+        {
+            std::vector<std::string> matches;
+            if(gptr->completeConsoleInput(m_InputModeString, &matches) > 1)
+            {
+                std::string matchlist;
+                for(int i = 0; i < int(matches.size()); i++) matchlist += matches[i] + " ";
+
+                std::string promptstr = getLastMessage()->msg;
+                m_MsgCount--;
+                addMessage(matchlist);
+                addMessage(promptstr, FONT_NORMAL);
+            }
+        }
+        break;
     default:
         //ignore everything else below the space character (32)
         //add character to string
@@ -116,176 +144,170 @@ void Scroll::addInputCharacter(int cval)
         break;
     }
 
+    //input string may be gone if input mode ended
+    if(m_InputModeString != NULL) shapeString(getLastMessage()->font, *m_InputModeString, &m_InputRun);
+    m_Dirty = true;
+
 }
 
-void Scroll::draw()
+void Scroll::draw(const rect<s32> *cliprect)
 {
-    //update scroll edges using modulus of start index
-    m_ScrollEdgeState = abs(m_ScrollStartIndex) % 5;
+    PROFILE_SCOPE("Scroll::draw");
 
-    //if start index is too far up or down, adjust
-    if(m_ScrollStartIndex < -4) m_ScrollStartIndex = -4;
-    else if(m_ScrollStartIndex >= int(m_MsgBuffer.size()) && !m_MsgBuffer.empty() ) m_ScrollStartIndex = int(m_MsgBuffer.size()-1);
+    //all visible lines go into one batch, runs were shaped when added
+    m_TextBatch.begin(cliprect);
 
-    for(int i = 0; i < 5; i++)
+    for(int i = 0; i < SCROLL_LINES; i++)
     {
+        int msgindex = i + m_ScrollStartIndex;
+
+        //if i and scroll start index are valid
+        if(msgindex < 0 || msgindex >= m_MsgCount) continue;
+
+        const ScrollMessage *tmsg = getMessage(msgindex);
+
         //determine where to draw message
         position2d<s32> mpos = m_ScrollRect.UpperLeftCorner;
+        mpos.Y += tmsg->font->m_Height * i;
 
-        //if i and scroll start index are valid
-        if(i + m_ScrollStartIndex >= 0 && i + m_ScrollStartIndex < int(m_MsgBuffer.size()) )
+        //draw message
+        m_TextBatch.addRun(tmsg->font, tmsg->run, mpos, tmsg->color);
+
+        //if it's the last message, and in input mode, draw input string after the message
+        if(msgindex == m_MsgCount-1 && m_InputModeString != NULL)
         {
-            mpos.Y += m_MsgBuffer[i + m_ScrollStartIndex].font->m_Height * i;
+            m_TextBatch.addRun(tmsg->font, m_InputRun, position2d<s32>(mpos.X + tmsg->run.width, mpos.Y), tmsg->color);
+        }
+    }
 
-            //draw message
-            drawFontString(m_MsgBuffer[i + m_ScrollStartIndex].font,
-                           m_MsgBuffer[i + m_ScrollStartIndex].msg,
-                           mpos,
-                           m_MsgBuffer[i + m_ScrollStartIndex].color );
+    m_TextBatch.end(gptr->getDriver());
+}
 
-            //if it's the last message, and in input mode, draw input string
-            if(i + m_ScrollStartIndex == int(m_MsgBuffer.size())-1 && gptr->getInputContext() == IMODE_SCROLL_ENTRY)
-            {
-                //if input mode string is not null
-                if(m_InputModeString != NULL)
-                {
-                    //draw message again but attach input mode string
-                    drawFontString(m_MsgBuffer[i + m_ScrollStartIndex].font,
-                                   m_MsgBuffer[i + m_ScrollStartIndex].msg + *m_InputModeString,
-                                   mpos,
-                                   m_MsgBuffer[i + m_ScrollStartIndex].color );
-
-                    //draw a cursor
-                    if(m_CursorGraphic != NULL && m_CursorTimer.getElapsedTime() < SCROLL_CURSOR_BLINK)
-                    {
-                        //get width of message
-                        int msgwidth = getStringWidth(m_MsgBuffer[i + m_ScrollStartIndex].font,  std::string(m_MsgBuffer[i+m_ScrollStartIndex].msg + *m_InputModeString) );
-                        gptr->getDriver()->draw2DImage( m_CursorGraphic, position2d<s32>(mpos.X + msgwidth, mpos.Y ));
-                    }
-                    if(m_CursorTimer.getElapsedTime() >= SCROLL_CURSOR_BLINK*2) m_CursorTimer.reset();
-
-                }
-
-            }//end of input mode drawing
-        }
+void Scroll::drawCursor()
+{
+    if(m_InputModeString == NULL || m_CursorGraphic == NULL || m_MsgCount == 0) return;
+    if(gptr->getInputContext() != IMODE_SCROLL_ENTRY) return;
+
+    //input is always on the last message, find its line in the window
+    int line = m_MsgCount-1 - m_ScrollStartIndex;
+    if(line < 0 || line >= SCROLL_LINES) return;
+
+    const ScrollMessage *tmsg = getLastMessage();
+
+    if(m_CursorTimer.getElapsedTime() < SCROLL_CURSOR_BLINK)
+    {
+        int msgwidth = tmsg->run.width + m_InputRun.width;
+        position2d<s32> mpos = m_ScrollRect.UpperLeftCorner + position2d<s32>(msgwidth, tmsg->font->m_Height * line);
 
+        gptr->getDriver()->draw2DImage( m_CursorGraphic, mpos);
     }
+    if(m_CursorTimer.getElapsedTime() >= SCROLL_CURSOR_BLINK*2) m_CursorTimer.reset();
 }
 
-void Scroll::addMessage(std::string msgstring, int fonttype, SColor fcolor)
+void Scroll::pushLine(const std::string &msgstring, int start, int end, UWFont *font, SColor fcolor)
 {
-    UWFont *font = NULL;
+    ScrollMessage *newmsg = NULL;
 
-    switch(fonttype)
+    //when full, the oldest slot is reused and everything shifts down one index
+    if(m_MsgCount < SCROLL_HISTORY)
     {
-    case FONT_NORMAL:
-        font = m_FontNormal;
-        break;
-    default:
-        font = m_FontNormal;
-        break;
+        m_MsgCount++;
+        newmsg = getLastMessage();
+    }
+    else
+    {
+        newmsg = getMessage(0);
+        m_MsgHead = (m_MsgHead + 1) % SCROLL_HISTORY;
+        m_ScrollStartIndex--;
     }
 
-    //if message is too long for scroll window, break off at closest space and create new message
-    int maxwidth = m_ScrollRect.getWidth();
+    //assign keeps the slot's string storage
+    newmsg->msg.assign(msgstring, start, end - start);
+    newmsg->color = fcolor;
+    newmsg->font = font;
+    shapeString(font, newmsg->msg, &newmsg->run);
+}
+
+void Scroll::updateScrollState()
+{
+    //if start index is too far up or down, adjust
+    if(m_ScrollStartIndex < -(SCROLL_LINES-1)) m_ScrollStartIndex = -(SCROLL_LINES-1);
+    else if(m_ScrollStartIndex >= m_MsgCount && m_MsgCount) m_ScrollStartIndex = m_MsgCount-1;
+
+    //update scroll edges using modulus of start index
+    m_ScrollEdgeState = abs(m_ScrollStartIndex) % 5;
+
+    m_Dirty = true;
+}
+
+void Scroll::scroll(int lines)
+{
+    if(lines == 0) return;
 
-    //container for substrings
-    std::vector<std::string> substrings;
+    m_ScrollStartIndex += lines;
 
-    //working string
-    std::string wstring = msgstring;
+    //can't scroll past the newest messages
+    if(m_ScrollStartIndex > m_MsgCount - SCROLL_LINES) m_ScrollStartIndex = m_MsgCount - SCROLL_LINES;
+
+    updateScrollState();
+}
 
-    int curpos = 0;
+void Scroll::addMessage(std::string msgstring, int fonttype, SColor fcolor)
+{
+    //unknown or missing fonts fall back to the normal font
+    UWFont *font = gptr->getFont(fonttype);
+
+    //if message is too long for scroll window, break off at closest space and create new message
+    int maxwidth = m_ScrollRect.getWidth();
+
+    int linestart = 0;
+    int lastspace = -1;
     int curwidth = 0;
 
-    //check each character and calculate current message position ,checking to see if it exceeds width
-    bool endofstring = false;
-    while(!endofstring)
+    //check each character once, accumulating current line width
+    for(int i = 0; i < int(msgstring.length()); i++)
     {
-        int charval = int(wstring[curpos]);
+        int charval = int(msgstring[i]);
 
         //only process recognized characters
-        if(charval >= 0 && charval < font->m_Count )
-        {
-            //advance current width by character width
-            curwidth += font->m_Clips[charval].getWidth();
+        if(charval < 0 || charval >= font->m_Count || charval >= int(font->m_Clips.size()) ) continue;
 
-            //if current position exceeds scroll window length
-            if(curwidth >= maxwidth)
-            {
-                //capture current widths, positions, and values
-                int retroval = charval;
-                int retropos = curpos;
-
-                //back up until a space is found or beginning of string is found
-                while(retroval != 32 && retropos > 0)
-                {
-                    //subtract width
-                    curwidth -= font->m_Clips[retroval].getWidth();
-
-                    //move back one character
-                    retropos--;
-
-                    //as long as position is valid
-                    if(retropos >= 0)
-                    {
-                        //get character value at retro position
-                        retroval = int(wstring[retropos]);
-                    }
-                }
-
-                //did the string run all the way to the front?
-                if(retropos == 0)
-                {
-                    //since no space could be found, just shear off string at max width
-                    substrings.push_back( wstring.substr(0, curpos-1));
-                    wstring = wstring.substr(curpos);
-                }
-                //else found a space
-                else
-                {
-                    substrings.push_back( wstring.substr(0, retropos));
-                    wstring = wstring.substr(retropos+1);
-                }
-
-                //reset position and width
-                curpos = 0;
-                curwidth = 0;
+        int charwidth = font->m_Clips[charval].getWidth();
 
+        //if current position exceeds scroll window length
+        if(curwidth + charwidth >= maxwidth && i > linestart)
+        {
+            //break at the last space, or shear off at max width if there is none
+            if(lastspace > linestart)
+            {
+                pushLine(msgstring, linestart, lastspace, font, fcolor);
+                linestart = lastspace + 1;
             }
-            //else, advance
             else
             {
-                curpos++;
+                pushLine(msgstring, linestart, i, font, fcolor);
+                linestart = i;
             }
-        }
-        //else advance
-        else
-        {
-            curpos++;
-        }
+            lastspace = -1;
 
-        //if current position has reached end of working string
-        if(curpos >= int(wstring.length()) )
-        {
-            endofstring = true;
+            //width of whatever carried over to the new line
+            curwidth = 0;
+            for(int n = linestart; n < i; n++)
+            {
+                int carryval = int(msgstring[n]);
+                if(carryval >= 0 && carryval < font->m_Count && carryval < int(font->m_Clips.size()) ) curwidth += font->m_Clips[carryval].getWidth();
+            }
         }
-    }
 
-    //push working string into string container
-    substrings.push_back(wstring);
-
-    //create one or more messages from string container
-    for(int i = 0; i < int(substrings.size()); i++)
-    {
-        //create scroll message
-        ScrollMessage newmsg;
-        newmsg.msg = substrings[i];
-        newmsg.color = fcolor;
-        newmsg.font = font;
-        m_MsgBuffer.push_back(newmsg);
+        if(charval == 32) lastspace = i;
+        curwidth += charwidth;
     }
 
+    //rest of string is the last line
+    pushLine(msgstring, linestart, int(msgstring.length()), font, fcolor);
+
     //reposition scroll window message index if necessary
-    if(m_ScrollStartIndex < int(m_MsgBuffer.size())-5) m_ScrollStartIndex = m_MsgBuffer.size()-5;
+    if(m_ScrollStartIndex < m_MsgCount - SCROLL_LINES) m_ScrollStartIndex = m_MsgCount - SCROLL_LINES;
+
+    updateScrollState();
 }
@@ -0,0 +1,90 @@
+#include "shading.hpp"
+
+#include <iostream>
+
+#include "tools.hpp"
+#include "game.hpp"
+
+ShadeTable::ShadeTable()
+{
+    for(int i = 0; i < SHADE_LEVELS; i++) m_Intensities[i] = u8(255 - i*255/(SHADE_LEVELS-1));
+}
+
+ShadeTable::~ShadeTable()
+{
+
+}
+
+int ShadeTable::load(std::string tpath)
+{
+    std::vector<unsigned char> fdata;
+
+    //light.dat, 16 blocks of 256 palette indices
+    if(!readFile(tpath + "light.dat", &fdata)) return -1; // error unable to read file
+    if(int(fdata.size()) < SHADE_LEVELS*256) return -2; // error file too short
+
+    m_LightMaps.resize(SHADE_LEVELS);
+    for(int i = 0; i < SHADE_LEVELS; i++) m_LightMaps[i].assign(fdata.begin() + i*256, fdata.begin() + (i+1)*256);
+
+    //shades.dat, one entry per light level
+    if(!readFile(tpath + "shades.dat", &fdata)) return -3; // error unable to read file
+    int entrycount = int(fdata.size()) / SHADE_ENTRY_SIZE;
+    if(entrycount <= 0) return -4; // error no entries
+
+    m_Entries.resize(entrycount);
+    for(int i = 0; i < entrycount; i++)
+    {
+        unsigned char *tdata = &fdata[i*SHADE_ENTRY_SIZE];
+
+        m_Entries[i].range = lsbSum(tdata, 2);
+        for(int n = 0; n < 5; n++) m_Entries[i].unknown[n] = int(s16(lsbSum(tdata + 2 + n*2, 2)));
+
+        if(m_Entries[i].range <= 0) m_Entries[i].range = 1;
+    }
+
+    return 0;
+}
+
+f32 ShadeTable::getRange(int lightlevel)
+{
+    if(lightlevel < 0 || lightlevel >= int(m_Entries.size())) return 0.f;
+
+    return f32(m_Entries[lightlevel].range) * UNIT_SCALE / SHADE_UNITS_PER_TILE;
+}
+
+void ShadeTable::computeIntensities(const std::vector<SColor> &tpalette)
+{
+    if(int(m_LightMaps.size()) != SHADE_LEVELS || tpalette.size() < 256) return;
+
+    //brightness of every shaded entry against the entry itself, summed over the palette
+    u32 basesum = 0;
+    for(int i = 0; i < 256; i++) basesum += tpalette[i].getRed() + tpalette[i].getGreen() + tpalette[i].getBlue();
+    if(basesum == 0) return;
+
+    for(int n = 0; n < SHADE_LEVELS; n++)
+    {
+        u32 shadesum = 0;
+        for(int i = 0; i < 256; i++)
+        {
+            const SColor &tcolor = tpalette[m_LightMaps[n][i]];
+            shadesum += tcolor.getRed() + tcolor.getGreen() + tcolor.getBlue();
+        }
+
+        m_Intensities[n] = u8(core::min_(shadesum*255/basesum, u32(255)));
+    }
+}
+
+int ShadeTable::getShadeLevel(f32 distance, f32 range)
+{
+    if(range <= 0.f) return 0;
+
+    f32 tshade = core::clamp(distance/range, 0.f, 1.f);
+    return int(tshade*(SHADE_LEVELS-1) + 0.5f);
+}
+
+SColor ShadeTable::getShadeColor(f32 distance, f32 range)
+{
+    u8 tlevel = m_Intensities[getShadeLevel(distance, range)];
+
+    return SColor(255, tlevel, tlevel, tlevel);
+}
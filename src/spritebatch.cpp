@@ -0,0 +1,371 @@
+#include "spritebatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//back to front over the whole list so alpha blends correctly, texture only breaks ties.
+//render merges neighbouring items that share a page into one draw call
+static bool spriteDrawItemCompare(const SpriteDrawItem &a, const SpriteDrawItem &b)
+{
+    if(a.distance != b.distance) return a.distance > b.distance;
+    return a.texture < b.texture;
+}
+
+SpriteBatch::SpriteBatch(ISceneNode *parent, ISceneManager *mgr, s32 id, f32 chunksize, int chunksx, int chunksz)
+    : ISceneNode(parent, mgr, id)
+{
+    m_ChunkSize = chunksize;
+    m_ChunksX = chunksx;
+    m_ChunksZ = chunksz;
+    m_Chunks.resize(m_ChunksX * m_ChunksZ);
+    m_ShadeTable = NULL;
+    m_ShadeRange = 0.f;
+
+    //allocate all storage up front
+    m_Sprites.resize(SPRITEBATCH_MAX_SPRITES);
+    m_FreeSprites.reserve(SPRITEBATCH_MAX_SPRITES);
+    m_DrawList.reserve(SPRITEBATCH_MAX_SPRITES);
+    m_Vertices.resize(SPRITEBATCH_MAX_SPRITES * 4);
+
+    //index pattern is the same for every quad, so build it once
+    m_Indices.resize(SPRITEBATCH_MAX_SPRITES * 6);
+    for(int i = 0; i < SPRITEBATCH_MAX_SPRITES; i++)
+    {
+        m_Indices[i*6 + 0] = u16(i*4 + 0);
+        m_Indices[i*6 + 1] = u16(i*4 + 2);
+        m_Indices[i*6 + 2] = u16(i*4 + 1);
+        m_Indices[i*6 + 3] = u16(i*4 + 0);
+        m_Indices[i*6 + 4] = u16(i*4 + 3);
+        m_Indices[i*6 + 5] = u16(i*4 + 2);
+    }
+
+    //sprites are culled per chunk
+    setAutomaticCulling(EAC_OFF);
+
+    clear();
+}
+
+SpriteBatch::~SpriteBatch()
+{
+
+}
+
+void SpriteBatch::clear()
+{
+    m_FreeSprites.clear();
+    for(int i = SPRITEBATCH_MAX_SPRITES-1; i >= 0; i--)
+    {
+        m_Sprites[i].used = false;
+        m_Sprites[i].chunk = -1;
+        m_FreeSprites.push_back(i);
+    }
+    m_SpriteCount = 0;
+
+    for(int i = 0; i < int(m_Chunks.size()); i++)
+    {
+        m_Chunks[i].sprites.clear();
+        m_Chunks[i].hasbox = false;
+    }
+
+    m_Box.reset(0,0,0);
+
+    m_DrawnCount = 0;
+    m_BatchCount = 0;
+    m_VisibleChunks = 0;
+}
+
+int SpriteBatch::getChunkIndex(const vector3df &tpos)
+{
+    int cx = int(tpos.X / m_ChunkSize);
+    int cz = int(tpos.Z / m_ChunkSize);
+
+    if(cx < 0) cx = 0;
+    else if(cx >= m_ChunksX) cx = m_ChunksX-1;
+    if(cz < 0) cz = 0;
+    else if(cz >= m_ChunksZ) cz = m_ChunksZ-1;
+
+    return cz*m_ChunksX + cx;
+}
+
+void SpriteBatch::addToChunk(int spriteid)
+{
+    Sprite *tsprite = &m_Sprites[spriteid];
+    tsprite->chunk = getChunkIndex(tsprite->position);
+
+    SpriteChunk *tchunk = &m_Chunks[tsprite->chunk];
+    tchunk->sprites.push_back(spriteid);
+
+    //grow chunk box to contain sprite, using largest extent so any facing fits
+    f32 extent = std::max(tsprite->size.Width, tsprite->size.Height) * 0.5f;
+    aabbox3d<f32> sbox(tsprite->position - vector3df(extent, extent, extent), tsprite->position + vector3df(extent, extent, extent));
+
+    if(!tchunk->hasbox)
+    {
+        tchunk->box = sbox;
+        tchunk->hasbox = true;
+    }
+    else tchunk->box.addInternalBox(sbox);
+}
+
+void SpriteBatch::removeFromChunk(int spriteid)
+{
+    Sprite *tsprite = &m_Sprites[spriteid];
+    if(tsprite->chunk < 0) return;
+
+    SpriteChunk *tchunk = &m_Chunks[tsprite->chunk];
+    for(int i = 0; i < int(tchunk->sprites.size()); i++)
+    {
+        if(tchunk->sprites[i] == spriteid)
+        {
+            tchunk->sprites[i] = tchunk->sprites.back();
+            tchunk->sprites.pop_back();
+            break;
+        }
+    }
+
+    //chunk box only shrinks once the chunk is empty
+    if(tchunk->sprites.empty()) tchunk->hasbox = false;
+
+    tsprite->chunk = -1;
+}
+
+void SpriteBatch::updateBoundingBox()
+{
+    bool first = true;
+
+    for(int i = 0; i < int(m_Chunks.size()); i++)
+    {
+        if(!m_Chunks[i].hasbox) continue;
+
+        if(first)
+        {
+            m_Box = m_Chunks[i].box;
+            first = false;
+        }
+        else m_Box.addInternalBox(m_Chunks[i].box);
+    }
+
+    if(first) m_Box.reset(0,0,0);
+}
+
+int SpriteBatch::addSprite(vector3df tpos, dimension2d<f32> tsize, ITexture *ttexture, u32 tuserdata, rect<f32> tuvrect)
+{
+    if(m_FreeSprites.empty())
+    {
+        std::cout << "Error adding sprite, sprite batch is full!\n";
+        return SPRITEBATCH_NONE;
+    }
+
+    int spriteid = m_FreeSprites.back();
+    m_FreeSprites.pop_back();
+
+    Sprite *tsprite = &m_Sprites[spriteid];
+    tsprite->used = true;
+    tsprite->position = tpos;
+    tsprite->size = tsize;
+    tsprite->texture = ttexture;
+    tsprite->uvrect = tuvrect;
+    tsprite->userdata = tuserdata;
+
+    addToChunk(spriteid);
+    updateBoundingBox();
+    m_SpriteCount++;
+
+    return spriteid;
+}
+
+bool SpriteBatch::updateSprite(int spriteid, vector3df tpos, dimension2d<f32> tsize, ITexture *ttexture, rect<f32> tuvrect)
+{
+    if(spriteid < 0 || spriteid >= SPRITEBATCH_MAX_SPRITES) return false;
+    if(!m_Sprites[spriteid].used) return false;
+
+    removeFromChunk(spriteid);
+
+    Sprite *tsprite = &m_Sprites[spriteid];
+    tsprite->position = tpos;
+    tsprite->size = tsize;
+    tsprite->texture = ttexture;
+    tsprite->uvrect = tuvrect;
+
+    addToChunk(spriteid);
+    updateBoundingBox();
+
+    return true;
+}
+
+bool SpriteBatch::removeSprite(int spriteid)
+{
+    if(spriteid < 0 || spriteid >= SPRITEBATCH_MAX_SPRITES) return false;
+    if(!m_Sprites[spriteid].used) return false;
+
+    removeFromChunk(spriteid);
+
+    m_Sprites[spriteid].used = false;
+    m_FreeSprites.push_back(spriteid);
+    m_SpriteCount--;
+
+    return true;
+}
+
+const Sprite *SpriteBatch::getSprite(int spriteid)
+{
+    if(spriteid < 0 || spriteid >= SPRITEBATCH_MAX_SPRITES) return NULL;
+    if(!m_Sprites[spriteid].used) return NULL;
+
+    return &m_Sprites[spriteid];
+}
+
+int SpriteBatch::pick(const line3df &ray)
+{
+    int closest = SPRITEBATCH_NONE;
+    f32 closestdist = 0;
+
+    for(int i = 0; i < int(m_Chunks.size()); i++)
+    {
+        SpriteChunk *tchunk = &m_Chunks[i];
+        if(!tchunk->hasbox) continue;
+        if(!tchunk->box.intersectsWithLine(ray)) continue;
+
+        for(int n = 0; n < int(tchunk->sprites.size()); n++)
+        {
+            const Sprite *tsprite = &m_Sprites[tchunk->sprites[n]];
+
+            //test against sprite box, same as picking a billboard by its bounding box
+            f32 extent = std::max(tsprite->size.Width, tsprite->size.Height) * 0.5f;
+            aabbox3d<f32> sbox(tsprite->position - vector3df(extent, extent, extent), tsprite->position + vector3df(extent, extent, extent));
+            if(!sbox.intersectsWithLine(ray)) continue;
+
+            f32 tdist = tsprite->position.getDistanceFromSQ(ray.start);
+            if(closest == SPRITEBATCH_NONE || tdist < closestdist)
+            {
+                closest = tchunk->sprites[n];
+                closestdist = tdist;
+            }
+        }
+    }
+
+    return closest;
+}
+
+void SpriteBatch::OnRegisterSceneNode()
+{
+    if(IsVisible && m_SpriteCount > 0) SceneManager->registerNodeForRendering(this, ESNRP_TRANSPARENT);
+
+    ISceneNode::OnRegisterSceneNode();
+}
+
+void SpriteBatch::gatherVisible(const SViewFrustum *frustum, const vector3df &campos)
+{
+    m_DrawList.clear();
+    m_VisibleChunks = 0;
+
+    for(int i = 0; i < int(m_Chunks.size()); i++)
+    {
+        SpriteChunk *tchunk = &m_Chunks[i];
+        if(!tchunk->hasbox) continue;
+
+        //chunk is culled if it is fully outside any frustum plane
+        bool visible = true;
+        for(int p = 0; p < SViewFrustum::VF_PLANE_COUNT; p++)
+        {
+            if(tchunk->box.classifyPlaneRelation(frustum->planes[p]) == ISREL3D_FRONT)
+            {
+                visible = false;
+                break;
+            }
+        }
+        if(!visible) continue;
+
+        m_VisibleChunks++;
+
+        for(int n = 0; n < int(tchunk->sprites.size()); n++)
+        {
+            SpriteDrawItem titem;
+            titem.sprite = tchunk->sprites[n];
+            titem.texture = m_Sprites[titem.sprite].texture;
+            titem.distance = m_Sprites[titem.sprite].position.getDistanceFromSQ(campos);
+            m_DrawList.push_back(titem);
+        }
+    }
+
+    std::sort(m_DrawList.begin(), m_DrawList.end(), spriteDrawItemCompare);
+}
+
+void SpriteBatch::render()
+{
+    m_DrawnCount = 0;
+    m_BatchCount = 0;
+
+    IVideoDriver *driver = SceneManager->getVideoDriver();
+    ICameraSceneNode *camera = SceneManager->getActiveCamera();
+    if(driver == NULL || camera == NULL) return;
+
+    vector3df campos = camera->getAbsolutePosition();
+    gatherVisible(camera->getViewFrustum(), campos);
+    if(m_DrawList.empty()) return;
+
+    //facing vectors are the same for all sprites this frame
+    vector3df view = camera->getTarget() - campos;
+    view.normalize();
+    vector3df horizontal = camera->getUpVector().crossProduct(view);
+    if(horizontal.getLength() == 0) horizontal.set(camera->getUpVector().Y, camera->getUpVector().X, camera->getUpVector().Z);
+    horizontal.normalize();
+    vector3df vertical = horizontal.crossProduct(view);
+    vertical.normalize();
+    vector3df normal = -view;
+
+    //build all quads into vertex buffer
+    for(int i = 0; i < int(m_DrawList.size()); i++)
+    {
+        const Sprite *tsprite = &m_Sprites[m_DrawList[i].sprite];
+        vector3df h = horizontal * (0.5f * tsprite->size.Width);
+        vector3df v = vertical * (0.5f * tsprite->size.Height);
+        const rect<f32> *uv = &tsprite->uvrect;
+        S3DVertex *tvert = &m_Vertices[i*4];
+
+        //whole sprite takes the shade at its center, draw list distances are squared
+        SColor tcolor(255,255,255,255);
+        if(m_ShadeTable != NULL && m_ShadeRange > 0.f) tcolor = m_ShadeTable->getShadeColor(sqrtf(m_DrawList[i].distance), m_ShadeRange);
+
+        tvert[0] = S3DVertex(tsprite->position + h + v, normal, tcolor, vector2df(uv->LowerRightCorner.X, uv->LowerRightCorner.Y));
+        tvert[1] = S3DVertex(tsprite->position + h - v, normal, tcolor, vector2df(uv->LowerRightCorner.X, uv->UpperLeftCorner.Y));
+        tvert[2] = S3DVertex(tsprite->position - h - v, normal, tcolor, vector2df(uv->UpperLeftCorner.X, uv->UpperLeftCorner.Y));
+        tvert[3] = S3DVertex(tsprite->position - h + v, normal, tcolor, vector2df(uv->UpperLeftCorner.X, uv->LowerRightCorner.Y));
+    }
+
+    driver->setTransform(ETS_WORLD, IdentityMatrix);
+
+    //one draw call per run of neighbouring sprites sharing a texture page
+    int runstart = 0;
+    for(int i = 1; i <= int(m_DrawList.size()); i++)
+    {
+        if(i < int(m_DrawList.size()) && m_DrawList[i].texture == m_DrawList[runstart].texture) continue;
+
+        int runcount = i - runstart;
+        m_Material.setTexture(0, m_DrawList[runstart].texture);
+        driver->setMaterial(m_Material);
+        driver->drawIndexedTriangleList(&m_Vertices[runstart*4], runcount*4, &m_Indices[0], runcount*2);
+
+        m_BatchCount++;
+        runstart = i;
+    }
+
+    m_DrawnCount = int(m_DrawList.size());
+
+    //debug boxes
+    if(DebugDataVisible & EDS_BBOX)
+    {
+        SMaterial debugmat;
+        debugmat.Lighting = false;
+        driver->setMaterial(debugmat);
+
+        for(int i = 0; i < int(m_DrawList.size()); i++)
+        {
+            const Sprite *tsprite = &m_Sprites[m_DrawList[i].sprite];
+            f32 extent = std::max(tsprite->size.Width, tsprite->size.Height) * 0.5f;
+            driver->draw3DBox(aabbox3d<f32>(tsprite->position - vector3df(extent, extent, extent), tsprite->position + vector3df(extent, extent, extent)),
+                              SColor(255,255,255,255));
+        }
+    }
+}
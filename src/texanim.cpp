@@ -0,0 +1,181 @@
+#include "texanim.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "tools.hpp"
+
+TextureAnimator::TextureAnimator()
+{
+    m_Driver = NULL;
+    m_Enabled = true;
+    m_UpdateCount = 0;
+}
+
+TextureAnimator::~TextureAnimator()
+{
+
+}
+
+bool TextureAnimator::readSource(TextureAnimGroup *tgroup)
+{
+    ITexture *tsource = tgroup->source;
+
+    void *tdata = tsource->lock(ETLM_READ_ONLY);
+    if(tdata == NULL) return false;
+
+    u32 rowbytes = tgroup->size.Width * tgroup->bytesperpixel;
+    u32 pitch = tsource->getPitch();
+    tgroup->texels.resize(rowbytes * tgroup->size.Height);
+    for(u32 y = 0; y < tgroup->size.Height; y++) memcpy(&tgroup->texels[y*rowbytes], (u8*)(tdata) + y*pitch, rowbytes);
+
+    tsource->unlock();
+
+    return true;
+}
+
+void TextureAnimator::writeTarget(TextureAnimGroup *tgroup)
+{
+    void *tdata = tgroup->target->lock(ETLM_WRITE_ONLY);
+    if(tdata == NULL) return;
+
+    //source row and column wrap around, so each row is at most two copies
+    u32 rowbytes = tgroup->size.Width * tgroup->bytesperpixel;
+    u32 splitbytes = u32(tgroup->offsetx) * tgroup->bytesperpixel;
+    u32 pitch = tgroup->target->getPitch();
+    for(u32 y = 0; y < tgroup->size.Height; y++)
+    {
+        const u8 *srcrow = &tgroup->texels[ ((y + u32(tgroup->offsety)) % tgroup->size.Height) * rowbytes];
+        u8 *dstrow = (u8*)(tdata) + y*pitch;
+
+        memcpy(dstrow, srcrow + splitbytes, rowbytes - splitbytes);
+        memcpy(dstrow + rowbytes - splitbytes, srcrow, splitbytes);
+    }
+
+    tgroup->target->unlock();
+}
+
+int TextureAnimator::addScroll(ITexture *tsource, int scrollx, int scrolly, u32 interval)
+{
+    if(m_Driver == NULL || tsource == NULL) return -1;
+    if(interval == 0) return -2;
+    if(m_GroupBySource.count(tsource)) return 0; // already animated
+
+    ECOLOR_FORMAT tformat = tsource->getColorFormat();
+    if(tformat != ECF_A1R5G5B5 && tformat != ECF_A8R8G8B8) return -3; // error unsupported format
+    if(tsource->getSize() != tsource->getOriginalSize()) return -4; // error driver resized texture
+
+    TextureAnimGroup newgroup;
+    newgroup.source = tsource;
+    newgroup.target = NULL;
+    newgroup.size = tsource->getSize();
+    newgroup.bytesperpixel = IImage::getBitsPerPixelFromFormat(tformat) / 8;
+    newgroup.scrollx = scrollx;
+    newgroup.scrolly = scrolly;
+    newgroup.interval = interval;
+    newgroup.time = 0;
+    newgroup.offsetx = 0;
+    newgroup.offsety = 0;
+
+    if(!readSource(&newgroup)) return -5; // error unable to read source
+
+    //target matches the source, including whether it has mips
+    bool mipflag = m_Driver->getTextureCreationFlag(ETCF_CREATE_MIP_MAPS);
+    m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, tsource->hasMipMaps());
+
+    IImage *timage = m_Driver->createImageFromData(tformat, newgroup.size, &newgroup.texels[0]);
+    std::string tname = std::string(tsource->getName().getPath().c_str()) + "_anim";
+    newgroup.target = m_Driver->addTexture(tname.c_str(), timage);
+    timage->drop();
+
+    m_Driver->setTextureCreationFlag(ETCF_CREATE_MIP_MAPS, mipflag);
+
+    if(newgroup.target == NULL) return -6; // error creating target
+
+    m_GroupBySource[tsource] = int(m_Groups.size());
+    m_Groups.push_back(newgroup);
+
+    return 0;
+}
+
+int TextureAnimator::addTerrainAnimations(std::string tfile, const std::vector<ITexture*> *walls, const std::vector<ITexture*> *floors)
+{
+    if(walls == NULL || floors == NULL) return -1;
+
+    std::vector<unsigned char> fdata;
+    if(!readFile(tfile, &fdata)) return -2; // error unable to read file
+
+    int wordcount = int(fdata.size()) / 2;
+    for(int i = 0; i < wordcount; i++)
+    {
+        int terrain = lsbSum(&fdata[i*2], 2);
+        if(terrain == 0) continue;
+
+        //floors drift sideways, falls run down the wall
+        ITexture *ttexture = NULL;
+        if(i < TERRAIN_FLOOR_OFFSET)
+        {
+            if(i < int(walls->size())) ttexture = (*walls)[i];
+        }
+        else if(i - TERRAIN_FLOOR_OFFSET < int(floors->size())) ttexture = (*floors)[i - TERRAIN_FLOOR_OFFSET];
+        if(ttexture == NULL) continue;
+
+        int errorcode = 0;
+        if(terrain == TERRAIN_WATER) errorcode = addScroll(ttexture, 1, 0, TEXANIM_WATER_INTERVAL);
+        else if(terrain == TERRAIN_LAVA) errorcode = addScroll(ttexture, 1, 0, TEXANIM_LAVA_INTERVAL);
+        else if(terrain == TERRAIN_WATERFALL) errorcode = addScroll(ttexture, 0, -1, TEXANIM_WATER_INTERVAL);
+        else if(terrain == TERRAIN_LAVAFALL) errorcode = addScroll(ttexture, 0, -1, TEXANIM_LAVA_INTERVAL);
+
+        if(errorcode) std::cout << "Error " << errorcode << " animating terrain texture " << i << std::endl;
+    }
+
+    return 0;
+}
+
+ITexture *TextureAnimator::getDisplayTexture(ITexture *tsource)
+{
+    std::map<ITexture*, int>::iterator it = m_GroupBySource.find(tsource);
+    if(it == m_GroupBySource.end()) return tsource;
+
+    return m_Groups[it->second].target;
+}
+
+void TextureAnimator::update(u32 deltams, const std::vector<ITexture*> *remapped)
+{
+    m_UpdateCount = 0;
+
+    for(int i = 0; i < int(m_Groups.size()); i++)
+    {
+        TextureAnimGroup *tgroup = &m_Groups[i];
+
+        //only a remap of this group's own source changes its texels
+        bool changed = remapped != NULL && std::find(remapped->begin(), remapped->end(), tgroup->source) != remapped->end();
+        if(changed) readSource(tgroup);
+
+        //every face using the group shares this offset
+        if(m_Enabled) tgroup->time += deltams;
+        while(tgroup->time >= tgroup->interval)
+        {
+            tgroup->time -= tgroup->interval;
+
+            int w = int(tgroup->size.Width);
+            int h = int(tgroup->size.Height);
+            tgroup->offsetx = ( (tgroup->offsetx + tgroup->scrollx) % w + w) % w;
+            tgroup->offsety = ( (tgroup->offsety + tgroup->scrolly) % h + h) % h;
+            changed = true;
+        }
+
+        if(!changed) continue;
+
+        writeTarget(tgroup);
+        m_UpdateCount++;
+    }
+}
+
+TextureAnimGroup *TextureAnimator::getGroup(int index)
+{
+    if(index < 0 || index >= int(m_Groups.size())) return NULL;
+
+    return &m_Groups[index];
+}
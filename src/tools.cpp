@@ -1,5 +1,7 @@
 #include "tools.hpp"
 
+#include <chrono>
+
 bool readBin(std::ifstream *fptr, unsigned char *data, int length, bool quiet)
 {
     unsigned char *buf = new unsigned char[length];
@@ -38,6 +40,26 @@ bool readBinAt(std::ifstream *fptr, unsigned char *data, int length, std::stream
     return readBin(fptr, data, length, quiet);
 }
 
+bool readFile(std::string tfilename, std::vector<unsigned char> *tdata)
+{
+    if(tdata == NULL) return false;
+
+    std::ifstream ifile;
+    ifile.open(tfilename.c_str(), std::ios_base::binary);
+    if(!ifile.is_open()) return false;
+
+    //determine file size
+    ifile.seekg(0, std::ios::end);
+    std::streamoff fsize = ifile.tellg();
+    ifile.seekg(0);
+    if(fsize < 0) return false;
+
+    tdata->resize(size_t(fsize));
+    if(fsize > 0) ifile.read( (char*)(&(*tdata)[0]), fsize);
+
+    return ifile.gcount() == fsize || fsize == 0;
+}
+
 int lsbSum(unsigned char *bytes, int length)
 {
     int sum = 0;
@@ -134,3 +156,8 @@ irr::core::vector2df projectVectorAontoB(irr::core::vector2df va, irr::core::vec
 
 
 }
+
+unsigned long long getMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
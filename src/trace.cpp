@@ -0,0 +1,197 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "tools.hpp"
+
+Tracer *Tracer::m_Instance = NULL;
+
+//buffer of the calling thread, created by its first event while enabled
+static thread_local TraceBuffer *t_TraceBuffer = NULL;
+//name given before the thread has a buffer
+static thread_local std::string t_TraceThreadName;
+
+Tracer::Tracer()
+{
+    m_Enabled = false;
+    m_StartTime = getMicroseconds();
+}
+
+Tracer::~Tracer()
+{
+    for(int i = 0; i < int(m_Buffers.size()); i++) delete m_Buffers[i];
+    m_Buffers.clear();
+}
+
+TraceBuffer *Tracer::getThreadBuffer()
+{
+    if(t_TraceBuffer != NULL) return t_TraceBuffer;
+
+    TraceBuffer *newbuffer = new TraceBuffer;
+    newbuffer->events.resize(TRACE_BUFFER_EVENTS);
+    newbuffer->count = 0;
+    newbuffer->dropped = 0;
+
+    std::lock_guard<std::mutex> lock(m_BufferLock);
+    newbuffer->threadIndex = int(m_Buffers.size());
+
+    if(t_TraceThreadName.empty())
+    {
+        std::stringstream tname;
+        tname << "thread " << newbuffer->threadIndex;
+        newbuffer->threadName = tname.str();
+    }
+    else newbuffer->threadName = t_TraceThreadName;
+
+    m_Buffers.push_back(newbuffer);
+    t_TraceBuffer = newbuffer;
+
+    return newbuffer;
+}
+
+void Tracer::start()
+{
+    //timeline starts with the first recording
+    if(getEventCount() == 0) m_StartTime = getMicroseconds();
+
+    m_Enabled = true;
+}
+
+void Tracer::stop()
+{
+    m_Enabled = false;
+}
+
+void Tracer::setThreadName(std::string tname)
+{
+    //threads that never trace never get a buffer, the name waits for the first event
+    t_TraceThreadName = tname;
+    if(t_TraceBuffer == NULL) return;
+
+    std::lock_guard<std::mutex> lock(m_BufferLock);
+    t_TraceBuffer->threadName = tname;
+}
+
+void Tracer::addEvent(const char *name, unsigned long long starttime, unsigned long long endtime)
+{
+    TraceBuffer *tbuffer = getThreadBuffer();
+    int tindex = tbuffer->count.load(std::memory_order_relaxed);
+
+    if(tindex >= TRACE_BUFFER_EVENTS)
+    {
+        tbuffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceEvent *tevent = &tbuffer->events[tindex];
+    tevent->name = name;
+    tevent->start = starttime;
+    tevent->end = endtime;
+
+    //publish event to the writer
+    tbuffer->count.store(tindex + 1, std::memory_order_release);
+}
+
+int Tracer::getEventCount()
+{
+    std::lock_guard<std::mutex> lock(m_BufferLock);
+
+    int eventcount = 0;
+    for(int i = 0; i < int(m_Buffers.size()); i++) eventcount += m_Buffers[i]->count.load();
+
+    return eventcount;
+}
+
+int Tracer::getDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(m_BufferLock);
+
+    int droppedcount = 0;
+    for(int i = 0; i < int(m_Buffers.size()); i++) droppedcount += m_Buffers[i]->dropped.load();
+
+    return droppedcount;
+}
+
+//escape string for json output
+static std::string traceString(const char *tstring)
+{
+    std::string jstring("\"");
+
+    for(const char *tchar = tstring; *tchar; tchar++)
+    {
+        if(*tchar == '"' || *tchar == '\\') jstring += '\\';
+        if((unsigned char)(*tchar) >= 0x20) jstring += *tchar;
+    }
+
+    jstring += "\"";
+    return jstring;
+}
+
+bool Tracer::write(std::string tfilename)
+{
+    std::ofstream ofile;
+    ofile.open(tfilename.c_str());
+    if(!ofile.is_open()) return false;
+
+    std::lock_guard<std::mutex> lock(m_BufferLock);
+
+    int eventcount = 0;
+    bool first = true;
+
+    ofile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for(int i = 0; i < int(m_Buffers.size()); i++)
+    {
+        TraceBuffer *tbuffer = m_Buffers[i];
+        int tcount = tbuffer->count.load(std::memory_order_acquire);
+
+        //thread name metadata
+        if(!first) ofile << ",";
+        first = false;
+        ofile << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tbuffer->threadIndex
+              << ",\"args\":{\"name\":" << traceString(tbuffer->threadName.c_str()) << "}}";
+
+        for(int n = 0; n < tcount; n++)
+        {
+            TraceEvent *tevent = &tbuffer->events[n];
+
+            //events from before the trace started are clamped to its start
+            unsigned long long tstart = tevent->start > m_StartTime ? tevent->start - m_StartTime : 0;
+            unsigned long long tend = tevent->end > m_StartTime ? tevent->end - m_StartTime : 0;
+
+            ofile << ",\n{\"name\":" << traceString(tevent->name) << ",\"ph\":\"X\",\"ts\":" << tstart
+                  << ",\"dur\":" << tend - tstart << ",\"pid\":1,\"tid\":" << tbuffer->threadIndex << "}";
+        }
+
+        eventcount += tcount;
+    }
+
+    ofile << "\n]}\n";
+    ofile.close();
+
+    std::cout << "Wrote " << eventcount << " trace events to " << tfilename << std::endl;
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////
+//  SCOPE
+TraceScope::TraceScope(const char *name)
+{
+    m_Name = NULL;
+
+    if(!Tracer::getInstance()->isEnabled()) return;
+
+    m_Name = name;
+    m_Start = getMicroseconds();
+}
+
+TraceScope::~TraceScope()
+{
+    //scope was opened while tracing was disabled
+    if(m_Name == NULL) return;
+
+    Tracer::getInstance()->addEvent(m_Name, m_Start, getMicroseconds());
+}
@@ -0,0 +1,117 @@
+#include "uicompositor.hpp"
+
+#include <iostream>
+
+#include "tools.hpp"
+
+UICompositor::UICompositor()
+{
+    m_Driver = NULL;
+    m_Target = NULL;
+    m_FullRedraw = true;
+
+    m_ComposeCount = 0;
+    m_FullComposeCount = 0;
+    m_LastComposeTime = 0;
+}
+
+UICompositor::~UICompositor()
+{
+    if(m_Target != NULL && m_Driver != NULL) m_Driver->removeTexture(m_Target);
+}
+
+bool UICompositor::init(IVideoDriver *tdriver, dimension2d<u32> tsize)
+{
+    if(tdriver == NULL) return false;
+
+    m_Driver = tdriver;
+    m_Size = tsize;
+
+    if(!m_Driver->queryFeature(EVDF_RENDER_TO_TARGET))
+    {
+        std::cout << "Render targets not supported, main UI is drawn directly\n";
+        return false;
+    }
+
+    m_Target = m_Driver->addRenderTargetTexture(m_Size, "ui_composite", ECF_A8R8G8B8);
+    if(m_Target == NULL)
+    {
+        std::cout << "Error creating main UI render target\n";
+        return false;
+    }
+
+    m_FullRedraw = true;
+
+    return true;
+}
+
+void UICompositor::markDirty(const rect<s32> &trect)
+{
+    if(m_FullRedraw) return;
+
+    //nothing under a transparent area can be partially redrawn
+    for(int i = 0; i < int(m_TransparentRects.size()); i++)
+    {
+        if(m_TransparentRects[i].isRectCollided(trect))
+        {
+            m_FullRedraw = true;
+            return;
+        }
+    }
+
+    //merge with an overlapping rect so no area is drawn twice
+    for(int i = 0; i < int(m_DirtyRects.size()); i++)
+    {
+        if(m_DirtyRects[i].isRectCollided(trect))
+        {
+            m_DirtyRects[i].addInternalPoint(trect.UpperLeftCorner);
+            m_DirtyRects[i].addInternalPoint(trect.LowerRightCorner);
+            return;
+        }
+    }
+
+    if(int(m_DirtyRects.size()) >= UICOMPOSITOR_MAX_DIRTY) m_FullRedraw = true;
+    else m_DirtyRects.push_back(trect);
+}
+
+int UICompositor::compose(std::function<void(const rect<s32> *cliprect)> drawfunc)
+{
+    if(m_Target == NULL || !isDirty()) return 0;
+
+    unsigned long long starttime = getMicroseconds();
+    int areacount = 0;
+
+    if(m_FullRedraw)
+    {
+        m_Driver->setRenderTarget(m_Target, true, false, SColor(0,0,0,0));
+        drawfunc(NULL);
+
+        m_FullComposeCount++;
+        areacount = 1;
+    }
+    else
+    {
+        //old pixels are overwritten by the opaque layers underneath
+        m_Driver->setRenderTarget(m_Target, false, false);
+        for(int i = 0; i < int(m_DirtyRects.size()); i++) drawfunc(&m_DirtyRects[i]);
+
+        areacount = int(m_DirtyRects.size());
+    }
+
+    m_Driver->setRenderTarget(0, false, false);
+
+    m_DirtyRects.clear();
+    m_FullRedraw = false;
+
+    m_ComposeCount++;
+    m_LastComposeTime = getMicroseconds() - starttime;
+
+    return areacount;
+}
+
+void UICompositor::draw()
+{
+    if(m_Target == NULL) return;
+
+    m_Driver->draw2DImage(m_Target, position2d<s32>(0,0), rect<s32>(position2d<s32>(0,0), m_Size), NULL, SColor(255,255,255,255), true);
+}